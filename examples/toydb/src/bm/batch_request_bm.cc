@@ -16,6 +16,9 @@
 
 #include "benchmark/benchmark.h"
 #include "bm/engine_bm_case.h"
+#include "gflags/gflags.h"
+
+DECLARE_int32(toydb_local_tablet_num);
 
 namespace hybridse {
 namespace bm {
@@ -45,6 +48,25 @@ using namespace ::llvm;  // NOLINT
         ->Args({0, 1000, 100})                                                 \
         ->Args({1, 1000, 100});
 
+// subqueries scattered to local tablets, run with HYBRIDSE_CLUSTER=true
+#define DEFINE_BATCH_REQUEST_TABLET_CASE(NAME, PATH, CASE_ID)                 \
+    static void BM_BatchRequestTablets_##NAME(benchmark::State& state) {      \
+        auto sql_case = LoadSqlCaseWithID(PATH, CASE_ID);                     \
+        sql_case.batch_request_optimized_ = true;                             \
+        if (!hybridse::sqlcase::SqlCase::IsDebug()) {                        \
+            sql_case.SqlCaseRepeatConfig("batch_scale", state.range(0));      \
+        }                                                                     \
+        FLAGS_toydb_local_tablet_num = state.range(1);                        \
+        EngineBenchmarkOnCase(sql_case, vm::kBatchRequestMode, &state);       \
+        FLAGS_toydb_local_tablet_num = 1;                                     \
+    }                                                                         \
+    BENCHMARK(BM_BatchRequestTablets_##NAME)                                  \
+        ->ArgNames({"batch_scale", "tablet_num"})                             \
+        ->Args({100, 1})                                                      \
+        ->Args({100, 4})                                                      \
+        ->Args({1000, 1})                                                     \
+        ->Args({1000, 4});
+
 const char* DEFAULT_YAML_PATH = "/cases/benchmark/batch_request_benchmark.yaml";
 
 DEFINE_BATCH_REQUEST_CASE(TwoWindow, DEFAULT_YAML_PATH, "0");
@@ -52,6 +74,8 @@ DEFINE_BATCH_REQUEST_CASE(CommonWindow, DEFAULT_YAML_PATH, "1");
 DEFINE_BATCH_REQUEST_CASE(SelectAll, DEFAULT_YAML_PATH, "2");
 DEFINE_BATCH_REQUEST_CASE(SimpleSelectFromNonCommonJoin, DEFAULT_YAML_PATH,
                           "3");
+DEFINE_BATCH_REQUEST_TABLET_CASE(SimpleSelectFromNonCommonJoin,
+                                 DEFAULT_YAML_PATH, "3");
 
 }  // namespace bm
 }  // namespace hybridse
@@ -149,6 +149,58 @@ static void BM_EngineRunBatchWindowSumFeature5Window5(
     EngineRunBatchWindowSumFeature5Window5(&state, BENCHMARK, state.range(0),
                                            state.range(1));
 }
+static void BM_EngineRunBatchWindowRowsIntAggFeature3(
+    benchmark::State& state) {  // NOLINT
+    EngineRunBatchWindowRowsIntAggFeature3(&state, BENCHMARK, state.range(0),
+                                           state.range(1));
+}
+static void BM_EngineRunBatchWindowRowsMinMaxFeature4(
+    benchmark::State& state) {  // NOLINT
+    EngineRunBatchWindowRowsMinMaxFeature4(&state, BENCHMARK, state.range(0),
+                                          state.range(1));
+}
+static void BM_EngineRunBatchWindowRowsRowAggFeature5(
+    benchmark::State& state) {  // NOLINT
+    EngineRunBatchWindowRowsColumnAggFeature5(&state, BENCHMARK, state.range(0),
+                                              state.range(1), false);
+}
+static void BM_EngineRunBatchWindowRowsColumnAggFeature5(
+    benchmark::State& state) {  // NOLINT
+    EngineRunBatchWindowRowsColumnAggFeature5(&state, BENCHMARK, state.range(0),
+                                              state.range(1), true);
+}
+static void BM_EngineRunBatchWindowRowsRecomputeAggFeature8(
+    benchmark::State& state) {  // NOLINT
+    EngineRunBatchWindowRowsRetractAggFeature8(&state, BENCHMARK,
+                                               state.range(0), state.range(1),
+                                               false);
+}
+static void BM_EngineRunBatchWindowRowsRetractAggFeature8(
+    benchmark::State& state) {  // NOLINT
+    EngineRunBatchWindowRowsRetractAggFeature8(&state, BENCHMARK,
+                                               state.range(0), state.range(1),
+                                               true);
+}
+static void BM_EngineRunBatchWindowSumPartitionByCol6(
+    benchmark::State& state) {  // NOLINT
+    EngineRunBatchWindowSumPartitionByCol6(&state, BENCHMARK, state.range(0),
+                                          state.range(1), false);
+}
+static void BM_EngineRunBatchWindowSumHashPartitionByCol6(
+    benchmark::State& state) {  // NOLINT
+    EngineRunBatchWindowSumPartitionByCol6(&state, BENCHMARK, state.range(0),
+                                          state.range(1), true);
+}
+static void BM_EngineRunBatchWindowSumParallel(
+    benchmark::State& state) {  // NOLINT
+    EngineRunBatchWindowSumParallel(&state, BENCHMARK, state.range(0),
+                                    state.range(1));
+}
+static void BM_EngineRunBatchLastJoinWithoutIndex(
+    benchmark::State& state) {  // NOLINT
+    EngineRunBatchLastJoinWithoutIndex(&state, BENCHMARK, state.range(0),
+                                       state.range(1));
+}
 
 // request engine simple bm
 BENCHMARK(BM_EngineRequestSimpleSelectVarchar);
@@ -275,6 +327,50 @@ BENCHMARK(BM_EngineRunBatchWindowMultiAggWindow25Feature25)
     ->Args({100, 100})
     ->Args({1000, 1000})
     ->Args({10000, 10000});
+BENCHMARK(BM_EngineRunBatchWindowRowsIntAggFeature3)
+    ->Args({100, 100})
+    ->Args({1000, 1000})
+    ->Args({10000, 10000})
+    ->Args({100000, 100000});
+BENCHMARK(BM_EngineRunBatchWindowRowsMinMaxFeature4)
+    ->Args({100, 100})
+    ->Args({1000, 1000})
+    ->Args({10000, 10000})
+    ->Args({100000, 100000});
+BENCHMARK(BM_EngineRunBatchWindowRowsRowAggFeature5)
+    ->Args({1000, 1000})
+    ->Args({10000, 10000})
+    ->Args({100000, 100000});
+BENCHMARK(BM_EngineRunBatchWindowRowsColumnAggFeature5)
+    ->Args({1000, 1000})
+    ->Args({10000, 10000})
+    ->Args({100000, 100000});
+BENCHMARK(BM_EngineRunBatchWindowRowsRecomputeAggFeature8)
+    ->Args({1000, 1000})
+    ->Args({10000, 10000})
+    ->Args({100000, 100000});
+BENCHMARK(BM_EngineRunBatchWindowRowsRetractAggFeature8)
+    ->Args({1000, 1000})
+    ->Args({10000, 10000})
+    ->Args({100000, 100000});
+BENCHMARK(BM_EngineRunBatchWindowSumPartitionByCol6)
+    ->Args({1000, 1000})
+    ->Args({10000, 10000})
+    ->Args({100000, 100000});
+BENCHMARK(BM_EngineRunBatchWindowSumHashPartitionByCol6)
+    ->Args({1000, 1000})
+    ->Args({10000, 10000})
+    ->Args({100000, 100000});
+BENCHMARK(BM_EngineRunBatchWindowSumParallel)
+    ->Args({100000, 1})
+    ->Args({100000, 2})
+    ->Args({100000, 4})
+    ->Args({100000, 8})
+    ->UseRealTime();
+BENCHMARK(BM_EngineRunBatchLastJoinWithoutIndex)
+    ->Args({1000, 1000})
+    ->Args({10000, 10000})
+    ->Args({100000, 100000});
 
 // batch engine window bm exclude current time
 BENCHMARK(BM_EngineRunBatchWindowSumFeature1ExcludeCurrentTime)
@@ -15,6 +15,8 @@
  */
 
 #include "bm/engine_bm_case.h"
+#include <algorithm>
+#include <chrono>  // NOLINT
 #include <map>
 #include <memory>
 #include <string>
@@ -22,6 +24,7 @@
 #include <vector>
 #include "benchmark/benchmark.h"
 #include "codec/type_codec.h"
+#include "gflags/gflags.h"
 #include "gtest/gtest.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
 #include "llvm/IR/Function.h"
@@ -38,6 +41,9 @@
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "tablet/tablet_catalog.h"
 
+DECLARE_bool(enable_window_column_agg);
+DECLARE_bool(enable_incremental_window_agg);
+
 namespace hybridse {
 namespace bm {
 using codec::Row;
@@ -147,13 +153,15 @@ static void EngineRequestMode(const std::string sql, MODE mode,
     }
 }
 
-static void EngineBatchMode(const std::string sql, MODE mode, int64_t limit_cnt,
-                            int64_t size, benchmark::State* state) {
+static void EngineBatchMode(
+    const std::string sql, MODE mode, int64_t limit_cnt, int64_t size,
+    benchmark::State* state,
+    const vm::EngineOptions& options = vm::EngineOptions()) {
     // prepare data into table
     InitializeNativeTarget();
     InitializeNativeTargetAsmPrinter();
     auto catalog = vm::BuildOnePkTableStorage(size);
-    Engine engine(catalog);
+    Engine engine(catalog, options);
     BatchRunSession session;
     base::Status query_status;
     engine.Get(sql, "db", session, query_status);
@@ -180,6 +188,31 @@ static void EngineBatchMode(const std::string sql, MODE mode, int64_t limit_cnt,
         }
     }
 }
+// run batch query over the catalog and return encoded output rows
+static std::vector<std::string> RunBatchRows(
+    std::shared_ptr<tablet::TabletCatalog> catalog, const std::string& sql,
+    const vm::EngineOptions& options) {
+    Engine engine(catalog, options);
+    BatchRunSession session;
+    base::Status query_status;
+    std::vector<std::string> rows;
+    if (!engine.Get(sql, "db", session, query_status)) {
+        ADD_FAILURE() << "fail to compile sql: " << query_status;
+        return rows;
+    }
+    auto res = session.Run(Row());
+    if (!res) {
+        ADD_FAILURE() << "run batch plan output is null";
+        return rows;
+    }
+    auto iter = res->GetIterator();
+    iter->SeekToFirst();
+    while (iter->Valid()) {
+        rows.push_back(iter->GetValue().ToString());
+        iter->Next();
+    }
+    return rows;
+}
 void EngineWindowSumFeature1ExcludeCurrentTime(benchmark::State* state,
                                                MODE mode, int64_t limit_cnt,
                                                int64_t size) {  // NOLINT
@@ -308,6 +341,174 @@ void EngineRunBatchWindowSumFeature5Window5(benchmark::State* state, MODE mode,
         std::to_string(limit_cnt) + ";";
     EngineBatchMode(sql, mode, limit_cnt, size, state);
 }
+void EngineRunBatchWindowRowsIntAggFeature3(benchmark::State* state,
+                                            MODE mode, int64_t limit_cnt,
+                                            int64_t size) {  // NOLINT
+    const std::string sql =
+        "SELECT "
+        "sum(col1) OVER w1 as w1_col1_sum, "
+        "count(col2) OVER w1 as w1_col2_cnt, "
+        "avg(col5) OVER w1 as w1_col5_avg "
+        "FROM t1 WINDOW w1 AS (PARTITION BY col0 ORDER BY col5 ROWS BETWEEN "
+        "1000 PRECEDING AND CURRENT ROW) limit " +
+        std::to_string(limit_cnt) + ";";
+    EngineBatchMode(sql, mode, limit_cnt, size, state);
+}
+void EngineRunBatchWindowRowsMinMaxFeature4(benchmark::State* state,
+                                           MODE mode, int64_t limit_cnt,
+                                           int64_t size) {  // NOLINT
+    const std::string sql =
+        "SELECT "
+        "min(col1) OVER w1 as w1_col1_min, "
+        "max(col1) OVER w1 as w1_col1_max, "
+        "min(col4) OVER w1 as w1_col4_min, "
+        "max(col5) OVER w1 as w1_col5_max "
+        "FROM t1 WINDOW w1 AS (PARTITION BY col0 ORDER BY col5 ROWS BETWEEN "
+        "1000 PRECEDING AND CURRENT ROW) limit " +
+        std::to_string(limit_cnt) + ";";
+    EngineBatchMode(sql, mode, limit_cnt, size, state);
+}
+void EngineRunBatchWindowRowsColumnAggFeature5(benchmark::State* state,
+                                              MODE mode, int64_t limit_cnt,
+                                              int64_t size,
+                                              bool column_agg) {  // NOLINT
+    // aggregations inside expressions iterate the window of 1000 rows on
+    // every row, unless they run on columnar copies of the window
+    const std::string sql =
+        "SELECT "
+        "sum(col1) OVER w1 + 1 as w1_col1_sum, "
+        "count(col2) OVER w1 + 1 as w1_col2_cnt, "
+        "avg(col1) OVER w1 + 1 as w1_col1_avg, "
+        "min(col4) OVER w1 + 1 as w1_col4_min, "
+        "max(col5) OVER w1 + 1 as w1_col5_max "
+        "FROM t1 WINDOW w1 AS (PARTITION BY col0 ORDER BY col5 ROWS BETWEEN "
+        "1000 PRECEDING AND CURRENT ROW) limit " +
+        std::to_string(limit_cnt) + ";";
+    bool origin_column_agg = FLAGS_enable_window_column_agg;
+    if (mode == BENCHMARK) {
+        FLAGS_enable_window_column_agg = column_agg;
+        EngineBatchMode(sql, mode, limit_cnt, size, state);
+        FLAGS_enable_window_column_agg = origin_column_agg;
+        return;
+    }
+    // columnar output is the same as row by row output value by value,
+    // including signs of zero min and max
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+    auto catalog = vm::BuildOnePkTableStorage(size);
+    FLAGS_enable_window_column_agg = false;
+    auto expect_rows = RunBatchRows(catalog, sql, vm::EngineOptions());
+    FLAGS_enable_window_column_agg = column_agg;
+    auto rows = RunBatchRows(catalog, sql, vm::EngineOptions());
+    FLAGS_enable_window_column_agg = origin_column_agg;
+    ASSERT_EQ(static_cast<size_t>(limit_cnt), expect_rows.size());
+    ASSERT_EQ(expect_rows, rows);
+}
+void EngineRunBatchWindowRowsRetractAggFeature8(benchmark::State* state,
+                                               MODE mode, int64_t limit_cnt,
+                                               int64_t size,
+                                               bool incremental) {  // NOLINT
+    // udafs with retract keep their states across rows of window, applying
+    // rows entering and leaving the window only
+    const std::string sql =
+        "SELECT "
+        "sum_where(col1, col2 > 50) OVER w1 as w1_col1_sum_where, "
+        "count_where(col1, col2 > 50) OVER w1 as w1_col1_cnt_where, "
+        "avg_where(col1, col2 > 50) OVER w1 as w1_col1_avg_where, "
+        "count_cate(col1, col2) OVER w1 as w1_col1_cnt_cate, "
+        "sum_cate(col1, col2) OVER w1 as w1_col1_sum_cate, "
+        "avg_cate(col1, col2) OVER w1 as w1_col1_avg_cate, "
+        "sum_cate_where(col1, col2 > 50, col2) OVER w1 as "
+        "w1_col1_sum_cate_where, "
+        "avg_cate_where(col5, col2 > 50, col2) OVER w1 as "
+        "w1_col5_avg_cate_where "
+        "FROM t1 WINDOW w1 AS (PARTITION BY col0 ORDER BY col5 ROWS BETWEEN "
+        "100 PRECEDING AND CURRENT ROW) limit " +
+        std::to_string(limit_cnt) + ";";
+    bool origin_incremental = FLAGS_enable_incremental_window_agg;
+    if (mode == BENCHMARK) {
+        FLAGS_enable_incremental_window_agg = incremental;
+        EngineBatchMode(sql, mode, limit_cnt, size, state);
+        FLAGS_enable_incremental_window_agg = origin_incremental;
+        return;
+    }
+    // incremental output is the same as the output recomputed from the whole
+    // window row by row
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+    auto catalog = vm::BuildOnePkTableStorage(size);
+    FLAGS_enable_incremental_window_agg = false;
+    auto expect_rows = RunBatchRows(catalog, sql, vm::EngineOptions());
+    FLAGS_enable_incremental_window_agg = incremental;
+    auto rows = RunBatchRows(catalog, sql, vm::EngineOptions());
+    FLAGS_enable_incremental_window_agg = origin_incremental;
+    ASSERT_EQ(static_cast<size_t>(limit_cnt), expect_rows.size());
+    ASSERT_EQ(expect_rows, rows);
+}
+void EngineRunBatchWindowSumPartitionByCol6(benchmark::State* state,
+                                           MODE mode, int64_t limit_cnt,
+                                           int64_t size,
+                                           bool hash_partition) {  // NOLINT
+    // col6 is not indexed, input table is partitioned in memory
+    const std::string sql =
+        "SELECT "
+        "sum(col1) OVER w1 as w1_col1_sum "
+        "FROM t1 WINDOW w1 AS (PARTITION BY col6 ORDER BY col5 ROWS BETWEEN "
+        "10 PRECEDING AND CURRENT ROW) limit " +
+        std::to_string(limit_cnt) + ";";
+    vm::EngineOptions options;
+    options.set_enable_hash_partition(hash_partition);
+    EngineBatchMode(sql, mode, limit_cnt, size, state, options);
+}
+void EngineRunBatchWindowSumParallel(benchmark::State* state, MODE mode,
+                                     int64_t size,
+                                     uint32_t worker_num) {  // NOLINT
+    // 100 partition keys of col1, no limit so that keys run in parallel
+    const std::string sql =
+        "SELECT "
+        "sum(col4) OVER w1 as w1_col4_sum "
+        "FROM t1 WINDOW w1 AS (PARTITION BY col1 ORDER BY col5 ROWS_RANGE "
+        "BETWEEN 30d PRECEDING AND CURRENT ROW);";
+    vm::EngineOptions options;
+    options.set_batch_window_agg_worker_num(worker_num);
+    if (mode == BENCHMARK) {
+        EngineBatchMode(sql, mode, size, size, state, options);
+        return;
+    }
+    // parallel output is the same as serial output, row by row if ordered,
+    // or else regardless of order
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+    auto catalog = vm::BuildOnePkTableStorage(size);
+    auto expect_rows = RunBatchRows(catalog, sql, vm::EngineOptions());
+    ASSERT_EQ(static_cast<size_t>(size), expect_rows.size());
+    auto sorted_expect_rows = expect_rows;
+    std::sort(sorted_expect_rows.begin(), sorted_expect_rows.end());
+    for (bool slab_allocator : {false, true}) {
+        for (bool ordered : {true, false}) {
+            options.set_enable_row_slab_allocator(slab_allocator);
+            options.set_enable_batch_window_agg_ordered(ordered);
+            auto rows = RunBatchRows(catalog, sql, options);
+            if (ordered) {
+                ASSERT_EQ(expect_rows, rows);
+            } else {
+                std::sort(rows.begin(), rows.end());
+                ASSERT_EQ(sorted_expect_rows, rows);
+            }
+        }
+    }
+}
+void EngineRunBatchLastJoinWithoutIndex(benchmark::State* state, MODE mode,
+                                        int64_t limit_cnt,
+                                        int64_t size) {  // NOLINT
+    // col6 is not indexed, right table is joined without index
+    const std::string sql =
+        "SELECT t1.col1, t2.col1 as t2_col1 FROM t1 LAST JOIN t1 as t2 "
+        "ORDER BY t2.col5 ON t1.col6 = t2.col6 and t1.col5 >= t2.col5 "
+        "limit " +
+        std::to_string(limit_cnt) + ";";
+    EngineBatchMode(sql, mode, limit_cnt, size, state);
+}
 void EngineRunBatchWindowMultiAggWindow25Feature25(benchmark::State* state,
                                                    MODE mode, int64_t limit_cnt,
                                                    int64_t size) {  // NOLINT
@@ -820,6 +1021,12 @@ void EngineBenchmarkOnCase(const std::string& yaml_path,
 void EngineBenchmarkOnCase(hybridse::sqlcase::SqlCase& sql_case,  // NOLINT
                            vm::EngineMode engine_mode,
                            benchmark::State* state) {
+    EngineBenchmarkOnCase(sql_case, engine_mode, vm::JitOptions(), state);
+}
+void EngineBenchmarkOnCase(hybridse::sqlcase::SqlCase& sql_case,  // NOLINT
+                           vm::EngineMode engine_mode,
+                           const vm::JitOptions& jit_options,
+                           benchmark::State* state) {
     InitializeNativeTarget();
     InitializeNativeTargetAsmPrinter();
 
@@ -840,6 +1047,7 @@ void EngineBenchmarkOnCase(hybridse::sqlcase::SqlCase& sql_case,  // NOLINT
     } else {
         engine_options.set_enable_expr_optimize(true);
     }
+    engine_options.jit_options() = jit_options;
     std::unique_ptr<vm::EngineTestRunner> engine_runner;
     if (engine_mode == vm::kBatchMode) {
         engine_runner = std::unique_ptr<vm::BatchEngineTestRunner>(
@@ -871,11 +1079,16 @@ void EngineBenchmarkOnCase(hybridse::sqlcase::SqlCase& sql_case,  // NOLINT
         LOG(ERROR) << "Engine Test Init Catalog Error";
         return;
     }
+    auto compile_start = std::chrono::steady_clock::now();
     base::Status status = engine_runner->Compile();
     if (!status.isOK()) {
         LOG(WARNING) << "Compile error: " << status;
         return;
     }
+    state->counters["compile_ms"] =
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - compile_start)
+            .count();
     status = engine_runner->PrepareData();
     if (!status.isOK()) {
         LOG(WARNING) << "Prepare data error: " << status;
@@ -55,6 +55,30 @@ void EngineRunBatchWindowSumFeature5Window5(benchmark::State* state, MODE mode,
 void EngineRunBatchWindowMultiAggWindow25Feature25(benchmark::State* state,
                                                    MODE mode, int64_t limit_cnt,
                                                    int64_t size);  // NOLINT
+void EngineRunBatchWindowRowsIntAggFeature3(benchmark::State* state,
+                                            MODE mode, int64_t limit_cnt,
+                                            int64_t size);  // NOLINT
+void EngineRunBatchWindowRowsMinMaxFeature4(benchmark::State* state,
+                                           MODE mode, int64_t limit_cnt,
+                                           int64_t size);  // NOLINT
+void EngineRunBatchWindowRowsColumnAggFeature5(benchmark::State* state,
+                                              MODE mode, int64_t limit_cnt,
+                                              int64_t size,
+                                              bool column_agg);  // NOLINT
+void EngineRunBatchWindowRowsRetractAggFeature8(benchmark::State* state,
+                                               MODE mode, int64_t limit_cnt,
+                                               int64_t size,
+                                               bool incremental);  // NOLINT
+void EngineRunBatchWindowSumPartitionByCol6(benchmark::State* state,
+                                           MODE mode, int64_t limit_cnt,
+                                           int64_t size,
+                                           bool hash_partition);  // NOLINT
+void EngineRunBatchWindowSumParallel(benchmark::State* state, MODE mode,
+                                     int64_t size,
+                                     uint32_t worker_num);  // NOLINT
+void EngineRunBatchLastJoinWithoutIndex(benchmark::State* state, MODE mode,
+                                        int64_t limit_cnt,
+                                        int64_t size);  // NOLINT
 void EngineRunBatchWindowSumFeature5(benchmark::State* state, MODE mode,
                                      int64_t limit_cnt,
                                      int64_t size);  // NOLINT
@@ -114,6 +138,11 @@ void EngineBenchmarkOnCase(const std::string& yaml_path,
                            vm::EngineMode engine_mode, benchmark::State* state);
 void EngineBenchmarkOnCase(hybridse::sqlcase::SqlCase& sql_case,  // NOLINT
                            vm::EngineMode engine_mode, benchmark::State* state);
+// compile time of the case is reported as counter `compile_ms`
+void EngineBenchmarkOnCase(hybridse::sqlcase::SqlCase& sql_case,  // NOLINT
+                           vm::EngineMode engine_mode,
+                           const vm::JitOptions& jit_options,
+                           benchmark::State* state);
 
 }  // namespace bm
 }  // namespace hybridse
@@ -71,6 +71,37 @@ TEST_F(EngineBMCaseTest, EngineRunBatchWindowSumFeature1_TEST) {
 TEST_F(EngineBMCaseTest, EngineRunBatchWindowSumFeature5Window5_TEST) {
     EngineRunBatchWindowSumFeature5Window5(nullptr, TEST, 100L, 100L);
 }
+TEST_F(EngineBMCaseTest, EngineRunBatchWindowRowsIntAggFeature3_TEST) {
+    EngineRunBatchWindowRowsIntAggFeature3(nullptr, TEST, 100L, 100L);
+    EngineRunBatchWindowRowsIntAggFeature3(nullptr, TEST, 2000L, 2000L);
+}
+TEST_F(EngineBMCaseTest, EngineRunBatchWindowRowsColumnAggFeature5_TEST) {
+    EngineRunBatchWindowRowsColumnAggFeature5(nullptr, TEST, 2000L, 2000L,
+                                              false);
+    EngineRunBatchWindowRowsColumnAggFeature5(nullptr, TEST, 2000L, 2000L,
+                                              true);
+}
+TEST_F(EngineBMCaseTest, EngineRunBatchWindowRowsRetractAggFeature8_TEST) {
+    EngineRunBatchWindowRowsRetractAggFeature8(nullptr, TEST, 1000L, 1000L,
+                                               false);
+    EngineRunBatchWindowRowsRetractAggFeature8(nullptr, TEST, 1000L, 1000L,
+                                               true);
+}
+TEST_F(EngineBMCaseTest, EngineRunBatchWindowSumPartitionByCol6_TEST) {
+    EngineRunBatchWindowSumPartitionByCol6(nullptr, TEST, 1000L, 1000L, false);
+    EngineRunBatchWindowSumPartitionByCol6(nullptr, TEST, 1000L, 1000L, true);
+}
+TEST_F(EngineBMCaseTest, EngineRunBatchWindowSumParallel_TEST) {
+    EngineRunBatchWindowSumParallel(nullptr, TEST, 1000L, 1);
+    EngineRunBatchWindowSumParallel(nullptr, TEST, 1000L, 4);
+}
+TEST_F(EngineBMCaseTest, EngineRunBatchLastJoinWithoutIndex_TEST) {
+    EngineRunBatchLastJoinWithoutIndex(nullptr, TEST, 1000L, 1000L);
+}
+TEST_F(EngineBMCaseTest, EngineRunBatchWindowRowsMinMaxFeature4_TEST) {
+    EngineRunBatchWindowRowsMinMaxFeature4(nullptr, TEST, 100L, 100L);
+    EngineRunBatchWindowRowsMinMaxFeature4(nullptr, TEST, 2000L, 2000L);
+}
 TEST_F(EngineBMCaseTest, EngineWindowMultiAggFeature5_TEST) {
     EngineWindowMultiAggFeature5(nullptr, TEST, 100L, 100L);
 }
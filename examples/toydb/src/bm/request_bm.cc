@@ -42,6 +42,29 @@ using namespace ::llvm;  // NOLINT
         ->Args({1000})                                                    \
         ->Args({2000});
 
+// compare compile time and run time of window cases over jit opt levels,
+// level -1 is the default light function passes
+#define DEFINE_REQUEST_WINDOW_OPT_LEVEL_CASE(NAME, PATH, CASE_ID)         \
+    static void BM_Request_OptLevel_##NAME(benchmark::State& state) {     \
+        auto sql_case = hybridse::sqlcase::SqlCase::LoadSqlCaseWithID(    \
+            hybridse::sqlcase::FindSqlCaseBaseDirPath(), PATH, CASE_ID);  \
+        if (!hybridse::sqlcase::SqlCase::IsDebug()) {                     \
+            sql_case.SqlCaseRepeatConfig("window_scale", state.range(0)); \
+        }                                                                 \
+        vm::JitOptions jit_options;                                       \
+        jit_options.set_opt_level(state.range(1));                        \
+        jit_options.set_enable_host_cpu_features(state.range(1) >= 0);    \
+        EngineBenchmarkOnCase(sql_case, vm::kRequestMode, jit_options,    \
+                              &state);                                    \
+    }                                                                     \
+    BENCHMARK(BM_Request_OptLevel_##NAME)                                 \
+        ->ArgNames({"window_scale", "opt_level"})                         \
+        ->Args({1000, -1})                                                \
+        ->Args({1000, 0})                                                 \
+        ->Args({1000, 1})                                                 \
+        ->Args({1000, 2})                                                 \
+        ->Args({1000, 3});
+
 const char* DEFAULT_YAML_PATH = "/cases/benchmark/request_benchmark.yaml";
 DEFINE_REQUEST_CASE(BM_SimpleLastJoin2Right, DEFAULT_YAML_PATH, "0");
 DEFINE_REQUEST_CASE(BM_SimpleLastJoin4Right, DEFAULT_YAML_PATH, "1");
@@ -55,6 +78,12 @@ DEFINE_REQUEST_WINDOW_CASE(BM_LastJoin8WindowOutput, DEFAULT_YAML_PATH, "5");
 DEFINE_REQUEST_WINDOW_CASE(BM_MultipleUDAF,
                            "/cases/benchmark/udaf_benchmark.yaml", "0");
 
+DEFINE_REQUEST_WINDOW_OPT_LEVEL_CASE(BM_LastJoin4WindowOutput,
+                                     DEFAULT_YAML_PATH, "4");
+DEFINE_REQUEST_WINDOW_OPT_LEVEL_CASE(BM_MultipleUDAF,
+                                     "/cases/benchmark/udaf_benchmark.yaml",
+                                     "0");
+
 }  // namespace bm
 }  // namespace hybridse
 
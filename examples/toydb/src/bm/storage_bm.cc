@@ -26,6 +26,26 @@ static void BM_ArrayListIterate(benchmark::State& state) {  // NOLINT
     ArrayListIterate(&state, BENCHMARK, state.range(0));
 }
 
+static void BM_DeepKeyInsert(benchmark::State& state) {  // NOLINT
+    DeepKeyInsert(&state, BENCHMARK, state.range(0));
+}
+
+static void BM_DeepKeyRangeSeek(benchmark::State& state) {  // NOLINT
+    DeepKeyRangeSeek(&state, BENCHMARK, state.range(0));
+}
+
+static void BM_TableConcurrentPut(benchmark::State& state) {  // NOLINT
+    TableConcurrentPut(&state, BENCHMARK, state.range(0), state.range(1));
+}
+
+static void BM_TablePutBatch(benchmark::State& state) {  // NOLINT
+    TablePutBatch(&state, BENCHMARK, state.range(0), state.range(1));
+}
+
+static void BM_TableRecover(benchmark::State& state) {  // NOLINT
+    TableRecover(&state, BENCHMARK, state.range(0), state.range(1));
+}
+
 static void BM_TabletFullIterate(benchmark::State& state) {  // NOLINT
     TabletFullIterate(&state, BENCHMARK, state.range(0));
 }
@@ -75,6 +95,35 @@ BENCHMARK(BM_MemSegmentIterate)
 
 BENCHMARK(BM_ArrayListIterate)->Args({100})->Args({1000})->Args({10000});
 
+BENCHMARK(BM_DeepKeyInsert)
+    ->Args({10000})
+    ->Args({100000})
+    ->Args({1000000});
+
+BENCHMARK(BM_DeepKeyRangeSeek)
+    ->Args({10000})
+    ->Args({100000})
+    ->Args({1000000});
+
+BENCHMARK(BM_TableConcurrentPut)
+    ->Args({100000, 1})
+    ->Args({100000, 4})
+    ->Args({100000, 16})
+    ->Args({100000, 32})
+    ->UseRealTime();
+
+BENCHMARK(BM_TablePutBatch)
+    ->Args({100000, 1})
+    ->Args({100000, 16})
+    ->Args({100000, 256})
+    ->Args({100000, 4096});
+
+BENCHMARK(BM_TableRecover)
+    ->Args({100000, 1})
+    ->Args({100000, 4})
+    ->Args({100000, 8})
+    ->UseRealTime();
+
 }  // namespace bm
 }  // namespace hybridse
 
@@ -15,11 +15,18 @@
  */
 
 #include "bm/storage_bm_case.h"
+#include <unistd.h>
+#include <algorithm>
 #include <memory>
+#include <string>
+#include <thread>  // NOLINT
 #include <vector>
+#include "boost/filesystem.hpp"
 #include "codec/fe_row_codec.h"
 #include "gtest/gtest.h"
 #include "storage/list.h"
+#include "storage/table_impl.h"
+#include "storage/table_store.h"
 
 namespace hybridse {
 namespace bm {
@@ -30,6 +37,7 @@ using ::hybridse::base::DefaultComparator;
 using hybridse::sqlcase::CaseDataMock;
 using hybridse::sqlcase::CaseSchemaMock;
 using storage::ArrayList;
+using storage::List;
 DefaultComparator cmp;
 
 int64_t RunIterate(storage::BaseList<uint64_t, int64_t>* list);
@@ -251,5 +259,269 @@ void TabletWindowIterate(benchmark::State* state, MODE mode,
         }
     }
 }
+
+// Keys of a deep key are inserted out of order, the stride is coprime to
+// `data_size` so every key in [0, data_size) is hit once
+static uint64_t DeepKeyAt(int64_t idx, int64_t data_size) {
+    return static_cast<uint64_t>((idx * 7919) % data_size);
+}
+static void BuildDeepKey(List<uint64_t, int64_t, DefaultComparator>* list,
+                         int64_t data_size) {
+    for (int64_t i = 0; i < data_size; i++) {
+        int64_t value = i;
+        list->Insert(DeepKeyAt(i, data_size), value);
+    }
+}
+void DeepKeyInsert(benchmark::State* state, MODE mode, int64_t data_size) {
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                List<uint64_t, int64_t, DefaultComparator> list(cmp);
+                BuildDeepKey(&list, data_size);
+                benchmark::ClobberMemory();
+            }
+            break;
+        }
+        case TEST: {
+            List<uint64_t, int64_t, DefaultComparator> list(cmp);
+            BuildDeepKey(&list, data_size);
+            std::unique_ptr<base::Iterator<uint64_t, int64_t>> iter(
+                list.NewIterator());
+            iter->SeekToFirst();
+            // keys are in descending order
+            int64_t cnt = 0;
+            while (iter->Valid()) {
+                ASSERT_EQ(static_cast<uint64_t>(data_size - cnt - 1),
+                          iter->GetKey());
+                iter->Next();
+                cnt++;
+            }
+            ASSERT_EQ(data_size, cnt);
+        }
+    }
+}
+
+// Seek a key of a deep key then scan a window of 100 entries
+void DeepKeyRangeSeek(benchmark::State* state, MODE mode, int64_t data_size) {
+    List<uint64_t, int64_t, DefaultComparator> list(cmp);
+    BuildDeepKey(&list, data_size);
+    const int64_t window = 100;
+    switch (mode) {
+        case BENCHMARK: {
+            std::unique_ptr<base::Iterator<uint64_t, int64_t>> iter(
+                list.NewIterator());
+            int64_t i = 0;
+            for (auto _ : *state) {
+                iter->Seek(DeepKeyAt(i++, data_size));
+                int64_t sum = 0;
+                for (int64_t cnt = 0; cnt < window && iter->Valid(); cnt++) {
+                    sum += iter->GetValue();
+                    iter->Next();
+                }
+                benchmark::DoNotOptimize(sum);
+            }
+            break;
+        }
+        case TEST: {
+            std::unique_ptr<base::Iterator<uint64_t, int64_t>> iter(
+                list.NewIterator());
+            for (int64_t i = 0; i < data_size; i += data_size / 10) {
+                uint64_t key = DeepKeyAt(i, data_size);
+                iter->Seek(key);
+                int64_t cnt = 0;
+                for (; cnt < window && iter->Valid(); cnt++) {
+                    ASSERT_EQ(key - cnt, iter->GetKey());
+                    iter->Next();
+                }
+                ASSERT_EQ(std::min(window, static_cast<int64_t>(key) + 1), cnt);
+            }
+        }
+    }
+}
+
+// Rows are keyed by col6 with 8 hot keys and by col1 with 100 keys
+static std::shared_ptr<storage::Table> BuildPutTable(
+    type::TableDef& table_def, std::vector<Row>& buffer,  // NOLINT
+    int64_t data_size) {
+    CaseDataMock::BuildOnePkTableData(table_def, buffer, data_size);
+    ::hybridse::type::IndexDef* index = table_def.add_indexes();
+    index->set_name("index1");
+    index->add_first_keys("col6");
+    index->set_second_key("col5");
+    index = table_def.add_indexes();
+    index->set_name("index2");
+    index->add_first_keys("col1");
+    index->set_second_key("col5");
+    auto table = std::make_shared<storage::Table>(1, 1, table_def);
+    table->Init();
+    return table;
+}
+// Put `buffer` with `thread_num` writers, each of them puts a slice of rows
+static bool ConcurrentPut(storage::Table* table, const std::vector<Row>& buffer,
+                          int64_t thread_num) {
+    std::vector<std::thread> threads;
+    std::atomic<bool> ok(true);
+    int64_t step = (buffer.size() + thread_num - 1) / thread_num;
+    for (int64_t i = 0; i < thread_num; i++) {
+        threads.emplace_back([&, i]() {
+            int64_t end = std::min(static_cast<int64_t>(buffer.size()),
+                                   (i + 1) * step);
+            for (int64_t idx = i * step; idx < end; idx++) {
+                if (!table->Put(reinterpret_cast<char*>(buffer[idx].buf()),
+                                buffer[idx].size())) {
+                    ok.store(false, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return ok.load(std::memory_order_relaxed);
+}
+// Every row of `BuildPutTable` is found by both indexes
+static void CheckPutRows(storage::Table* table, int64_t data_size) {
+    int64_t cnt = 0;
+    for (auto key : {"astring", "bstring", "cstring", "dstring", "estring",
+                     "fstring", "gstring", "hstring"}) {
+        auto iter = table->NewIterator(key, "index1");
+        iter->SeekToFirst();
+        while (iter->Valid()) {
+            iter->Next();
+            cnt++;
+        }
+    }
+    ASSERT_EQ(data_size, cnt);
+    cnt = 0;
+    for (int32_t key = 1; key <= 100; key++) {
+        auto iter = table->NewIterator(std::to_string(key), "index2");
+        iter->SeekToFirst();
+        while (iter->Valid()) {
+            iter->Next();
+            cnt++;
+        }
+    }
+    ASSERT_EQ(data_size, cnt);
+}
+void TableConcurrentPut(benchmark::State* state, MODE mode, int64_t data_size,
+                        int64_t thread_num) {
+    type::TableDef table_def;
+    std::vector<Row> buffer;
+    auto table = BuildPutTable(table_def, buffer, data_size);
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                state->PauseTiming();
+                table = std::make_shared<storage::Table>(1, 1, table_def);
+                table->Init();
+                state->ResumeTiming();
+                benchmark::DoNotOptimize(
+                    ConcurrentPut(table.get(), buffer, thread_num));
+            }
+            state->SetItemsProcessed(state->iterations() * data_size);
+            break;
+        }
+        case TEST: {
+            ASSERT_TRUE(ConcurrentPut(table.get(), buffer, thread_num));
+            CheckPutRows(table.get(), data_size);
+        }
+    }
+}
+// Put `buffer` by batches of `batch_size` rows
+static bool PutByBatch(storage::Table* table, const std::vector<Row>& buffer,
+                       int64_t batch_size) {
+    std::vector<base::Slice> rows;
+    rows.reserve(batch_size);
+    for (size_t idx = 0; idx < buffer.size(); idx++) {
+        rows.push_back(base::Slice(reinterpret_cast<char*>(buffer[idx].buf()),
+                                   buffer[idx].size()));
+        if (static_cast<int64_t>(rows.size()) == batch_size ||
+            idx + 1 == buffer.size()) {
+            if (!table->PutBatch(rows)) {
+                return false;
+            }
+            rows.clear();
+        }
+    }
+    return true;
+}
+void TablePutBatch(benchmark::State* state, MODE mode, int64_t data_size,
+                   int64_t batch_size) {
+    type::TableDef table_def;
+    std::vector<Row> buffer;
+    auto table = BuildPutTable(table_def, buffer, data_size);
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                state->PauseTiming();
+                table = std::make_shared<storage::Table>(1, 1, table_def);
+                table->Init();
+                state->ResumeTiming();
+                benchmark::DoNotOptimize(
+                    PutByBatch(table.get(), buffer, batch_size));
+            }
+            state->SetItemsProcessed(state->iterations() * data_size);
+            break;
+        }
+        case TEST: {
+            ASSERT_TRUE(PutByBatch(table.get(), buffer, batch_size));
+            CheckPutRows(table.get(), data_size);
+        }
+    }
+}
+
+// Half of the rows are recovered from a snapshot with `thread_num` threads,
+// the other half are replayed from the binlog
+void TableRecover(benchmark::State* state, MODE mode, int64_t data_size,
+                  int64_t thread_num) {
+    type::TableDef table_def;
+    std::vector<Row> buffer;
+    auto table = BuildPutTable(table_def, buffer, data_size);
+    std::string dir =
+        "/tmp/toydb_storage_bm_recover_" + std::to_string(getpid());
+    boost::filesystem::remove_all(dir);
+    storage::BinlogOptions options;
+    options.sync_policy = storage::SyncPolicy::kSyncNone;
+    {
+        storage::TableStore store(table, dir, options);
+        ASSERT_TRUE(store.Init());
+        for (size_t idx = 0; idx < buffer.size(); idx++) {
+            if (idx == buffer.size() / 2) {
+                ASSERT_TRUE(store.MakeSnapshot());
+            }
+            ASSERT_TRUE(store.Put(reinterpret_cast<char*>(buffer[idx].buf()),
+                                  buffer[idx].size()));
+        }
+    }
+    auto recover = [&]() {
+        auto recovered = std::make_shared<storage::Table>(1, 1, table_def);
+        recovered->Init();
+        storage::TableStore store(recovered, dir, options);
+        if (!store.Init() || !store.Recover(thread_num)) {
+            return std::shared_ptr<storage::Table>();
+        }
+        return recovered;
+    };
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                state->PauseTiming();
+                table.reset();
+                state->ResumeTiming();
+                table = recover();
+                benchmark::DoNotOptimize(table);
+            }
+            state->SetItemsProcessed(state->iterations() * data_size);
+            break;
+        }
+        case TEST: {
+            table = recover();
+            ASSERT_TRUE(table);
+            CheckPutRows(table.get(), data_size);
+        }
+    }
+    boost::filesystem::remove_all(dir);
+}
+
 }  // namespace bm
 }  // namespace hybridse
@@ -30,6 +30,14 @@ void MemSegmentIterate(benchmark::State* state, MODE mode, int64_t data_size);
 void TabletFullIterate(benchmark::State* state, MODE mode, int64_t data_size);
 void TabletWindowIterate(benchmark::State* state, MODE mode, int64_t data_size);
 void ArrayListIterate(benchmark::State* state, MODE mode, int64_t data_size);
+void DeepKeyInsert(benchmark::State* state, MODE mode, int64_t data_size);
+void DeepKeyRangeSeek(benchmark::State* state, MODE mode, int64_t data_size);
+void TableConcurrentPut(benchmark::State* state, MODE mode, int64_t data_size,
+                        int64_t thread_num);
+void TablePutBatch(benchmark::State* state, MODE mode, int64_t data_size,
+                   int64_t batch_size);
+void TableRecover(benchmark::State* state, MODE mode, int64_t data_size,
+                  int64_t thread_num);
 }  // namespace bm
 }  // namespace hybridse
 #endif  // EXAMPLES_TOYDB_SRC_BM_STORAGE_BM_CASE_H_
@@ -30,6 +30,31 @@ TEST_F(StorageBMCaseTest, ArrayListIterate_TEST) {
     ArrayListIterate(nullptr, TEST, 10000L);
 }
 
+TEST_F(StorageBMCaseTest, DeepKeyInsert_TEST) {
+    DeepKeyInsert(nullptr, TEST, 100L);
+    DeepKeyInsert(nullptr, TEST, 10000L);
+}
+
+TEST_F(StorageBMCaseTest, DeepKeyRangeSeek_TEST) {
+    DeepKeyRangeSeek(nullptr, TEST, 100L);
+    DeepKeyRangeSeek(nullptr, TEST, 10000L);
+}
+
+TEST_F(StorageBMCaseTest, TableConcurrentPut_TEST) {
+    TableConcurrentPut(nullptr, TEST, 1000L, 1L);
+    TableConcurrentPut(nullptr, TEST, 10000L, 8L);
+}
+
+TEST_F(StorageBMCaseTest, TablePutBatch_TEST) {
+    TablePutBatch(nullptr, TEST, 1000L, 1L);
+    TablePutBatch(nullptr, TEST, 10000L, 100L);
+}
+
+TEST_F(StorageBMCaseTest, TableRecover_TEST) {
+    TableRecover(nullptr, TEST, 1000L, 1L);
+    TableRecover(nullptr, TEST, 10000L, 4L);
+}
+
 TEST_F(StorageBMCaseTest, TabletTableIterate_TEST) {
     TabletFullIterate(nullptr, TEST, 10L);
     TabletFullIterate(nullptr, TEST, 100L);
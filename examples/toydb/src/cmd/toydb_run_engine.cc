@@ -39,6 +39,16 @@ DEFINE_bool(enable_mcjit, false, "Use llvm legacy mcjit engine");
 DEFINE_bool(enable_vtune, false, "Enable llvm jit vtune events");
 DEFINE_bool(enable_gdb, false, "Enable llvm jit gdb events");
 DEFINE_bool(enable_perf, false, "Enable llvm jit perf events");
+DEFINE_bool(enable_shared_jit_session, false,
+            "Compile queries into one shared llvm jit session");
+DEFINE_string(jit_object_cache_dir, "",
+              "Directory to cache compiled objects of queries");
+DEFINE_int32(jit_opt_level, -1,
+             "Llvm opt level 0-3, negative for default light passes");
+DEFINE_bool(enable_host_cpu_features, false,
+            "Generate code for the cpu features of host");
+DEFINE_bool(enable_udf_bitcode, false,
+            "Inline builtin udfs from bitcode into generated code");
 
 namespace hybridse {
 namespace vm {
@@ -83,6 +93,11 @@ int RunSingle(const std::string& yaml_path) {
     jit_options.set_enable_vtune(FLAGS_enable_vtune);
     jit_options.set_enable_gdb(FLAGS_enable_gdb);
     jit_options.set_enable_perf(FLAGS_enable_perf);
+    jit_options.set_enable_shared_session(FLAGS_enable_shared_jit_session);
+    jit_options.set_object_cache_dir(FLAGS_jit_object_cache_dir);
+    jit_options.set_opt_level(FLAGS_jit_opt_level);
+    jit_options.set_enable_host_cpu_features(FLAGS_enable_host_cpu_features);
+    jit_options.set_enable_udf_bitcode(FLAGS_enable_udf_bitcode);
 
     for (auto& sql_case : cases) {
         if (FLAGS_case_id >= 0 &&
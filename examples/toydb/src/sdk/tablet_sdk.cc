@@ -19,6 +19,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 #include "base/fe_strings.h"
 #include "brpc/channel.h"
 #include "codec/fe_row_codec.h"
@@ -27,12 +28,15 @@
 #include "node/node_enum.h"
 #include "plan/plan_api.h"
 #include "proto/fe_tablet.pb.h"
+#include "sdk/base_impl.h"
 #include "sdk/result_set_impl.h"
 
 namespace hybridse {
 namespace sdk {
 
 static const std::string EMPTY_STR;  // NOLINT
+// rows of an insert batch rpc are cut at the size
+static constexpr uint64_t INSERT_BATCH_MAX_BYTES = 4 * 1024 * 1024;
 
 class ExplainInfoImpl : public ExplainInfo {
  public:
@@ -65,6 +69,384 @@ class ExplainInfoImpl : public ExplainInfo {
     std::string ir_;
 };
 
+// Map values of an insert row to the columns of `schema` in order, columns
+// without value are mapped to nullptr. Values are constants, or placeholders
+// if `with_parameter`.
+static bool MapInsertValues(const type::TableDef& schema,
+                            const std::vector<std::string>& columns,
+                            node::ExprListNode* values, bool with_parameter,
+                            std::vector<node::ExprNode*>* column_values,
+                            sdk::Status* status) {
+    if (nullptr == values) {
+        status->code = -1;
+        status->msg = "Insert Values Is Null";
+        return false;
+    }
+    std::map<std::string, node::ExprNode*> column_value_map;
+    if (!columns.empty()) {
+        if (columns.size() != values->children_.size()) {
+            status->msg = "Fail Build Request: insert column size != value size";
+            status->code = -1;
+            LOG(WARNING) << status->msg;
+            return false;
+        }
+        for (size_t i = 0; i < columns.size(); i++) {
+            column_value_map.insert(std::make_pair(columns[i], values->children_[i]));
+        }
+    } else {
+        if (schema.columns().size() != static_cast<int32_t>(values->children_.size())) {
+            status->msg = "Fail Build Request: insert column size != value size";
+            status->code = -1;
+            LOG(WARNING) << status->msg;
+            return false;
+        }
+        for (int i = 0; i < schema.columns().size(); i++) {
+            column_value_map.insert(std::make_pair(schema.columns(i).name(), values->children_[i]));
+        }
+    }
+    for (const auto& kv : column_value_map) {
+        node::ExprType expr_type = kv.second->GetExprType();
+        if (node::kExprPrimary != expr_type && !(with_parameter && node::kExprParameter == expr_type)) {
+            status->code = common::kTypeError;
+            status->msg = "Fail insert value with type " + node::ExprTypeName(expr_type);
+            return false;
+        }
+    }
+    column_values->clear();
+    for (auto column : schema.columns()) {
+        auto it = column_value_map.find(column.name());
+        if (it == column_value_map.end()) {
+            column_values->push_back(nullptr);
+            continue;
+        }
+        column_values->push_back(it->second);
+        column_value_map.erase(it);
+    }
+    if (!column_value_map.empty()) {
+        status->code = common::kTypeError;
+        status->msg = "Fail insert: column " + column_value_map.begin()->first + "not exist";
+        return false;
+    }
+    return true;
+}
+
+static bool AppendConstValue(const type::ColumnDef& column, const node::ConstNode* primary, codec::RowBuilder* rb,
+                             sdk::Status* status) {
+    bool ok = false;
+    switch (column.type()) {
+        case type::kNull: {
+            ok = rb->AppendNULL();
+            break;
+        }
+        case type::kInt16: {
+            ok = rb->AppendInt16(primary->GetAsInt16());
+            break;
+        }
+        case type::kInt32: {
+            ok = rb->AppendInt32(primary->GetAsInt32());
+            break;
+        }
+        case type::kInt64: {
+            ok = rb->AppendInt64(primary->GetAsInt64());
+            break;
+        }
+        case type::kFloat: {
+            ok = rb->AppendFloat(primary->GetAsFloat());
+            break;
+        }
+        case type::kDouble: {
+            ok = rb->AppendDouble(primary->GetAsDouble());
+            break;
+        }
+        case type::kVarchar: {
+            ok = rb->AppendString(primary->GetStr(), strlen(primary->GetStr()));
+            break;
+        }
+        case type::kTimestamp: {
+            ok = rb->AppendTimestamp(primary->GetAsInt64());
+            break;
+        }
+        case type::kDate: {
+            int32_t year;
+            int32_t month;
+            int32_t day;
+            if (!primary->GetAsDate(&year, &month, &day)) {
+                ok = false;
+            } else {
+                ok = rb->AppendDate(year, month, day);
+            }
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+    if (!ok) {
+        status->code = common::kTypeError;
+        status->msg = "can not handle data type " + node::DataTypeName(primary->GetDataType());
+        LOG(WARNING) << status->msg;
+        return false;
+    }
+    return true;
+}
+
+// Copy field `idx` of `parameter` to `rb`, the field has the type of `column`
+static bool AppendParameterValue(const type::ColumnDef& column, codec::RowView* parameter, uint32_t idx,
+                                 codec::RowBuilder* rb) {
+    switch (column.type()) {
+        case type::kBool: {
+            bool val = false;
+            return parameter->GetBool(idx, &val) == 0 && rb->AppendBool(val);
+        }
+        case type::kInt16: {
+            int16_t val = 0;
+            return parameter->GetInt16(idx, &val) == 0 && rb->AppendInt16(val);
+        }
+        case type::kInt32: {
+            int32_t val = 0;
+            return parameter->GetInt32(idx, &val) == 0 && rb->AppendInt32(val);
+        }
+        case type::kInt64: {
+            int64_t val = 0;
+            return parameter->GetInt64(idx, &val) == 0 && rb->AppendInt64(val);
+        }
+        case type::kFloat: {
+            float val = 0;
+            return parameter->GetFloat(idx, &val) == 0 && rb->AppendFloat(val);
+        }
+        case type::kDouble: {
+            double val = 0;
+            return parameter->GetDouble(idx, &val) == 0 && rb->AppendDouble(val);
+        }
+        case type::kVarchar: {
+            const char* val = nullptr;
+            uint32_t length = 0;
+            return parameter->GetString(idx, &val, &length) == 0 && rb->AppendString(val, length);
+        }
+        case type::kTimestamp: {
+            int64_t val = 0;
+            return parameter->GetTimestamp(idx, &val) == 0 && rb->AppendTimestamp(val);
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+// Encode a table row of `column_values` mapped by `MapInsertValues` into
+// `row`, values of placeholders are read from `parameter`
+static bool EncodeInsertRow(const type::TableDef& schema, const std::vector<node::ExprNode*>& column_values,
+                            codec::RowView* parameter, std::string* row, sdk::Status* status) {
+    uint32_t str_size = 0;
+    for (int i = 0; i < schema.columns().size(); i++) {
+        const node::ExprNode* value = column_values[i];
+        if (nullptr == value || type::kVarchar != schema.columns(i).type()) {
+            continue;
+        }
+        if (node::kExprParameter == value->GetExprType()) {
+            uint32_t idx = dynamic_cast<const node::ParameterExpr*>(value)->position() - 1;
+            const char* val = nullptr;
+            uint32_t length = 0;
+            if (!parameter->IsNULL(idx) && parameter->GetString(idx, &val, &length) == 0) {
+                str_size += length;
+            }
+        } else if (!dynamic_cast<const node::ConstNode*>(value)->IsNull()) {
+            str_size += strlen(dynamic_cast<const node::ConstNode*>(value)->GetStr());
+        }
+    }
+
+    codec::RowBuilder rb(schema.columns());
+    uint32_t row_size = rb.CalTotalLength(str_size);
+    row->resize(row_size);
+    char* buf = reinterpret_cast<char*>(&(row->at(0)));
+    rb.SetBuffer(reinterpret_cast<int8_t*>(buf), row_size);
+    for (int i = 0; i < schema.columns().size(); i++) {
+        const type::ColumnDef& column = schema.columns(i);
+        const node::ExprNode* value = column_values[i];
+        bool is_null = nullptr == value;
+        if (!is_null) {
+            if (node::kExprParameter == value->GetExprType()) {
+                is_null = parameter->IsNULL(dynamic_cast<const node::ParameterExpr*>(value)->position() - 1);
+            } else {
+                is_null = dynamic_cast<const node::ConstNode*>(value)->IsNull();
+            }
+        }
+        if (is_null) {
+            if (column.is_not_null()) {
+                status->code = common::kTypeError;
+                status->msg = "Un-support insert null into NOT NULL column " + column.name();
+                LOG(WARNING) << status->msg;
+                return false;
+            }
+            rb.AppendNULL();
+            continue;
+        }
+        if (node::kExprParameter == value->GetExprType()) {
+            uint32_t idx = dynamic_cast<const node::ParameterExpr*>(value)->position() - 1;
+            if (!AppendParameterValue(column, parameter, idx, &rb)) {
+                status->code = common::kTypeError;
+                status->msg = "fail to bind value of column " + column.name();
+                LOG(WARNING) << status->msg;
+                return false;
+            }
+        } else if (!AppendConstValue(column, dynamic_cast<const node::ConstNode*>(value), &rb, status)) {
+            return false;
+        }
+    }
+    status->code = 0;
+    return true;
+}
+
+// Send `cnt` rows laid one after another from `rows` with InsertBatch rpcs of
+// at most INSERT_BATCH_MAX_BYTES each. Return the number of rows sent.
+static uint32_t SendInsertBatch(brpc::Channel* channel, const std::string& db, const std::string& table,
+                                const uint32_t* row_sizes, uint32_t cnt, const char* rows, sdk::Status* status) {
+    ::hybridse::tablet::TabletServer_Stub stub(channel);
+    uint32_t sent = 0;
+    while (sent < cnt) {
+        tablet::InsertBatchRequest request;
+        request.set_db(db);
+        request.set_table(table);
+        brpc::Controller cntl;
+        uint64_t batch_size = 0;
+        uint32_t end = sent;
+        while (end < cnt && (end == sent || batch_size + row_sizes[end] <= INSERT_BATCH_MAX_BYTES)) {
+            request.add_row_sizes(row_sizes[end]);
+            batch_size += row_sizes[end];
+            end++;
+        }
+        cntl.request_attachment().append(rows, batch_size);
+        tablet::InsertBatchResponse response;
+        stub.InsertBatch(&cntl, &request, &response, NULL);
+        if (cntl.Failed()) {
+            status->code = common::kConnError;
+            status->msg = "rpc controller error " + cntl.ErrorText();
+            LOG(WARNING) << "InsertBatch fail: " << status->msg;
+            return sent;
+        }
+        if (response.status().code() != common::kOk) {
+            status->code = response.status().code();
+            status->msg = response.status().msg();
+            LOG(WARNING) << "InsertBatch fail: " << status->msg;
+            return sent;
+        }
+        rows += batch_size;
+        sent = end;
+    }
+    status->code = common::kOk;
+    return sent;
+}
+
+class PreparedInsertImpl : public PreparedInsert {
+ public:
+    PreparedInsertImpl(brpc::Channel* channel, const std::string& db, const type::TableDef& schema,
+                       std::unique_ptr<node::NodeManager> node_manager,
+                       const std::vector<node::ExprNode*>& column_values, const vm::Schema& parameter_schema)
+        : channel_(channel),
+          db_(db),
+          schema_(schema),
+          node_manager_(std::move(node_manager)),
+          column_values_(column_values),
+          parameter_schema_(parameter_schema),
+          parameter_view_(parameter_schema),
+          direct_(true),
+          row_sizes_(),
+          rows_() {
+        // rows of placeholders of all columns in order are table rows already
+        for (int i = 0; i < schema_.columns().size(); i++) {
+            const node::ExprNode* value = column_values_[i];
+            if (nullptr == value || node::kExprParameter != value->GetExprType() ||
+                dynamic_cast<const node::ParameterExpr*>(value)->position() != i + 1) {
+                direct_ = false;
+                break;
+            }
+        }
+    }
+    ~PreparedInsertImpl() {}
+
+    const Schema& GetParameterSchema() { return parameter_schema_; }
+
+    std::shared_ptr<RequestRow> NewRow() { return std::make_shared<RequestRow>(&parameter_schema_); }
+
+    bool AddRow(RequestRow* row, sdk::Status* status);
+
+    uint32_t GetRowCount() { return row_sizes_.size(); }
+
+    void Execute(sdk::Status* status);
+
+ private:
+    brpc::Channel* channel_;
+    std::string db_;
+    type::TableDef schema_;
+    // owns constants of the statement
+    std::unique_ptr<node::NodeManager> node_manager_;
+    std::vector<node::ExprNode*> column_values_;
+    SchemaImpl parameter_schema_;
+    codec::RowView parameter_view_;
+    bool direct_;
+    std::vector<uint32_t> row_sizes_;
+    std::string rows_;
+};
+
+bool PreparedInsertImpl::AddRow(RequestRow* row, sdk::Status* status) {
+    if (status == NULL) {
+        return false;
+    }
+    if (row == NULL || row->GetSchema() != &parameter_schema_) {
+        status->code = common::kBadRequest;
+        status->msg = "row is not created by the prepared insert";
+        return false;
+    }
+    const std::string& parameter = row->GetRow();
+    if (parameter_schema_.GetColumnCnt() > 0 &&
+        (parameter.empty() ||
+         codec::RowView::GetSize(reinterpret_cast<const int8_t*>(parameter.data())) != parameter.size())) {
+        status->code = common::kBadRequest;
+        status->msg = "row is not built";
+        return false;
+    }
+    if (direct_) {
+        // the row is buffered as is, check NOT NULL columns it skips
+        parameter_view_.Reset(reinterpret_cast<const int8_t*>(parameter.data()), parameter.size());
+        for (int i = 0; i < schema_.columns().size(); i++) {
+            if (schema_.columns(i).is_not_null() && parameter_view_.IsNULL(i)) {
+                status->code = common::kTypeError;
+                status->msg = "Un-support insert null into NOT NULL column " + schema_.columns(i).name();
+                LOG(WARNING) << status->msg;
+                return false;
+            }
+        }
+        rows_.append(parameter);
+        row_sizes_.push_back(parameter.size());
+        status->code = common::kOk;
+        return true;
+    }
+    if (parameter_schema_.GetColumnCnt() > 0) {
+        parameter_view_.Reset(reinterpret_cast<const int8_t*>(parameter.data()), parameter.size());
+    }
+    std::string table_row;
+    if (!EncodeInsertRow(schema_, column_values_, &parameter_view_, &table_row, status)) {
+        return false;
+    }
+    rows_.append(table_row);
+    row_sizes_.push_back(table_row.size());
+    return true;
+}
+
+void PreparedInsertImpl::Execute(sdk::Status* status) {
+    if (status == NULL) {
+        return;
+    }
+    uint32_t sent = SendInsertBatch(channel_, db_, schema_.name(), row_sizes_.data(), row_sizes_.size(),
+                                    rows_.data(), status);
+    uint64_t sent_bytes = 0;
+    for (uint32_t i = 0; i < sent; i++) {
+        sent_bytes += row_sizes_[i];
+    }
+    rows_.erase(0, sent_bytes);
+    row_sizes_.erase(row_sizes_.begin(), row_sizes_.begin() + sent);
+}
+
 class TabletSdkImpl : public TabletSdk {
  public:
     TabletSdkImpl() {}
@@ -92,19 +474,15 @@ class TabletSdkImpl : public TabletSdk {
     void Insert(const std::string& db, const std::string& sql,
                 sdk::Status* status);
 
+    std::shared_ptr<PreparedInsert> PrepareInsert(const std::string& db,
+                                                  const std::string& sql,
+                                                  sdk::Status* status);
+
     std::shared_ptr<ExplainInfo> Explain(const std::string& db,
                                          const std::string& sql,
                                          sdk::Status* status);
 
  private:
-    void BuildInsertRequest(const std::string& db, const std::string& table,
-                            const std::vector<std::string>& columns,
-                            node::ExprListNode* insert_value,
-                            tablet::InsertRequest* request,
-                            sdk::Status* status);
-
-    void Insert(const tablet::InsertRequest& request, sdk::Status* status);
-
     bool GetSchema(const std::string& db, const std::string& table,
                    type::TableDef* schema, sdk::Status* status);
 
@@ -134,19 +512,6 @@ bool TabletSdkImpl::Init() {
     return true;
 }
 
-void TabletSdkImpl::Insert(const tablet::InsertRequest& request,
-                           sdk::Status* status) {
-    ::hybridse::tablet::TabletServer_Stub stub(channel_);
-    ::hybridse::tablet::InsertResponse response;
-    brpc::Controller cntl;
-    stub.Insert(&cntl, &request, &response, NULL);
-    if (cntl.Failed()) {
-        status->code = -1;
-        status->msg = "Rpc Control error";
-    }
-    status->code = 0;
-}
-
 std::shared_ptr<ResultSet> TabletSdkImpl::Query(const std::string& db,
                                                 const std::string& sql,
                                                 const std::string& row,
@@ -273,178 +638,85 @@ void TabletSdkImpl::GetSqlPlan(const std::string& db, const std::string& sql,
         return;
     }
 }
-void TabletSdkImpl::BuildInsertRequest(const std::string& db,
-                                       const std::string& table_name,
-                                       const std::vector<std::string>& columns,
-                                       node::ExprListNode* values,
-                                       tablet::InsertRequest* request,
-                                       sdk::Status* status) {
-    if (nullptr == values) {
-        status->code = -1;
-        status->msg = "Insert Values Is Null";
-        return;
+std::shared_ptr<PreparedInsert> TabletSdkImpl::PrepareInsert(const std::string& db, const std::string& sql,
+                                                             sdk::Status* status) {
+    if (status == NULL) {
+        LOG(WARNING) << "status is null";
+        return std::shared_ptr<PreparedInsert>();
+    }
+    node::PlanNodeList plan_trees;
+    std::unique_ptr<node::NodeManager> node_manager(new node::NodeManager());
+    GetSqlPlan(db, sql, *node_manager, plan_trees, *status);
+    if (0 != status->code) {
+        return std::shared_ptr<PreparedInsert>();
+    }
+    if (plan_trees.empty() || nullptr == plan_trees[0]) {
+        status->msg = "fail to prepare plan : plan tree is empty or null";
+        status->code = common::kPlanError;
+        LOG(WARNING) << status->msg;
+        return std::shared_ptr<PreparedInsert>();
+    }
+    node::PlanNode* plan = plan_trees[0];
+    if (node::kPlanTypeInsert != plan->GetType()) {
+        status->code = common::kUnSupport;
+        status->msg = "can not prepare plan type " + node::NameOfPlanNodeType(plan->GetType());
+        return std::shared_ptr<PreparedInsert>();
+    }
+    const node::InsertStmt* insert_stmt = dynamic_cast<node::InsertPlanNode*>(plan)->GetInsertNode();
+    if (nullptr == insert_stmt) {
+        status->code = common::kNullPointer;
+        status->msg = "fail to prepare insert statement with null node";
+        return std::shared_ptr<PreparedInsert>();
+    }
+    if (insert_stmt->values_.size() != 1) {
+        status->code = common::kUnSupport;
+        status->msg = "can not prepare insert statement with " + std::to_string(insert_stmt->values_.size()) +
+                      " rows of values";
+        return std::shared_ptr<PreparedInsert>();
     }
     type::TableDef schema;
-    if (!GetSchema(db, table_name, &schema, status)) {
+    if (!GetSchema(db, insert_stmt->table_name_, &schema, status)) {
         if (0 == status->code) {
             status->code = -1;
             status->msg = "Table Not Exist";
         }
-        return;
-    }
-    request->set_table(table_name);
-    request->set_db(db);
-
-    std::unordered_set<std::string> column_set;
-    for (size_t i = 0; i < schema.columns().size(); i++) {
-        column_set.insert(schema.columns(i).name());
-    }
-    std::map<std::string, node::ConstNode*> column_value_map;
-    if (!columns.empty()) {
-        if (columns.size() != values->children_.size()) {
-            status->msg = "Fail Build Request: insert column size != value size";
-            status->code = -1;
-            LOG(WARNING) << status->msg;
-            return;
-        }
-        for (size_t i = 0; i < columns.size(); i++) {
-            if (node::kExprPrimary != values->children_[i]->GetExprType()) {
-                status->code = common::kTypeError;
-                status->msg =
-                    "Fail insert value with type " + node::ExprTypeName(values->children_[i]->GetExprType());
-                return;
-            }
-            if (column_set.find(columns[i]) == column_set.end()) {
-                status->code = common::kTypeError;
-                status->msg =
-                    "Fail insert: column " + columns[i] + "not exist";
-                return;
-            }
-            column_value_map.insert(std::make_pair(columns[i], dynamic_cast<node::ConstNode*>(values->children_[i])));
-        }
-    } else {
-        if (schema.columns().size() != static_cast<int32_t>(values->children_.size())) {
-            status->msg = "Fail Build Request: insert column size != value size";
-            status->code = -1;
-            LOG(WARNING) << status->msg;
-            return;
-        }
-        for (int i = 0; i < schema.columns().size(); i++) {
-            if (node::kExprPrimary != values->children_[i]->GetExprType()) {
-                status->code = common::kTypeError;
-                status->msg = "Fail insert value with type " + node::ExprTypeName(values->children_[i]->GetExprType());
-                return;
-            }
-            column_value_map.insert(
-                std::make_pair(schema.columns(i).name(), dynamic_cast<node::ConstNode*>(values->children_[i])));
-        }
+        return std::shared_ptr<PreparedInsert>();
     }
-    uint32_t str_size = 0;
-    for (auto column : schema.columns()) {
-        std::string column_name = column.name();
-        auto expr_node_it = column_value_map.find(column_name);
-        if (expr_node_it == column_value_map.cend()) {
-            continue;
-        }
-        if (type::kVarchar == column.type() && !expr_node_it->second->IsNull()) {
-            str_size += strlen(expr_node_it->second->GetStr());
-        }
+    std::vector<node::ExprNode*> column_values;
+    if (!MapInsertValues(schema, insert_stmt->columns_, dynamic_cast<node::ExprListNode*>(insert_stmt->values_[0]),
+                         true, &column_values, status)) {
+        return std::shared_ptr<PreparedInsert>();
     }
-
-    codec::RowBuilder rb(schema.columns());
-    uint32_t row_size = rb.CalTotalLength(str_size);
-    std::string* row = request->mutable_row();
-    row->resize(row_size);
-    char* buf = reinterpret_cast<char*>(&(row->at(0)));
-    rb.SetBuffer(reinterpret_cast<int8_t*>(buf), row_size);
-    auto it = schema.columns().begin();
-    uint32_t index = 0;
-    for (; it != schema.columns().end(); ++it) {
-        index++;
-        std::string column_name = it->name();
-        auto expr_node_it = column_value_map.find(column_name);
-        if (expr_node_it == column_value_map.cend()) {
-            if (it->is_not_null()) {
-                status->code = common::kTypeError;
-                status->msg = "Un-support insert null into NOT NULL column " + it->name();
-                LOG(WARNING) << status->msg;
-                return;
-            }
-            rb.AppendNULL();
+    // placeholders are numbered from 1 in order
+    std::vector<const type::ColumnDef*> parameter_columns;
+    for (int i = 0; i < schema.columns().size(); i++) {
+        const node::ExprNode* value = column_values[i];
+        if (nullptr == value || node::kExprParameter != value->GetExprType()) {
             continue;
         }
-        const node::ConstNode* primary = expr_node_it->second;
-        if (primary->IsNull()) {
-            if (it->is_not_null()) {
-                status->code = common::kTypeError;
-                status->msg = "Un-support insert null into NOT NULL column " + it->name();
-                LOG(WARNING) << status->msg;
-                return;
-            }
-            rb.AppendNULL();
-            continue;
+        if (type::kDate == schema.columns(i).type()) {
+            status->code = common::kUnSupport;
+            status->msg = "can not bind placeholder of date column " + schema.columns(i).name();
+            return std::shared_ptr<PreparedInsert>();
         }
-        bool ok = false;
-        switch (it->type()) {
-            case type::kNull: {
-                ok = rb.AppendNULL();
-                break;
-            }
-            case type::kInt16: {
-                ok = rb.AppendInt16(primary->GetAsInt16());
-                break;
-            }
-            case type::kInt32: {
-                ok = rb.AppendInt32(primary->GetAsInt32());
-                break;
-            }
-            case type::kInt64: {
-                ok = rb.AppendInt64(primary->GetAsInt64());
-                break;
-            }
-            case type::kFloat: {
-                ok = rb.AppendFloat(primary->GetAsFloat());
-                break;
-            }
-            case type::kDouble: {
-                ok = rb.AppendDouble(primary->GetAsDouble());
-                break;
-            }
-            case type::kVarchar: {
-                ok = rb.AppendString(primary->GetStr(), strlen(primary->GetStr()));
-                break;
-            }
-            case type::kTimestamp: {
-                ok = rb.AppendTimestamp(primary->GetAsInt64());
-                break;
-            }
-            case type::kDate: {
-                int32_t year;
-                int32_t month;
-                int32_t day;
-                if (!primary->GetAsDate(&year, &month, &day)) {
-                    ok = false;
-                } else {
-                    ok = rb.AppendDate(year, month, day);
-                }
-                break;
-            }
-            default: {
-                status->code = common::kTypeError;
-                status->msg = "can not handle data type " + node::DataTypeName(primary->GetDataType());
-                LOG(WARNING) << status->msg;
-                return;
-            }
+        size_t position = dynamic_cast<const node::ParameterExpr*>(value)->position();
+        if (parameter_columns.size() < position) {
+            parameter_columns.resize(position, nullptr);
         }
-        if (!ok) {
-            status->code = common::kTypeError;
-            status->msg = "can not handle data type " + node::DataTypeName(primary->GetDataType());
-
-            LOG(WARNING) << status->msg;
-            return;
+        parameter_columns[position - 1] = &schema.columns(i);
+    }
+    vm::Schema parameter_schema;
+    for (auto column : parameter_columns) {
+        if (nullptr == column) {
+            status->code = common::kBadRequest;
+            status->msg = "placeholders of insert statement are not in order";
+            return std::shared_ptr<PreparedInsert>();
         }
+        parameter_schema.Add()->CopyFrom(*column);
     }
-    status->code = 0;
+    status->code = common::kOk;
+    return std::make_shared<PreparedInsertImpl>(channel_, db, schema, std::move(node_manager), column_values,
+                                                parameter_schema);
 }
 
 void TabletSdkImpl::Insert(const std::string& db, const std::string& sql, sdk::Status* status) {
@@ -475,19 +747,32 @@ void TabletSdkImpl::Insert(const std::string& db, const std::string& sql, sdk::S
                 status->msg = "fail to execute insert statement with null node";
                 return;
             }
+            type::TableDef schema;
+            if (!GetSchema(db, insert_stmt->table_name_, &schema, status)) {
+                if (0 == status->code) {
+                    status->code = -1;
+                    status->msg = "Table Not Exist";
+                }
+                return;
+            }
+            // rows of all values are sent together
+            std::vector<uint32_t> row_sizes;
+            std::string rows;
             for (auto iter = insert_stmt->values_.cbegin(); iter != insert_stmt->values_.cend(); iter++) {
-                tablet::InsertRequest request;
-                BuildInsertRequest(db, insert_stmt->table_name_, insert_stmt->columns_,
-                                   dynamic_cast<node::ExprListNode*>(*iter), &request, status);
-                if (status->code != 0) {
+                std::vector<node::ExprNode*> column_values;
+                if (!MapInsertValues(schema, insert_stmt->columns_, dynamic_cast<node::ExprListNode*>(*iter), false,
+                                     &column_values, status)) {
                     return;
                 }
-                Insert(request, status);
-                if (common::kOk != status->code) {
+                std::string row;
+                if (!EncodeInsertRow(schema, column_values, nullptr, &row, status)) {
                     return;
                 }
+                row_sizes.push_back(row.size());
+                rows.append(row);
             }
-
+            SendInsertBatch(channel_, db, insert_stmt->table_name_, row_sizes.data(), row_sizes.size(), rows.data(),
+                            status);
             return;
         }
         default: {
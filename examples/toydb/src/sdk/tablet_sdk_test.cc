@@ -224,6 +224,127 @@ TEST_P(TabletSdkTest, test_normal) {
     }
 }
 
+TEST_P(TabletSdkTest, test_prepared_insert) {
+    tablet::TabletInternalSDK interal_sdk("127.0.0.1:" +
+                                          std::to_string(base_tablet_port_));
+    bool ok = interal_sdk.Init();
+    ASSERT_TRUE(ok);
+    tablet::CreateTableRequest req;
+    req.set_tid(1);
+    req.add_pids(0);
+    req.set_db("db1");
+    type::TableDef* table_def = req.mutable_table();
+    table_def->set_catalog("db1");
+    table_def->set_name("t1");
+    {
+        ::hybridse::type::ColumnDef* column = table_def->add_columns();
+        column->set_type(::hybridse::type::kInt32);
+        column->set_name("col1");
+        column->set_is_not_null(true);
+    }
+    {
+        ::hybridse::type::ColumnDef* column = table_def->add_columns();
+        column->set_type(::hybridse::type::kVarchar);
+        column->set_name("col2");
+    }
+    {
+        ::hybridse::type::ColumnDef* column = table_def->add_columns();
+        column->set_type(::hybridse::type::kInt64);
+        column->set_name("col3");
+    }
+    ::hybridse::type::IndexDef* index = table_def->add_indexes();
+    index->set_name("idx1");
+    index->add_first_keys("col1");
+    index->set_second_key("col3");
+    common::Status status;
+    interal_sdk.CreateTable(&req, status);
+    ASSERT_EQ(status.code(), common::kOk);
+    std::shared_ptr<TabletSdk> sdk =
+        CreateTabletSdk("127.0.0.1:" + std::to_string(base_tablet_port_));
+    ASSERT_TRUE(sdk);
+    std::string db = "db1";
+    {
+        // rows sent as they are still respect NOT NULL columns
+        ::hybridse::sdk::Status insert_status;
+        std::shared_ptr<PreparedInsert> insert =
+            sdk->PrepareInsert(db, "insert into t1 values(?, ?, ?);",
+                               &insert_status);
+        ASSERT_EQ(0, static_cast<int>(insert_status.code));
+        std::shared_ptr<RequestRow> row = insert->NewRow();
+        ASSERT_TRUE(row->Init(2));
+        ASSERT_TRUE(row->AppendNULL());
+        ASSERT_TRUE(row->AppendString("hi"));
+        ASSERT_TRUE(row->AppendInt64(1));
+        ASSERT_TRUE(row->Build());
+        ASSERT_FALSE(insert->AddRow(row.get(), &insert_status));
+        ASSERT_EQ(0u, insert->GetRowCount());
+    }
+    {
+        // rows of placeholders of all columns are sent as they are
+        ::hybridse::sdk::Status insert_status;
+        std::shared_ptr<PreparedInsert> insert =
+            sdk->PrepareInsert(db, "insert into t1 values(?, ?, ?);",
+                               &insert_status);
+        ASSERT_EQ(0, static_cast<int>(insert_status.code));
+        ASSERT_EQ(3, insert->GetParameterSchema().GetColumnCnt());
+        for (int64_t i = 0; i < 100; i++) {
+            std::shared_ptr<RequestRow> row = insert->NewRow();
+            ASSERT_TRUE(row->Init(2));
+            ASSERT_TRUE(row->AppendInt32(1));
+            ASSERT_TRUE(row->AppendString("hi"));
+            ASSERT_TRUE(row->AppendInt64(i));
+            ASSERT_TRUE(row->Build());
+            ASSERT_TRUE(insert->AddRow(row.get(), &insert_status));
+        }
+        ASSERT_EQ(100u, insert->GetRowCount());
+        insert->Execute(&insert_status);
+        ASSERT_EQ(0, static_cast<int>(insert_status.code));
+        ASSERT_EQ(0u, insert->GetRowCount());
+    }
+    {
+        // constants and unlisted columns are filled in
+        ::hybridse::sdk::Status insert_status;
+        std::shared_ptr<PreparedInsert> insert = sdk->PrepareInsert(
+            db, "insert into t1 (col3, col1) values(?, 2);", &insert_status);
+        ASSERT_EQ(0, static_cast<int>(insert_status.code));
+        ASSERT_EQ(1, insert->GetParameterSchema().GetColumnCnt());
+        ASSERT_EQ("col3", insert->GetParameterSchema().GetColumnName(0));
+        for (int64_t i = 0; i < 10; i++) {
+            std::shared_ptr<RequestRow> row = insert->NewRow();
+            ASSERT_TRUE(row->Init(0));
+            ASSERT_TRUE(row->AppendInt64(i));
+            ASSERT_TRUE(row->Build());
+            ASSERT_TRUE(insert->AddRow(row.get(), &insert_status));
+        }
+        insert->Execute(&insert_status);
+        ASSERT_EQ(0, static_cast<int>(insert_status.code));
+    }
+    {
+        // rows of all values are inserted by one batch
+        ::hybridse::sdk::Status insert_status;
+        sdk->Insert(db, "insert into t1 values(3, 'a', 1), (3, 'b', 2);",
+                    &insert_status);
+        ASSERT_EQ(0, static_cast<int>(insert_status.code));
+    }
+    {
+        sdk::Status query_status;
+        std::string sql = "select col1, col2, col3 from t1;";
+        std::shared_ptr<ResultSet> rs = sdk->Query(db, sql, &query_status);
+        ASSERT_TRUE(rs);
+        ASSERT_EQ(112, rs->Size());
+        int32_t null_cnt = 0;
+        while (rs->Next()) {
+            if (rs->IsNULL(1)) {
+                int32_t val = 0;
+                ASSERT_TRUE(rs->GetInt32(0, &val));
+                ASSERT_EQ(2, val);
+                null_cnt++;
+            }
+        }
+        ASSERT_EQ(10, null_cnt);
+    }
+}
+
 TEST_P(TabletSdkTest, test_explain) {
     usleep(4000 * 1000);
     const std::string endpoint = "127.0.0.1:" + std::to_string(base_dbms_port_);
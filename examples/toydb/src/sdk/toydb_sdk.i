@@ -34,6 +34,7 @@
 %shared_ptr(hybridse::sdk::ResultSet);
 %shared_ptr(hybridse::sdk::Date);
 %shared_ptr(hybridse::sdk::RequestRow);
+%shared_ptr(hybridse::sdk::PreparedInsert);
 
 %{
 #include "sdk/base.h"
@@ -51,6 +52,7 @@ using hybridse::sdk::RequestRow;
 using hybridse::sdk::DBMSSdk;
 using hybridse::sdk::TabletSdk;
 using hybridse::sdk::ExplainInfo;
+using hybridse::sdk::PreparedInsert;
 %}
 
 %include "sdk/base.h"
@@ -0,0 +1,406 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/binlog.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include "base/fe_hash.h"
+#include "boost/filesystem.hpp"
+#include "glog/logging.h"
+
+namespace hybridse {
+namespace storage {
+
+static constexpr uint32_t BINLOG_SEED = 0xe17000;
+// size and checksum of a record
+static constexpr uint32_t BINLOG_HEADER_SIZE = 8;
+static constexpr size_t BINLOG_READ_BUFFER_SIZE = 4 * 1024 * 1024;
+static const char BINLOG_SUFFIX[] = ".log";
+
+bool ParseSyncPolicy(const std::string& name, SyncPolicy* policy) {
+    if (name == "none") {
+        *policy = SyncPolicy::kSyncNone;
+    } else if (name == "group") {
+        *policy = SyncPolicy::kSyncGroup;
+    } else if (name == "interval") {
+        *policy = SyncPolicy::kSyncInterval;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+Binlog::Binlog(const std::string& dir, const BinlogOptions& options)
+    : dir_(dir),
+      options_(options),
+      mu_(),
+      cond_(),
+      writers_(),
+      next_offset_(0),
+      files_(),
+      broken_(false),
+      file_mu_(),
+      fd_(-1),
+      file_size_(0),
+      last_sync_(std::chrono::steady_clock::now()),
+      buf_() {}
+
+Binlog::~Binlog() {
+    if (fd_ >= 0) {
+        if (options_.sync_policy != SyncPolicy::kSyncNone) {
+            fdatasync(fd_);
+        }
+        close(fd_);
+    }
+}
+
+std::string Binlog::GetFilePath(uint64_t start_offset) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%020lu%s",
+             static_cast<unsigned long>(start_offset),  // NOLINT
+             BINLOG_SUFFIX);
+    return dir_ + "/" + name;
+}
+
+bool Binlog::Init() {
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(dir_, ec);
+    if (ec) {
+        LOG(WARNING) << "fail to create binlog dir " << dir_ << ": "
+                     << ec.message();
+        return false;
+    }
+    files_.clear();
+    boost::filesystem::directory_iterator end;
+    for (boost::filesystem::directory_iterator it(dir_, ec); !ec && it != end;
+         it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        size_t suffix_size = strlen(BINLOG_SUFFIX);
+        if (name.size() <= suffix_size ||
+            name.compare(name.size() - suffix_size, suffix_size,
+                         BINLOG_SUFFIX) != 0) {
+            continue;
+        }
+        char* name_end = nullptr;
+        uint64_t start_offset = strtoull(name.c_str(), &name_end, 10);
+        if (name_end != name.c_str() + name.size() - suffix_size) {
+            continue;
+        }
+        files_.push_back(start_offset);
+    }
+    if (ec) {
+        LOG(WARNING) << "fail to list binlog dir " << dir_ << ": "
+                     << ec.message();
+        return false;
+    }
+    std::sort(files_.begin(), files_.end());
+    if (files_.empty()) {
+        files_.push_back(0);
+        next_offset_ = 0;
+        return OpenFile(0, 0);
+    }
+    uint64_t valid_size = 0;
+    uint64_t record_cnt = 0;
+    if (!ScanFile(files_.back(), nullptr, true, &valid_size, &record_cnt)) {
+        return false;
+    }
+    next_offset_ = files_.back() + record_cnt;
+    DLOG(INFO) << "open binlog " << dir_ << " at offset " << next_offset_;
+    return OpenFile(files_.back(), valid_size);
+}
+
+bool Binlog::OpenFile(uint64_t start_offset, uint64_t size) {
+    std::string path = GetFilePath(start_offset);
+    int fd = open(path.c_str(), O_CREAT | O_WRONLY, 0644);
+    if (fd < 0) {
+        LOG(WARNING) << "fail to open binlog file " << path << ": "
+                     << strerror(errno);
+        return false;
+    }
+    // drop the torn tail if any
+    if (ftruncate(fd, size) != 0 || lseek(fd, size, SEEK_SET) < 0) {
+        LOG(WARNING) << "fail to seek binlog file " << path << ": "
+                     << strerror(errno);
+        close(fd);
+        return false;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+    fd_ = fd;
+    file_size_ = size;
+    return true;
+}
+
+bool Binlog::Append(const base::Slice& record, uint64_t* offset) {
+    return AppendBatch(&record, 1, offset);
+}
+
+bool Binlog::AppendBatch(const base::Slice* records, size_t cnt,
+                         uint64_t* offset) {
+    Writer w;
+    w.records = records;
+    w.cnt = cnt;
+    std::unique_lock<std::mutex> lock(mu_);
+    writers_.push_back(&w);
+    cond_.wait(lock, [&]() { return w.done || writers_.front() == &w; });
+    if (w.done) {
+        *offset = w.offset;
+        return w.ok;
+    }
+    // the head of the queue leads a group of every waiting writer, the next
+    // leader waits until the group is popped
+    std::vector<Writer*> group(writers_.begin(), writers_.end());
+    uint64_t start_offset = next_offset_;
+    bool ok = !broken_;
+    lock.unlock();
+    if (ok) {
+        std::lock_guard<std::mutex> file_lock(file_mu_);
+        buf_.clear();
+        for (auto writer : group) {
+            for (size_t i = 0; i < writer->cnt; i++) {
+                const base::Slice& record = writer->records[i];
+                uint32_t size = record.size();
+                uint32_t checksum =
+                    base::hash(record.data(), size, BINLOG_SEED);
+                buf_.append(reinterpret_cast<const char*>(&size),
+                            sizeof(size));
+                buf_.append(reinterpret_cast<const char*>(&checksum),
+                            sizeof(checksum));
+                buf_.append(record.data(), size);
+            }
+        }
+        ok = WriteGroup(buf_, start_offset);
+    }
+    lock.lock();
+    uint64_t record_cnt = 0;
+    for (auto writer : group) {
+        record_cnt += writer->cnt;
+    }
+    if (ok) {
+        next_offset_ += record_cnt;
+    } else if (!broken_) {
+        // offsets of records after a failed write are unknown
+        broken_ = true;
+        LOG(WARNING) << "binlog " << dir_ << " is broken at offset "
+                     << start_offset;
+    }
+    uint64_t next = start_offset;
+    for (auto writer : group) {
+        writers_.pop_front();
+        writer->offset = next;
+        writer->ok = ok;
+        writer->done = true;
+        next += writer->cnt;
+    }
+    cond_.notify_all();
+    *offset = w.offset;
+    return w.ok;
+}
+
+bool Binlog::WriteGroup(const std::string& buf, uint64_t start_offset) {
+    if (file_size_ > 0 && file_size_ + buf.size() > options_.max_file_size) {
+        if (options_.sync_policy != SyncPolicy::kSyncNone && !SyncLocked()) {
+            return false;
+        }
+        if (!OpenFile(start_offset, 0)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        files_.push_back(start_offset);
+    }
+    const char* data = buf.data();
+    size_t left = buf.size();
+    while (left > 0) {
+        ssize_t ret = write(fd_, data, left);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG(WARNING) << "fail to write binlog " << dir_ << ": "
+                         << strerror(errno);
+            return false;
+        }
+        data += ret;
+        left -= ret;
+    }
+    file_size_ += buf.size();
+    switch (options_.sync_policy) {
+        case SyncPolicy::kSyncGroup: {
+            return SyncLocked();
+        }
+        case SyncPolicy::kSyncInterval: {
+            if (std::chrono::steady_clock::now() - last_sync_ >=
+                std::chrono::milliseconds(options_.sync_interval_ms)) {
+                return SyncLocked();
+            }
+            return true;
+        }
+        default: {
+            return true;
+        }
+    }
+}
+
+bool Binlog::SyncLocked() {
+    if (fd_ < 0) {
+        return false;
+    }
+    if (fdatasync(fd_) != 0) {
+        LOG(WARNING) << "fail to sync binlog " << dir_ << ": "
+                     << strerror(errno);
+        return false;
+    }
+    last_sync_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool Binlog::Sync() {
+    std::lock_guard<std::mutex> lock(file_mu_);
+    return SyncLocked();
+}
+
+uint64_t Binlog::GetOffset() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return next_offset_;
+}
+
+bool Binlog::ScanFile(
+    uint64_t start_offset,
+    const std::function<bool(uint64_t, const base::Slice&)>& fn,
+    bool allow_torn_tail, uint64_t* valid_size, uint64_t* record_cnt) {
+    std::string path = GetFilePath(start_offset);
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL) {
+        LOG(WARNING) << "fail to open binlog file " << path << ": "
+                     << strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0) {
+        LOG(WARNING) << "fail to stat binlog file " << path << ": "
+                     << strerror(errno);
+        fclose(file);
+        return false;
+    }
+    uint64_t file_size = st.st_size;
+    std::unique_ptr<char[]> read_buf(new char[BINLOG_READ_BUFFER_SIZE]);
+    setvbuf(file, read_buf.get(), _IOFBF, BINLOG_READ_BUFFER_SIZE);
+    *valid_size = 0;
+    *record_cnt = 0;
+    bool ok = true;
+    std::string record;
+    while (true) {
+        uint32_t header[2];
+        size_t header_size = fread(header, 1, BINLOG_HEADER_SIZE, file);
+        if (header_size == 0) {
+            break;
+        }
+        // a length past the end of file is corrupted, never allocated
+        bool torn = header_size != BINLOG_HEADER_SIZE ||
+                    *valid_size + BINLOG_HEADER_SIZE + header[0] > file_size;
+        if (!torn) {
+            record.resize(header[0]);
+            torn = fread(&record[0], 1, header[0], file) != header[0] ||
+                   base::hash(record.data(), header[0], BINLOG_SEED) !=
+                       header[1];
+        }
+        if (torn) {
+            if (!allow_torn_tail) {
+                LOG(WARNING) << "binlog file " << path << " is corrupted at "
+                             << *valid_size;
+                ok = false;
+                break;
+            }
+            // torn by a crash while the record is written
+            LOG(WARNING) << "binlog file " << path << " is torn at "
+                         << *valid_size;
+            break;
+        }
+        if (fn && !fn(start_offset + *record_cnt, base::Slice(record))) {
+            ok = false;
+            break;
+        }
+        *valid_size += BINLOG_HEADER_SIZE + header[0];
+        (*record_cnt)++;
+    }
+    fclose(file);
+    return ok;
+}
+
+bool Binlog::Replay(
+    uint64_t start_offset,
+    const std::function<bool(uint64_t, const base::Slice&)>& fn) {
+    std::vector<uint64_t> files;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        files = files_;
+    }
+    for (size_t i = 0; i < files.size(); i++) {
+        if (i + 1 < files.size() && files[i + 1] <= start_offset) {
+            continue;
+        }
+        uint64_t valid_size = 0;
+        uint64_t record_cnt = 0;
+        bool is_last = i + 1 == files.size();
+        bool ok = ScanFile(
+            files[i],
+            [&](uint64_t offset, const base::Slice& record) {
+                return offset < start_offset || fn(offset, record);
+            },
+            is_last, &valid_size, &record_cnt);
+        if (!ok) {
+            return false;
+        }
+        // a file ends where the next one starts
+        if (!is_last && files[i] + record_cnt != files[i + 1]) {
+            LOG(WARNING) << "binlog file " << GetFilePath(files[i]) << " has "
+                         << record_cnt << " records, "
+                         << files[i + 1] - files[i] << " expected";
+            return false;
+        }
+    }
+    return true;
+}
+
+void Binlog::Purge(uint64_t offset) {
+    std::vector<uint64_t> removed;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        while (files_.size() > 1 && files_[1] <= offset) {
+            removed.push_back(files_.front());
+            files_.erase(files_.begin());
+        }
+    }
+    for (auto start_offset : removed) {
+        boost::system::error_code ec;
+        boost::filesystem::remove(GetFilePath(start_offset), ec);
+        if (ec) {
+            LOG(WARNING) << "fail to remove binlog file "
+                         << GetFilePath(start_offset) << ": " << ec.message();
+        }
+    }
+}
+
+}  // namespace storage
+}  // namespace hybridse
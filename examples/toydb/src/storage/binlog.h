@@ -0,0 +1,132 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+#include "base/fe_slice.h"
+
+namespace hybridse {
+namespace storage {
+
+enum class SyncPolicy {
+    // written records are left to the page cache of the os
+    kSyncNone = 0,
+    // every group of records is synced before its appends return
+    kSyncGroup,
+    // groups are synced at most once every `sync_interval_ms`
+    kSyncInterval,
+};
+
+// Parse "none", "group" or "interval"
+bool ParseSyncPolicy(const std::string& name, SyncPolicy* policy);
+
+struct BinlogOptions {
+    SyncPolicy sync_policy = SyncPolicy::kSyncGroup;
+    uint64_t sync_interval_ms = 1000;
+    // a new log file is started once the current one is larger
+    uint64_t max_file_size = 256 * 1024 * 1024;
+};
+
+// Write ahead log of records numbered by offset from 0. Records are kept in
+// files named by the offset of their first record under `dir`, each of them
+// is framed by its size and checksum.
+//
+// Concurrent appends are group committed: the writer at the head of the
+// queue writes the records of every waiting writer with one write and sync,
+// the others just wait for it.
+class Binlog {
+ public:
+    Binlog(const std::string& dir, const BinlogOptions& options);
+    ~Binlog();
+    Binlog(const Binlog&) = delete;
+    Binlog& operator=(const Binlog&) = delete;
+
+    // Open the log, a torn record left at the tail by a crash is truncated
+    bool Init();
+
+    // Append a record and return once it is written and synced by the
+    // policy, `offset` is set to offset of the record
+    bool Append(const base::Slice& record, uint64_t* offset);
+    // Append `cnt` records at consecutive offsets, `offset` is set to the
+    // offset of the first one
+    bool AppendBatch(const base::Slice* records, size_t cnt,
+                     uint64_t* offset);
+
+    bool Sync();
+
+    // Offset the next record is appended at
+    uint64_t GetOffset();
+
+    // Call `fn` with records from `start_offset` on in order, stop once it
+    // returns false
+    bool Replay(
+        uint64_t start_offset,
+        const std::function<bool(uint64_t, const base::Slice&)>& fn);
+
+    // Remove files holding records before `offset` only
+    void Purge(uint64_t offset);
+
+ private:
+    struct Writer {
+        const base::Slice* records = nullptr;
+        size_t cnt = 0;
+        uint64_t offset = 0;
+        bool done = false;
+        bool ok = false;
+    };
+
+    std::string GetFilePath(uint64_t start_offset) const;
+    bool OpenFile(uint64_t start_offset, uint64_t size);
+    bool WriteGroup(const std::string& buf, uint64_t start_offset);
+    bool SyncLocked();
+    // Scan records of a file from `start_offset`, return the size of the
+    // valid prefix of the file. Only the last file may be torn by a crash,
+    // a bad record fails the scan unless `allow_torn_tail`.
+    bool ScanFile(
+        uint64_t start_offset,
+        const std::function<bool(uint64_t, const base::Slice&)>& fn,
+        bool allow_torn_tail, uint64_t* valid_size, uint64_t* record_cnt);
+
+    const std::string dir_;
+    const BinlogOptions options_;
+
+    // guards the writer queue, `next_offset_` and `files_`
+    std::mutex mu_;
+    std::condition_variable cond_;
+    std::deque<Writer*> writers_;
+    uint64_t next_offset_;
+    // start offsets of log files in ascending order
+    std::vector<uint64_t> files_;
+    bool broken_;
+
+    // guards the current file, held by the group leader and `Sync`
+    std::mutex file_mu_;
+    int fd_;
+    uint64_t file_size_;
+    std::chrono::steady_clock::time_point last_sync_;
+    // records of the group being written, reused by leaders
+    std::string buf_;
+};
+
+}  // namespace storage
+}  // namespace hybridse
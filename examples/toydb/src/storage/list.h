@@ -22,7 +22,9 @@
 #include <cstddef>
 #include <memory>
 #include <type_traits>
+#include <vector>
 #include "base/iterator.h"
+#include "storage/skiplist.h"
 
 namespace hybridse {
 namespace storage {
@@ -30,10 +32,13 @@ namespace storage {
 using ::hybridse::base::Iterator;
 
 constexpr uint16_t MAX_ARRAY_LIST_LEN = 400;
+constexpr uint8_t SKIP_LIST_MAX_HEIGHT = 12;
+constexpr uint8_t SKIP_LIST_BRANCH = 4;
 
 enum class ListType {
     kArrayList = 1,
     kLinkList = 2,
+    kSkipList = 3,
 };
 
 template <class K, class V>
@@ -393,31 +398,51 @@ class ArrayList : public BaseList<K, V> {
                                    std::memory_order_release);
     }
 
-    // TODO(denglong) : use binary search
     uint32_t FindLessOrEqual(const K& key) {
         std::shared_ptr<ArrayListNode<K, V>> array =
             std::atomic_load_explicit(&array_, std::memory_order_acquire);
-        ArrayListNode<K, V>* array_ptr = array.get();
-        uint32_t length = GetSize();
-        for (uint32_t idx = 0; idx < length; idx++) {
-            if (compare_(array_ptr[idx].key_, key) >= 0) {
-                return idx;
-            }
+        if (!array) {
+            return 0;
         }
-        return length;
+        return LowerBound(array.get(), ARRAY_HDR(array.get())->length_, key,
+                          compare_);
     }
 
     uint32_t FindLessThan(const K& key) {
         std::shared_ptr<ArrayListNode<K, V>> array =
             std::atomic_load_explicit(&array_, std::memory_order_acquire);
+        if (!array) {
+            return 0;
+        }
         ArrayListNode<K, V>* array_ptr = array.get();
-        uint32_t length = GetSize();
-        for (uint32_t idx = 0; idx < length; idx++) {
-            if (compare_(array_ptr[idx].key_, key) > 0) {
-                return idx;
+        uint32_t begin = 0;
+        uint32_t end = ARRAY_HDR(array_ptr)->length_;
+        while (begin < end) {
+            uint32_t mid = begin + (end - begin) / 2;
+            if (compare_(array_ptr[mid].key_, key) > 0) {
+                end = mid;
+            } else {
+                begin = mid + 1;
             }
         }
-        return length;
+        return begin;
+    }
+
+    // Return the first position the key of which is not before `key`
+    static uint32_t LowerBound(const ArrayListNode<K, V>* array_ptr,
+                               uint32_t length, const K& key,
+                               const Comparator& compare) {
+        uint32_t begin = 0;
+        uint32_t end = length;
+        while (begin < end) {
+            uint32_t mid = begin + (end - begin) / 2;
+            if (compare(array_ptr[mid].key_, key) >= 0) {
+                end = mid;
+            } else {
+                begin = mid + 1;
+            }
+        }
+        return begin;
     }
 
     LinkList<K, V, Comparator>* ConvertToLinkList() {
@@ -437,6 +462,26 @@ class ArrayList : public BaseList<K, V> {
         return list;
     }
 
+    // Build a skip list of the entries, entries are added from the last
+    // one so each of them is added to the front
+    SkipList<K, V, Comparator>* ConvertToSkipList() {
+        uint32_t length = GetSize();
+        if (length == 0) {
+            return NULL;
+        }
+        SkipList<K, V, Comparator>* list = new SkipList<K, V, Comparator>(
+            SKIP_LIST_MAX_HEIGHT, SKIP_LIST_BRANCH, compare_);
+        std::shared_ptr<ArrayListNode<K, V>> array =
+            std::atomic_load_explicit(&array_, std::memory_order_relaxed);
+        ArrayListNode<K, V>* array_ptr = array.get();
+        for (uint32_t idx = 0; idx < length; idx++) {
+            uint32_t cur_idx = length - idx - 1;
+            list->AddToFirst(array_ptr[cur_idx].key_,
+                             array_ptr[cur_idx].value_);
+        }
+        return list;
+    }
+
     class ArrayListIterator : public Iterator<K, V> {
      public:
         explicit ArrayListIterator(ArrayList<K, V, Comparator>* list)
@@ -473,13 +518,7 @@ class ArrayList : public BaseList<K, V> {
         }
         virtual void Seek(const K& key) {
             if (array_) {
-                ArrayListNode<K, V>* array_ptr = array_.get();
-                for (uint32_t idx = 0; idx < length_; idx++) {
-                    if (compare_(array_ptr[idx].key_, key) >= 0) {
-                        pos_ = idx;
-                        break;
-                    }
-                }
+                pos_ = LowerBound(array_.get(), length_, key, compare_);
             }
         }
         virtual bool IsSeekable() const { return true; }
@@ -501,6 +540,33 @@ class ArrayList : public BaseList<K, V> {
     std::shared_ptr<ArrayListNode<K, V>> array_;
 };
 
+// Time entries of deep keys, inserts and seeks are O(log n) instead of
+// walking a link list
+template <class K, class V, class Comparator>
+class SkipListAdapter : public BaseList<K, V> {
+ public:
+    // take the ownership of `list`
+    explicit SkipListAdapter(SkipList<K, V, Comparator>* list) : list_(list) {}
+    ~SkipListAdapter() {
+        list_->Clear();
+        delete list_;
+    }
+
+    void Insert(const K& key, V& value) override {  // NOLINT
+        list_->Insert(key, value);
+    }
+    uint32_t GetSize() override { return list_->GetSize(); }
+    bool IsEmpty() override { return list_->IsEmpty(); }
+    ListType GetType() const override { return ListType::kSkipList; }
+    Iterator<K, V>* NewIterator() override { return list_->NewIterator(); }
+
+    // Cut nodes from the `pos`-th on, return them as a chain
+    Node<K, V>* SplitByPos(uint64_t pos) { return list_->SplitByPos(pos); }
+
+ private:
+    SkipList<K, V, Comparator>* list_;
+};
+
 template <class K, class V, class Comparator>
 class List {
  public:
@@ -516,12 +582,11 @@ class List {
             list->GetSize() >= MAX_ARRAY_LIST_LEN) {
             ArrayList<K, V, Comparator>* array_list =
                 dynamic_cast<ArrayList<K, V, Comparator>*>(list);
-            LinkList<K, V, Comparator>* new_list =
-                array_list->ConvertToLinkList();
-            if (new_list != NULL) {
-                list_.store(new_list, std::memory_order_release);
-                delete array_list;
-            }
+            SkipListAdapter<K, V, Comparator>* new_list =
+                new SkipListAdapter<K, V, Comparator>(
+                    array_list->ConvertToSkipList());
+            list_.store(new_list, std::memory_order_release);
+            delete array_list;
             new_list->Insert(key, value);
         } else {
             list->Insert(key, value);
@@ -532,6 +597,44 @@ class List {
         return list_.load(std::memory_order_relaxed)->NewIterator();
     }
 
+    // Cut entries from the `pos`-th on, values of them are appended to
+    // `values`. Nodes cut from a skip list are returned as a chain, readers
+    // may still be on them so they are to be deleted by `DeleteNodes` later.
+    // Must not run with `Insert` concurrently.
+    Node<K, V>* Truncate(uint64_t pos, std::vector<V>* values) {
+        BaseList<K, V>* list = list_.load(std::memory_order_relaxed);
+        if (list->GetType() == ListType::kSkipList) {
+            Node<K, V>* node =
+                dynamic_cast<SkipListAdapter<K, V, Comparator>*>(list)
+                    ->SplitByPos(pos);
+            for (auto cur = node; cur != NULL;
+                 cur = cur->GetNextNoBarrier(0)) {
+                values->push_back(cur->GetValue());
+            }
+            return node;
+        }
+        std::unique_ptr<Iterator<K, V>> it(list->NewIterator());
+        it->SeekToFirst();
+        uint64_t idx = 0;
+        for (; it->Valid(); it->Next(), idx++) {
+            if (idx >= pos) {
+                values->push_back(it->GetValue());
+            }
+        }
+        if (pos < idx) {
+            dynamic_cast<ArrayList<K, V, Comparator>*>(list)->SplitByPos(pos);
+        }
+        return NULL;
+    }
+
+    static void DeleteNodes(Node<K, V>* node) {
+        while (node != NULL) {
+            Node<K, V>* next = node->GetNextNoBarrier(0);
+            delete node;
+            node = next;
+        }
+    }
+
  private:
     Comparator const compare_;
     std::atomic<BaseList<K, V>*> list_;
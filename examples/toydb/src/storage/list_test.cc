@@ -17,8 +17,10 @@
 #include "storage/list.h"
 #include <sys/time.h>
 #include <time.h>
+#include <memory>
 #include <random>
 #include <string>
+#include <vector>
 #include "gtest/gtest.h"
 #include "storage/skiplist.h"
 
@@ -239,6 +241,41 @@ TEST_F(ListTest, ArrayListEqualItem) {
     delete iter;
 }
 
+TEST_F(ListTest, ListToSkipList) {
+    List<uint64_t, uint64_t, DefaultComparator> list(cmp);
+    uint64_t cnt = MAX_ARRAY_LIST_LEN * 5;
+    // odd keys fill the array list, even keys go to the skip list
+    for (uint64_t idx = 0; idx < cnt; idx++) {
+        uint64_t key = idx < MAX_ARRAY_LIST_LEN ? idx * 2 + 1
+                                                : (idx - MAX_ARRAY_LIST_LEN) * 2;
+        list.Insert(key, key);
+    }
+    std::unique_ptr<Iterator<uint64_t, uint64_t>> iter(list.NewIterator());
+    iter->SeekToFirst();
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ((cnt - MAX_ARRAY_LIST_LEN - 1) * 2, iter->GetKey());
+    iter->Seek(MAX_ARRAY_LIST_LEN * 2 - 1);
+    uint64_t expect = MAX_ARRAY_LIST_LEN * 2 - 1;
+    for (; iter->Valid(); iter->Next(), expect--) {
+        ASSERT_EQ(expect, iter->GetKey());
+        ASSERT_EQ(expect, iter->GetValue());
+    }
+    ASSERT_EQ(UINT64_MAX, expect);
+
+    std::vector<uint64_t> values;
+    Node<uint64_t, uint64_t>* node = list.Truncate(10, &values);
+    ASSERT_TRUE(node != NULL);
+    ASSERT_EQ(cnt - 10, values.size());
+    iter.reset(list.NewIterator());
+    iter->SeekToFirst();
+    uint64_t left = 0;
+    for (; iter->Valid(); iter->Next()) {
+        left++;
+    }
+    ASSERT_EQ(10u, left);
+    List<uint64_t, uint64_t, DefaultComparator>::DeleteNodes(node);
+}
+
 /*TEST_F(ListTest, SkipListPerform) {
     {
         std::vector<::hybridse::base::Skiplist<uint64_t, uint64_t,
@@ -15,6 +15,8 @@
  */
 
 #include "storage/segment.h"
+#include <algorithm>
+#include <chrono>  // NOLINT
 #include <mutex>  //NOLINT
 
 namespace hybridse {
@@ -26,18 +28,118 @@ Segment::Segment() : entries_(NULL), mu_() {
 
 Segment::~Segment() { delete entries_; }
 
-void Segment::Put(const base::Slice& key, uint64_t time, DataBlock* row) {
+TimeEntry* Segment::GetOrInsertEntry(const base::Slice& key) {
     void* entry = NULL;
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    int ret = entries_->Get(key, entry);
-    if (ret < 0 || entry == NULL) {
-        entry = reinterpret_cast<void*>(new TimeEntry(tcmp));
-        char* pk = new char[key.size()];
-        memcpy(pk, key.data(), key.size());
-        base::Slice skey(pk, key.size());
-        entries_->Insert(skey, entry);
+    if (entries_->Get(key, entry) < 0 || entry == NULL) {
+        std::lock_guard<base::SpinMutex> lock(mu_);
+        // the key may be inserted by another writer since the former lookup
+        if (entries_->Get(key, entry) < 0 || entry == NULL) {
+            entry = reinterpret_cast<void*>(new TimeEntry(tcmp));
+            char* pk = new char[key.size()];
+            memcpy(pk, key.data(), key.size());
+            base::Slice skey(pk, key.size());
+            entries_->Insert(skey, entry);
+        }
+    }
+    return reinterpret_cast<TimeEntry*>(entry);
+}
+
+void Segment::Put(const base::Slice& key, uint64_t time, DataBlock* row) {
+    TimeEntry* time_entry = GetOrInsertEntry(key);
+    std::lock_guard<base::SpinMutex> lock(GetKeyLock(time_entry));
+    time_entry->Insert(time, row);
+}
+
+void Segment::Put(const KeyedRow* rows, uint32_t cnt) {
+    if (cnt == 0) {
+        return;
+    }
+    TimeEntry* time_entry = GetOrInsertEntry(rows[0].key);
+    std::lock_guard<base::SpinMutex> lock(GetKeyLock(time_entry));
+    for (uint32_t i = 0; i < cnt; i++) {
+        DataBlock* row = rows[i].row;
+        time_entry->Insert(rows[i].time, row);
+    }
+}
+
+// Return the position rows from which on are expired, or UINT64_MAX if no
+// row of the entry can expire
+static uint64_t GetExpirePos(TimeEntry* entry, const TTLSt& ttl,
+                             uint64_t expire_time) {
+    bool by_time = ttl.abs_ttl > 0;
+    bool by_cnt = ttl.lat_ttl > 0;
+    switch (ttl.ttl_type) {
+        case type::kTTLTimeLive: {
+            by_cnt = false;
+            break;
+        }
+        case type::kTTLCountLive: {
+            by_time = false;
+            break;
+        }
+        case type::kTTLTimeLiveAndCountLive: {
+            // expired only if expired on both
+            if (!by_time || !by_cnt) {
+                return UINT64_MAX;
+            }
+            break;
+        }
+        case type::kTTLTimeLiveOrCountLive: {
+            break;
+        }
+        default: {
+            return UINT64_MAX;
+        }
+    }
+    uint64_t time_pos = UINT64_MAX;
+    if (by_time) {
+        // times are in descending order
+        std::unique_ptr<base::Iterator<uint64_t, DataBlock*>> it(
+            entry->NewIterator());
+        it->SeekToFirst();
+        uint64_t pos = 0;
+        while (it->Valid() && it->GetKey() >= expire_time) {
+            it->Next();
+            pos++;
+        }
+        time_pos = it->Valid() ? pos : UINT64_MAX;
+    }
+    uint64_t cnt_pos = by_cnt ? ttl.lat_ttl : UINT64_MAX;
+    if (ttl.ttl_type == type::kTTLTimeLiveAndCountLive) {
+        return std::max(time_pos, cnt_pos);
+    }
+    return std::min(time_pos, cnt_pos);
+}
+
+void Segment::Gc(const TTLSt& ttl, uint64_t expire_time,
+                 std::vector<DataBlock*>* blocks,
+                 std::vector<TimeEntryNode*>* nodes, GcStat* stat) {
+    std::unique_ptr<base::Iterator<Slice, void*>> it(entries_->NewIterator());
+    it->SeekToFirst();
+    while (it->Valid()) {
+        TimeEntry* entry = reinterpret_cast<TimeEntry*>(it->GetValue());
+        auto start = std::chrono::steady_clock::now();
+        size_t cut_cnt = blocks->size();
+        {
+            // writers of the key are blocked while positions are computed
+            // and rows are cut, or else a row put in between may be cut
+            std::lock_guard<base::SpinMutex> lock(GetKeyLock(entry));
+            uint64_t pos = GetExpirePos(entry, ttl, expire_time);
+            if (pos != UINT64_MAX) {
+                TimeEntryNode* node = entry->Truncate(pos, blocks);
+                if (node != NULL) {
+                    nodes->push_back(node);
+                }
+            }
+        }
+        uint64_t pause_us =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count();
+        stat->max_pause_us = std::max(stat->max_pause_us, pause_us);
+        stat->expired_row_cnt += blocks->size() - cut_cnt;
+        it->Next();
     }
-    reinterpret_cast<TimeEntry*>(entry)->Insert(time, row);
 }
 
 }  // namespace storage
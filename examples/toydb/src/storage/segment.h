@@ -17,6 +17,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
@@ -34,7 +35,10 @@ using ::hybridse::base::Iterator;
 using ::hybridse::base::Slice;
 
 struct DataBlock {
+    // number of indexes still holding the block, only decremented by gc
     uint32_t ref_cnt;
+    // binlog offset of the row, rows not logged are taken as logged at 0
+    uint64_t offset;
     char data[];
 };
 
@@ -61,19 +65,77 @@ static constexpr SliceComparator scmp;
 static constexpr TimeComparator tcmp;
 
 using TimeEntry = List<uint64_t, DataBlock*, TimeComparator>;
+using TimeEntryNode = Node<uint64_t, DataBlock*>;
 using KeyEntry = SkipList<Slice, void*, SliceComparator>;
 
+// ttl of an index, `abs_ttl` in milliseconds and `lat_ttl` in rows, 0 means
+// no limit on that dimension
+struct TTLSt {
+    ::hybridse::type::TTLType ttl_type = ::hybridse::type::kTTLNone;
+    uint64_t abs_ttl = 0;
+    uint64_t lat_ttl = 0;
+};
+
+struct GcStat {
+    uint64_t expired_row_cnt = 0;
+    uint64_t freed_row_cnt = 0;
+    uint64_t freed_bytes = 0;
+    // time of gc rounds, and the longest time a segment is locked by gc
+    uint64_t gc_time_us = 0;
+    uint64_t max_pause_us = 0;
+};
+
+// a row keyed by an index, for rows put in batches
+struct KeyedRow {
+    Slice key;
+    uint64_t time;
+    DataBlock* row;
+    uint32_t seg_index;
+};
+
+// number of locks the keys of a segment are striped over
+static constexpr uint32_t KEY_LOCK_STRIPE = 64;
+
 class Segment {
  public:
     Segment();
     ~Segment();
 
+    // Rows of different keys are put concurrently: the key entry is found
+    // without lock, `mu_` only serializes inserting new keys, and the row is
+    // inserted under the stripe lock of the key. `key` is copied only if it
+    // is new to the segment.
     void Put(const Slice& key, uint64_t time, DataBlock* row);
+    // Put `cnt` rows of the same key with one lookup and one lock of the key
+    void Put(const KeyedRow* rows, uint32_t cnt);
     inline KeyEntry* GetEntries() { return entries_; }
 
+    // Cut rows expired by `ttl` off every key, rows with time before
+    // `expire_time` are expired by time. Blocks of the cut rows are appended
+    // to `blocks` and cut skip list nodes to `nodes`, readers may still be
+    // on them so they are freed by the caller later.
+    void Gc(const TTLSt& ttl, uint64_t expire_time,
+            std::vector<DataBlock*>* blocks,
+            std::vector<TimeEntryNode*>* nodes, GcStat* stat);
+
  private:
+    // padded so writers of different stripes do not share cache lines
+    struct alignas(64) KeyLock {
+        base::SpinMutex mu;
+    };
+
+    // Find the entry of `key`, insert it if it is new
+    TimeEntry* GetOrInsertEntry(const Slice& key);
+
+    inline base::SpinMutex& GetKeyLock(const TimeEntry* entry) {
+        return key_locks_[(reinterpret_cast<uintptr_t>(entry) >> 4) %
+                          KEY_LOCK_STRIPE]
+            .mu;
+    }
+
     KeyEntry* entries_;
     base::SpinMutex mu_;
+    KeyLock key_locks_[KEY_LOCK_STRIPE];
 };
 
 }  // namespace storage
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/table_gc.h"
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include "glog/logging.h"
+
+namespace hybridse {
+namespace storage {
+
+TableGc::TableGc(uint64_t interval_ms)
+    : interval_ms_(interval_ms), mu_(), cond_(), running_(false) {}
+
+TableGc::~TableGc() { Stop(); }
+
+void TableGc::AddTable(std::shared_ptr<Table> table) {
+    std::lock_guard<std::mutex> lock(mu_);
+    tables_.push_back(table);
+}
+
+void TableGc::Start() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread([this]() { WorkLoop(); });
+}
+
+void TableGc::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        running_ = false;
+    }
+    cond_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+GcStat TableGc::RunOnce() {
+    std::vector<std::shared_ptr<Table>> tables;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto end = std::remove_if(
+            tables_.begin(), tables_.end(),
+            [](const std::weak_ptr<Table>& table) { return table.expired(); });
+        tables_.erase(end, tables_.end());
+        for (auto& table : tables_) {
+            auto locked = table.lock();
+            if (locked) {
+                tables.push_back(locked);
+            }
+        }
+    }
+    GcStat stat;
+    for (auto& table : tables) {
+        GcStat table_stat = table->SchedGc();
+        stat.expired_row_cnt += table_stat.expired_row_cnt;
+        stat.freed_row_cnt += table_stat.freed_row_cnt;
+        stat.freed_bytes += table_stat.freed_bytes;
+        stat.gc_time_us += table_stat.gc_time_us;
+        stat.max_pause_us =
+            std::max(stat.max_pause_us, table_stat.max_pause_us);
+    }
+    return stat;
+}
+
+void TableGc::WorkLoop() {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (running_) {
+        cond_.wait_for(lock, std::chrono::milliseconds(interval_ms_),
+                       [this]() { return !running_; });
+        if (!running_) {
+            break;
+        }
+        lock.unlock();
+        GcStat stat = RunOnce();
+        LOG(INFO) << "gc round done: expired " << stat.expired_row_cnt
+                  << " rows, freed " << stat.freed_row_cnt << " rows of "
+                  << stat.freed_bytes << " bytes, took " << stat.gc_time_us
+                  << "us, max pause " << stat.max_pause_us << "us";
+        lock.lock();
+    }
+}
+
+}  // namespace storage
+}  // namespace hybridse
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>  // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+#include "storage/table_impl.h"
+
+namespace hybridse {
+namespace storage {
+
+// Background thread running ttl gc rounds on registered tables every
+// `interval_ms`. Tables are held weakly and dropped once destroyed.
+class TableGc {
+ public:
+    explicit TableGc(uint64_t interval_ms);
+    ~TableGc();
+    TableGc(const TableGc&) = delete;
+    TableGc& operator=(const TableGc&) = delete;
+
+    void AddTable(std::shared_ptr<Table> table);
+
+    void Start();
+    void Stop();
+
+    // Run a gc round on every table, return stat summed over tables
+    GcStat RunOnce();
+
+ private:
+    void WorkLoop();
+
+    const uint64_t interval_ms_;
+    std::mutex mu_;
+    std::condition_variable cond_;
+    bool running_;
+    std::vector<std::weak_ptr<Table>> tables_;
+    std::thread thread_;
+};
+
+}  // namespace storage
+}  // namespace hybridse
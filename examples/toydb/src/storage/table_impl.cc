@@ -17,7 +17,9 @@
 #include "storage/table_impl.h"
 #include <sys/time.h>
 #include <algorithm>
+#include <chrono>  // NOLINT
 #include <string>
+#include <vector>
 #include "base/fe_hash.h"
 #include "base/fe_slice.h"
 #include "glog/logging.h"
@@ -35,6 +37,16 @@ Table::Table(uint32_t id, uint32_t pid, const TableDef& table_def)
       row_view_(table_def_.columns()) {}
 
 Table::~Table() {
+    for (auto nodes : {&gc_nodes_, &retired_nodes_}) {
+        for (auto node : *nodes) {
+            TimeEntry::DeleteNodes(node);
+        }
+    }
+    for (auto blocks : {&gc_blocks_, &retired_blocks_}) {
+        for (auto block : *blocks) {
+            free(block);
+        }
+    }
     if (segments_ != NULL) {
         for (uint32_t i = 0; i < index_map_.size(); i++) {
             for (uint32_t j = 0; j < seg_cnt_; j++) {
@@ -114,6 +126,29 @@ bool Table::Init() {
         }
         if (col_vec.empty()) return false;
         st.keys = col_vec;
+        const IndexDef& index_def = table_def_.indexes(idx);
+        if (index_def.ttl_size() > 0) {
+            // ttl is [abs_ttl] or [abs_ttl, lat_ttl], a single ttl of count
+            // ttl type is lat_ttl. abs_ttl is in milliseconds for both tables
+            // of create table and of yaml cases, see SqlCase::TTLParse
+            if (index_def.ttl_size() > 1) {
+                st.ttl.abs_ttl = index_def.ttl(0);
+                st.ttl.lat_ttl = index_def.ttl(1);
+            } else if (index_def.ttl_type() == type::kTTLCountLive) {
+                st.ttl.lat_ttl = index_def.ttl(0);
+            } else {
+                st.ttl.abs_ttl = index_def.ttl(0);
+            }
+            if (index_def.has_ttl_type()) {
+                st.ttl.ttl_type = index_def.ttl_type();
+            } else if (st.ttl.abs_ttl > 0 && st.ttl.lat_ttl > 0) {
+                st.ttl.ttl_type = type::kTTLTimeLiveAndCountLive;
+            } else if (st.ttl.lat_ttl > 0) {
+                st.ttl.ttl_type = type::kTTLCountLive;
+            } else {
+                st.ttl.ttl_type = type::kTTLTimeLive;
+            }
+        }
         index_map_.insert(
             std::make_pair(table_def_.indexes(idx).name(), std::move(st)));
     }
@@ -134,91 +169,312 @@ bool Table::Init() {
 bool Table::DecodeKeysAndTs(const IndexSt& index, const char* row,
                             uint32_t size, std::string& key,
                             int64_t* time_ptr) {
+    std::string buf;
+    base::Slice key_slice;
+    if (!DecodeKeysAndTs(index, row, size, &buf, &key_slice, time_ptr)) {
+        return false;
+    }
+    key.assign(key_slice.data(), key_slice.size());
+    return true;
+}
+
+bool Table::DecodeKeysAndTs(const IndexSt& index, const char* row,
+                            uint32_t size, std::string* buf, base::Slice* key,
+                            int64_t* time_ptr) {
+    const int8_t* row_ptr = reinterpret_cast<const int8_t*>(row);
+    buf->clear();
     if (index.keys.size() > 1) {
-        key.reserve(COMBINE_KEY_RESERVE_SIZE);
+        buf->reserve(COMBINE_KEY_RESERVE_SIZE);
         for (const auto& col : index.keys) {
-            if (!key.empty()) {
-                key.append("|");
+            if (!buf->empty()) {
+                buf->append("|");
             }
-            if (row_view_.IsNULL(reinterpret_cast<const int8_t*>(row),
-                                 col.second)) {
-                key.append(codec::NONETOKEN);
+            if (row_view_.IsNULL(row_ptr, col.second)) {
+                buf->append(codec::NONETOKEN);
             } else if (col.first == ::hybridse::type::kVarchar) {
                 const char* val = NULL;
                 uint32_t length = 0;
-                row_view_.GetValue(reinterpret_cast<const int8_t*>(row),
-                                   col.second, &val, &length);
+                row_view_.GetValue(row_ptr, col.second, &val, &length);
                 if (length != 0) {
-                    key.append(val, length);
+                    buf->append(val, length);
                 } else {
-                    key.append(codec::EMPTY_STRING);
+                    buf->append(codec::EMPTY_STRING);
                 }
             } else {
                 int64_t value = 0;
-                row_view_.GetInteger(reinterpret_cast<const int8_t*>(row),
-                                     col.second, col.first, &value);
-                key.append(std::to_string(value));
+                row_view_.GetInteger(row_ptr, col.second, col.first, &value);
+                buf->append(std::to_string(value));
             }
         }
+        *key = base::Slice(*buf);
     } else {
-        if (row_view_.IsNULL(reinterpret_cast<const int8_t*>(row),
-                             index.keys[0].second)) {
-            key = codec::NONETOKEN;
+        if (row_view_.IsNULL(row_ptr, index.keys[0].second)) {
+            *key = base::Slice(codec::NONETOKEN);
         } else if (index.keys[0].first == ::hybridse::type::kVarchar) {
-            const char* buf = nullptr;
-            uint32_t size = 0;
-            key = row_view_.GetValue(reinterpret_cast<const int8_t*>(row),
-                                     index.keys[0].second, &buf, &size);
-            key = std::string(buf, size);
-            if (key == "") {
-                key = codec::EMPTY_STRING;
+            const char* val = nullptr;
+            uint32_t length = 0;
+            row_view_.GetValue(row_ptr, index.keys[0].second, &val, &length);
+            if (length != 0) {
+                *key = base::Slice(val, length);
+            } else {
+                *key = base::Slice(codec::EMPTY_STRING);
             }
         } else {
             int64_t value = 0;
-            row_view_.GetInteger(reinterpret_cast<const int8_t*>(row),
-                                 index.keys[0].second, index.keys[0].first,
-                                 &value);
-            key = std::to_string(value);
+            row_view_.GetInteger(row_ptr, index.keys[0].second,
+                                 index.keys[0].first, &value);
+            buf->append(std::to_string(value));
+            *key = base::Slice(*buf);
         }
     }
     if (hybridse::vm::INVALID_POS == index.ts_pos ||
-        row_view_.IsNULL(reinterpret_cast<const int8_t*>(row), index.ts_pos)) {
+        row_view_.IsNULL(row_ptr, index.ts_pos)) {
         struct timeval cur_time;
         gettimeofday(&cur_time, NULL);
         *time_ptr = cur_time.tv_sec * 1000 + cur_time.tv_usec / 1000;
         return true;
     }
-    row_view_.GetInteger(reinterpret_cast<const int8_t*>(row), index.ts_pos,
+    row_view_.GetInteger(row_ptr, index.ts_pos,
                          table_def_.columns(index.ts_pos).type(), time_ptr);
     return true;
 }
-bool Table::Put(const char* row, uint32_t size) {
+
+bool Table::Put(const char* row, uint32_t size) { return Put(row, size, 0); }
+
+bool Table::Put(const char* row, uint32_t size, uint64_t offset) {
     if (row_view_.GetSize(reinterpret_cast<const int8_t*>(row)) != size) {
         return false;
     }
     DataBlock* block =
         reinterpret_cast<DataBlock*>(malloc(sizeof(DataBlock) + size));
     block->ref_cnt = table_def_.indexes_size();
+    block->offset = offset;
     memcpy(block->data, row, size);
+    // keys refer to the copy held by the block, segments copy new keys only
+    std::string buf;
     for (const auto& kv : index_map_) {
-        std::string key;
+        base::Slice key;
         uint32_t seg_index = 0;
         int64_t time = 1;
-        if (!DecodeKeysAndTs(kv.second, row, size, key, &time)) {
+        if (!DecodeKeysAndTs(kv.second, block->data, size, &buf, &key,
+                             &time)) {
+            // rows of former indexes may be put already
+            version_.fetch_add(1, std::memory_order_release);
             return false;
         }
         if (seg_cnt_ > 1) {
             seg_index =
-                ::hybridse::base::hash(key.c_str(), key.length(), SEED) %
+                ::hybridse::base::hash(key.data(), key.size(), SEED) %
                 seg_cnt_;
         }
         Segment* segment = segments_[kv.second.index][seg_index];
-        Slice spk(key);
-        segment->Put(spk, (uint64_t)time, block);
+        segment->Put(key, (uint64_t)time, block);
+    }
+    version_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+bool Table::PutBatch(const std::vector<base::Slice>& rows) {
+    return PutBatch(rows, 0);
+}
+
+bool Table::CheckRow(const char* row, uint32_t size) {
+    if (row == nullptr || size < codec::HEADER_LENGTH ||
+        row_view_.GetSize(reinterpret_cast<const int8_t*>(row)) != size) {
+        return false;
+    }
+    std::string buf;
+    for (const auto& kv : index_map_) {
+        base::Slice key;
+        int64_t time = 1;
+        if (!DecodeKeysAndTs(kv.second, row, size, &buf, &key, &time)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Table::PutBatch(const std::vector<base::Slice>& rows, uint64_t offset) {
+    for (const auto& row : rows) {
+        if (row_view_.GetSize(reinterpret_cast<const int8_t*>(row.data())) !=
+            row.size()) {
+            return false;
+        }
     }
+    std::vector<DataBlock*> blocks(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        DataBlock* block = reinterpret_cast<DataBlock*>(
+            malloc(sizeof(DataBlock) + rows[i].size()));
+        block->ref_cnt = table_def_.indexes_size();
+        block->offset = offset + i;
+        memcpy(block->data, rows[i].data(), rows[i].size());
+        blocks[i] = block;
+    }
+    // keys of a row are kept in its own buffer unless they refer to the block
+    std::vector<std::string> bufs(rows.size() * index_map_.size());
+    std::vector<std::vector<KeyedRow>> keyed_rows(index_map_.size());
+    size_t index_pos = 0;
+    for (const auto& kv : index_map_) {
+        std::vector<KeyedRow>& keyed = keyed_rows[index_pos];
+        keyed.resize(rows.size());
+        for (size_t i = 0; i < rows.size(); i++) {
+            KeyedRow& keyed_row = keyed[i];
+            int64_t time = 1;
+            if (!DecodeKeysAndTs(kv.second, blocks[i]->data, rows[i].size(),
+                                 &bufs[index_pos * rows.size() + i],
+                                 &keyed_row.key, &time)) {
+                for (auto block : blocks) {
+                    free(block);
+                }
+                return false;
+            }
+            keyed_row.time = static_cast<uint64_t>(time);
+            keyed_row.row = blocks[i];
+            keyed_row.seg_index = 0;
+            if (seg_cnt_ > 1) {
+                // rows of a key are often adjacent in a batch
+                if (i > 0 && keyed[i - 1].key == keyed_row.key) {
+                    keyed_row.seg_index = keyed[i - 1].seg_index;
+                } else {
+                    keyed_row.seg_index =
+                        ::hybridse::base::hash(keyed_row.key.data(),
+                                               keyed_row.key.size(), SEED) %
+                        seg_cnt_;
+                }
+            }
+        }
+        index_pos++;
+    }
+    index_pos = 0;
+    for (const auto& kv : index_map_) {
+        std::vector<KeyedRow>& keyed = keyed_rows[index_pos++];
+        // stable so rows of a key are put in the order of the batch
+        std::stable_sort(keyed.begin(), keyed.end(),
+                         [](const KeyedRow& a, const KeyedRow& b) {
+                             if (a.seg_index != b.seg_index) {
+                                 return a.seg_index < b.seg_index;
+                             }
+                             return a.key.compare(b.key) < 0;
+                         });
+        size_t start = 0;
+        for (size_t i = 1; i <= keyed.size(); i++) {
+            if (i < keyed.size() &&
+                keyed[i].seg_index == keyed[start].seg_index &&
+                keyed[i].key == keyed[start].key) {
+                continue;
+            }
+            segments_[kv.second.index][keyed[start].seg_index]->Put(
+                &keyed[start], i - start);
+            start = i;
+        }
+    }
+    version_.fetch_add(1, std::memory_order_release);
     return true;
 }
 
+GcStat Table::SchedGc() {
+    struct timeval cur_time;
+    gettimeofday(&cur_time, NULL);
+    return SchedGc(cur_time.tv_sec * 1000 + cur_time.tv_usec / 1000);
+}
+
+GcStat Table::SchedGc(uint64_t cur_time) {
+    std::lock_guard<std::mutex> lock(gc_mu_);
+    auto start = std::chrono::steady_clock::now();
+    GcStat stat;
+    std::vector<DataBlock*> blocks;
+    for (const auto& kv : index_map_) {
+        const TTLSt& ttl = kv.second.ttl;
+        if (ttl.ttl_type == type::kTTLNone) {
+            continue;
+        }
+        uint64_t expire_time =
+            cur_time > ttl.abs_ttl ? cur_time - ttl.abs_ttl : 0;
+        for (uint32_t i = 0; i < seg_cnt_; i++) {
+            segments_[kv.second.index][i]->Gc(ttl, expire_time, &blocks,
+                                              &gc_nodes_, &stat);
+        }
+    }
+    // blocks are only released by gc, ref counts need no atomic update
+    for (auto block : blocks) {
+        if (--block->ref_cnt == 0) {
+            gc_blocks_.push_back(block);
+        }
+    }
+    // readers registered before the last bump may still reach rows retired
+    // by it, all readers are in the slot of the current epoch once they are
+    // gone
+    uint64_t epoch = gc_epoch_.load();
+    if (reader_cnt_[(epoch + 1) & 1].load() == 0) {
+        for (auto node : retired_nodes_) {
+            for (auto cur = node; cur != NULL;
+                 cur = cur->GetNextNoBarrier(0)) {
+                stat.freed_bytes +=
+                    sizeof(TimeEntryNode) +
+                    cur->Height() * sizeof(std::atomic<TimeEntryNode*>);
+            }
+            TimeEntry::DeleteNodes(node);
+        }
+        for (auto block : retired_blocks_) {
+            stat.freed_bytes +=
+                sizeof(DataBlock) +
+                codec::RowView::GetSize(reinterpret_cast<int8_t*>(block->data));
+            free(block);
+        }
+        stat.freed_row_cnt = retired_blocks_.size();
+        retired_nodes_.clear();
+        retired_blocks_.clear();
+        retired_nodes_.swap(gc_nodes_);
+        retired_blocks_.swap(gc_blocks_);
+        gc_epoch_.store(epoch + 1);
+    }
+    if (stat.expired_row_cnt > 0) {
+        version_.fetch_add(1, std::memory_order_release);
+    }
+    stat.gc_time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    {
+        std::lock_guard<std::mutex> stat_lock(gc_stat_mu_);
+        gc_stat_.expired_row_cnt += stat.expired_row_cnt;
+        gc_stat_.freed_row_cnt += stat.freed_row_cnt;
+        gc_stat_.freed_bytes += stat.freed_bytes;
+        gc_stat_.gc_time_us += stat.gc_time_us;
+        gc_stat_.max_pause_us =
+            std::max(gc_stat_.max_pause_us, stat.max_pause_us);
+    }
+    return stat;
+}
+
+uint32_t Table::EnterRead() {
+    while (true) {
+        uint64_t epoch = gc_epoch_.load();
+        uint32_t slot = epoch & 1;
+        reader_cnt_[slot].fetch_add(1);
+        // counted in the slot of a stale epoch, gc may have checked it
+        if (gc_epoch_.load() == epoch) {
+            return slot;
+        }
+        reader_cnt_[slot].fetch_sub(1);
+    }
+}
+
+void Table::ExitRead(uint32_t slot) { reader_cnt_[slot].fetch_sub(1); }
+
+GcReadGuard::GcReadGuard(Table* table)
+    : table_(table), slot_(table == nullptr ? 0 : table->EnterRead()) {}
+
+GcReadGuard::~GcReadGuard() {
+    if (table_ != nullptr) {
+        table_->ExitRead(slot_);
+    }
+}
+
+GcStat Table::GetGcStat() const {
+    std::lock_guard<std::mutex> lock(gc_stat_mu_);
+    return gc_stat_;
+}
+
 std::unique_ptr<TableIterator> Table::NewIndexIterator(const std::string& pk,
                                                        const uint32_t index) {
     uint32_t seg_idx = 0;
@@ -235,8 +491,10 @@ std::unique_ptr<TableIterator> Table::NewIndexIterator(const std::string& pk,
     if (segment->GetEntries()->Get(spk, entry) < 0 || entry == NULL) {
         return std::unique_ptr<TableIterator>(new TableIterator());
     }
+    // creating the iterator reads no node, the reader is registered before
+    // the iterator moves
     return std::unique_ptr<TableIterator>(new TableIterator(
-        (reinterpret_cast<TimeEntry*>(entry))->NewIterator()));
+        (reinterpret_cast<TimeEntry*>(entry))->NewIterator(), this));
 }
 
 std::unique_ptr<TableIterator> Table::NewIterator(
@@ -269,21 +527,23 @@ std::unique_ptr<TableIterator> Table::NewTraverseIterator(
         return nullptr;
     }
     return std::unique_ptr<TableIterator>(
-        new TableIterator(segments_[iter->second.index], seg_cnt_));
+        new TableIterator(segments_[iter->second.index], seg_cnt_, this));
 }
 
 std::unique_ptr<TableIterator> Table::NewTraverseIterator() {
     return std::unique_ptr<TableIterator>(
-        new TableIterator(segments_[0], seg_cnt_));
+        new TableIterator(segments_[0], seg_cnt_, this));
 }
 
 // Iterator
 
-TableIterator::TableIterator(base::Iterator<uint64_t, DataBlock*>* ts_it)
-    : ts_it_(ts_it) {}
+TableIterator::TableIterator(base::Iterator<uint64_t, DataBlock*>* ts_it,
+                             Table* table)
+    : guard_(table), ts_it_(ts_it) {}
 
-TableIterator::TableIterator(Segment** segments, uint32_t seg_cnt)
-    : segments_(segments), seg_cnt_(seg_cnt) {}
+TableIterator::TableIterator(Segment** segments, uint32_t seg_cnt,
+                             Table* table)
+    : guard_(table), segments_(segments), seg_cnt_(seg_cnt) {}
 
 TableIterator::~TableIterator() {
     delete ts_it_;
@@ -19,6 +19,7 @@
 #include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <utility>
 #include <vector>
@@ -35,11 +36,28 @@ using ::hybridse::type::IndexDef;
 using ::hybridse::type::TableDef;
 static constexpr uint32_t SEG_CNT = 8;
 
+class Table;
+
+// Registers a reader of `table` while it lives: nodes and rows cut by gc are
+// freed only after readers registered before the cut are gone. A null table
+// registers nothing.
+class GcReadGuard {
+ public:
+    explicit GcReadGuard(Table* table);
+    ~GcReadGuard();
+    GcReadGuard(const GcReadGuard&) = delete;
+    GcReadGuard& operator=(const GcReadGuard&) = delete;
+
+ private:
+    Table* table_;
+    uint32_t slot_;
+};
+
 class TableIterator : public ConstIterator<uint64_t, base::Slice> {
  public:
     TableIterator() = default;
-    explicit TableIterator(base::Iterator<uint64_t, DataBlock*>* ts_it);
-    TableIterator(Segment** segments, uint32_t seg_cnt);
+    TableIterator(base::Iterator<uint64_t, DataBlock*>* ts_it, Table* table);
+    TableIterator(Segment** segments, uint32_t seg_cnt, Table* table);
     ~TableIterator();
     void Seek(const uint64_t& time);
     void Seek(const std::string& key, uint64_t ts);
@@ -58,6 +76,8 @@ class TableIterator : public ConstIterator<uint64_t, base::Slice> {
     bool SeekToNextTsInPks();
 
  private:
+    // released after the iterators below
+    GcReadGuard guard_{nullptr};
     Segment** segments_ = NULL;
     uint32_t seg_cnt_ = 0;
     uint32_t seg_idx_ = 0;
@@ -77,6 +97,18 @@ class Table {
     bool Init();
 
     bool Put(const char* row, uint32_t size);
+    // Put a row logged at `offset` of the binlog of the table
+    bool Put(const char* row, uint32_t size, uint64_t offset);
+
+    // Put rows logged from `offset` on in order, keys of all rows are decoded
+    // before any of them is put so the batch is put entirely or not at all.
+    // Rows are grouped by segment and key to look up and lock each key of a
+    // segment once.
+    bool PutBatch(const std::vector<base::Slice>& rows, uint64_t offset);
+    bool PutBatch(const std::vector<base::Slice>& rows);
+
+    // Check a row would be accepted by Put, to be called before logging it
+    bool CheckRow(const char* row, uint32_t size);
 
     std::unique_ptr<TableIterator> NewIterator(const std::string& pk,
                                                const uint64_t ts);
@@ -99,6 +131,7 @@ class Table {
         uint32_t index;
         uint32_t ts_pos;
         std::vector<std::pair<::hybridse::type::Type, size_t>> keys;
+        TTLSt ttl;
     };
 
     const std::map<std::string, IndexSt>& GetIndexMap() const {
@@ -110,13 +143,46 @@ class Table {
     inline Segment*** GetSegments() { return segments_; }
 
     inline uint32_t GetSegCnt() { return seg_cnt_; }
+
+    // bumped after rows are changed, for readers to validate cached rows
+    inline uint64_t GetVersion() const {
+        return version_.load(std::memory_order_acquire);
+    }
     bool DecodeKeysAndTs(const IndexSt& index, const char* row, uint32_t size,
                          std::string& key,  // NOLINT
                          int64_t* time_ptr);
+    // Decode without copying the key: `key` refers to `row` if the index key
+    // is a single non empty string column, or else to `buf`
+    bool DecodeKeysAndTs(const IndexSt& index, const char* row, uint32_t size,
+                         std::string* buf, base::Slice* key,
+                         int64_t* time_ptr);
+
+    // Run a gc round at `cur_time` in milliseconds: rows expired by ttl of
+    // each index are cut off, and rows no index holds any more are freed by
+    // the first round after readers registered before their cut are gone.
+    // Readers are iterators of the table, each holding a GcReadGuard; rows
+    // kept after an iterator is destroyed are not covered. Return stat of the
+    // round.
+    GcStat SchedGc(uint64_t cur_time);
+    GcStat SchedGc();
+
+    // Return stat accumulated over gc rounds, `max_pause_us` is the longest
+    // pause of all rounds
+    GcStat GetGcStat() const;
+
+    // Gc rounds wait while the lock is held, for scans longer than a gc
+    // interval such as snapshots
+    std::unique_lock<std::mutex> PauseGc() {
+        return std::unique_lock<std::mutex>(gc_mu_);
+    }
 
  private:
+    friend class GcReadGuard;
     std::unique_ptr<TableIterator> NewIndexIterator(const std::string& pk,
                                                     const uint32_t index);
+    // Register a reader in the slot of the current gc epoch, return the slot
+    uint32_t EnterRead();
+    void ExitRead(uint32_t slot);
 
  private:
     std::string name_;
@@ -127,6 +193,21 @@ class Table {
     TableDef table_def_;
     codec::RowView row_view_;
     std::map<std::string, IndexSt> index_map_;
+    std::atomic<uint64_t> version_{0};
+    std::mutex gc_mu_;
+    // readers of the current and the former gc epoch, the epoch is bumped by
+    // a gc round only once readers of the former one are gone
+    std::atomic<uint64_t> gc_epoch_{0};
+    std::atomic<uint64_t> reader_cnt_[2] = {{0}, {0}};
+    // rows and nodes cut since the epoch is bumped
+    std::vector<DataBlock*> gc_blocks_;
+    std::vector<TimeEntryNode*> gc_nodes_;
+    // rows and nodes cut before the epoch is bumped, freed once readers of
+    // the former epoch are gone
+    std::vector<DataBlock*> retired_blocks_;
+    std::vector<TimeEntryNode*> retired_nodes_;
+    mutable std::mutex gc_stat_mu_;
+    GcStat gc_stat_;
 };
 
 }  // namespace storage
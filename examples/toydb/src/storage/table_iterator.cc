@@ -30,8 +30,12 @@ using hybridse::vm::RowIterator;
 static constexpr uint32_t SEED = 0xe17a1465;
 
 WindowInternalIterator::WindowInternalIterator(
-    std::unique_ptr<base::Iterator<uint64_t, DataBlock*>> ts_it)
-    : ts_it_(std::move(ts_it)), value_() {}
+    std::unique_ptr<base::Iterator<uint64_t, DataBlock*>> ts_it,
+    std::shared_ptr<Table> table)
+    : ts_it_(std::move(ts_it)),
+      value_(),
+      table_(table),
+      guard_(table.get()) {}
 WindowInternalIterator::~WindowInternalIterator() {}
 
 void WindowInternalIterator::Seek(const uint64_t& ts) { ts_it_->Seek(ts); }
@@ -61,7 +65,8 @@ WindowTableIterator::WindowTableIterator(Segment*** segments, uint32_t seg_cnt,
       index_(index),
       seg_idx_(0),
       pk_it_(),
-      table_(table) {
+      table_(table),
+      guard_(table.get()) {
     GoToStart();
 }
 
@@ -88,7 +93,7 @@ std::unique_ptr<RowIterator> WindowTableIterator::GetValue() {
     std::unique_ptr<base::Iterator<uint64_t, DataBlock*>> it(
         (reinterpret_cast<TimeEntry*>(pk_it_->GetValue()))->NewIterator());
     std::unique_ptr<WindowInternalIterator> wit(
-        new WindowInternalIterator(std::move(it)));
+        new WindowInternalIterator(std::move(it), table_));
     return std::move(wit);
 }
 
@@ -98,7 +103,7 @@ RowIterator* WindowTableIterator::GetRawValue() {
     }
     std::unique_ptr<base::Iterator<uint64_t, DataBlock*>> it(
         (reinterpret_cast<TimeEntry*>(pk_it_->GetValue()))->NewIterator());
-    return new WindowInternalIterator(std::move(it));
+    return new WindowInternalIterator(std::move(it), table_);
 }
 
 void WindowTableIterator::GoToStart() {
@@ -164,6 +169,7 @@ FullTableIterator::FullTableIterator(Segment*** segments, uint32_t seg_cnt,
       ts_it_(),
       pk_it_(),
       table_(table),
+      guard_(table.get()),
       key_(0) {
     GoToStart();
 }
@@ -63,8 +63,9 @@ class EmptyWindowIterator : public ConstIterator<uint64_t, Row> {
 
 class WindowInternalIterator : public ConstIterator<uint64_t, Row> {
  public:
-    explicit WindowInternalIterator(
-        std::unique_ptr<base::Iterator<uint64_t, DataBlock*>> ts_it);
+    WindowInternalIterator(
+        std::unique_ptr<base::Iterator<uint64_t, DataBlock*>> ts_it,
+        std::shared_ptr<Table> table);
     ~WindowInternalIterator();
 
     inline void Seek(const uint64_t& ts);
@@ -83,6 +84,9 @@ class WindowInternalIterator : public ConstIterator<uint64_t, Row> {
  private:
     std::unique_ptr<base::Iterator<uint64_t, DataBlock*>> ts_it_;
     Row value_;
+    std::shared_ptr<Table> table_;
+    // released before the table it registers to
+    GcReadGuard guard_;
 };
 
 class WindowTableIterator : public WindowIterator {
@@ -111,13 +115,21 @@ class WindowTableIterator : public WindowIterator {
     std::unique_ptr<base::Iterator<base::Slice, void*>> pk_it_;
     // hold the reference
     std::shared_ptr<Table> table_;
+    // released before the table it registers to
+    GcReadGuard guard_;
 };
 
 // the full table iterator
 class FullTableIterator : public ConstIterator<uint64_t, Row> {
  public:
     FullTableIterator()
-        : seg_cnt_(0), seg_idx_(0), segments_(NULL), value_(), key_(0) {}
+        : seg_cnt_(0),
+          seg_idx_(0),
+          segments_(NULL),
+          table_(),
+          guard_(nullptr),
+          value_(),
+          key_(0) {}
 
     explicit FullTableIterator(Segment*** segments, uint32_t seg_cnt,
                                std::shared_ptr<Table> table);
@@ -148,6 +160,8 @@ class FullTableIterator : public ConstIterator<uint64_t, Row> {
     std::unique_ptr<base::Iterator<uint64_t, DataBlock*>> ts_it_;
     std::unique_ptr<base::Iterator<base::Slice, void*>> pk_it_;
     std::shared_ptr<Table> table_;
+    // released before the table it registers to
+    GcReadGuard guard_;
     Row value_;
     uint64_t key_;
 };
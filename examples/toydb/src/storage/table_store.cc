@@ -0,0 +1,415 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/table_store.h"
+#include <errno.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include "boost/filesystem.hpp"
+#include "codec/fe_row_codec.h"
+#include "glog/logging.h"
+
+namespace hybridse {
+namespace storage {
+
+static const char SNAPSHOT_DIR[] = "snapshot";
+static const char SNAPSHOT_TMP_DIR[] = "snapshot.tmp";
+static const char SNAPSHOT_OLD_DIR[] = "snapshot.old";
+static const char SNAPSHOT_MANIFEST[] = "MANIFEST";
+static constexpr size_t SNAPSHOT_BUFFER_SIZE = 4 * 1024 * 1024;
+
+static std::string GetSegmentPath(const std::string& dir, uint32_t idx) {
+    return dir + "/" + std::to_string(idx) + ".rows";
+}
+
+// Flush and sync a file opened for write, then close it
+static bool CloseAndSync(FILE* file, const std::string& path) {
+    bool ok = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if (!ok) {
+        LOG(WARNING) << "fail to sync " << path << ": " << strerror(errno);
+    }
+    return fclose(file) == 0 && ok;
+}
+
+TableStore::TableStore(std::shared_ptr<Table> table, const std::string& dir,
+                       const BinlogOptions& options)
+    : table_(table),
+      dir_(dir),
+      binlog_(dir + "/binlog", options),
+      put_mu_(),
+      snapshot_mu_() {}
+
+bool TableStore::Init() {
+    if (!table_ || table_->GetIndexMap().empty()) {
+        LOG(WARNING) << "fail to init table store " << dir_
+                     << ": table without index";
+        return false;
+    }
+    return binlog_.Init();
+}
+
+bool TableStore::Put(const char* row, uint32_t size) {
+    // rows rejected by the table must not be logged to be replayed
+    if (!table_->CheckRow(row, size)) {
+        return false;
+    }
+    std::shared_lock<std::shared_mutex> lock(put_mu_);
+    uint64_t offset = 0;
+    if (!binlog_.Append(base::Slice(row, size), &offset)) {
+        return false;
+    }
+    return table_->Put(row, size, offset);
+}
+
+bool TableStore::PutBatch(const std::vector<base::Slice>& rows) {
+    if (rows.empty()) {
+        return true;
+    }
+    // a batch is logged only if the table accepts all of its rows
+    for (const auto& row : rows) {
+        if (!table_->CheckRow(row.data(), row.size())) {
+            return false;
+        }
+    }
+    std::shared_lock<std::shared_mutex> lock(put_mu_);
+    uint64_t offset = 0;
+    if (!binlog_.AppendBatch(rows.data(), rows.size(), &offset)) {
+        return false;
+    }
+    return table_->PutBatch(rows, offset);
+}
+
+bool TableStore::WriteSegment(Segment* segment, uint64_t offset,
+                              const std::string& path,
+                              std::unordered_set<DataBlock*>* written,
+                              uint64_t* row_cnt) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        LOG(WARNING) << "fail to open " << path << ": " << strerror(errno);
+        return false;
+    }
+    std::unique_ptr<char[]> write_buf(new char[SNAPSHOT_BUFFER_SIZE]);
+    setvbuf(file, write_buf.get(), _IOFBF, SNAPSHOT_BUFFER_SIZE);
+    bool ok = true;
+    std::unique_ptr<base::Iterator<Slice, void*>> key_it(
+        segment->GetEntries()->NewIterator());
+    key_it->SeekToFirst();
+    for (; ok && key_it->Valid(); key_it->Next()) {
+        std::unique_ptr<base::Iterator<uint64_t, DataBlock*>> it(
+            reinterpret_cast<TimeEntry*>(key_it->GetValue())->NewIterator());
+        it->SeekToFirst();
+        for (; it->Valid(); it->Next()) {
+            DataBlock* block = it->GetValue();
+            // put after the snapshot is cut, left to the binlog
+            if (block->offset >= offset) {
+                continue;
+            }
+            // a row is held by each of its indexes until expired on it
+            if (written != nullptr && !written->insert(block).second) {
+                continue;
+            }
+            uint32_t size = codec::RowView::GetSize(
+                reinterpret_cast<int8_t*>(block->data));
+            if (fwrite(&size, sizeof(size), 1, file) != 1 ||
+                fwrite(block->data, 1, size, file) != size) {
+                LOG(WARNING) << "fail to write " << path << ": "
+                             << strerror(errno);
+                ok = false;
+                break;
+            }
+            (*row_cnt)++;
+        }
+    }
+    return CloseAndSync(file, path) && ok;
+}
+
+bool TableStore::MakeSnapshot() {
+    std::lock_guard<std::mutex> lock(snapshot_mu_);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t offset = 0;
+    {
+        // wait for puts logged but not put yet
+        std::unique_lock<std::shared_mutex> put_lock(put_mu_);
+        offset = binlog_.GetOffset();
+    }
+    std::string tmp_dir = dir_ + "/" + SNAPSHOT_TMP_DIR;
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(tmp_dir, ec);
+    boost::filesystem::create_directories(tmp_dir, ec);
+    if (ec) {
+        LOG(WARNING) << "fail to create snapshot dir " << tmp_dir << ": "
+                     << ec.message();
+        return false;
+    }
+    // rows are written once each, from the first index still holding them.
+    // Blocks are not freed while gc is paused so their addresses tell rows
+    // apart.
+    uint64_t row_cnt = 0;
+    uint32_t file_cnt = 0;
+    {
+        auto gc_lock = table_->PauseGc();
+        uint32_t index_cnt = table_->GetIndexMap().size();
+        std::unordered_set<DataBlock*> written;
+        for (uint32_t index = 0; index < index_cnt; index++) {
+            Segment** segments = table_->GetSegments()[index];
+            for (uint32_t i = 0; i < table_->GetSegCnt(); i++) {
+                if (!WriteSegment(segments[i], offset,
+                                  GetSegmentPath(tmp_dir, file_cnt++),
+                                  index_cnt > 1 ? &written : nullptr,
+                                  &row_cnt)) {
+                    return false;
+                }
+            }
+        }
+    }
+    std::string manifest_path = tmp_dir + "/" + SNAPSHOT_MANIFEST;
+    FILE* manifest = fopen(manifest_path.c_str(), "w");
+    if (manifest == NULL) {
+        LOG(WARNING) << "fail to open " << manifest_path << ": "
+                     << strerror(errno);
+        return false;
+    }
+    fprintf(manifest, "%lu %u %lu\n",
+            static_cast<unsigned long>(offset),  // NOLINT
+            file_cnt,
+            static_cast<unsigned long>(row_cnt));  // NOLINT
+    if (!CloseAndSync(manifest, manifest_path)) {
+        return false;
+    }
+    // the old snapshot is kept until the new one takes its place
+    std::string snapshot_dir = dir_ + "/" + SNAPSHOT_DIR;
+    std::string old_dir = dir_ + "/" + SNAPSHOT_OLD_DIR;
+    boost::filesystem::remove_all(old_dir, ec);
+    boost::system::error_code exists_ec;
+    ec.clear();
+    if (boost::filesystem::exists(snapshot_dir, exists_ec)) {
+        boost::filesystem::rename(snapshot_dir, old_dir, ec);
+    }
+    if (!ec) {
+        boost::filesystem::rename(tmp_dir, snapshot_dir, ec);
+    }
+    if (ec) {
+        LOG(WARNING) << "fail to replace snapshot " << snapshot_dir << ": "
+                     << ec.message();
+        return false;
+    }
+    boost::filesystem::remove_all(old_dir, ec);
+    binlog_.Purge(offset);
+    LOG(INFO) << "make snapshot of table " << table_->GetTableDef().name()
+              << " at offset " << offset << " with " << row_cnt
+              << " rows, took "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count()
+              << "ms";
+    return true;
+}
+
+std::string TableStore::FindSnapshot() {
+    // a crash while a snapshot is replaced may leave the new one in the tmp
+    // dir or the former one in the old dir
+    for (auto name : {SNAPSHOT_DIR, SNAPSHOT_TMP_DIR, SNAPSHOT_OLD_DIR}) {
+        std::string dir = dir_ + "/" + name;
+        boost::system::error_code ec;
+        if (boost::filesystem::is_regular_file(dir + "/" + SNAPSHOT_MANIFEST,
+                                               ec)) {
+            return dir;
+        }
+    }
+    return "";
+}
+
+bool TableStore::LoadSnapshot(const std::string& dir, uint32_t thread_num,
+                              uint64_t* offset) {
+    std::string manifest_path = dir + "/" + SNAPSHOT_MANIFEST;
+    FILE* manifest = fopen(manifest_path.c_str(), "r");
+    if (manifest == NULL) {
+        LOG(WARNING) << "fail to open " << manifest_path << ": "
+                     << strerror(errno);
+        return false;
+    }
+    unsigned long snapshot_offset = 0;  // NOLINT
+    uint32_t file_cnt = 0;
+    unsigned long row_cnt = 0;  // NOLINT
+    int ret = fscanf(manifest, "%lu %u %lu", &snapshot_offset, &file_cnt,
+                     &row_cnt);
+    fclose(manifest);
+    if (ret != 3) {
+        LOG(WARNING) << "fail to parse " << manifest_path;
+        return false;
+    }
+    // files are loaded in parallel, puts of a table run concurrently
+    std::atomic<uint32_t> next_file(0);
+    std::atomic<uint64_t> loaded_cnt(0);
+    std::atomic<bool> ok(true);
+    auto load = [&]() {
+        std::unique_ptr<char[]> read_buf(new char[SNAPSHOT_BUFFER_SIZE]);
+        std::string row;
+        for (uint32_t idx = next_file++; idx < file_cnt && ok.load();
+             idx = next_file++) {
+            std::string path = GetSegmentPath(dir, idx);
+            FILE* file = fopen(path.c_str(), "rb");
+            if (file == NULL) {
+                LOG(WARNING) << "fail to open " << path << ": "
+                             << strerror(errno);
+                ok.store(false);
+                return;
+            }
+            setvbuf(file, read_buf.get(), _IOFBF, SNAPSHOT_BUFFER_SIZE);
+            uint32_t size = 0;
+            while (fread(&size, sizeof(size), 1, file) == 1) {
+                row.resize(size);
+                if (fread(&row[0], 1, size, file) != size) {
+                    LOG(WARNING) << "snapshot file " << path << " is torn";
+                    ok.store(false);
+                    break;
+                }
+                if (!table_->Put(row.data(), size, 0)) {
+                    LOG(WARNING) << "fail to put row of " << path;
+                    ok.store(false);
+                    break;
+                }
+                loaded_cnt++;
+            }
+            fclose(file);
+        }
+    };
+    uint32_t worker_num = std::max(1u, std::min(thread_num, file_cnt));
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < worker_num; i++) {
+        threads.emplace_back(load);
+    }
+    load();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (!ok.load() || loaded_cnt.load() != row_cnt) {
+        LOG(WARNING) << "fail to load snapshot " << dir << ", " << loaded_cnt
+                     << " of " << row_cnt << " rows are loaded";
+        return false;
+    }
+    *offset = snapshot_offset;
+    return true;
+}
+
+bool TableStore::Recover(uint32_t thread_num) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t offset = 0;
+    std::string snapshot_dir = FindSnapshot();
+    if (!snapshot_dir.empty() &&
+        !LoadSnapshot(snapshot_dir, thread_num, &offset)) {
+        return false;
+    }
+    uint64_t replay_cnt = 0;
+    bool ok = binlog_.Replay(
+        offset, [&](uint64_t record_offset, const base::Slice& row) {
+            if (!table_->Put(row.data(), row.size(), record_offset)) {
+                LOG(WARNING) << "fail to replay row at offset "
+                             << record_offset << " of " << dir_;
+            }
+            replay_cnt++;
+            return true;
+        });
+    if (!ok) {
+        LOG(WARNING) << "fail to replay binlog of " << dir_;
+        return false;
+    }
+    LOG(INFO) << "recover table " << table_->GetTableDef().name() << " from "
+              << (snapshot_dir.empty() ? "no snapshot" : snapshot_dir)
+              << " at offset " << offset << " and " << replay_cnt
+              << " binlog rows, took "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count()
+              << "ms";
+    return true;
+}
+
+TableSnapshotter::TableSnapshotter(uint64_t interval_ms)
+    : interval_ms_(interval_ms), mu_(), cond_(), running_(false) {}
+
+TableSnapshotter::~TableSnapshotter() { Stop(); }
+
+void TableSnapshotter::AddStore(std::shared_ptr<TableStore> store) {
+    std::lock_guard<std::mutex> lock(mu_);
+    stores_.push_back(store);
+}
+
+void TableSnapshotter::Start() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread([this]() { WorkLoop(); });
+}
+
+void TableSnapshotter::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        running_ = false;
+    }
+    cond_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+uint32_t TableSnapshotter::RunOnce() {
+    std::vector<std::shared_ptr<TableStore>> stores;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto end = std::remove_if(stores_.begin(), stores_.end(),
+                                  [](const std::weak_ptr<TableStore>& store) {
+                                      return store.expired();
+                                  });
+        stores_.erase(end, stores_.end());
+        for (auto& store : stores_) {
+            auto locked = store.lock();
+            if (locked) {
+                stores.push_back(locked);
+            }
+        }
+    }
+    uint32_t cnt = 0;
+    for (auto& store : stores) {
+        if (store->MakeSnapshot()) {
+            cnt++;
+        }
+    }
+    return cnt;
+}
+
+void TableSnapshotter::WorkLoop() {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (running_) {
+        cond_.wait_for(lock, std::chrono::milliseconds(interval_ms_),
+                       [this]() { return !running_; });
+        if (!running_) {
+            break;
+        }
+        lock.unlock();
+        RunOnce();
+        lock.lock();
+    }
+}
+
+}  // namespace storage
+}  // namespace hybridse
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>  // NOLINT
+#include <memory>
+#include <mutex>         // NOLINT
+#include <shared_mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <unordered_set>
+#include <vector>
+#include "storage/binlog.h"
+#include "storage/table_impl.h"
+
+namespace hybridse {
+namespace storage {
+
+// A table persisted under `dir` by a binlog of its rows and snapshots:
+//   binlog/    rows in the order they are put
+//   snapshot/  rows logged before the offset in MANIFEST, a file of rows for
+//              each segment of the first index, then a file for each segment
+//              of other indexes with rows no former index holds any more
+// Binlog files before the latest snapshot are removed once it is made.
+class TableStore {
+ public:
+    TableStore(std::shared_ptr<Table> table, const std::string& dir,
+               const BinlogOptions& options);
+    TableStore(const TableStore&) = delete;
+    TableStore& operator=(const TableStore&) = delete;
+
+    bool Init();
+
+    // Log the row then put it to the table
+    bool Put(const char* row, uint32_t size);
+    // Log the rows with one append then put them with one batch
+    bool PutBatch(const std::vector<base::Slice>& rows);
+
+    // Snapshot rows logged so far, puts go on while rows are written
+    bool MakeSnapshot();
+
+    // Load the latest snapshot with `thread_num` threads, a segment file a
+    // time, then replay the binlog from the offset of the snapshot. Run
+    // after `Init` and before puts.
+    bool Recover(uint32_t thread_num);
+
+    inline std::shared_ptr<Table> GetTable() const { return table_; }
+    inline Binlog* GetBinlog() { return &binlog_; }
+
+ private:
+    std::string FindSnapshot();
+    bool LoadSnapshot(const std::string& dir, uint32_t thread_num,
+                      uint64_t* offset);
+    // Write rows of `segment` not in `written` yet, adding them to it
+    bool WriteSegment(Segment* segment, uint64_t offset,
+                      const std::string& path,
+                      std::unordered_set<DataBlock*>* written,
+                      uint64_t* row_cnt);
+
+    std::shared_ptr<Table> table_;
+    const std::string dir_;
+    Binlog binlog_;
+    // shared by puts, a snapshot takes it to cut the binlog at an offset all
+    // rows before which are put
+    std::shared_mutex put_mu_;
+    std::mutex snapshot_mu_;
+};
+
+// Background thread making snapshots of registered stores every
+// `interval_ms`. Stores are held weakly and dropped once destroyed.
+class TableSnapshotter {
+ public:
+    explicit TableSnapshotter(uint64_t interval_ms);
+    ~TableSnapshotter();
+    TableSnapshotter(const TableSnapshotter&) = delete;
+    TableSnapshotter& operator=(const TableSnapshotter&) = delete;
+
+    void AddStore(std::shared_ptr<TableStore> store);
+
+    void Start();
+    void Stop();
+
+    // Make a snapshot of every store, return the number of snapshots made
+    uint32_t RunOnce();
+
+ private:
+    void WorkLoop();
+
+    const uint64_t interval_ms_;
+    std::mutex mu_;
+    std::condition_variable cond_;
+    bool running_;
+    std::vector<std::weak_ptr<TableStore>> stores_;
+    std::thread thread_;
+};
+
+}  // namespace storage
+}  // namespace hybridse
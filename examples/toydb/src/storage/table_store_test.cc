@@ -0,0 +1,364 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/table_store.h"
+#include <unistd.h>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "boost/filesystem.hpp"
+#include "codec/fe_row_codec.h"
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace storage {
+using codec::RowBuilder;
+
+class TableStoreTest : public ::testing::Test {
+ public:
+    TableStoreTest()
+        : dir_("/tmp/toydb_table_store_test_" + std::to_string(getpid())) {}
+    ~TableStoreTest() {}
+    void SetUp() { boost::filesystem::remove_all(dir_); }
+    void TearDown() { boost::filesystem::remove_all(dir_); }
+
+ protected:
+    std::string dir_;
+};
+
+static void BuildTableDef(::hybridse::type::TableDef* def) {
+    ::hybridse::type::ColumnDef* col = def->add_columns();
+    col->set_name("col1");
+    col->set_type(::hybridse::type::kVarchar);
+    col = def->add_columns();
+    col->set_name("col2");
+    col->set_type(::hybridse::type::kInt64);
+    col = def->add_columns();
+    col->set_name("col3");
+    col->set_type(::hybridse::type::kVarchar);
+    ::hybridse::type::IndexDef* index = def->add_indexes();
+    index->set_name("index1");
+    index->add_first_keys("col1");
+    index->set_second_key("col2");
+    index = def->add_indexes();
+    index->set_name("index2");
+    index->add_first_keys("col3");
+    index->set_second_key("col2");
+}
+
+static void PutRows(const ::hybridse::type::TableDef& def,
+                    const std::string& key, int64_t begin, int64_t end,
+                    TableStore* store) {
+    RowBuilder builder(def.columns());
+    uint32_t size = builder.CalTotalLength(key.size() + 2);
+    for (int64_t ts = begin; ts < end; ++ts) {
+        std::string row;
+        row.resize(size);
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&(row[0])), size);
+        builder.AppendString(key.c_str(), key.size());
+        builder.AppendInt64(ts);
+        builder.AppendString("v1", 2);
+        ASSERT_TRUE(store->Put(row.c_str(), row.length()));
+    }
+}
+
+static uint64_t CountRows(Table* table, const std::string& key,
+                          const std::string& index_name) {
+    auto iter = table->NewIterator(key, index_name);
+    uint64_t cnt = 0;
+    iter->SeekToFirst();
+    while (iter->Valid()) {
+        cnt++;
+        iter->Next();
+    }
+    return cnt;
+}
+
+static std::shared_ptr<TableStore> OpenStore(
+    const ::hybridse::type::TableDef& def, const std::string& dir,
+    const BinlogOptions& options) {
+    auto table = std::make_shared<Table>(1, 1, def);
+    if (!table->Init()) {
+        return std::shared_ptr<TableStore>();
+    }
+    auto store = std::make_shared<TableStore>(table, dir, options);
+    if (!store->Init()) {
+        return std::shared_ptr<TableStore>();
+    }
+    return store;
+}
+
+TEST_F(TableStoreTest, BinlogGroupCommit) {
+    BinlogOptions options;
+    options.max_file_size = 4096;
+    {
+        Binlog binlog(dir_, options);
+        ASSERT_TRUE(binlog.Init());
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 8; i++) {
+            threads.emplace_back([&binlog, i]() {
+                for (int j = 0; j < 100; j++) {
+                    std::string record =
+                        std::to_string(i) + "_" + std::to_string(j);
+                    uint64_t offset = 0;
+                    ASSERT_TRUE(
+                        binlog.Append(base::Slice(record), &offset));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        ASSERT_EQ(800u, binlog.GetOffset());
+    }
+    Binlog binlog(dir_, options);
+    ASSERT_TRUE(binlog.Init());
+    ASSERT_EQ(800u, binlog.GetOffset());
+    uint64_t expect = 100;
+    ASSERT_TRUE(binlog.Replay(100, [&](uint64_t offset, const base::Slice&) {
+        EXPECT_EQ(expect++, offset);
+        return true;
+    }));
+    ASSERT_EQ(800u, expect);
+
+    // files before the offset are removed, records from it are kept
+    binlog.Purge(500);
+    expect = 0;
+    ASSERT_TRUE(binlog.Replay(500, [&](uint64_t offset, const base::Slice&) {
+        expect++;
+        return true;
+    }));
+    ASSERT_EQ(300u, expect);
+}
+
+TEST_F(TableStoreTest, BinlogTornTail) {
+    BinlogOptions options;
+    {
+        Binlog binlog(dir_, options);
+        ASSERT_TRUE(binlog.Init());
+        uint64_t offset = 0;
+        for (int i = 0; i < 10; i++) {
+            ASSERT_TRUE(binlog.Append(base::Slice("record"), &offset));
+        }
+    }
+    // half of a record left by a crash
+    std::string path = dir_ + "/00000000000000000000.log";
+    uint64_t size = boost::filesystem::file_size(path);
+    boost::filesystem::resize_file(path, size - 3);
+
+    Binlog binlog(dir_, options);
+    ASSERT_TRUE(binlog.Init());
+    ASSERT_EQ(9u, binlog.GetOffset());
+    uint64_t offset = 0;
+    ASSERT_TRUE(binlog.Append(base::Slice("record"), &offset));
+    ASSERT_EQ(9u, offset);
+    uint64_t cnt = 0;
+    ASSERT_TRUE(binlog.Replay(0, [&](uint64_t, const base::Slice& record) {
+        EXPECT_EQ("record", record.ToString());
+        cnt++;
+        return true;
+    }));
+    ASSERT_EQ(10u, cnt);
+}
+
+TEST_F(TableStoreTest, BinlogCorruptedFile) {
+    BinlogOptions options;
+    options.max_file_size = 64;
+    {
+        Binlog binlog(dir_, options);
+        ASSERT_TRUE(binlog.Init());
+        uint64_t offset = 0;
+        for (int i = 0; i < 20; i++) {
+            ASSERT_TRUE(binlog.Append(base::Slice("record"), &offset));
+        }
+    }
+    // size of the second record of the first file is corrupted, only the
+    // tail of the last file may be torn
+    std::string path = dir_ + "/00000000000000000000.log";
+    FILE* file = fopen(path.c_str(), "r+b");
+    ASSERT_TRUE(file != NULL);
+    uint32_t size = 0xffffffff;
+    ASSERT_EQ(0, fseek(file, 14, SEEK_SET));
+    ASSERT_EQ(1u, fwrite(&size, sizeof(size), 1, file));
+    fclose(file);
+
+    Binlog binlog(dir_, options);
+    ASSERT_TRUE(binlog.Init());
+    ASSERT_EQ(20u, binlog.GetOffset());
+    ASSERT_FALSE(binlog.Replay(
+        0, [&](uint64_t, const base::Slice&) { return true; }));
+}
+
+TEST_F(TableStoreTest, RecoverSnapshotAndBinlog) {
+    ::hybridse::type::TableDef def;
+    BuildTableDef(&def);
+    BinlogOptions options;
+    options.sync_policy = SyncPolicy::kSyncNone;
+    {
+        auto store = OpenStore(def, dir_, options);
+        ASSERT_TRUE(store);
+        PutRows(def, "k1", 0, 100, store.get());
+        PutRows(def, "k2", 0, 50, store.get());
+        ASSERT_TRUE(store->MakeSnapshot());
+        PutRows(def, "k1", 100, 120, store.get());
+        PutRows(def, "k3", 0, 10, store.get());
+    }
+    auto store = OpenStore(def, dir_, options);
+    ASSERT_TRUE(store);
+    ASSERT_TRUE(store->Recover(4));
+    Table* table = store->GetTable().get();
+    ASSERT_EQ(120u, CountRows(table, "k1", "index1"));
+    ASSERT_EQ(50u, CountRows(table, "k2", "index1"));
+    ASSERT_EQ(10u, CountRows(table, "k3", "index1"));
+    ASSERT_EQ(180u, CountRows(table, "v1", "index2"));
+
+    // rows put after recovery are logged after the recovered ones
+    PutRows(def, "k3", 10, 20, store.get());
+    ASSERT_TRUE(store->MakeSnapshot());
+    store.reset();
+    store = OpenStore(def, dir_, options);
+    ASSERT_TRUE(store);
+    ASSERT_TRUE(store->Recover(1));
+    ASSERT_EQ(120u, CountRows(store->GetTable().get(), "k1", "index1"));
+    ASSERT_EQ(20u, CountRows(store->GetTable().get(), "k3", "index1"));
+}
+
+TEST_F(TableStoreTest, RecoverPutBatch) {
+    ::hybridse::type::TableDef def;
+    BuildTableDef(&def);
+    BinlogOptions options;
+    options.sync_policy = SyncPolicy::kSyncNone;
+    RowBuilder builder(def.columns());
+    std::vector<std::string> bufs;
+    for (int64_t ts = 0; ts < 100; ++ts) {
+        std::string key = ts % 2 == 0 ? "k1" : "k2";
+        uint32_t size = builder.CalTotalLength(key.size() + 2);
+        std::string row;
+        row.resize(size);
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&(row[0])), size);
+        builder.AppendString(key.c_str(), key.size());
+        builder.AppendInt64(ts);
+        builder.AppendString("v1", 2);
+        bufs.push_back(row);
+    }
+    std::vector<base::Slice> rows;
+    for (const auto& row : bufs) {
+        rows.push_back(base::Slice(row));
+    }
+    {
+        auto store = OpenStore(def, dir_, options);
+        ASSERT_TRUE(store);
+        PutRows(def, "k3", 0, 10, store.get());
+        ASSERT_TRUE(store->PutBatch(rows));
+        ASSERT_EQ(110u, store->GetBinlog()->GetOffset());
+        ASSERT_TRUE(store->MakeSnapshot());
+        ASSERT_TRUE(store->PutBatch(rows));
+    }
+    auto store = OpenStore(def, dir_, options);
+    ASSERT_TRUE(store);
+    ASSERT_TRUE(store->Recover(2));
+    ASSERT_EQ(100u, CountRows(store->GetTable().get(), "k1", "index1"));
+    ASSERT_EQ(100u, CountRows(store->GetTable().get(), "k2", "index1"));
+    ASSERT_EQ(210u, CountRows(store->GetTable().get(), "v1", "index2"));
+}
+
+TEST_F(TableStoreTest, SnapshotRowsExpiredOnFirstIndex) {
+    ::hybridse::type::TableDef def;
+    BuildTableDef(&def);
+    // rows expire on the first index only
+    def.mutable_indexes(0)->add_ttl(100);
+    def.mutable_indexes(0)->set_ttl_type(::hybridse::type::kTTLTimeLive);
+    BinlogOptions options;
+    options.sync_policy = SyncPolicy::kSyncNone;
+    {
+        auto store = OpenStore(def, dir_, options);
+        ASSERT_TRUE(store);
+        PutRows(def, "k1", 0, 1000, store.get());
+        // rows before 900 are cut from index1, index2 still holds them
+        store->GetTable()->SchedGc(1000);
+        ASSERT_EQ(100u, CountRows(store->GetTable().get(), "k1", "index1"));
+        ASSERT_EQ(1000u, CountRows(store->GetTable().get(), "v1", "index2"));
+        ASSERT_TRUE(store->MakeSnapshot());
+    }
+    auto store = OpenStore(def, dir_, options);
+    ASSERT_TRUE(store);
+    ASSERT_TRUE(store->Recover(2));
+    ASSERT_EQ(1000u, CountRows(store->GetTable().get(), "v1", "index2"));
+    ASSERT_EQ(1000u, CountRows(store->GetTable().get(), "k1", "index1"));
+}
+
+TEST_F(TableStoreTest, RejectedRowsNotLogged) {
+    ::hybridse::type::TableDef def;
+    BuildTableDef(&def);
+    BinlogOptions options;
+    options.sync_policy = SyncPolicy::kSyncNone;
+    RowBuilder builder(def.columns());
+    uint32_t size = builder.CalTotalLength(4);
+    std::string row;
+    row.resize(size);
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&(row[0])), size);
+    builder.AppendString("k1", 2);
+    builder.AppendInt64(1);
+    builder.AppendString("v1", 2);
+    // size in the header does not match the row
+    std::string bad_row = row + "x";
+    {
+        auto store = OpenStore(def, dir_, options);
+        ASSERT_TRUE(store);
+        ASSERT_FALSE(store->Put(bad_row.c_str(), bad_row.size()));
+        std::vector<base::Slice> rows = {base::Slice(row),
+                                         base::Slice(bad_row)};
+        ASSERT_FALSE(store->PutBatch(rows));
+        ASSERT_EQ(0u, store->GetBinlog()->GetOffset());
+        ASSERT_TRUE(store->Put(row.c_str(), row.size()));
+        ASSERT_EQ(1u, store->GetBinlog()->GetOffset());
+    }
+    auto store = OpenStore(def, dir_, options);
+    ASSERT_TRUE(store);
+    ASSERT_TRUE(store->Recover(1));
+    ASSERT_EQ(1u, CountRows(store->GetTable().get(), "k1", "index1"));
+}
+
+TEST_F(TableStoreTest, SnapshotWithConcurrentPut) {
+    ::hybridse::type::TableDef def;
+    BuildTableDef(&def);
+    BinlogOptions options;
+    options.sync_policy = SyncPolicy::kSyncNone;
+    {
+        auto store = OpenStore(def, dir_, options);
+        ASSERT_TRUE(store);
+        std::thread writer(
+            [&]() { PutRows(def, "k1", 0, 2000, store.get()); });
+        for (int i = 0; i < 5; i++) {
+            ASSERT_TRUE(store->MakeSnapshot());
+        }
+        writer.join();
+    }
+    // every row is either in the snapshot or replayed, never both
+    auto store = OpenStore(def, dir_, options);
+    ASSERT_TRUE(store);
+    ASSERT_TRUE(store->Recover(4));
+    ASSERT_EQ(2000u, CountRows(store->GetTable().get(), "k1", "index1"));
+}
+
+}  // namespace storage
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -15,9 +15,13 @@
  */
 
 #include <sys/time.h>
+#include <memory>
 #include <string>
+#include <vector>
+#include "case/sql_case.h"
 #include "codec/fe_row_codec.h"
 #include "gtest/gtest.h"
+#include "storage/table_gc.h"
 #include "storage/table_impl.h"
 
 namespace hybridse {
@@ -467,6 +471,272 @@ TEST_F(TableTest, DecodeKeysAndTsTest) {
     ASSERT_EQ("i1_k1|21", key);
     ASSERT_EQ(11L, time);
 }
+// table of (col1 string, col2 int64, col3 string) with a ttl index on col1
+// with ts col2 and an index on col3 without ttl
+static void BuildTTLTableDef(::hybridse::type::TTLType ttl_type,
+                             const std::vector<uint64_t>& ttls,
+                             ::hybridse::type::TableDef* def) {
+    ::hybridse::type::ColumnDef* col = def->add_columns();
+    col->set_name("col1");
+    col->set_type(::hybridse::type::kVarchar);
+    col = def->add_columns();
+    col->set_name("col2");
+    col->set_type(::hybridse::type::kInt64);
+    col = def->add_columns();
+    col->set_name("col3");
+    col->set_type(::hybridse::type::kVarchar);
+    ::hybridse::type::IndexDef* index = def->add_indexes();
+    index->set_name("index1");
+    index->add_first_keys("col1");
+    index->set_second_key("col2");
+    for (auto ttl : ttls) {
+        index->add_ttl(ttl);
+    }
+    index->set_ttl_type(ttl_type);
+    index = def->add_indexes();
+    index->set_name("index2");
+    index->add_first_keys("col3");
+    index->set_second_key("col2");
+}
+
+static void PutTTLRows(const ::hybridse::type::TableDef& def,
+                       const std::string& key, int64_t begin, int64_t end,
+                       Table* table) {
+    RowBuilder builder(def.columns());
+    uint32_t size = builder.CalTotalLength(key.size() + 2);
+    for (int64_t ts = begin; ts < end; ++ts) {
+        std::string row;
+        row.resize(size);
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&(row[0])), size);
+        builder.AppendString(key.c_str(), key.size());
+        builder.AppendInt64(ts);
+        builder.AppendString("v1", 2);
+        ASSERT_TRUE(table->Put(row.c_str(), row.length()));
+    }
+}
+
+static uint64_t CountRows(Table* table, const std::string& key,
+                          const std::string& index_name) {
+    auto iter = table->NewIterator(key, index_name);
+    uint64_t cnt = 0;
+    iter->SeekToFirst();
+    while (iter->Valid()) {
+        cnt++;
+        iter->Next();
+    }
+    return cnt;
+}
+
+TEST_F(TableTest, GcTimeTTL) {
+    ::hybridse::type::TableDef def;
+    BuildTTLTableDef(::hybridse::type::kTTLTimeLive, {100}, &def);
+    Table table(1, 1, def);
+    ASSERT_TRUE(table.Init());
+    PutTTLRows(def, "k1", 0, 1000, &table);
+    PutTTLRows(def, "k2", 500, 600, &table);
+
+    uint64_t version = table.GetVersion();
+    // rows before 900 are expired
+    GcStat stat = table.SchedGc(1000);
+    ASSERT_EQ(1000u, stat.expired_row_cnt);
+    ASSERT_EQ(0u, stat.freed_bytes);
+    ASSERT_LT(version, table.GetVersion());
+    ASSERT_EQ(100u, CountRows(&table, "k1", "index1"));
+    ASSERT_EQ(0u, CountRows(&table, "k2", "index1"));
+    // index without ttl still holds the rows
+    ASSERT_EQ(1100u, CountRows(&table, "v1", "index2"));
+
+    // cut rows are freed by the next round only if no index holds them
+    stat = table.SchedGc(1000);
+    ASSERT_EQ(0u, stat.expired_row_cnt);
+    ASSERT_EQ(0u, stat.freed_row_cnt);
+    ASSERT_LT(0u, stat.freed_bytes);
+    ASSERT_EQ(100u, CountRows(&table, "k1", "index1"));
+}
+
+// ttl of a yaml case is in the unit of the ttl of create table, 1m expires
+// rows older than 60000 ms
+TEST_F(TableTest, GcYamlCaseTTL) {
+    sqlcase::SqlCase::TableInfo info;
+    ASSERT_TRUE(sqlcase::SqlCase::CreateTableInfoFromYamlNode(
+        YAML::Load("name: t1\n"
+                   "columns: [\"col1 string\", \"col2 int64\", "
+                   "\"col3 string\"]\n"
+                   "indexs: [\"index1:col1:col2:1m:absolute\", "
+                   "\"index2:col3:col2\"]\n"),
+        &info));
+    sqlcase::SqlCase sql_case;
+    ::hybridse::type::TableDef def;
+    ASSERT_TRUE(sql_case.ExtractInputTableDef(info, def));
+    ASSERT_EQ(60000u, def.indexes(0).ttl(0));
+    Table table(1, 1, def);
+    ASSERT_TRUE(table.Init());
+    PutTTLRows(def, "k1", 59900, 60100, &table);
+
+    GcStat stat = table.SchedGc(120000);
+    ASSERT_EQ(100u, stat.expired_row_cnt);
+    ASSERT_EQ(100u, CountRows(&table, "k1", "index1"));
+    // the oldest row kept is right at the expiry point
+    auto iter = table.NewIterator("k1", "index1");
+    uint64_t oldest = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        oldest = iter->GetKey();
+    }
+    ASSERT_EQ(60000u, oldest);
+}
+
+TEST_F(TableTest, GcCountTTL) {
+    ::hybridse::type::TableDef def;
+    BuildTTLTableDef(::hybridse::type::kTTLCountLive, {10}, &def);
+    def.mutable_indexes(1)->add_ttl(10);
+    def.mutable_indexes(1)->set_ttl_type(::hybridse::type::kTTLCountLive);
+    Table table(1, 1, def);
+    ASSERT_TRUE(table.Init());
+    // deep enough to turn into skip list
+    PutTTLRows(def, "k1", 0, 1000, &table);
+    PutTTLRows(def, "k2", 0, 5, &table);
+
+    GcStat stat = table.SchedGc(1000);
+    ASSERT_EQ(990u + 995u, stat.expired_row_cnt);
+    ASSERT_EQ(10u, CountRows(&table, "k1", "index1"));
+    ASSERT_EQ(5u, CountRows(&table, "k2", "index1"));
+    ASSERT_EQ(10u, CountRows(&table, "v1", "index2"));
+
+    // latest rows are kept
+    auto iter = table.NewIterator("k1", "index1");
+    iter->SeekToFirst();
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(999u, iter->GetKey());
+
+    stat = table.SchedGc(1000);
+    ASSERT_EQ(0u, stat.expired_row_cnt);
+    ASSERT_EQ(990u, stat.freed_row_cnt);
+    ASSERT_LT(0u, stat.freed_bytes);
+    ASSERT_EQ(990u, table.GetGcStat().freed_row_cnt);
+    ASSERT_EQ(990u + 995u, table.GetGcStat().expired_row_cnt);
+}
+
+TEST_F(TableTest, GcWaitForReaders) {
+    ::hybridse::type::TableDef def;
+    BuildTTLTableDef(::hybridse::type::kTTLCountLive, {10}, &def);
+    def.mutable_indexes(1)->add_ttl(10);
+    def.mutable_indexes(1)->set_ttl_type(::hybridse::type::kTTLCountLive);
+    Table table(1, 1, def);
+    ASSERT_TRUE(table.Init());
+    PutTTLRows(def, "k1", 0, 100, &table);
+
+    // a reader registered before the cut may still walk the cut rows
+    auto iter = table.NewIterator("k1", "index1");
+    iter->SeekToFirst();
+    ASSERT_TRUE(iter->Valid());
+    GcStat stat = table.SchedGc(1000);
+    ASSERT_EQ(90u + 90u, stat.expired_row_cnt);
+    for (int i = 0; i < 10; i++) {
+        iter->Next();
+    }
+    stat = table.SchedGc(1000);
+    ASSERT_EQ(0u, stat.freed_bytes);
+    uint64_t cnt = 0;
+    for (; iter->Valid(); iter->Next()) {
+        ASSERT_EQ(89u - cnt, iter->GetKey());
+        cnt++;
+    }
+    ASSERT_EQ(90u, cnt);
+
+    // freed once the reader is gone
+    iter.reset();
+    stat = table.SchedGc(1000);
+    ASSERT_EQ(90u, stat.freed_row_cnt);
+}
+
+TEST_F(TableTest, GcTimeAndCountTTL) {
+    {
+        // expired only if expired by time and count
+        ::hybridse::type::TableDef def;
+        BuildTTLTableDef(::hybridse::type::kTTLTimeLiveAndCountLive,
+                         {100, 500}, &def);
+        Table table(1, 1, def);
+        ASSERT_TRUE(table.Init());
+        PutTTLRows(def, "k1", 0, 1000, &table);
+        table.SchedGc(1000);
+        ASSERT_EQ(500u, CountRows(&table, "k1", "index1"));
+        table.SchedGc(1300);
+        ASSERT_EQ(500u, CountRows(&table, "k1", "index1"));
+    }
+    {
+        // expired if expired by time or count
+        ::hybridse::type::TableDef def;
+        BuildTTLTableDef(::hybridse::type::kTTLTimeLiveOrCountLive,
+                         {100, 500}, &def);
+        Table table(1, 1, def);
+        ASSERT_TRUE(table.Init());
+        PutTTLRows(def, "k1", 0, 1000, &table);
+        table.SchedGc(1000);
+        ASSERT_EQ(100u, CountRows(&table, "k1", "index1"));
+        table.SchedGc(1050);
+        ASSERT_EQ(50u, CountRows(&table, "k1", "index1"));
+    }
+}
+TEST_F(TableTest, TableGcRunOnce) {
+    ::hybridse::type::TableDef def;
+    BuildTTLTableDef(::hybridse::type::kTTLCountLive, {10}, &def);
+    auto table = std::make_shared<Table>(1, 1, def);
+    ASSERT_TRUE(table->Init());
+    PutTTLRows(def, "k1", 0, 100, table.get());
+
+    TableGc gc(1000);
+    gc.AddTable(table);
+    GcStat stat = gc.RunOnce();
+    ASSERT_EQ(90u, stat.expired_row_cnt);
+    ASSERT_EQ(10u, CountRows(table.get(), "k1", "index1"));
+
+    // destroyed tables are dropped
+    table.reset();
+    stat = gc.RunOnce();
+    ASSERT_EQ(0u, stat.expired_row_cnt);
+}
+
+TEST_F(TableTest, PutBatch) {
+    ::hybridse::type::TableDef def;
+    BuildTTLTableDef(::hybridse::type::kTTLNone, {}, &def);
+    Table table(1, 1, def);
+    ASSERT_TRUE(table.Init());
+    RowBuilder builder(def.columns());
+    std::vector<std::string> bufs;
+    for (int64_t ts = 0; ts < 300; ++ts) {
+        // keys of the batch interleave
+        std::string key = "k" + std::to_string(ts % 3);
+        uint32_t size = builder.CalTotalLength(key.size() + 2);
+        std::string row;
+        row.resize(size);
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&(row[0])), size);
+        builder.AppendString(key.c_str(), key.size());
+        builder.AppendInt64(ts);
+        builder.AppendString("v1", 2);
+        bufs.push_back(row);
+    }
+    std::vector<base::Slice> rows;
+    for (const auto& row : bufs) {
+        rows.push_back(base::Slice(row));
+    }
+    uint64_t version = table.GetVersion();
+    ASSERT_TRUE(table.PutBatch(rows));
+    ASSERT_LT(version, table.GetVersion());
+    for (int32_t i = 0; i < 3; i++) {
+        std::string key = "k" + std::to_string(i);
+        ASSERT_EQ(100u, CountRows(&table, key, "index1"));
+        auto iter = table.NewIterator(key, "index1");
+        iter->SeekToFirst();
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(static_cast<uint64_t>(297 + i), iter->GetKey());
+    }
+    ASSERT_EQ(300u, CountRows(&table, "v1", "index2"));
+
+    // a batch with a broken row is not put at all
+    rows.push_back(base::Slice(bufs[0].data(), bufs[0].size() - 1));
+    ASSERT_FALSE(table.PutBatch(rows));
+    ASSERT_EQ(300u, CountRows(&table, "v1", "index2"));
+}
 }  // namespace storage
 }  // namespace hybridse
 int main(int argc, char** argv) {
@@ -39,7 +39,7 @@ TabletTableHandler::TabletTableHandler(const vm::Schema schema,
       table_(table),
       types_(),
       index_list_(index_list),
-      tablet_() {}
+      tablets_() {}
 
 TabletTableHandler::TabletTableHandler(const vm::Schema schema,
                                        const std::string& name,
@@ -53,7 +53,23 @@ TabletTableHandler::TabletTableHandler(const vm::Schema schema,
       table_(table),
       types_(),
       index_list_(index_list),
-      tablet_(tablet) {}
+      tablets_() {
+    if (tablet) {
+        tablets_.push_back(tablet);
+    }
+}
+
+TabletTableHandler::TabletTableHandler(
+    const vm::Schema schema, const std::string& name, const std::string& db,
+    const vm::IndexList& index_list, std::shared_ptr<storage::Table> table,
+    const std::vector<std::shared_ptr<vm::Tablet>>& tablets)
+    : schema_(schema),
+      name_(name),
+      db_(db),
+      table_(table),
+      types_(),
+      index_list_(index_list),
+      tablets_(tablets) {}
 TabletTableHandler::~TabletTableHandler() {}
 
 bool TabletTableHandler::Init() {
@@ -123,34 +139,66 @@ std::unique_ptr<WindowIterator> TabletTableHandler::GetWindowIterator(
     return std::move(it);
 }
 
-// TODP(chenjing): 基于segment 优化Get(int pos) 操作
-const Row TabletTableHandler::Get(int32_t pos) {
-    auto iter = GetIterator();
+// rows of storage point into data blocks which gc may free once their
+// reader is gone, rows kept beyond the iterator are copied to own buffers
+static Row CopyRow(const Row& row) {
+    if (row.empty()) {
+        return row;
+    }
+    auto buf = base::RefCountedSlice::AllocInline(row.size());
+    if (nullptr == buf) {
+        LOG(WARNING) << "fail to alloc row of size " << row.size();
+        return Row();
+    }
+    memcpy(buf, row.buf(), row.size());
+    return Row(base::RefCountedSlice::CreateManagedInline(buf, row.size()));
+}
 
-    while (pos-- > 0 && iter->Valid()) {
-        iter->Next();
+std::shared_ptr<const std::vector<Row>> RowSnapshot::Get(
+    uint64_t version, const IteratorFactory& new_iterator) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (valid_ && version_ == version) {
+        return rows_;
+    }
+    auto rows = std::make_shared<std::vector<Row>>();
+    auto iter = new_iterator();
+    if (iter) {
+        iter->SeekToFirst();
+        while (iter->Valid()) {
+            rows->push_back(CopyRow(iter->GetValue()));
+            iter->Next();
+        }
     }
-    return iter->Valid() ? iter->GetValue() : Row();
+    rows_ = rows;
+    version_ = version;
+    valid_ = true;
+    return rows_;
+}
+
+const Row TabletTableHandler::Get(int32_t pos) {
+    return pos < 0 ? Row() : At(pos);
 }
 RowIterator* TabletTableHandler::GetRawIterator() {
     return new storage::FullTableIterator(table_->GetSegments(),
                                           table_->GetSegCnt(), table_);
 }
+// the table is live storage, materializing it would be redone on every put,
+// so positional access walks a fresh iterator instead
 const uint64_t TabletTableHandler::GetCount() {
     auto iter = GetIterator();
     uint64_t cnt = 0;
-    while (iter->Valid()) {
-        iter->Next();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
         cnt++;
     }
     return cnt;
 }
 Row TabletTableHandler::At(uint64_t pos) {
     auto iter = GetIterator();
-    while (pos-- > 0 && iter->Valid()) {
+    iter->SeekToFirst();
+    for (uint64_t i = 0; i < pos && iter->Valid(); ++i) {
         iter->Next();
     }
-    return iter->Valid() ? iter->GetValue() : Row();
+    return iter->Valid() ? CopyRow(iter->GetValue()) : Row();
 }
 
 TabletCatalog::TabletCatalog() : tables_(), db_() {}
@@ -250,20 +298,14 @@ std::unique_ptr<WindowIterator> TabletSegmentHandler::GetWindowIterator(
     return std::unique_ptr<WindowIterator>();
 }
 const uint64_t TabletSegmentHandler::GetCount() {
-    auto iter = GetIterator();
-    uint64_t cnt = 0;
-    while (iter->Valid()) {
-        cnt++;
-        iter->Next();
-    }
-    return cnt;
+    return GetRows()->size();
 }
 Row TabletSegmentHandler::At(uint64_t pos) {
-    auto iter = GetIterator();
-    while (pos-- > 0 && iter->Valid()) {
-        iter->Next();
-    }
-    return iter->Valid() ? iter->GetValue() : Row();
+    auto rows = GetRows();
+    return pos < rows->size() ? rows->at(pos) : Row();
+}
+std::shared_ptr<const std::vector<Row>> TabletSegmentHandler::GetRows() {
+    return snapshot_.Get(0, [this]() { return GetIterator(); });
 }
 
 const uint64_t TabletPartitionHandler::GetCount() {
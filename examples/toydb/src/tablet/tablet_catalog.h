@@ -17,8 +17,10 @@
 #ifndef EXAMPLES_TOYDB_SRC_TABLET_TABLET_CATALOG_H_
 #define EXAMPLES_TOYDB_SRC_TABLET_TABLET_CATALOG_H_
 
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <vector>
 #include "base/spin_lock.h"
@@ -39,6 +41,26 @@ class TabletPartitionHandler;
 class TabletTableHandler;
 class TabletSegmentHandler;
 
+/// \brief Rows of a dataset materialized once for O(1) positional access.
+///
+/// Rows are rebuilt from a new iterator only if the version of the source
+/// has changed since the last materialization. Rows are copied into buffers
+/// of their own, so they stay valid after gc frees the rows of storage.
+class RowSnapshot {
+ public:
+    typedef std::function<std::unique_ptr<RowIterator>()> IteratorFactory;
+    RowSnapshot() : mu_(), valid_(false), version_(0), rows_() {}
+
+    std::shared_ptr<const std::vector<Row>> Get(
+        uint64_t version, const IteratorFactory& new_iterator);
+
+ private:
+    std::mutex mu_;
+    bool valid_;
+    uint64_t version_;
+    std::shared_ptr<const std::vector<Row>> rows_;
+};
+
 class TabletSegmentHandler : public TableHandler {
  public:
     TabletSegmentHandler(std::shared_ptr<PartitionHandler> partition_hander,
@@ -77,8 +99,12 @@ class TabletSegmentHandler : public TableHandler {
     }
 
  private:
+    std::shared_ptr<const std::vector<Row>> GetRows();
+
     std::shared_ptr<vm::PartitionHandler> partition_hander_;
     std::string key_;
+    // segment handler is a view for one query, materialized once
+    RowSnapshot snapshot_;
 };
 
 class TabletPartitionHandler
@@ -135,6 +161,13 @@ class TabletTableHandler
                        const std::string& db, const vm::IndexList& index_list,
                        std::shared_ptr<storage::Table> table,
                        std::shared_ptr<hybridse::vm::Tablet> tablet);
+    // rows are partitioned to the tablets by hash of key, all tablets serve
+    // the same in-process storage table
+    TabletTableHandler(
+        const vm::Schema schema, const std::string& name,
+        const std::string& db, const vm::IndexList& index_list,
+        std::shared_ptr<storage::Table> table,
+        const std::vector<std::shared_ptr<hybridse::vm::Tablet>>& tablets);
 
     ~TabletTableHandler();
 
@@ -176,11 +209,14 @@ class TabletTableHandler
     }
     virtual std::shared_ptr<hybridse::vm::Tablet> GetTablet(
         const std::string& index_name, const std::string& pk) {
-        return tablet_;
+        if (tablets_.empty()) {
+            return std::shared_ptr<hybridse::vm::Tablet>();
+        }
+        return tablets_[std::hash<std::string>()(pk) % tablets_.size()];
     }
     virtual std::shared_ptr<hybridse::vm::Tablet> GetTablet(
         const std::string& index_name, const std::vector<std::string>& pks) {
-        return tablet_;
+        return GetTablet(index_name, pks.empty() ? "" : pks[0]);
     }
 
  private:
@@ -201,7 +237,7 @@ class TabletTableHandler
     vm::Types types_;
     vm::IndexList index_list_;
     vm::IndexHint index_hint_;
-    std::shared_ptr<hybridse::vm::Tablet> tablet_;
+    std::vector<std::shared_ptr<hybridse::vm::Tablet>> tablets_;
 };
 
 typedef std::map<std::string,
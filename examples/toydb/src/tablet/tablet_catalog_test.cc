@@ -0,0 +1,161 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/tablet_catalog.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include "codec/fe_row_codec.h"
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace tablet {
+using codec::RowBuilder;
+using codec::RowView;
+
+class TabletCatalogTest : public ::testing::Test {
+ public:
+    TabletCatalogTest() {}
+    ~TabletCatalogTest() {}
+};
+
+static type::TableDef BuildTableDef() {
+    type::TableDef def;
+    def.set_name("t1");
+    def.set_catalog("db");
+    type::ColumnDef* col = def.add_columns();
+    col->set_name("col1");
+    col->set_type(type::kVarchar);
+    col = def.add_columns();
+    col->set_name("col2");
+    col->set_type(type::kInt64);
+    type::IndexDef* index = def.add_indexes();
+    index->set_name("index1");
+    index->add_first_keys("col1");
+    index->set_second_key("col2");
+    return def;
+}
+
+static void PutRow(storage::Table* table, const type::TableDef& def,
+                   const std::string& key, int64_t ts) {
+    RowBuilder builder(def.columns());
+    uint32_t size = builder.CalTotalLength(key.size());
+    std::string row(size, '\0');
+    builder.SetBuffer(reinterpret_cast<int8_t*>(&(row[0])), size);
+    builder.AppendString(key.c_str(), key.size());
+    builder.AppendInt64(ts);
+    ASSERT_TRUE(table->Put(row.c_str(), row.size()));
+}
+
+// positional access must agree with the iterator order
+static void CheckPositionalAccess(TableHandler* handler) {
+    std::vector<Row> expect;
+    auto iter = handler->GetIterator();
+    if (iter) {
+        iter->SeekToFirst();
+    }
+    while (iter && iter->Valid()) {
+        expect.push_back(iter->GetValue());
+        iter->Next();
+    }
+    ASSERT_EQ(expect.size(), handler->GetCount());
+    for (size_t i = 0; i < expect.size(); ++i) {
+        ASSERT_EQ(expect[i].ToString(), handler->At(i).ToString());
+    }
+    ASSERT_EQ(0, handler->At(expect.size()).size());
+}
+
+TEST_F(TabletCatalogTest, TableHandlerAt) {
+    auto def = BuildTableDef();
+    auto table = std::make_shared<storage::Table>(1, 1, def);
+    ASSERT_TRUE(table->Init());
+    auto handler = std::make_shared<TabletTableHandler>(
+        def.columns(), def.name(), def.catalog(), def.indexes(), table);
+    ASSERT_TRUE(handler->Init());
+    ASSERT_EQ(0u, handler->GetCount());
+
+    for (int64_t ts = 1; ts <= 100; ++ts) {
+        PutRow(table.get(), def, "key" + std::to_string(ts % 7), ts);
+    }
+    CheckPositionalAccess(handler.get());
+    ASSERT_EQ(100u, handler->GetCount());
+
+    // rows put later are visible to positional access
+    PutRow(table.get(), def, "key_new", 1000);
+    ASSERT_EQ(101u, handler->GetCount());
+    CheckPositionalAccess(handler.get());
+}
+
+TEST_F(TabletCatalogTest, SegmentHandlerAt) {
+    auto def = BuildTableDef();
+    auto table = std::make_shared<storage::Table>(1, 1, def);
+    ASSERT_TRUE(table->Init());
+    auto handler = std::make_shared<TabletTableHandler>(
+        def.columns(), def.name(), def.catalog(), def.indexes(), table);
+    ASSERT_TRUE(handler->Init());
+    for (int64_t ts = 1; ts <= 100; ++ts) {
+        PutRow(table.get(), def, "key" + std::to_string(ts % 4), ts);
+    }
+    auto partition = handler->GetPartition("index1");
+    ASSERT_TRUE(partition != nullptr);
+    auto segment = partition->GetSegment("key1");
+    ASSERT_EQ(25u, segment->GetCount());
+    CheckPositionalAccess(segment.get());
+
+    auto empty = partition->GetSegment("key_not_exist");
+    ASSERT_EQ(0u, empty->GetCount());
+    ASSERT_EQ(0, empty->At(0).size());
+}
+
+TEST_F(TabletCatalogTest, RowsOutliveGc) {
+    auto def = BuildTableDef();
+    def.mutable_indexes(0)->add_ttl(1);
+    def.mutable_indexes(0)->set_ttl_type(type::kTTLCountLive);
+    auto table = std::make_shared<storage::Table>(1, 1, def);
+    ASSERT_TRUE(table->Init());
+    auto handler = std::make_shared<TabletTableHandler>(
+        def.columns(), def.name(), def.catalog(), def.indexes(), table);
+    ASSERT_TRUE(handler->Init());
+    for (int64_t ts = 1; ts <= 10; ++ts) {
+        PutRow(table.get(), def, "key1", ts);
+    }
+    auto segment = handler->GetPartition("index1")->GetSegment("key1");
+    ASSERT_EQ(10u, handler->GetCount());
+    ASSERT_EQ(10u, segment->GetCount());
+    Row oldest = handler->At(9);
+    Row oldest_in_segment = segment->At(9);
+
+    // cut and then free all rows but the latest one
+    table->SchedGc(1000);
+    ASSERT_EQ(9u, table->SchedGc(1000).freed_row_cnt);
+    RowView row_view(def.columns());
+    int64_t ts = 0;
+    ASSERT_TRUE(row_view.Reset(oldest.buf(), oldest.size()));
+    ASSERT_EQ(0, row_view.GetInt64(1, &ts));
+    ASSERT_EQ(1, ts);
+    ASSERT_TRUE(
+        row_view.Reset(oldest_in_segment.buf(), oldest_in_segment.size()));
+    ASSERT_EQ(0, row_view.GetInt64(1, &ts));
+    ASSERT_EQ(1, ts);
+}
+
+}  // namespace tablet
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
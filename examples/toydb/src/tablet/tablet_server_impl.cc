@@ -16,12 +16,14 @@
 
 #include "tablet/tablet_server_impl.h"
 
+#include <fstream>
 #include <map>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 #include "base/fe_strings.h"
+#include "boost/filesystem.hpp"
 #include "brpc/controller.h"
 #include "butil/iobuf.h"
 #include "codec/fe_schema_codec.h"
@@ -31,14 +33,43 @@ DECLARE_string(dbms_endpoint);
 DECLARE_string(toydb_endpoint);
 DECLARE_int32(toydb_port);
 DECLARE_bool(enable_keep_alive);
+DECLARE_int32(toydb_gc_interval_ms);
+DECLARE_string(toydb_data_dir);
+DECLARE_string(toydb_binlog_sync_policy);
+DECLARE_int32(toydb_binlog_sync_interval_ms);
+DECLARE_int32(toydb_binlog_file_size_mb);
+DECLARE_int32(toydb_snapshot_interval_ms);
+DECLARE_int32(toydb_recover_thread_num);
 
 namespace hybridse {
 namespace tablet {
 
+static const char TABLE_META_FILE[] = "table_meta";
+
+static std::string GetStoreDir(const CreateTableRequest& meta) {
+    return FLAGS_toydb_data_dir + "/" + std::to_string(meta.tid()) + "_" +
+           std::to_string(meta.pids(0));
+}
+
 TabletServerImpl::TabletServerImpl()
-    : slock_(), engine_(), catalog_(), dbms_ch_(NULL) {}
+    : slock_(),
+      engine_(),
+      catalog_(),
+      dbms_ch_(NULL),
+      gc_(),
+      binlog_options_(),
+      stores_(),
+      snapshotter_() {}
 
-TabletServerImpl::~TabletServerImpl() { delete dbms_ch_; }
+TabletServerImpl::~TabletServerImpl() {
+    if (gc_) {
+        gc_->Stop();
+    }
+    if (snapshotter_) {
+        snapshotter_->Stop();
+    }
+    delete dbms_ch_;
+}
 
 bool TabletServerImpl::Init() {
     catalog_ = std::shared_ptr<TabletCatalog>(new TabletCatalog());
@@ -48,6 +79,36 @@ bool TabletServerImpl::Init() {
         return false;
     }
     engine_ = std::unique_ptr<vm::Engine>(new vm::Engine(catalog_));
+    if (FLAGS_toydb_gc_interval_ms > 0) {
+        gc_ = std::unique_ptr<storage::TableGc>(
+            new storage::TableGc(FLAGS_toydb_gc_interval_ms));
+        gc_->Start();
+    }
+    if (!FLAGS_toydb_data_dir.empty()) {
+        if (!storage::ParseSyncPolicy(FLAGS_toydb_binlog_sync_policy,
+                                      &binlog_options_.sync_policy)) {
+            LOG(WARNING) << "invalid binlog sync policy "
+                         << FLAGS_toydb_binlog_sync_policy;
+            return false;
+        }
+        binlog_options_.sync_interval_ms = FLAGS_toydb_binlog_sync_interval_ms;
+        binlog_options_.max_file_size =
+            static_cast<uint64_t>(FLAGS_toydb_binlog_file_size_mb) * 1024 *
+            1024;
+        if (FLAGS_toydb_snapshot_interval_ms > 0) {
+            snapshotter_ = std::unique_ptr<storage::TableSnapshotter>(
+                new storage::TableSnapshotter(
+                    FLAGS_toydb_snapshot_interval_ms));
+        }
+        if (!Recover()) {
+            LOG(WARNING) << "fail to recover tables from "
+                         << FLAGS_toydb_data_dir;
+            return false;
+        }
+        if (snapshotter_) {
+            snapshotter_->Start();
+        }
+    }
     if (FLAGS_enable_keep_alive) {
         dbms_ch_ = new ::brpc::Channel();
         brpc::ChannelOptions options;
@@ -100,10 +161,35 @@ void TabletServerImpl::CreateTable(RpcController* ctrl,
             status->set_msg("fail to init table storage");
             return;
         }
-        ok = AddTableLocked(table);
+        std::shared_ptr<storage::TableStore> store;
+        CreateTableRequest meta;
+        if (!FLAGS_toydb_data_dir.empty()) {
+            if (GetTableLocked(request->table().catalog(),
+                               request->table().name())) {
+                status->set_code(common::kTableExists);
+                status->set_msg("table exist");
+                return;
+            }
+            meta.CopyFrom(*request);
+            meta.clear_pids();
+            meta.add_pids(request->pids(i));
+            store = CreateStore(meta, table);
+            if (!store) {
+                status->set_code(common::kBadRequest);
+                status->set_msg("fail to init table store");
+                return;
+            }
+        }
+        ok = store ? AddTableLocked(table, store) : AddTableLocked(table);
         if (!ok) {
             LOG(WARNING) << "table with name " << request->table().name()
                          << " exists";
+            if (store) {
+                // drop the orphan meta so recovery does not bring the table back
+                store.reset();
+                boost::system::error_code ec;
+                boost::filesystem::remove_all(GetStoreDir(meta), ec);
+            }
             status->set_code(common::kTableExists);
             status->set_msg("table exist");
             return;
@@ -134,8 +220,12 @@ void TabletServerImpl::Insert(RpcController* ctrl, const InsertRequest* request,
         return;
     }
 
+    std::shared_ptr<storage::TableStore> store =
+        GetStoreLocked(request->db(), request->table());
     bool ok =
-        handler->GetTable()->Put(request->row().c_str(), request->row().size());
+        store ? store->Put(request->row().c_str(), request->row().size())
+              : handler->GetTable()->Put(request->row().c_str(),
+                                         request->row().size());
     if (!ok) {
         status->set_code(common::kTablePutFailed);
         status->set_msg("fail to put row");
@@ -146,6 +236,136 @@ void TabletServerImpl::Insert(RpcController* ctrl, const InsertRequest* request,
     status->set_code(common::kOk);
 }
 
+void TabletServerImpl::InsertBatch(RpcController* ctrl,
+                                   const InsertBatchRequest* request,
+                                   InsertBatchResponse* response,
+                                   Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    ::hybridse::common::Status* status = response->mutable_status();
+    if (request->db().empty() || request->table().empty()) {
+        status->set_code(common::kBadRequest);
+        status->set_msg("db or table name is empty");
+        return;
+    }
+    std::shared_ptr<TabletTableHandler> handler =
+        GetTableLocked(request->db(), request->table());
+    if (!handler) {
+        status->set_code(common::kTableNotFound);
+        status->set_msg("table is not found");
+        return;
+    }
+    brpc::Controller* cntl = static_cast<brpc::Controller*>(ctrl);
+    const butil::IOBuf& buf = cntl->request_attachment();
+    uint64_t total_size = 0;
+    for (auto size : request->row_sizes()) {
+        total_size += size;
+    }
+    if (total_size != buf.size()) {
+        status->set_code(common::kBadRequest);
+        status->set_msg("row sizes mismatch the attachment");
+        return;
+    }
+    // the attachment may be split over blocks, rows are cut from one copy
+    std::string data;
+    buf.copy_to(&data);
+    std::vector<base::Slice> rows;
+    rows.reserve(request->row_sizes_size());
+    uint64_t pos = 0;
+    for (auto size : request->row_sizes()) {
+        rows.push_back(base::Slice(data.data() + pos, size));
+        pos += size;
+    }
+    std::shared_ptr<storage::TableStore> store =
+        GetStoreLocked(request->db(), request->table());
+    bool ok = store ? store->PutBatch(rows)
+                    : handler->GetTable()->PutBatch(rows);
+    if (!ok) {
+        status->set_code(common::kTablePutFailed);
+        status->set_msg("fail to put rows");
+        LOG(WARNING) << "fail to put " << rows.size() << " rows to table "
+                     << request->table();
+        return;
+    }
+    status->set_code(common::kOk);
+}
+
+std::shared_ptr<storage::TableStore> TabletServerImpl::CreateStore(
+    const CreateTableRequest& meta, std::shared_ptr<storage::Table> table) {
+    std::string dir = GetStoreDir(meta);
+    std::shared_ptr<storage::TableStore> store(
+        new storage::TableStore(table, dir, binlog_options_));
+    if (!store->Init()) {
+        LOG(WARNING) << "fail to init store of table " << meta.table().name();
+        return std::shared_ptr<storage::TableStore>();
+    }
+    std::string path = dir + "/" + TABLE_META_FILE;
+    {
+        std::ofstream out(path + ".tmp", std::ios::binary | std::ios::trunc);
+        if (!meta.SerializeToOstream(&out) || !out.flush()) {
+            LOG(WARNING) << "fail to write table meta " << path;
+            return std::shared_ptr<storage::TableStore>();
+        }
+    }
+    boost::system::error_code ec;
+    boost::filesystem::rename(path + ".tmp", path, ec);
+    if (ec) {
+        LOG(WARNING) << "fail to write table meta " << path << ": "
+                     << ec.message();
+        return std::shared_ptr<storage::TableStore>();
+    }
+    return store;
+}
+
+bool TabletServerImpl::Recover() {
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(FLAGS_toydb_data_dir, ec);
+    if (ec) {
+        LOG(WARNING) << "fail to create data dir " << FLAGS_toydb_data_dir
+                     << ": " << ec.message();
+        return false;
+    }
+    boost::filesystem::directory_iterator end;
+    for (boost::filesystem::directory_iterator it(FLAGS_toydb_data_dir, ec);
+         !ec && it != end; it.increment(ec)) {
+        std::string dir = it->path().string();
+        std::ifstream in(dir + "/" + TABLE_META_FILE, std::ios::binary);
+        if (!in) {
+            // the table is dropped before its meta is written
+            LOG(WARNING) << "skip " << dir << " without table meta";
+            continue;
+        }
+        CreateTableRequest meta;
+        if (!meta.ParseFromIstream(&in) || meta.pids_size() == 0) {
+            LOG(WARNING) << "fail to parse table meta under " << dir;
+            return false;
+        }
+        std::shared_ptr<storage::Table> table(
+            new storage::Table(meta.tid(), meta.pids(0), meta.table()));
+        if (!table->Init()) {
+            LOG(WARNING) << "fail to init table storage for table "
+                         << meta.table().name();
+            return false;
+        }
+        std::shared_ptr<storage::TableStore> store(
+            new storage::TableStore(table, dir, binlog_options_));
+        if (!store->Init() || !store->Recover(FLAGS_toydb_recover_thread_num)) {
+            LOG(WARNING) << "fail to recover table " << meta.table().name();
+            return false;
+        }
+        if (!AddTableLocked(table, store)) {
+            LOG(WARNING) << "table with name " << meta.table().name()
+                         << " exists";
+            return false;
+        }
+    }
+    if (ec) {
+        LOG(WARNING) << "fail to list data dir " << FLAGS_toydb_data_dir
+                     << ": " << ec.message();
+        return false;
+    }
+    return true;
+}
+
 void TabletServerImpl::Query(RpcController* ctrl, const QueryRequest* request,
                              QueryResponse* response, Closure* done) {
     brpc::ClosureGuard done_guard(done);
@@ -25,6 +25,8 @@
 #include "brpc/server.h"
 #include "proto/dbms.pb.h"
 #include "proto/fe_tablet.pb.h"
+#include "storage/table_gc.h"
+#include "storage/table_store.h"
 #include "tablet/tablet_catalog.h"
 #include "vm/engine.h"
 
@@ -50,6 +52,9 @@ class TabletServerImpl : public TabletServer {
     void Insert(RpcController* ctrl, const InsertRequest* request,
                 InsertResponse* response, Closure* done);
 
+    void InsertBatch(RpcController* ctrl, const InsertBatchRequest* request,
+                     InsertBatchResponse* response, Closure* done);
+
     void Explain(RpcController* ctrl, const ExplainRequest* request,
                  ExplainResponse* response, Closure* done);
 
@@ -82,6 +87,9 @@ class TabletServerImpl : public TabletServer {
         if (!ok) {
             return false;
         }
+        if (gc_) {
+            gc_->AddTable(table);
+        }
         return catalog_->AddTable(handler);
     }
 
@@ -90,11 +98,50 @@ class TabletServerImpl : public TabletServer {
         return AddTableUnLocked(table);
     }
 
+    inline std::shared_ptr<storage::TableStore> GetStoreLocked(
+        const std::string& db, const std::string& name) {
+        std::lock_guard<base::SpinMutex> lock(slock_);
+        auto it = stores_.find(db + "." + name);
+        if (it == stores_.end()) {
+            return std::shared_ptr<storage::TableStore>();
+        }
+        return it->second;
+    }
+
+    // Add a table and its store in one critical section, so that puts never
+    // find the table without its store and skip the binlog
+    inline bool AddTableLocked(std::shared_ptr<storage::Table> table,
+                               std::shared_ptr<storage::TableStore> store) {
+        const type::TableDef& table_def = table->GetTableDef();
+        std::lock_guard<base::SpinMutex> lock(slock_);
+        if (!AddTableUnLocked(table)) {
+            return false;
+        }
+        stores_[table_def.catalog() + "." + table_def.name()] = store;
+        if (snapshotter_) {
+            snapshotter_->AddStore(store);
+        }
+        return true;
+    }
+
+    // Create the store of a new table under the data dir, `meta` is kept
+    // for recovery
+    std::shared_ptr<storage::TableStore> CreateStore(
+        const CreateTableRequest& meta, std::shared_ptr<storage::Table> table);
+
+    // Recover tables persisted under the data dir
+    bool Recover();
+
  private:
     base::SpinMutex slock_;
     std::unique_ptr<vm::Engine> engine_;
     std::shared_ptr<TabletCatalog> catalog_;
     brpc::Channel* dbms_ch_;
+    std::unique_ptr<storage::TableGc> gc_;
+    storage::BinlogOptions binlog_options_;
+    // stores of persisted tables by db and table name
+    std::map<std::string, std::shared_ptr<storage::TableStore>> stores_;
+    std::unique_ptr<storage::TableSnapshotter> snapshotter_;
 };
 
 }  // namespace tablet
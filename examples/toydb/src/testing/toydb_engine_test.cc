@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include "gflags/gflags.h"
 #include "gtest/gtest.h"
 #include "gtest/internal/gtest-param-util.h"
 #include "testing/toydb_engine_test_base.h"
@@ -21,6 +22,8 @@
 using namespace llvm;       // NOLINT (build/namespaces)
 using namespace llvm::orc;  // NOLINT (build/namespaces)
 
+DECLARE_int32(toydb_local_tablet_num);
+
 namespace hybridse {
 namespace vm {
 TEST_P(EngineTest, test_request_engine) {
@@ -71,6 +74,20 @@ TEST_P(EngineTest, test_cluster_request_engine) {
         LOG(INFO) << "Skip mode " << sql_case.mode();
     }
 }
+TEST_P(EngineTest, test_cluster_request_engine_async_runner) {
+    ParamType sql_case = GetParam();
+    EngineOptions options;
+    options.set_cluster_optimized(true);
+    options.set_request_runner_worker_num(4);
+    LOG(INFO) << "ID: " << sql_case.id() << ", DESC: " << sql_case.desc();
+    if (!boost::contains(sql_case.mode(), "request-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-unsupport") &&
+        !boost::contains(sql_case.mode(), "cluster-unsupport")) {
+        EngineCheck(sql_case, options, kRequestMode);
+    } else {
+        LOG(INFO) << "Skip mode " << sql_case.mode();
+    }
+}
 TEST_P(EngineTest, test_cluster_batch_request_engine) {
     ParamType sql_case = GetParam();
     EngineOptions options;
@@ -109,6 +126,22 @@ TEST_P(BatchRequestEngineTest, test_cluster_batch_request_engine) {
         LOG(INFO) << "Skip mode " << sql_case.mode();
     }
 }
+TEST_P(BatchRequestEngineTest,
+       test_cluster_batch_request_engine_multi_tablets) {
+    ParamType sql_case = GetParam();
+    LOG(INFO) << "ID: " << sql_case.id() << ", DESC: " << sql_case.desc();
+    EngineOptions options;
+    options.set_cluster_optimized(true);
+    if (!boost::contains(sql_case.mode(), "batch-request-unsupport") &&
+        !boost::contains(sql_case.mode(), "cluster-unsupport")) {
+        // request rows are scattered to tablets and gathered in order
+        FLAGS_toydb_local_tablet_num = 4;
+        EngineCheck(sql_case, options, kBatchRequestMode);
+        FLAGS_toydb_local_tablet_num = 1;
+    } else {
+        LOG(INFO) << "Skip mode " << sql_case.mode();
+    }
+}
 
 }  // namespace vm
 }  // namespace hybridse
@@ -15,12 +15,16 @@
  */
 
 #include "testing/toydb_engine_test_base.h"
+#include <algorithm>
+#include "gflags/gflags.h"
 #include "gtest/gtest.h"
 #include "gtest/internal/gtest-param-util.h"
 
 using namespace llvm;       // NOLINT (build/namespaces)
 using namespace llvm::orc;  // NOLINT (build/namespaces)
 
+DECLARE_int32(toydb_local_tablet_num);
+
 namespace hybridse {
 namespace vm {
 using hybridse::sqlcase::CaseDataMock;
@@ -48,12 +52,17 @@ bool AddTable(const std::shared_ptr<tablet::TabletCatalog>& catalog,
 bool AddTable(const std::shared_ptr<tablet::TabletCatalog>& catalog,
               const hybridse::type::TableDef& table_def,
               std::shared_ptr<hybridse::storage::Table> table, Engine* engine) {
-    auto local_tablet = std::shared_ptr<vm::Tablet>(
-        new vm::LocalTablet(engine, std::shared_ptr<CompileInfoCache>()));
+    // partition keys to several local tablets to exercise the
+    // scatter-gather of batch request subqueries
+    std::vector<std::shared_ptr<vm::Tablet>> local_tablets;
+    for (int32_t i = 0; i < std::max(1, FLAGS_toydb_local_tablet_num); ++i) {
+        local_tablets.push_back(std::shared_ptr<vm::Tablet>(
+            new vm::LocalTablet(engine, std::shared_ptr<CompileInfoCache>())));
+    }
     std::shared_ptr<tablet::TabletTableHandler> handler(
         new tablet::TabletTableHandler(table_def.columns(), table_def.name(),
                                        table_def.catalog(), table_def.indexes(),
-                                       table, local_tablet));
+                                       table, local_tablets));
     bool ok = handler->Init();
     if (!ok) {
         return false;
@@ -21,8 +21,29 @@ DEFINE_string(toydb_endpoint, "",
 DEFINE_int32(toydb_port, 0, "config the port that toydb serves for");
 DEFINE_int32(toydb_thread_pool_size, 8,
              "config the thread pool for dbms and tablet");
+DEFINE_int32(toydb_local_tablet_num, 1,
+             "config the number of in-process tablets a table is "
+             "partitioned to when running cluster mode locally");
 DEFINE_string(tablet_endpoint, "",
               "config the ip and port that toydb tablet for");
 // for tablet
 DEFINE_string(dbms_endpoint, "", "config the ip and port that toydb dbms for");
 DEFINE_bool(enable_keep_alive, true, "config if tablet keep alive with dbms");
+DEFINE_int32(toydb_gc_interval_ms, 0,
+             "config the interval tablet tables are gc-ed by ttl in ms, "
+             "0 to disable gc");
+DEFINE_string(toydb_data_dir, "",
+              "config the dir tablet tables are persisted to by binlog and "
+              "snapshots, empty to keep tables in memory only");
+DEFINE_string(toydb_binlog_sync_policy, "group",
+              "config when binlog is synced to disk: none, group for every "
+              "group commit, or interval");
+DEFINE_int32(toydb_binlog_sync_interval_ms, 1000,
+             "config the interval binlog is synced in ms by interval policy");
+DEFINE_int32(toydb_binlog_file_size_mb, 256,
+             "config the size in mb a new binlog file is started at");
+DEFINE_int32(toydb_snapshot_interval_ms, 1800000,
+             "config the interval snapshots of tablet tables are made in ms, "
+             "0 to disable snapshots");
+DEFINE_int32(toydb_recover_thread_num, 8,
+             "config the number of threads a table snapshot is loaded with");
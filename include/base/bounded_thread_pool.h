@@ -0,0 +1,111 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_BASE_BOUNDED_THREAD_POOL_H_
+#define INCLUDE_BASE_BOUNDED_THREAD_POOL_H_
+
+#include <stddef.h>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+namespace hybridse {
+namespace base {
+
+/**
+ * A fixed group of worker threads draining a bounded task queue. Workers
+ * start on the first submitted task, pending tasks are still run when the
+ * pool is destroyed.
+ */
+class BoundedThreadPool {
+ public:
+    BoundedThreadPool(size_t worker_num, size_t max_pending_num)
+        : worker_num_(worker_num == 0 ? 1 : worker_num),
+          max_pending_num_(max_pending_num) {}
+
+    ~BoundedThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stopped_ = true;
+        }
+        cond_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    BoundedThreadPool(const BoundedThreadPool&) = delete;
+    BoundedThreadPool& operator=(const BoundedThreadPool&) = delete;
+
+    /// Return false without running the task if the queue is full
+    bool Submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (stopped_ || tasks_.size() >= max_pending_num_) {
+                return false;
+            }
+            tasks_.push_back(std::move(task));
+            if (threads_.empty()) {
+                for (size_t i = 0; i < worker_num_; ++i) {
+                    threads_.emplace_back([this]() { WorkLoop(); });
+                }
+            }
+        }
+        cond_.notify_one();
+        return true;
+    }
+
+    size_t worker_num() const { return worker_num_; }
+
+    size_t pending_num() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return tasks_.size();
+    }
+
+ private:
+    void WorkLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                cond_.wait(lock,
+                           [this]() { return stopped_ || !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    const size_t worker_num_;
+    const size_t max_pending_num_;
+    std::mutex mu_;
+    std::condition_variable cond_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+    bool stopped_ = false;
+};
+
+}  // namespace base
+}  // namespace hybridse
+#endif  // INCLUDE_BASE_BOUNDED_THREAD_POOL_H_
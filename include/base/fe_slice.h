@@ -123,6 +123,37 @@ inline int Slice::compare(const Slice &b) const {
     return r;
 }
 
+class Slab;
+
+// Ref count of a managed slice. `slab` is null if both the buffer and the
+// count are allocated from heap, otherwise they are carved from `slab`.
+// `inlined` is set if the count is placed right before the buffer in the
+// same heap allocation. `atomic` is set if the count is updated with atomic
+// operations, so that the slice can be shared between threads.
+struct SliceRefCount {
+    int32_t cnt;
+    bool atomic;
+    bool inlined;
+    Slab *slab;
+
+    inline void Ref() {
+        if (atomic) {
+            __atomic_add_fetch(&cnt, 1, __ATOMIC_RELAXED);
+        } else {
+            cnt += 1;
+        }
+    }
+
+    // Return true if the last reference is dropped
+    inline bool Unref() {
+        if (atomic) {
+            return __atomic_sub_fetch(&cnt, 1, __ATOMIC_ACQ_REL) == 0;
+        }
+        cnt -= 1;
+        return cnt == 0;
+    }
+};
+
 class RefCountedSlice : public Slice {
  public:
     ~RefCountedSlice();
@@ -132,6 +163,27 @@ class RefCountedSlice : public Slice {
         return RefCountedSlice(buf, size, true);
     }
 
+    // Create slice own the buffer with an external ref count cell
+    inline static RefCountedSlice CreateManaged(int8_t *buf, size_t size,
+                                                SliceRefCount *ref_cnt) {
+        ref_cnt->cnt = 1;
+        ref_cnt->atomic = IsAtomicRefCount();
+        return RefCountedSlice(buf, size, ref_cnt);
+    }
+
+    // Allocate a buffer of `size` bytes together with its ref count cell in
+    // a single heap allocation, which should be wrapped with
+    // `CreateManagedInline()` later. Return nullptr on failure.
+    static int8_t *AllocInline(size_t size);
+
+    // Create slice own the buffer allocated by `AllocInline()`
+    inline static RefCountedSlice CreateManagedInline(int8_t *buf,
+                                                      size_t size) {
+        return CreateManaged(buf, size,
+                             reinterpret_cast<SliceRefCount *>(
+                                 buf - sizeof(SliceRefCount)));
+    }
+
     // Create slice without ownership
     inline static RefCountedSlice Create(int8_t *buf, size_t size) {
         return RefCountedSlice(buf, size, false);
@@ -142,6 +194,15 @@ class RefCountedSlice : public Slice {
         return RefCountedSlice(buf, size, false);
     }
 
+    // Return true if slices created on current thread count references with
+    // atomic operations, see `AtomicRefCountScope`.
+    static bool IsAtomicRefCount();
+
+    // Switch the ref count of a managed slice, and of the slab it is carved
+    // from, to atomic operations so that it can be shared with other threads.
+    // No other thread may reference the slice meanwhile.
+    void MakeRefCountAtomic();
+
     RefCountedSlice() : Slice(nullptr, 0), ref_cnt_(nullptr) {}
 
     RefCountedSlice(const RefCountedSlice &slice);
@@ -152,16 +213,39 @@ class RefCountedSlice : public Slice {
  private:
     RefCountedSlice(int8_t *data, size_t size, bool managed)
         : Slice(reinterpret_cast<const char *>(data), size),
-          ref_cnt_(managed ? new int(1) : nullptr) {}
+          ref_cnt_(managed ? new SliceRefCount{1, IsAtomicRefCount(), false,
+                                               nullptr}
+                           : nullptr) {}
 
     RefCountedSlice(const char *data, size_t size, bool managed)
-        : Slice(data, size), ref_cnt_(managed ? new int(1) : nullptr) {}
+        : Slice(data, size),
+          ref_cnt_(managed ? new SliceRefCount{1, IsAtomicRefCount(), false,
+                                               nullptr}
+                           : nullptr) {}
+
+    RefCountedSlice(int8_t *data, size_t size, SliceRefCount *ref_cnt)
+        : Slice(reinterpret_cast<const char *>(data), size),
+          ref_cnt_(ref_cnt) {}
 
     void Release();
 
     void Update(const RefCountedSlice &slice);
 
-    int32_t *ref_cnt_;
+    SliceRefCount *ref_cnt_;
+};
+
+// Count references of slices and slabs created on current thread with atomic
+// operations while the scope is alive, so that rows can be shared and released
+// across threads. Slices created before keep the mode they are created with.
+class AtomicRefCountScope {
+ public:
+    explicit AtomicRefCountScope(bool flag = true);
+    ~AtomicRefCountScope();
+    AtomicRefCountScope(const AtomicRefCountScope &) = delete;
+    AtomicRefCountScope &operator=(const AtomicRefCountScope &) = delete;
+
+ private:
+    bool prev_;
 };
 
 }  // namespace base
@@ -50,6 +50,8 @@ class MemoryChunk {
     }
     inline void free() { allocated_size_ = 0; }
     inline MemoryChunk* next() { return next_; }
+    inline void set_next(MemoryChunk* next) { next_ = next; }
+    inline size_t size() const { return chuck_size_; }
     enum { DEFAULT_CHUCK_SIZE = 4096 };
 
  private:
@@ -58,10 +60,25 @@ class MemoryChunk {
     size_t allocated_size_;
     char* mem_;
 };
+struct MemoryPoolStats {
+    // total bytes handed out by Alloc
+    uint64_t allocated_bytes = 0;
+    // chunks (and their bytes) kept by the pool, either in use or retained
+    uint64_t chunks = 0;
+    uint64_t chunk_bytes = 0;
+    // times the pool is reset or rewound
+    uint64_t resets = 0;
+    // times retained chunks are released because of idleness
+    uint64_t shrinks = 0;
+};
+
 class ByteMemoryPool {
  public:
     explicit ByteMemoryPool(size_t init_size = MemoryChunk::DEFAULT_CHUCK_SIZE)
-        : chucks_(nullptr) {
+        : chucks_(nullptr),
+          free_chucks_(nullptr),
+          high_water_(0),
+          idle_rewinds_(0) {
         DLOG(INFO) << std::this_thread::get_id() << " " << __FUNCTION__ << "("
                    << reinterpret_cast<void*>(this) << ")" << std::endl;
 
@@ -76,25 +93,108 @@ class ByteMemoryPool {
         if (nullptr == chucks_ || chucks_->available_size() < request_size) {
             ExpandStorage(request_size);
         }
+        stats_.allocated_bytes += request_size;
         return chucks_->Alloc(request_size);
     }
 
-    // clear last chuck
-    // and delete other chucks
+    // delete all chucks, including the retained ones
     void Reset() {
-        auto chuck = chucks_;
-        while (chuck) {
-            chucks_ = chuck->next();
-            delete chuck;
-            chuck = chucks_;
+        DeleteChucks(chucks_);
+        DeleteChucks(free_chucks_);
+        chucks_ = nullptr;
+        free_chucks_ = nullptr;
+        high_water_ = 0;
+        idle_rewinds_ = 0;
+        stats_.resets++;
+    }
+
+    // rewind all chucks and retain them for later allocations. Retained
+    // chucks beyond the high-water mark of the recent rewinds are deleted
+    // once the pool has been rewound `idle_threshold` times in a row
+    // without using all of them. `idle_threshold` 0 never shrinks.
+    void Rewind(uint32_t idle_threshold) {
+        size_t used = 0;
+        while (chucks_) {
+            auto next = chucks_->next();
+            chucks_->free();
+            chucks_->set_next(free_chucks_);
+            free_chucks_ = chucks_;
+            chucks_ = next;
+            used++;
+        }
+        stats_.resets++;
+        if (used >= stats_.chunks) {
+            high_water_ = 0;
+            idle_rewinds_ = 0;
+            return;
+        }
+        high_water_ = used > high_water_ ? used : high_water_;
+        if (idle_threshold == 0 || ++idle_rewinds_ < idle_threshold) {
+            return;
+        }
+        // keep the first `high_water_` retained chucks
+        size_t kept = 0;
+        MemoryChunk* last = nullptr;
+        auto chuck = free_chucks_;
+        while (chuck && kept < high_water_) {
+            last = chuck;
+            chuck = chuck->next();
+            kept++;
+        }
+        if (last == nullptr) {
+            free_chucks_ = nullptr;
+        } else {
+            last->set_next(nullptr);
         }
+        DeleteChucks(chuck);
+        high_water_ = 0;
+        idle_rewinds_ = 0;
+        stats_.shrinks++;
     }
+
     void ExpandStorage(size_t request_size) {
+        // reuse the first retained chuck which is large enough
+        MemoryChunk* prev = nullptr;
+        auto chuck = free_chucks_;
+        while (chuck && chuck->available_size() < request_size) {
+            prev = chuck;
+            chuck = chuck->next();
+        }
+        if (chuck != nullptr) {
+            if (prev == nullptr) {
+                free_chucks_ = chuck->next();
+            } else {
+                prev->set_next(chuck->next());
+            }
+            chuck->set_next(chucks_);
+            chucks_ = chuck;
+            return;
+        }
         chucks_ = new MemoryChunk(chucks_, request_size);
+        stats_.chunks++;
+        stats_.chunk_bytes += chucks_->size();
     }
 
+    inline const MemoryPoolStats& stats() const { return stats_; }
+
  private:
+    void DeleteChucks(MemoryChunk* chuck) {
+        while (chuck) {
+            auto next = chuck->next();
+            stats_.chunks--;
+            stats_.chunk_bytes -= chuck->size();
+            delete chuck;
+            chuck = next;
+        }
+    }
+
     MemoryChunk* chucks_;
+    // rewound chucks which are ready for reuse
+    MemoryChunk* free_chucks_;
+    // max chucks used in a run step since the pool becomes idle
+    size_t high_water_;
+    size_t idle_rewinds_;
+    MemoryPoolStats stats_;
 };
 }  // namespace base
 }  // namespace hybridse
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_BASE_SIMD_AGG_H_
+#define INCLUDE_BASE_SIMD_AGG_H_
+#include <stddef.h>
+#include <stdint.h>
+
+namespace hybridse {
+namespace base {
+
+/**
+ * Aggregation kernels over contiguous values. Each kernel is dispatched at
+ * run time to an AVX2 or SSE4.2 implementation if the cpu supports it, or
+ * else to a scalar loop. Results are exactly the same as folding values
+ * one by one.
+ */
+enum SimdLevel { kSimdScalar = 0, kSimdSse42, kSimdAvx2 };
+
+/// Return the instruction set kernels are dispatched to.
+SimdLevel GetSimdLevel();
+
+/// Return sum of values, wrapping around on overflow like a scalar sum.
+int16_t SimdSum(const int16_t* values, size_t n);
+int32_t SimdSum(const int32_t* values, size_t n);
+int64_t SimdSum(const int64_t* values, size_t n);
+
+/// Return sum of values widened to int64.
+int64_t SimdWideSum(const int16_t* values, size_t n);
+int64_t SimdWideSum(const int32_t* values, size_t n);
+
+/// Fold values with `v < cur ? v : cur` starting from `init`.
+int16_t SimdMin(const int16_t* values, size_t n, int16_t init);
+int32_t SimdMin(const int32_t* values, size_t n, int32_t init);
+int64_t SimdMin(const int64_t* values, size_t n, int64_t init);
+float SimdMin(const float* values, size_t n, float init);
+double SimdMin(const double* values, size_t n, double init);
+
+/// Fold values with `v > cur ? v : cur` starting from `init`.
+int16_t SimdMax(const int16_t* values, size_t n, int16_t init);
+int32_t SimdMax(const int32_t* values, size_t n, int32_t init);
+int64_t SimdMax(const int64_t* values, size_t n, int64_t init);
+float SimdMax(const float* values, size_t n, float init);
+double SimdMax(const double* values, size_t n, double init);
+
+}  // namespace base
+}  // namespace hybridse
+#endif  // INCLUDE_BASE_SIMD_AGG_H_
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_BASE_SLAB_ALLOCATOR_H_
+#define INCLUDE_BASE_SLAB_ALLOCATOR_H_
+#include <stddef.h>
+#include <stdint.h>
+#include "base/fe_slice.h"
+
+namespace hybridse {
+namespace base {
+
+/**
+ * A continuous memory block which buffers are carved from. A slab is
+ * referenced by its allocator and by every live buffer carved from it, it
+ * deletes itself once the last reference is dropped. References are counted
+ * atomically if the slab is created within an `AtomicRefCountScope`.
+ */
+class Slab {
+ public:
+    explicit Slab(size_t size)
+        : mem_(new char[size]),
+          size_(size),
+          offset_(0),
+          ref_cnt_{1, RefCountedSlice::IsAtomicRefCount(), false, nullptr} {}
+
+    // keep every buffer 8 bytes aligned
+    static inline size_t AlignedSize(size_t bytes) {
+        return (bytes + 7) & ~static_cast<size_t>(7);
+    }
+
+    char* Alloc(size_t bytes) {
+        bytes = AlignedSize(bytes);
+        if (bytes > size_ - offset_) {
+            return nullptr;
+        }
+        char* addr = mem_ + offset_;
+        offset_ += bytes;
+        ref_cnt_.Ref();
+        return addr;
+    }
+
+    void Unref() {
+        if (ref_cnt_.Unref()) {
+            delete this;
+        }
+    }
+
+    // Count references with atomic operations from now on, no other thread
+    // may reference the slab meanwhile
+    void MakeRefCountAtomic() { ref_cnt_.atomic = true; }
+
+    inline size_t size() const { return size_; }
+
+ private:
+    ~Slab() { delete[] mem_; }
+
+    char* mem_;
+    size_t size_;
+    size_t offset_;
+    SliceRefCount ref_cnt_;
+};
+
+/**
+ * Allocator for codegen output rows. Each row buffer is carved from a slab
+ * together with its ref count cell, which is placed right before the
+ * buffer, so that a row costs no heap allocation at all. Slabs are released
+ * in bulk once the allocator and all rows carved from them are gone.
+ */
+class SlabAllocator {
+ public:
+    explicit SlabAllocator(size_t slab_size = DEFAULT_SLAB_SIZE)
+        : slab_size_(slab_size), slab_(nullptr) {}
+    ~SlabAllocator() {
+        if (slab_ != nullptr) {
+            slab_->Unref();
+        }
+    }
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    /**
+     * Allocate a row buffer of `bytes`, which should be wrapped with
+     * `CreateSlice()` later.
+     */
+    int8_t* Alloc(size_t bytes) {
+        size_t cell_size = sizeof(SliceRefCount) + bytes;
+        char* cell = nullptr;
+        Slab* slab = nullptr;
+        if (cell_size > slab_size_ / 8) {
+            // large row takes a slab of its own
+            slab = new Slab(Slab::AlignedSize(cell_size));
+            cell = slab->Alloc(cell_size);
+            slab->Unref();
+        } else {
+            if (slab_ == nullptr ||
+                (cell = slab_->Alloc(cell_size)) == nullptr) {
+                if (slab_ != nullptr) {
+                    slab_->Unref();
+                }
+                slab_ = new Slab(slab_size_);
+                cell = slab_->Alloc(cell_size);
+            }
+            slab = slab_;
+        }
+        auto ref_cnt = reinterpret_cast<SliceRefCount*>(cell);
+        ref_cnt->cnt = 0;
+        ref_cnt->inlined = false;
+        ref_cnt->slab = slab;
+        return reinterpret_cast<int8_t*>(cell + sizeof(SliceRefCount));
+    }
+
+    /**
+     * Wrap buffer allocated by `Alloc()` into a managed slice.
+     */
+    static RefCountedSlice CreateSlice(int8_t* buf, size_t size) {
+        return RefCountedSlice::CreateManaged(
+            buf, size,
+            reinterpret_cast<SliceRefCount*>(buf - sizeof(SliceRefCount)));
+    }
+
+    enum { DEFAULT_SLAB_SIZE = 256 * 1024 };
+
+ private:
+    size_t slab_size_;
+    Slab* slab_;
+};
+
+}  // namespace base
+}  // namespace hybridse
+#endif  // INCLUDE_BASE_SLAB_ALLOCATOR_H_
@@ -0,0 +1,258 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_BASE_WORK_STEALING_EXECUTOR_H_
+#define INCLUDE_BASE_WORK_STEALING_EXECUTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+#include "base/spin_lock.h"
+
+namespace hybridse {
+namespace base {
+
+/**
+ * Run a batch of independent tasks on a group of worker threads. Tasks are
+ * dealt to workers as contiguous ranges up front, a worker running out of
+ * tasks steals the latter half of the largest range left to others, so
+ * skewed tasks do not leave workers idle.
+ *
+ * Helper threads start on the first parallel run and are kept until the
+ * executor is destroyed. Runs do not share helpers: a run that finds them
+ * busy with another run works through its tasks on the calling thread.
+ */
+class WorkStealingExecutor {
+ public:
+    explicit WorkStealingExecutor(size_t worker_num)
+        : worker_num_(worker_num == 0 ? 1 : worker_num) {}
+
+    ~WorkStealingExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stopped_ = true;
+        }
+        cond_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+
+    /**
+     * Return the executor of `worker_num` workers shared in process, so that
+     * its helper threads are reused across runs of all callers.
+     */
+    static std::shared_ptr<WorkStealingExecutor> GetShared(size_t worker_num) {
+        static std::mutex shared_mu;
+        static std::map<size_t, std::shared_ptr<WorkStealingExecutor>> shared;
+        worker_num = worker_num == 0 ? 1 : worker_num;
+        std::lock_guard<std::mutex> lock(shared_mu);
+        auto& executor = shared[worker_num];
+        if (!executor) {
+            executor = std::make_shared<WorkStealingExecutor>(worker_num);
+        }
+        return executor;
+    }
+
+    size_t worker_num() const { return worker_num_; }
+
+    /**
+     * Run `fn(worker_idx, task_idx)` for every task of `[0, task_num)`, the
+     * calling thread works as worker 0. Return after all tasks are done.
+     */
+    void Run(size_t task_num, const std::function<void(size_t, size_t)>& fn) {
+        size_t worker_num = std::min(worker_num_, task_num);
+        bool busy = false;
+        if (worker_num <= 1 || !busy_.compare_exchange_strong(busy, true)) {
+            for (size_t i = 0; i < task_num; ++i) {
+                fn(0, i);
+            }
+            return;
+        }
+        std::vector<TaskRange> ranges(worker_num);
+        for (size_t i = 0; i < worker_num; ++i) {
+            ranges[i].begin = task_num * i / worker_num;
+            ranges[i].end = task_num * (i + 1) / worker_num;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (threads_.empty()) {
+                threads_.reserve(worker_num_ - 1);
+                for (size_t i = 1; i < worker_num_; ++i) {
+                    threads_.emplace_back([this, i]() { HelperLoop(i); });
+                }
+            }
+            ranges_ = &ranges;
+            fn_ = &fn;
+            active_num_ = worker_num;
+            pending_num_ = worker_num - 1;
+            round_ += 1;
+        }
+        cond_.notify_all();
+        WorkLoop(&ranges, 0, fn);
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            done_cond_.wait(lock, [this]() { return pending_num_ == 0; });
+            ranges_ = nullptr;
+            fn_ = nullptr;
+        }
+        busy_.store(false);
+    }
+
+ private:
+    struct TaskRange {
+        SpinMutex mu;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    static void WorkLoop(std::vector<TaskRange>* ranges, size_t worker_idx,
+                         const std::function<void(size_t, size_t)>& fn) {
+        auto& own = (*ranges)[worker_idx];
+        while (true) {
+            size_t task_idx = 0;
+            bool has_task = false;
+            {
+                std::lock_guard<SpinMutex> lock(own.mu);
+                if (own.begin < own.end) {
+                    task_idx = own.begin++;
+                    has_task = true;
+                }
+            }
+            if (has_task) {
+                fn(worker_idx, task_idx);
+            } else if (!Steal(ranges, worker_idx)) {
+                return;
+            }
+        }
+    }
+
+    // move latter half of the largest range of others into own range,
+    // return false if there is nothing left to steal
+    static bool Steal(std::vector<TaskRange>* ranges, size_t worker_idx) {
+        while (true) {
+            size_t victim = worker_idx;
+            size_t max_left = 0;
+            for (size_t i = 0; i < ranges->size(); ++i) {
+                if (i == worker_idx) {
+                    continue;
+                }
+                auto& range = (*ranges)[i];
+                std::lock_guard<SpinMutex> lock(range.mu);
+                if (range.end - range.begin > max_left) {
+                    max_left = range.end - range.begin;
+                    victim = i;
+                }
+            }
+            if (max_left == 0) {
+                return false;
+            }
+            size_t begin = 0;
+            size_t end = 0;
+            {
+                auto& range = (*ranges)[victim];
+                std::lock_guard<SpinMutex> lock(range.mu);
+                if (range.begin >= range.end) {
+                    // drained by its owner meanwhile, try again
+                    continue;
+                }
+                size_t mid = range.begin + (range.end - range.begin) / 2;
+                begin = mid;
+                end = range.end;
+                range.end = mid;
+            }
+            if (begin == end) {
+                // single task left, take it
+                auto& range = (*ranges)[victim];
+                std::lock_guard<SpinMutex> lock(range.mu);
+                if (range.begin >= range.end) {
+                    continue;
+                }
+                begin = range.begin;
+                end = begin + 1;
+                range.begin = end;
+            }
+            auto& own = (*ranges)[worker_idx];
+            std::lock_guard<SpinMutex> lock(own.mu);
+            own.begin = begin;
+            own.end = end;
+            return true;
+        }
+    }
+
+    // helper `worker_idx` joins every run of more than `worker_idx` workers
+    void HelperLoop(size_t worker_idx) {
+        uint64_t round = 0;
+        while (true) {
+            std::vector<TaskRange>* ranges = nullptr;
+            const std::function<void(size_t, size_t)>* fn = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                cond_.wait(lock, [this, round]() {
+                    return stopped_ || round_ != round;
+                });
+                if (stopped_) {
+                    return;
+                }
+                round = round_;
+                if (worker_idx >= active_num_) {
+                    continue;
+                }
+                ranges = ranges_;
+                fn = fn_;
+            }
+            WorkLoop(ranges, worker_idx, *fn);
+            bool done = false;
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                pending_num_ -= 1;
+                done = pending_num_ == 0;
+            }
+            if (done) {
+                done_cond_.notify_one();
+            }
+        }
+    }
+
+    const size_t worker_num_;
+    std::atomic<bool> busy_{false};
+    std::mutex mu_;
+    std::condition_variable cond_;
+    std::condition_variable done_cond_;
+    std::vector<std::thread> threads_;
+    // the run helpers are working on, guarded by `mu_`
+    uint64_t round_ = 0;
+    std::vector<TaskRange>* ranges_ = nullptr;
+    const std::function<void(size_t, size_t)>* fn_ = nullptr;
+    size_t active_num_ = 0;
+    size_t pending_num_ = 0;
+    bool stopped_ = false;
+};
+
+}  // namespace base
+}  // namespace hybridse
+#endif  // INCLUDE_BASE_WORK_STEALING_EXECUTOR_H_
@@ -115,6 +115,8 @@ class SqlCase {
                           hybridse::type::Type* type);
     static bool TTLTypeParse(const std::string& type_str,
                              ::hybridse::type::TTLType* type);
+    // parse ttls separated by '|', ttls with unit d/h/m/s are turned into
+    // milliseconds like ttls of create table, others are kept as they are
     static bool TTLParse(const std::string& type_str,
                          std::vector<int64_t>& ttls);  // NOLINT
 
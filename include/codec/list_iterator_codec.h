@@ -102,6 +102,9 @@ class ColumnImpl : public WrapListImpl<V, Row> {
     V At(uint64_t pos) override { return GetFieldUnsafe(root_->At(pos)); }
 
     ListV<Row> *root() const override { return root_; }
+    uint32_t row_idx() const { return row_idx_; }
+    uint32_t col_idx() const { return col_idx_; }
+    uint32_t offset() const { return offset_; }
 
  protected:
     ListV<Row> *root_;
@@ -83,6 +83,10 @@ class Row {
     // Return a string that contains the copy of the referenced data.
     std::string ToString() const;
 
+    // Switch ref counts of all slices to atomic operations, so that the row
+    // can be shared with other threads, see `RefCountedSlice`.
+    void MakeRefCountAtomic();
+
     void Reset(const int8_t *buf, size_t size) {
         slice_.reset(reinterpret_cast<const char *>(buf), size);
     }
@@ -2234,7 +2234,8 @@ class UdafDefNode : public FnDefNode {
           init_expr_(init_expr),
           update_(update_func),
           merge_(merge_func),
-          output_(output_func) {}
+          output_(output_func),
+          retract_(nullptr) {}
 
     const std::string GetName() const override { return name_; }
 
@@ -2245,8 +2246,13 @@ class UdafDefNode : public FnDefNode {
     FnDefNode *update_func() const { return update_; }
     FnDefNode *merge_func() const { return merge_; }
     FnDefNode *output_func() const { return output_; }
+    FnDefNode *retract_func() const { return retract_; }
+
+    // retract is the inverse of update, which remove an input from state
+    void SetRetractFunc(FnDefNode *retract_func) { retract_ = retract_func; }
 
     bool AllowMerge() const { return merge_ != nullptr; }
+    bool AllowRetract() const { return retract_ != nullptr; }
 
     base::Status Validate(const std::vector<const TypeNode *> &arg_types) const override;
 
@@ -2296,6 +2302,7 @@ class UdafDefNode : public FnDefNode {
     FnDefNode *update_;
     FnDefNode *merge_;
     FnDefNode *output_;
+    FnDefNode *retract_;
 };
 
 class PartitionMetaNode : public SqlNode {
@@ -21,6 +21,7 @@
 #include <string>
 #include <vector>
 #include "sdk/base.h"
+#include "sdk/request_row.h"
 #include "sdk/result_set.h"
 
 namespace hybridse {
@@ -37,6 +38,30 @@ class ExplainInfo {
     virtual const std::string& GetIR() = 0;
 };
 
+// An insert statement parsed once, e.g. "insert into t1 values(?, ?, 1);".
+// Values of its placeholders are bound row by row with request rows, the rows
+// are buffered and sent in batches by `Execute`. Valid while its sdk lives.
+class PreparedInsert {
+ public:
+    PreparedInsert() {}
+    virtual ~PreparedInsert() {}
+
+    // schema of the placeholders in the order of their positions
+    virtual const Schema& GetParameterSchema() = 0;
+
+    // a row to append values of the placeholders to, build it before `AddRow`
+    virtual std::shared_ptr<RequestRow> NewRow() = 0;
+
+    // buffer a table row of the statement with the values bound by `row`
+    virtual bool AddRow(RequestRow* row, sdk::Status* status) = 0;
+
+    // number of rows buffered
+    virtual uint32_t GetRowCount() = 0;
+
+    // send the buffered rows, rows not sent are kept on failure
+    virtual void Execute(sdk::Status* status) = 0;
+};
+
 class TabletSdk {
  public:
     TabletSdk() = default;
@@ -45,6 +70,10 @@ class TabletSdk {
     virtual void Insert(const std::string& db, const std::string& sql,
                         sdk::Status* status) = 0;
 
+    virtual std::shared_ptr<PreparedInsert> PrepareInsert(
+        const std::string& db, const std::string& sql,
+        sdk::Status* status) = 0;
+
     virtual std::shared_ptr<ResultSet> Query(const std::string& db,
                                              const std::string& sql,
                                              sdk::Status* status) = 0;
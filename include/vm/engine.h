@@ -17,13 +17,18 @@
 #ifndef INCLUDE_VM_ENGINE_H_
 #define INCLUDE_VM_ENGINE_H_
 
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <future>  // NOLINT
 #include <map>
 #include <memory>
 #include <mutex>  //NOLINT
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
+#include "base/bounded_thread_pool.h"
 #include "base/raw_buffer.h"
 #include "base/spin_lock.h"
 #include "codec/fe_row_codec.h"
@@ -32,6 +37,7 @@
 #include "llvm-c/Target.h"
 #include "proto/fe_common.pb.h"
 #include "vm/catalog.h"
+#include "vm/engine_compile_cache.h"
 #include "vm/engine_context.h"
 #include "vm/router.h"
 
@@ -111,6 +117,94 @@ class EngineOptions {
         return enable_batch_window_parallelization_;
     }
 
+    /// Set `true` to carve output rows from slabs owned by each run, default `false`.
+    ///
+    /// Rows of a run are released in bulk instead of one free per row, at the
+    /// cost of keeping a slab alive as long as any row carved from it is alive.
+    inline EngineOptions* set_enable_row_slab_allocator(bool flag) {
+        enable_row_slab_allocator_ = flag;
+        return this;
+    }
+    /// Return if output rows are carved from slabs.
+    inline bool is_enable_row_slab_allocator() const {
+        return enable_row_slab_allocator_;
+    }
+
+    /// Set `true` to partition batch window and group by inputs with hash
+    /// partitions, default `false`.
+    ///
+    /// Partition keys are encoded in typed binary form and located by a hash
+    /// table instead of formatted into strings and kept in an ordered map.
+    /// Partitions are then output in the order their keys first appear
+    /// rather than in key order.
+    inline EngineOptions* set_enable_hash_partition(bool flag) {
+        enable_hash_partition_ = flag;
+        return this;
+    }
+    /// Return if hash partitions are used.
+    inline bool is_enable_hash_partition() const {
+        return enable_hash_partition_;
+    }
+
+    /// Set `true` to count references of rows of a run with atomic
+    /// operations, default `false`.
+    ///
+    /// Rows output by a run can then be shared and released across threads.
+    /// Runs on parallel workers turn it on by themselves.
+    inline EngineOptions* set_enable_atomic_ref_count(bool flag) {
+        enable_atomic_ref_count_ = flag;
+        return this;
+    }
+    /// Return if rows of a run count references with atomic operations.
+    inline bool is_enable_atomic_ref_count() const {
+        return enable_atomic_ref_count_;
+    }
+
+    /// Set the number of threads batch window aggregation runs partition
+    /// keys on, default `1` which runs them serially.
+    ///
+    /// Keys are distributed over a work-stealing pool whose threads are
+    /// shared by all engines, each worker outputs rows into a buffer of its
+    /// own and buffers are merged at the end. Rows of the run count
+    /// references atomically then. Windows with a limit are always run
+    /// serially.
+    inline EngineOptions* set_batch_window_agg_worker_num(uint32_t num) {
+        batch_window_agg_worker_num_ = num;
+        return this;
+    }
+    /// Return the number of threads batch window aggregation runs on.
+    inline uint32_t batch_window_agg_worker_num() const {
+        return batch_window_agg_worker_num_;
+    }
+
+    /// Set `false` to output rows of parallel batch window aggregation in
+    /// the order workers finish instead of partition key order, default
+    /// `true`.
+    inline EngineOptions* set_enable_batch_window_agg_ordered(bool flag) {
+        enable_batch_window_agg_ordered_ = flag;
+        return this;
+    }
+    /// Return if parallel batch window aggregation keeps partition key order.
+    inline bool is_enable_batch_window_agg_ordered() const {
+        return enable_batch_window_agg_ordered_;
+    }
+
+    /// Set the number of threads a request runs its runners on, default
+    /// `1` which runs them serially.
+    ///
+    /// Runners are scheduled once their inputs are done, so independent
+    /// subtrees such as both sides of a last join and remote subqueries
+    /// overlap with local computation. Rows of the run count references
+    /// atomically then.
+    inline EngineOptions* set_request_runner_worker_num(uint32_t num) {
+        request_runner_worker_num_ = num;
+        return this;
+    }
+    /// Return the number of threads a request runs its runners on.
+    inline uint32_t request_runner_worker_num() const {
+        return request_runner_worker_num_;
+    }
+
     /// Set the maximum number of cache entries, default is `50`.
     inline void set_max_sql_cache_size(uint32_t size) {
         max_sql_cache_size_ = size;
@@ -118,6 +212,25 @@ class EngineOptions {
     /// Return the maximum number of entries we can hold for compiling cache.
     inline uint32_t max_sql_cache_size() const { return max_sql_cache_size_; }
 
+    /// Set the number of background threads `Engine::GetAsync` compiles
+    /// on, default is `2`.
+    inline EngineOptions* set_compile_worker_num(uint32_t num) {
+        compile_worker_num_ = num;
+        return this;
+    }
+    /// Return the number of background compile threads.
+    inline uint32_t compile_worker_num() const { return compile_worker_num_; }
+
+    /// Set the maximum number of queued async compiles, default is `64`.
+    inline EngineOptions* set_max_pending_compile_num(uint32_t num) {
+        max_pending_compile_num_ = num;
+        return this;
+    }
+    /// Return the maximum number of queued async compiles.
+    inline uint32_t max_pending_compile_num() const {
+        return max_pending_compile_num_;
+    }
+
     /// Set `true` to enable spark unsafe row format, default `false`.
     EngineOptions* set_enable_spark_unsaferow_format(bool flag);
     /// Return if the engine can support can support spark unsafe row format.
@@ -137,7 +250,15 @@ class EngineOptions {
     bool batch_request_optimized_;
     bool enable_expr_optimize_;
     bool enable_batch_window_parallelization_;
+    bool enable_row_slab_allocator_;
+    bool enable_hash_partition_;
+    bool enable_atomic_ref_count_;
+    uint32_t batch_window_agg_worker_num_;
+    bool enable_batch_window_agg_ordered_;
+    uint32_t request_runner_worker_num_;
     uint32_t max_sql_cache_size_;
+    uint32_t compile_worker_num_;
+    uint32_t max_pending_compile_num_;
     bool enable_spark_unsaferow_format_;
     JitOptions jit_options_;
 };
@@ -335,10 +456,28 @@ class Engine {
     ~Engine();
 
     /// \brief Compile sql in db and stored the results in the session
+    ///
+    /// Concurrent compiles of the same sql wait for the first one and
+    /// share its result.
     bool Get(const std::string& sql, const std::string& db,
              RunSession& session,    // NOLINT
              base::Status& status);  // NOLINT
 
+    /// \brief Compile sql in db on background compile threads
+    ///
+    /// A cached result is set into the session at once. Otherwise the
+    /// compile is queued and `done` is called with the compile status on
+    /// a compile thread after the result is stored in the session. If the
+    /// queue is full `done` is called at once with a failed status.
+    void GetAsync(const std::string& sql, const std::string& db,
+                  std::shared_ptr<RunSession> session,
+                  std::function<void(const base::Status&)> done);
+
+    /// \brief Same as above, but returning a future of the compile status
+    std::future<base::Status> GetAsync(const std::string& sql,
+                                       const std::string& db,
+                                       std::shared_ptr<RunSession> session);
+
     /// \brief Search all tables related to the specific sql in db.
     ///
     /// The tables' names are returned in tables
@@ -373,14 +512,28 @@ class Engine {
     /// \brief Clear engine's compiling result cache
     void ClearCacheLocked(const std::string& db);
 
+    /// \brief Return hit, miss and eviction counts of the compiling cache
+    CompileCacheStats GetCacheStats() const {
+        return compile_cache_.GetStats();
+    }
+
  private:
+    // a compile running for a sql, waited by other compiles of the sql
+    struct InflightCompile {
+        std::mutex mu;
+        std::condition_variable cond;
+        bool done = false;
+        std::shared_ptr<CompileInfo> info;
+    };
+
+    bool Compile(const std::string& sql, const std::string& db,
+                 RunSession& session,    // NOLINT
+                 base::Status& status);  // NOLINT
+
     bool GetDependentTables(node::PlanNode* node, std::set<std::string>* tables,
                             base::Status& status);  // NOLINT
-    std::shared_ptr<CompileInfo> GetCacheLocked(const std::string& db,
-                                                const std::string& sql,
-                                                EngineMode engine_mode);
-    bool SetCacheLocked(const std::string& db, const std::string& sql,
-                        EngineMode engine_mode,
+    std::shared_ptr<CompileInfo> GetCacheLocked(const CompileCacheKey& key);
+    bool SetCacheLocked(const CompileCacheKey& key,
                         std::shared_ptr<CompileInfo> info);
 
     bool IsCompatibleCache(RunSession& session,  // NOLINT
@@ -389,8 +542,13 @@ class Engine {
 
     std::shared_ptr<Catalog> cl_;
     EngineOptions options_;
-    base::SpinMutex mu_;
-    EngineLRUCache lru_cache_;
+    EngineCompileCache compile_cache_;
+    std::mutex inflight_mu_;
+    std::unordered_map<CompileCacheKey, std::shared_ptr<InflightCompile>,
+                       CompileCacheKeyHash>
+        inflight_compiles_;
+    // destroyed first to finish queued compiles
+    base::BoundedThreadPool compile_pool_;
 };
 
 /// \brief Local tablet is responsible to run a task locally.
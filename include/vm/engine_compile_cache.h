@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_VM_ENGINE_COMPILE_CACHE_H_
+#define INCLUDE_VM_ENGINE_COMPILE_CACHE_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>         // NOLINT
+#include <shared_mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "vm/engine_context.h"
+
+namespace hybridse {
+namespace vm {
+
+/// \brief Key of a compiled sql, the hash is computed once on creation.
+class CompileCacheKey {
+ public:
+    CompileCacheKey(EngineMode engine_mode, const std::string& db,
+                    const std::string& sql);
+
+    EngineMode engine_mode() const { return engine_mode_; }
+    const std::string& db() const { return db_; }
+    const std::string& sql() const { return sql_; }
+    uint64_t hash() const { return hash_; }
+
+    bool operator==(const CompileCacheKey& other) const {
+        return hash_ == other.hash_ && engine_mode_ == other.engine_mode_ &&
+               db_ == other.db_ && sql_ == other.sql_;
+    }
+
+ private:
+    EngineMode engine_mode_;
+    std::string db_;
+    std::string sql_;
+    uint64_t hash_;
+};
+
+struct CompileCacheKeyHash {
+    size_t operator()(const CompileCacheKey& key) const { return key.hash(); }
+};
+
+/// \brief Counters of the compile cache.
+struct CompileCacheStats {
+    uint64_t hit_cnt = 0;
+    uint64_t miss_cnt = 0;
+    uint64_t eviction_cnt = 0;
+};
+
+/// \brief Compile results cache of an engine.
+///
+/// Entries are spread over shards by key hash, a lookup only takes the read
+/// lock of one shard and marks the entry referenced. Each (mode, db) keeps
+/// at most `capacity` entries, evicting by the CLOCK algorithm on insert.
+class EngineCompileCache {
+ public:
+    explicit EngineCompileCache(uint32_t capacity);
+    ~EngineCompileCache() {}
+
+    std::shared_ptr<CompileInfo> Get(const CompileCacheKey& key);
+
+    /// Return false if the key exists and `overwrite` is false
+    bool Insert(const CompileCacheKey& key,
+                const std::shared_ptr<CompileInfo>& info, bool overwrite);
+
+    /// Remove all entries of db
+    void Clear(const std::string& db);
+
+    CompileCacheStats GetStats() const;
+
+ private:
+    struct Entry {
+        explicit Entry(const std::shared_ptr<CompileInfo>& compile_info)
+            : info(compile_info), referenced(false) {}
+        std::shared_ptr<CompileInfo> info;
+        std::atomic<bool> referenced;
+    };
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mu;
+        std::unordered_map<CompileCacheKey, std::shared_ptr<Entry>,
+                           CompileCacheKeyHash>
+            entries;
+        std::atomic<uint64_t> hit_cnt{0};
+        std::atomic<uint64_t> miss_cnt{0};
+        std::atomic<uint64_t> eviction_cnt{0};
+    };
+
+    // keys of a (mode, db) in insert order, swept by the clock hand
+    struct Clock {
+        std::vector<CompileCacheKey> keys;
+        size_t hand = 0;
+    };
+
+    static const size_t SHARD_NUM = 64;
+
+    Shard& GetShard(const CompileCacheKey& key) {
+        return shards_[key.hash() % SHARD_NUM];
+    }
+    void EvictOne(Clock* clock);
+
+    const uint32_t capacity_;
+    Shard shards_[SHARD_NUM];
+    // guard clocks, only taken to insert or remove entries
+    std::mutex clock_mu_;
+    std::map<std::pair<EngineMode, std::string>, Clock> clocks_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // INCLUDE_VM_ENGINE_COMPILE_CACHE_H_
@@ -94,11 +94,46 @@ class JitOptions {
     bool is_enable_perf() const { return enable_perf_; }
     void set_enable_perf(bool flag) { enable_perf_ = flag; }
 
+    bool is_enable_shared_session() const { return enable_shared_session_; }
+    void set_enable_shared_session(bool flag) {
+        enable_shared_session_ = flag;
+    }
+
+    /// Optimization level of generated code. Negative runs the default
+    /// light function passes, `0` disables optimization, `1` to `3` runs the
+    /// O1-O3 pipeline with inliner, and loop and slp vectorizers from `2`
+    int opt_level() const { return opt_level_; }
+    void set_opt_level(int level) { opt_level_ = level; }
+
+    /// Generate code for the cpu and features of the host
+    bool is_enable_host_cpu_features() const {
+        return enable_host_cpu_features_;
+    }
+    void set_enable_host_cpu_features(bool flag) {
+        enable_host_cpu_features_ = flag;
+    }
+
+    /// Link bitcode of builtin udfs into the query module so that they can be
+    /// inlined, only takes effect if built with `UDF_BITCODE_ENABLE`
+    bool is_enable_udf_bitcode() const { return enable_udf_bitcode_; }
+    void set_enable_udf_bitcode(bool flag) { enable_udf_bitcode_ = flag; }
+
+    /// Directory of the on-disk compiled object cache, disabled if empty
+    const std::string& object_cache_dir() const { return object_cache_dir_; }
+    void set_object_cache_dir(const std::string& dir) {
+        object_cache_dir_ = dir;
+    }
+
  private:
     bool enable_mcjit_ = false;
     bool enable_vtune_ = false;
     bool enable_gdb_ = false;
     bool enable_perf_ = false;
+    bool enable_shared_session_ = false;
+    std::string object_cache_dir_ = "";
+    int opt_level_ = -1;
+    bool enable_host_cpu_features_ = false;
+    bool enable_udf_bitcode_ = false;
 };
 }  // namespace vm
 }  // namespace hybridse
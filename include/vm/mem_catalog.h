@@ -58,6 +58,7 @@ typedef std::deque<std::pair<uint64_t, Row>> MemTimeTable;
 typedef std::vector<Row> MemTable;
 typedef std::map<std::string, MemTimeTable, std::greater<std::string>>
     MemSegmentMap;
+typedef std::vector<std::pair<std::string, MemTimeTable>> MemSegmentList;
 
 class MemTimeTableIterator : public RowIterator {
  public:
@@ -126,6 +127,28 @@ class MemWindowIterator : public WindowIterator {
     const MemSegmentMap::const_iterator end_iter_;
 };
 
+class HashPartitionHandler;
+class HashWindowIterator : public WindowIterator {
+ public:
+    HashWindowIterator(const HashPartitionHandler* partitions,
+                       const Schema* schema);
+
+    ~HashWindowIterator();
+
+    void Seek(const std::string& key);
+    void SeekToFirst();
+    void Next();
+    bool Valid();
+    std::unique_ptr<RowIterator> GetValue();
+    RowIterator* GetRawValue();
+    const Row GetKey();
+
+ private:
+    const HashPartitionHandler* partitions_;
+    const Schema* schema_;
+    size_t pos_;
+};
+
 class MemRowHandler : public RowHandler {
  public:
     explicit MemRowHandler(const Row row)
@@ -239,6 +262,155 @@ class MemTimeTableHandler : public TableHandler {
     OrderType order_type_;
 };
 
+/**
+ * Monotonic queue which answers min (or max) of a sliding window in
+ * amortized O(1). Values have to leave the window in the order they
+ * entered it.
+ */
+template <typename T>
+class MonotonicQueue {
+ public:
+    explicit MonotonicQueue(bool is_min) : is_min_(is_min) {}
+
+    // push a value newer than all values in window
+    void Push(const T& value) {
+        while (!values_.empty() && Prior(value, values_.back())) {
+            values_.pop_back();
+        }
+        values_.push_back(value);
+    }
+
+    // push a value older than all values in window
+    void PushFront(const T& value) {
+        if (values_.empty() || !Prior(values_.front(), value)) {
+            values_.push_front(value);
+        }
+    }
+
+    // pop the oldest value in window
+    void Pop(const T& value) {
+        if (!values_.empty() && values_.front() == value) {
+            values_.pop_front();
+        }
+    }
+
+    const T Front() const { return values_.empty() ? T(0) : values_.front(); }
+    bool Empty() const { return values_.empty(); }
+    void Clear() { values_.clear(); }
+
+ private:
+    bool Prior(const T& l, const T& r) const {
+        return is_min_ ? l < r : r < l;
+    }
+
+    bool is_min_;
+    std::deque<T> values_;
+};
+
+/**
+ * Values of a column of rows in window, kept in contiguous arrays in the
+ * order rows entered the window, so that aggregations over the window run
+ * on arrays instead of decoding rows one by one. Null values are stored as
+ * zero and flagged in `nulls()`.
+ */
+class WindowColumnBase {
+ public:
+    WindowColumnBase(uint32_t row_idx, uint32_t col_idx, uint32_t offset)
+        : row_idx_(row_idx), col_idx_(col_idx), offset_(offset) {}
+    virtual ~WindowColumnBase() {}
+
+    // push a row newer than all rows in window
+    virtual void PushNewest(const Row& row) = 0;
+    virtual void PopOldest() = 0;
+    virtual void PopNewest() = 0;
+    virtual void Clear() = 0;
+    virtual size_t size() const = 0;
+
+ protected:
+    const uint32_t row_idx_;
+    const uint32_t col_idx_;
+    const uint32_t offset_;
+};
+
+template <typename T>
+class WindowColumn : public WindowColumnBase {
+ public:
+    WindowColumn(uint32_t row_idx, uint32_t col_idx, uint32_t offset)
+        : WindowColumnBase(row_idx, col_idx, offset), head_(0), null_cnt_(0) {}
+
+    void PushNewest(const Row& row) override {
+        const int8_t* buf = row.buf(row_idx_);
+        bool is_null = buf == nullptr || codec::v1::IsNullAt(buf, col_idx_);
+        values_.push_back(
+            is_null ? T(0) : *reinterpret_cast<const T*>(buf + offset_));
+        nulls_.push_back(is_null);
+        null_cnt_ += is_null;
+    }
+
+    void PopOldest() override {
+        if (size() == 0) {
+            return;
+        }
+        null_cnt_ -= nulls_[head_];
+        ++head_;
+        if (head_ == values_.size()) {
+            Clear();
+        } else if (head_ >= kCompactThreshold && head_ * 2 >= values_.size()) {
+            // drop popped values once they take up half of the arrays
+            values_.erase(values_.begin(), values_.begin() + head_);
+            nulls_.erase(nulls_.begin(), nulls_.begin() + head_);
+            head_ = 0;
+        }
+    }
+
+    void PopNewest() override {
+        if (size() == 0) {
+            return;
+        }
+        null_cnt_ -= nulls_.back();
+        values_.pop_back();
+        nulls_.pop_back();
+    }
+
+    void Clear() override {
+        values_.clear();
+        nulls_.clear();
+        head_ = 0;
+        null_cnt_ = 0;
+    }
+
+    size_t size() const override { return values_.size() - head_; }
+    size_t null_cnt() const { return null_cnt_; }
+    // values from the oldest to the newest
+    const T* values() const { return values_.data() + head_; }
+    const uint8_t* nulls() const { return nulls_.data() + head_; }
+
+ private:
+    static const size_t kCompactThreshold = 1024;
+    std::vector<T> values_;
+    std::vector<uint8_t> nulls_;
+    size_t head_;
+    size_t null_cnt_;
+};
+
+class Window;
+
+/// Rows entered into, or popped out of a window if `is_retract` is set,
+/// since its aggregation states were requested last time
+class WindowDeltaList : public ListV<Row> {
+ public:
+    WindowDeltaList(Window* window, bool is_retract)
+        : window_(window), is_retract_(is_retract) {}
+    std::unique_ptr<RowIterator> GetIterator() override {
+        return std::unique_ptr<RowIterator>(GetRawIterator());
+    }
+    RowIterator* GetRawIterator() override;
+
+ private:
+    Window* window_;
+    bool is_retract_;
+};
+
 class Window : public MemTimeTableHandler {
  public:
     enum WindowFrameType {
@@ -249,8 +421,14 @@ class Window : public MemTimeTableHandler {
     Window()
         : MemTimeTableHandler(),
           exclude_current_time_(false),
-          instance_not_in_window_(false) {}
-    virtual ~Window() {}
+          instance_not_in_window_(false),
+          track_delta_(false),
+          delta_valid_(false),
+          delta_consumed_(true),
+          step_(0),
+          delta_added_list_(this, false),
+          delta_popped_list_(this, true) {}
+    virtual ~Window();
 
     std::unique_ptr<RowIterator> GetIterator() override {
         std::unique_ptr<vm::MemTimeTableIterator> it(
@@ -262,7 +440,7 @@ class Window : public MemTimeTableHandler {
         return new vm::MemTimeTableIterator(&table_, schema_);
     }
     virtual bool BufferData(uint64_t key, const Row& row) = 0;
-    virtual void PopBackData() { PopBackRow(); }
+    virtual void PopBackData() { PopBackWindowRow(); }
     virtual void PopFrontData() = 0;
 
     virtual const uint64_t GetCount() { return table_.size(); }
@@ -286,9 +464,162 @@ class Window : public MemTimeTableHandler {
         exclude_current_time_ = flag;
     }
 
+    /**
+     * Get the running state buffer of `size` bytes of an incremental
+     * aggregation identified by `key`. Once any state is requested, the
+     * window starts to record rows entered and popped since states were
+     * requested last time. `is_delta` is set if the state is in sync with
+     * the window at that time, so that only rows from
+     * `GetRawDeltaIterator()` have to be applied; otherwise the state has
+     * to be recomputed from the whole window. A state holding resources is
+     * passed to `release` before it is recomputed, or the window is gone.
+     */
+    int8_t* GetAggState(const void* key, size_t size, bool* is_delta,
+                        void (*release)(int8_t*) = nullptr);
+
+    /**
+     * Get the `idx`-th min/max queue of incremental aggregation identified
+     * by `key`, the queue is cleared if `reset` is set.
+     */
+    template <typename T>
+    MonotonicQueue<T>* GetAggQueue(const void* key, size_t idx, bool is_min,
+                                   bool reset) {
+        auto& queues = GetQueues(&agg_states_[key], static_cast<T*>(nullptr));
+        if (queues.size() <= idx) {
+            queues.resize(idx + 1);
+        }
+        if (!queues[idx]) {
+            queues[idx].reset(new MonotonicQueue<T>(is_min));
+        } else if (reset) {
+            queues[idx]->Clear();
+        }
+        return queues[idx].get();
+    }
+
+    /**
+     * Iterate rows entered into the window, or rows popped out of the
+     * window if `is_retract` is set, since states were requested last time.
+     */
+    RowIterator* GetRawDeltaIterator(bool is_retract) {
+        return new vm::MemTimeTableIterator(
+            is_retract ? &delta_popped_ : &delta_added_, schema_);
+    }
+
+    /// Rows of `GetRawDeltaIterator()` as a list
+    ListV<Row>* GetDeltaList(bool is_retract) {
+        return is_retract ? &delta_popped_list_ : &delta_added_list_;
+    }
+
+    /**
+     * Get the columnar copy of a column of type `T` in window. Once
+     * requested, the column is kept in sync with rows entering and leaving
+     * the window, and it is rebuilt from the window if they mismatch.
+     */
+    template <typename T>
+    WindowColumn<T>* GetColumn(uint32_t row_idx, uint32_t col_idx,
+                               uint32_t offset) {
+        auto& column = columns_[std::make_pair(row_idx, col_idx)];
+        auto typed = dynamic_cast<WindowColumn<T>*>(column.get());
+        if (typed == nullptr) {
+            typed = new WindowColumn<T>(row_idx, col_idx, offset);
+            column.reset(typed);
+        }
+        if (typed->size() != table_.size()) {
+            typed->Clear();
+            for (auto iter = table_.rbegin(); iter != table_.rend(); ++iter) {
+                typed->PushNewest(iter->second);
+            }
+        }
+        return typed;
+    }
+
  protected:
+    // start recording rows changed by a new `BufferData()`, rows are
+    // accumulated until states consume them
+    void BeginDelta() {
+        if (!delta_consumed_) {
+            return;
+        }
+        step_ += 1;
+        delta_added_.clear();
+        delta_popped_.clear();
+        delta_valid_ = track_delta_;
+        delta_consumed_ = false;
+    }
+
+    // rows changed other than entering front or popping back can not be
+    // applied incrementally, all states have to be recomputed
+    void InvalidateDelta() {
+        delta_valid_ = false;
+        step_ += 1;
+    }
+
+    // rows entered are recorded in the order they entered
+    void AddFrontWindowRow(uint64_t key, const Row& row) {
+        AddFrontRow(key, row);
+        if (track_delta_) {
+            delta_added_.emplace_back(key, row);
+        }
+        for (auto& column : columns_) {
+            column.second->PushNewest(row);
+        }
+    }
+
+    void PopBackWindowRow() {
+        if (track_delta_) {
+            if (table_.size() <= delta_added_.size()) {
+                // row entered in the same step, never seen by states
+                delta_added_.pop_front();
+            } else {
+                delta_popped_.push_back(table_.back());
+            }
+        }
+        PopBackRow();
+        for (auto& column : columns_) {
+            column.second->PopOldest();
+        }
+    }
+
+    // newest row popped can not be applied incrementally
+    void PopFrontWindowRow() {
+        InvalidateDelta();
+        PopFrontRow();
+        for (auto& column : columns_) {
+            column.second->PopNewest();
+        }
+    }
+
+    struct AggState {
+        uint64_t step;
+        void (*release)(int8_t*) = nullptr;
+        std::vector<int8_t> buf;
+        std::vector<std::unique_ptr<MonotonicQueue<int64_t>>> int_queues;
+        std::vector<std::unique_ptr<MonotonicQueue<double>>> real_queues;
+    };
+
+    static std::vector<std::unique_ptr<MonotonicQueue<int64_t>>>& GetQueues(
+        AggState* state, int64_t*) {
+        return state->int_queues;
+    }
+    static std::vector<std::unique_ptr<MonotonicQueue<double>>>& GetQueues(
+        AggState* state, double*) {
+        return state->real_queues;
+    }
+
     bool exclude_current_time_;
     bool instance_not_in_window_;
+
+    bool track_delta_;
+    bool delta_valid_;
+    bool delta_consumed_;
+    uint64_t step_;
+    MemTimeTable delta_added_;
+    MemTimeTable delta_popped_;
+    WindowDeltaList delta_added_list_;
+    WindowDeltaList delta_popped_list_;
+    std::map<const void*, AggState> agg_states_;
+    std::map<std::pair<uint32_t, uint32_t>, std::unique_ptr<WindowColumnBase>>
+        columns_;
 };
 class WindowRange {
  public:
@@ -370,14 +701,14 @@ class HistoryWindow : public Window {
     ~HistoryWindow() {}
     virtual void PopFrontData() {
         if (current_history_buffer_.empty()) {
-            PopFrontRow();
+            PopFrontWindowRow();
         } else {
             current_history_buffer_.pop_front();
         }
     }
     virtual void PopEffectiveData() {
         if (!table_.empty()) {
-            PopFrontRow();
+            PopFrontWindowRow();
         }
     }
     bool BufferData(uint64_t key, const Row& row) {
@@ -385,6 +716,7 @@ class HistoryWindow : public Window {
             DLOG(WARNING) << "Fail BufferData: buffer key less than latest key";
             return false;
         }
+        BeginDelta();
         auto cur_size = table_.size();
         if (cur_size < window_range_.start_row_) {
             // current row InWindow
@@ -427,11 +759,11 @@ class HistoryWindow : public Window {
 
     bool BufferEffectiveWindow(uint64_t key, const Row& row,
                                uint64_t start_ts) {
-        AddFrontRow(key, row);
+        AddFrontWindowRow(key, row);
         auto cur_size = table_.size();
         while (window_range_.max_size_ > 0 &&
                cur_size > window_range_.max_size_) {
-            PopBackRow();
+            PopBackWindowRow();
             --cur_size;
         }
 
@@ -445,7 +777,7 @@ class HistoryWindow : public Window {
             }
             if (kFrameRows == window_range_.frame_type_ ||
                 pair.first < start_ts) {
-                PopBackRow();
+                PopBackWindowRow();
                 --cur_size;
 
             } else {
@@ -489,12 +821,13 @@ class CurrentHistoryWindow : public HistoryWindow {
                                     max_size)) {}
     ~CurrentHistoryWindow() {}
 
-    virtual void PopFrontData() { PopFrontRow(); }
+    virtual void PopFrontData() { PopFrontWindowRow(); }
     bool BufferData(uint64_t key, const Row& row) {
         if (!table_.empty() && GetFrontRow().first > key) {
             DLOG(WARNING) << "Fail BufferData: buffer key less than latest key";
             return false;
         }
+        BeginDelta();
         int64_t sub = (key + window_range_.start_offset_);
         uint64_t start_ts = sub < 0 ? 0u : static_cast<uint64_t>(sub);
 
@@ -633,6 +966,63 @@ class MemPartitionHandler
     IndexHint index_hint_;
     OrderType order_type_;
 };
+
+/**
+ * Partition handler which locates segments by an open addressing hash table
+ * instead of an ordered map. Segments are iterated in the order their keys
+ * are first added, rather than sorted by key.
+ */
+class HashPartitionHandler
+    : public PartitionHandler,
+      public std::enable_shared_from_this<PartitionHandler> {
+ public:
+    explicit HashPartitionHandler(const Schema* schema);
+    ~HashPartitionHandler();
+    const Types& GetTypes() override { return types_; }
+    const IndexHint& GetIndex() override { return index_hint_; }
+    const Schema* GetSchema() override { return schema_; }
+    const std::string& GetName() override { return table_name_; }
+    const std::string& GetDatabase() override { return db_; }
+    virtual std::unique_ptr<WindowIterator> GetWindowIterator();
+    bool AddRow(const std::string& key, uint64_t ts, const Row& row);
+    void Sort(const bool is_asc);
+    void Reverse();
+    virtual const uint64_t GetCount() { return segments_.size(); }
+    virtual std::shared_ptr<TableHandler> GetSegment(const std::string& key) {
+        return std::shared_ptr<MemSegmentHandler>(
+            new MemSegmentHandler(shared_from_this(), key));
+    }
+    void SetOrderType(const OrderType order_type) { order_type_ = order_type; }
+    const OrderType GetOrderType() const { return order_type_; }
+    const std::string GetHandlerTypeName() override {
+        return "HashPartitionHandler";
+    }
+
+    /**
+     * Return position of segment with `key` in `GetSegmentList()`, or
+     * `GetCount()` if key not exist.
+     */
+    size_t Find(const std::string& key) const;
+    const MemSegmentList& GetSegmentList() const { return segments_; }
+
+ private:
+    uint64_t Hash(const std::string& key) const;
+    size_t Probe(const std::string& key, uint64_t hash) const;
+    void Rehash(size_t capacity);
+
+    std::string table_name_;
+    std::string db_;
+    const Schema* schema_;
+    MemSegmentList segments_;
+    // hash of each segment key, aligned with `segments_`
+    std::vector<uint64_t> hashes_;
+    // segment position of each slot, empty slot is marked by `UINT64_MAX`
+    std::vector<uint64_t> slots_;
+    Types types_;
+    IndexHint index_hint_;
+    OrderType order_type_;
+};
+
 class ConcatTableHandler : public MemTimeTableHandler {
  public:
     ConcatTableHandler(std::shared_ptr<TableHandler> left, size_t left_slices,
@@ -763,6 +1153,12 @@ class RequestUnionTableHandler : public TableHandler {
     std::shared_ptr<TableHandler> window_;
 };
 
+/// Switch ref counts of the rows reachable from `input` to atomic
+/// operations, so that they can be shared with worker threads. Unmanaged
+/// rows, e.g. rows of the storage, are left as they are. No other thread may
+/// reference the rows meanwhile.
+void MakeRowsRefCountAtomic(const std::shared_ptr<DataHandler>& input);
+
 // row iter interfaces for llvm
 void GetRowIter(int8_t* input, int8_t* iter);
 bool RowIterHasNext(int8_t* iter);
@@ -770,8 +1166,38 @@ void RowIterNext(int8_t* iter);
 int8_t* RowIterGetCurSlice(int8_t* iter, size_t idx);
 size_t RowIterGetCurSliceSize(int8_t* iter, size_t idx);
 void RowIterDelete(int8_t* iter);
+int8_t* GetWindowAggState(int8_t* input, int8_t* key, int32_t size,
+                          bool* is_delta, void (*release)(int8_t*));
+void GetWindowDeltaIter(int8_t* input, bool is_retract, int8_t* iter);
+void GetWindowDeltaList(int8_t* input, bool is_retract, int8_t* output);
+int8_t* GetWindowAggIntQueue(int8_t* input, int8_t* key, int32_t idx,
+                             bool is_min, bool reset);
+int8_t* GetWindowAggRealQueue(int8_t* input, int8_t* key, int32_t idx,
+                              bool is_min, bool reset);
+void WindowAggIntQueuePush(int8_t* queue, int64_t value);
+void WindowAggIntQueuePushFront(int8_t* queue, int64_t value);
+void WindowAggIntQueuePop(int8_t* queue, int64_t value);
+int64_t WindowAggIntQueueFront(int8_t* queue);
+void WindowAggRealQueuePush(int8_t* queue, double value);
+void WindowAggRealQueuePushFront(int8_t* queue, double value);
+void WindowAggRealQueuePop(int8_t* queue, double value);
+double WindowAggRealQueueFront(int8_t* queue);
 int8_t* RowGetSlice(int8_t* row_ptr, size_t idx);
 size_t RowGetSliceSize(int8_t* row_ptr, size_t idx);
+
+// Aggregate a column list over window columns and accumulate results into
+// states of sum/count/min/max/avg udaf. Return 0 if states are updated, or
+// -1 if the list is not a column of window and has to be iterated instead.
+template <typename T>
+int32_t WindowColumnSum(int8_t* input, T* sum);
+template <typename T>
+int32_t WindowColumnCount(int8_t* input, int64_t* cnt);
+template <typename T>
+int32_t WindowColumnMin(int8_t* input, bool* is_empty, T* min);
+template <typename T>
+int32_t WindowColumnMax(int8_t* input, bool* is_empty, T* max);
+template <typename T>
+int32_t WindowColumnAvg(int8_t* input, int64_t* cnt, double* sum);
 }  // namespace vm
 }  // namespace hybridse
 #endif  // INCLUDE_VM_MEM_CATALOG_H_
@@ -141,6 +141,7 @@ class FnInfo {
         frames_.clear();
         schemas_ctx_ = nullptr;
         fn_ptr_ = nullptr;
+        batch_fn_ptr_ = nullptr;
     }
 
     const node::FrameNode *GetFrame(size_t idx) const {
@@ -156,6 +157,24 @@ class FnInfo {
     const int8_t *fn_ptr() const { return fn_ptr_; }
     void SetFnPtr(const int8_t *fn) { fn_ptr_ = fn; }
 
+    /// Return true if the function never touches a window, then a table
+    /// project generates a batch entry `batch_fn_name()` which projects an
+    /// array of rows in a single native call.
+    bool SupportBatchProject() const {
+        if (primary_frame_ != nullptr) {
+            return false;
+        }
+        for (auto frame : frames_) {
+            if (frame != nullptr) {
+                return false;
+            }
+        }
+        return true;
+    }
+    const std::string batch_fn_name() const { return fn_name_ + "_batch"; }
+    const int8_t *batch_fn_ptr() const { return batch_fn_ptr_; }
+    void SetBatchFnPtr(const int8_t *fn) { batch_fn_ptr_ = fn; }
+
  private:
     std::string fn_name_ = "";
     vm::Schema fn_schema_;
@@ -172,6 +191,9 @@ class FnInfo {
 
     // function ptr
     const int8_t *fn_ptr_ = nullptr;
+
+    // batch function ptr, null if batch entry is not supported
+    const int8_t *batch_fn_ptr_ = nullptr;
 };
 
 class FnComponent {
@@ -711,6 +733,14 @@ class PhysicalProjectNode : public PhysicalUnaryNode {
     ColumnProjects project_;
 };
 
+/// Return true if `node` projects a whole table row by row, only such
+/// nodes get the batch entry of their row function.
+inline bool IsTableProjectNode(const PhysicalOpNode *node) {
+    return node != nullptr && kPhysicalOpProject == node->GetOpType() &&
+           kTableProject ==
+               dynamic_cast<const PhysicalProjectNode *>(node)->project_type_;
+}
+
 class PhysicalRowProjectNode : public PhysicalProjectNode {
  public:
     PhysicalRowProjectNode(PhysicalOpNode *node, const ColumnProjects &project)
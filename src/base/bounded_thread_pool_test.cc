@@ -0,0 +1,71 @@
+/*
+ * Copyright 2021 4Paradigm
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/bounded_thread_pool.h"
+#include <atomic>
+#include <future>  // NOLINT
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace base {
+
+class BoundedThreadPoolTest : public ::testing::Test {
+ public:
+    BoundedThreadPoolTest() {}
+    ~BoundedThreadPoolTest() {}
+};
+
+TEST_F(BoundedThreadPoolTest, RunAllTasks) {
+    std::atomic<int> cnt(0);
+    {
+        BoundedThreadPool pool(4, 1000);
+        for (int i = 0; i < 1000; ++i) {
+            ASSERT_TRUE(pool.Submit([&cnt]() { cnt.fetch_add(1); }));
+        }
+    }
+    ASSERT_EQ(1000, cnt.load());
+}
+
+TEST_F(BoundedThreadPoolTest, RejectWhenFull) {
+    std::promise<void> block;
+    std::shared_future<void> blocked = block.get_future().share();
+    std::promise<void> started;
+    std::atomic<int> cnt(0);
+    BoundedThreadPool pool(1, 2);
+    ASSERT_TRUE(pool.Submit([&]() {
+        started.set_value();
+        blocked.wait();
+        cnt.fetch_add(1);
+    }));
+    // the only worker is busy, queue holds at most two tasks
+    started.get_future().wait();
+    ASSERT_TRUE(pool.Submit([&cnt]() { cnt.fetch_add(1); }));
+    ASSERT_TRUE(pool.Submit([&cnt]() { cnt.fetch_add(1); }));
+    ASSERT_FALSE(pool.Submit([&cnt]() { cnt.fetch_add(1); }));
+    ASSERT_EQ(2u, pool.pending_num());
+    block.set_value();
+    while (cnt.load() < 3) {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(0u, pool.pending_num());
+}
+
+}  // namespace base
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
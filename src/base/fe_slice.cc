@@ -15,17 +15,54 @@
  */
 
 #include "base/fe_slice.h"
+#include "base/slab_allocator.h"
 
 namespace hybridse {
 namespace base {
 
+static thread_local bool atomic_ref_count = false;
+
+AtomicRefCountScope::AtomicRefCountScope(bool flag)
+    : prev_(atomic_ref_count) {
+    atomic_ref_count = flag;
+}
+
+AtomicRefCountScope::~AtomicRefCountScope() { atomic_ref_count = prev_; }
+
+bool RefCountedSlice::IsAtomicRefCount() { return atomic_ref_count; }
+
+void RefCountedSlice::MakeRefCountAtomic() {
+    if (this->ref_cnt_ == nullptr || this->ref_cnt_->atomic) {
+        return;
+    }
+    this->ref_cnt_->atomic = true;
+    if (this->ref_cnt_->slab != nullptr) {
+        this->ref_cnt_->slab->MakeRefCountAtomic();
+    }
+}
+
+int8_t* RefCountedSlice::AllocInline(size_t size) {
+    auto cell = reinterpret_cast<char*>(malloc(sizeof(SliceRefCount) + size));
+    if (cell == nullptr) {
+        return nullptr;
+    }
+    auto ref_cnt = reinterpret_cast<SliceRefCount*>(cell);
+    ref_cnt->cnt = 0;
+    ref_cnt->atomic = false;
+    ref_cnt->inlined = true;
+    ref_cnt->slab = nullptr;
+    return reinterpret_cast<int8_t*>(cell + sizeof(SliceRefCount));
+}
+
 RefCountedSlice::~RefCountedSlice() { Release(); }
 
 void RefCountedSlice::Release() {
-    if (this->ref_cnt_ != nullptr) {
-        auto& cnt = *this->ref_cnt_;
-        cnt -= 1;
-        if (cnt == 0) {
+    if (this->ref_cnt_ != nullptr && this->ref_cnt_->Unref()) {
+        if (this->ref_cnt_->slab != nullptr) {
+            this->ref_cnt_->slab->Unref();
+        } else if (this->ref_cnt_->inlined) {
+            free(this->ref_cnt_);
+        } else {
             free(buf());
             delete this->ref_cnt_;
         }
@@ -36,7 +73,7 @@ void RefCountedSlice::Update(const RefCountedSlice& slice) {
     reset(slice.data(), slice.size());
     this->ref_cnt_ = slice.ref_cnt_;
     if (this->ref_cnt_ != nullptr) {
-        (*this->ref_cnt_) += 1;
+        this->ref_cnt_->Ref();
     }
 }
 
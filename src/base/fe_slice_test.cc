@@ -15,6 +15,9 @@
  */
 
 #include "base/fe_slice.h"
+#include <thread>  // NOLINT
+#include <vector>
+#include "base/slab_allocator.h"
 #include "gtest/gtest.h"
 
 namespace hybridse {
@@ -46,6 +49,121 @@ TEST_F(SliceTest, ref_cnt_slice) {
     ASSERT_EQ(0, strcmp(reinterpret_cast<char*>(ref.buf()), "hello world"));
 }
 
+TEST_F(SliceTest, slab_ref_cnt_slice) {
+    std::vector<RefCountedSlice> slices;
+    {
+        SlabAllocator allocator(4096);
+        for (int i = 0; i < 100; i++) {
+            // large buffer takes a slab of its own
+            size_t size = i % 10 == 0 ? 1024 : 32;
+            auto buf = allocator.Alloc(size);
+            snprintf(reinterpret_cast<char*>(buf), size, "hello %d", i);
+            slices.push_back(SlabAllocator::CreateSlice(buf, size));
+        }
+    }
+    // slices outlive allocator
+    RefCountedSlice ref = slices[42];
+    slices.clear();
+    ASSERT_EQ(0, strcmp(reinterpret_cast<char*>(ref.buf()), "hello 42"));
+    ASSERT_EQ(32u, ref.size());
+}
+
+TEST_F(SliceTest, slab_odd_large_slice) {
+    std::vector<RefCountedSlice> slices;
+    {
+        SlabAllocator allocator(4096);
+        // sizes of large buffers are not multiples of the alignment
+        for (size_t size : {1021, 1023, 4095, 4097}) {
+            auto buf = allocator.Alloc(size);
+            ASSERT_TRUE(buf != nullptr);
+            memset(buf, 'x', size);
+            slices.push_back(SlabAllocator::CreateSlice(buf, size));
+        }
+    }
+    ASSERT_EQ(1021u, slices[0].size());
+    ASSERT_EQ('x', slices[3].data()[4096]);
+}
+
+TEST_F(SliceTest, inline_ref_cnt_slice) {
+    RefCountedSlice ref;
+    {
+        auto buf = RefCountedSlice::AllocInline(1024);
+        strcpy(reinterpret_cast<char*>(buf), "hello world");  // NOLINT
+        auto slice = RefCountedSlice::CreateManagedInline(buf, 1024);
+        ref = slice;
+    }
+    ASSERT_EQ(0, strcmp(reinterpret_cast<char*>(ref.buf()), "hello world"));
+}
+
+TEST_F(SliceTest, atomic_ref_cnt_slice) {
+    std::vector<RefCountedSlice> slices;
+    {
+        AtomicRefCountScope atomic_scope;
+        SlabAllocator allocator(4096);
+        for (int i = 0; i < 100; i++) {
+            auto buf = allocator.Alloc(32);
+            snprintf(reinterpret_cast<char*>(buf), 32, "hello %d", i);
+            slices.push_back(SlabAllocator::CreateSlice(buf, 32));
+        }
+        auto buf = RefCountedSlice::AllocInline(32);
+        snprintf(reinterpret_cast<char*>(buf), 32, "hello inline");
+        slices.push_back(RefCountedSlice::CreateManagedInline(buf, 32));
+    }
+    ASSERT_FALSE(RefCountedSlice::IsAtomicRefCount());
+
+    // copy and release slices sharing ref counts and slabs on threads
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&slices]() {
+            for (int round = 0; round < 100; round++) {
+                std::vector<RefCountedSlice> copies(slices);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    RefCountedSlice ref = slices[42];
+    slices.clear();
+    ASSERT_EQ(0, strcmp(reinterpret_cast<char*>(ref.buf()), "hello 42"));
+}
+
+TEST_F(SliceTest, make_ref_cnt_atomic_slice) {
+    std::vector<RefCountedSlice> slices;
+    {
+        SlabAllocator allocator(4096);
+        for (int i = 0; i < 100; i++) {
+            auto buf = allocator.Alloc(32);
+            snprintf(reinterpret_cast<char*>(buf), 32, "hello %d", i);
+            slices.push_back(SlabAllocator::CreateSlice(buf, 32));
+        }
+    }
+    // atomic scope only applies to the thread it is created on
+    AtomicRefCountScope atomic_scope;
+    std::thread([]() {
+        ASSERT_FALSE(RefCountedSlice::IsAtomicRefCount());
+    }).join();
+    ASSERT_TRUE(RefCountedSlice::IsAtomicRefCount());
+
+    for (auto& slice : slices) {
+        slice.MakeRefCountAtomic();
+    }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&slices]() {
+            for (int round = 0; round < 100; round++) {
+                std::vector<RefCountedSlice> copies(slices);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    RefCountedSlice ref = slices[42];
+    slices.clear();
+    ASSERT_EQ(0, strcmp(reinterpret_cast<char*>(ref.buf()), "hello 42"));
+}
+
 }  // namespace base
 }  // namespace hybridse
 
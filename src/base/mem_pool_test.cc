@@ -51,6 +51,44 @@ TEST_F(MemPoolTest, ByteMemoryPoolTest) {
         ASSERT_EQ("helloworldhybri", std::string(s3, 15));
     }
 }
+
+TEST_F(MemPoolTest, ByteMemoryPoolRewindTest) {
+    ByteMemoryPool mem_pool;
+    ASSERT_EQ(1u, mem_pool.stats().chunks);
+    // three chunks in the first step
+    for (int i = 0; i < 3; i++) {
+        mem_pool.Alloc(MemoryChunk::DEFAULT_CHUCK_SIZE);
+    }
+    ASSERT_EQ(3u, mem_pool.stats().chunks);
+    mem_pool.Rewind(2);
+    ASSERT_EQ(3u, mem_pool.stats().chunks);
+
+    // retained chunks are reused
+    for (int i = 0; i < 3; i++) {
+        char* s1 = mem_pool.Alloc(MemoryChunk::DEFAULT_CHUCK_SIZE);
+        memcpy(s1, "helloworld", 10);
+        ASSERT_EQ("helloworld", std::string(s1, 10));
+    }
+    ASSERT_EQ(3u, mem_pool.stats().chunks);
+    ASSERT_EQ(6u * MemoryChunk::DEFAULT_CHUCK_SIZE,
+              mem_pool.stats().allocated_bytes);
+    mem_pool.Rewind(2);
+
+    // shrink after two idle steps which use one chunk only
+    mem_pool.Alloc(10);
+    mem_pool.Rewind(2);
+    ASSERT_EQ(3u, mem_pool.stats().chunks);
+    ASSERT_EQ(0u, mem_pool.stats().shrinks);
+    mem_pool.Alloc(10);
+    mem_pool.Rewind(2);
+    ASSERT_EQ(1u, mem_pool.stats().shrinks);
+    ASSERT_EQ(1u, mem_pool.stats().chunks);
+    ASSERT_EQ(4u, mem_pool.stats().resets);
+
+    mem_pool.Reset();
+    ASSERT_EQ(0u, mem_pool.stats().chunks);
+    ASSERT_EQ(0u, mem_pool.stats().chunk_bytes);
+}
 }  // namespace base
 }  // namespace hybridse
 
@@ -0,0 +1,442 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/simd_agg.h"
+#include <string.h>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace hybridse {
+namespace base {
+
+namespace {
+
+// scalar folds, also used to fold vector lanes and the tail of input
+struct SumFold {
+    static const bool kFromZero = true;
+    template <typename R, typename T>
+    static R Apply(R cur, T v) {
+        // wrap around on overflow instead of undefined behaviour
+        using U = typename std::make_unsigned<R>::type;
+        return static_cast<R>(static_cast<U>(cur) +
+                              static_cast<U>(static_cast<R>(v)));
+    }
+};
+
+struct MinFold {
+    static const bool kFromZero = false;
+    template <typename R, typename T>
+    static R Apply(R cur, T v) {
+        return v < cur ? v : cur;
+    }
+};
+
+struct MaxFold {
+    static const bool kFromZero = false;
+    template <typename R, typename T>
+    static R Apply(R cur, T v) {
+        return v > cur ? v : cur;
+    }
+};
+
+template <typename Fold, typename T, typename R>
+inline R ScalarFold(const T* values, size_t n, R init) {
+    R cur = init;
+    for (size_t i = 0; i < n; ++i) {
+        cur = Fold::template Apply<R, T>(cur, values[i]);
+    }
+    return cur;
+}
+
+#if defined(__x86_64__)
+
+#define HYBRIDSE_AVX2_INLINE \
+    __attribute__((always_inline, target("avx2"))) static inline
+#define HYBRIDSE_SSE42_INLINE \
+    __attribute__((always_inline, target("sse4.2"))) static inline
+
+// Vector traits: `T` is the input type, `R` the lane type, a step consumes
+// `kLanes` input values.
+template <typename T>
+struct Avx2;
+
+template <>
+struct Avx2<int16_t> {
+    typedef int16_t T;
+    typedef int16_t R;
+    typedef __m256i V;
+    static const size_t kLanes = 16;
+    HYBRIDSE_AVX2_INLINE V Load(const T* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    HYBRIDSE_AVX2_INLINE V Set1(R v) { return _mm256_set1_epi16(v); }
+    HYBRIDSE_AVX2_INLINE V Add(V x, V acc) { return _mm256_add_epi16(x, acc); }
+    HYBRIDSE_AVX2_INLINE V Min(V x, V acc) { return _mm256_min_epi16(x, acc); }
+    HYBRIDSE_AVX2_INLINE V Max(V x, V acc) { return _mm256_max_epi16(x, acc); }
+};
+
+template <>
+struct Avx2<int32_t> {
+    typedef int32_t T;
+    typedef int32_t R;
+    typedef __m256i V;
+    static const size_t kLanes = 8;
+    HYBRIDSE_AVX2_INLINE V Load(const T* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    HYBRIDSE_AVX2_INLINE V Set1(R v) { return _mm256_set1_epi32(v); }
+    HYBRIDSE_AVX2_INLINE V Add(V x, V acc) { return _mm256_add_epi32(x, acc); }
+    HYBRIDSE_AVX2_INLINE V Min(V x, V acc) { return _mm256_min_epi32(x, acc); }
+    HYBRIDSE_AVX2_INLINE V Max(V x, V acc) { return _mm256_max_epi32(x, acc); }
+};
+
+template <>
+struct Avx2<int64_t> {
+    typedef int64_t T;
+    typedef int64_t R;
+    typedef __m256i V;
+    static const size_t kLanes = 4;
+    HYBRIDSE_AVX2_INLINE V Load(const T* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    HYBRIDSE_AVX2_INLINE V Set1(R v) { return _mm256_set1_epi64x(v); }
+    HYBRIDSE_AVX2_INLINE V Add(V x, V acc) { return _mm256_add_epi64(x, acc); }
+    HYBRIDSE_AVX2_INLINE V Min(V x, V acc) {
+        return _mm256_blendv_epi8(acc, x, _mm256_cmpgt_epi64(acc, x));
+    }
+    HYBRIDSE_AVX2_INLINE V Max(V x, V acc) {
+        return _mm256_blendv_epi8(acc, x, _mm256_cmpgt_epi64(x, acc));
+    }
+};
+
+template <>
+struct Avx2<float> {
+    typedef float T;
+    typedef float R;
+    typedef __m256 V;
+    static const size_t kLanes = 8;
+    HYBRIDSE_AVX2_INLINE V Load(const T* p) { return _mm256_loadu_ps(p); }
+    HYBRIDSE_AVX2_INLINE V Set1(R v) { return _mm256_set1_ps(v); }
+    // min_ps(x, acc) is `x < acc ? x : acc`, the same as MinFold
+    HYBRIDSE_AVX2_INLINE V Min(V x, V acc) { return _mm256_min_ps(x, acc); }
+    HYBRIDSE_AVX2_INLINE V Max(V x, V acc) { return _mm256_max_ps(x, acc); }
+};
+
+template <>
+struct Avx2<double> {
+    typedef double T;
+    typedef double R;
+    typedef __m256d V;
+    static const size_t kLanes = 4;
+    HYBRIDSE_AVX2_INLINE V Load(const T* p) { return _mm256_loadu_pd(p); }
+    HYBRIDSE_AVX2_INLINE V Set1(R v) { return _mm256_set1_pd(v); }
+    HYBRIDSE_AVX2_INLINE V Min(V x, V acc) { return _mm256_min_pd(x, acc); }
+    HYBRIDSE_AVX2_INLINE V Max(V x, V acc) { return _mm256_max_pd(x, acc); }
+};
+
+template <typename T>
+struct Avx2Wide;
+
+template <>
+struct Avx2Wide<int16_t> {
+    typedef int16_t T;
+    typedef int64_t R;
+    typedef __m256i V;
+    static const size_t kLanes = 4;
+    HYBRIDSE_AVX2_INLINE V Load(const T* p) {
+        return _mm256_cvtepi16_epi64(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+    }
+    HYBRIDSE_AVX2_INLINE V Set1(R v) { return _mm256_set1_epi64x(v); }
+    HYBRIDSE_AVX2_INLINE V Add(V x, V acc) { return _mm256_add_epi64(x, acc); }
+};
+
+template <>
+struct Avx2Wide<int32_t> {
+    typedef int32_t T;
+    typedef int64_t R;
+    typedef __m256i V;
+    static const size_t kLanes = 4;
+    HYBRIDSE_AVX2_INLINE V Load(const T* p) {
+        return _mm256_cvtepi32_epi64(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+    HYBRIDSE_AVX2_INLINE V Set1(R v) { return _mm256_set1_epi64x(v); }
+    HYBRIDSE_AVX2_INLINE V Add(V x, V acc) { return _mm256_add_epi64(x, acc); }
+};
+
+template <typename T>
+struct Sse42;
+
+template <>
+struct Sse42<int16_t> {
+    typedef int16_t T;
+    typedef int16_t R;
+    typedef __m128i V;
+    static const size_t kLanes = 8;
+    HYBRIDSE_SSE42_INLINE V Load(const T* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    HYBRIDSE_SSE42_INLINE V Set1(R v) { return _mm_set1_epi16(v); }
+    HYBRIDSE_SSE42_INLINE V Add(V x, V acc) { return _mm_add_epi16(x, acc); }
+    HYBRIDSE_SSE42_INLINE V Min(V x, V acc) { return _mm_min_epi16(x, acc); }
+    HYBRIDSE_SSE42_INLINE V Max(V x, V acc) { return _mm_max_epi16(x, acc); }
+};
+
+template <>
+struct Sse42<int32_t> {
+    typedef int32_t T;
+    typedef int32_t R;
+    typedef __m128i V;
+    static const size_t kLanes = 4;
+    HYBRIDSE_SSE42_INLINE V Load(const T* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    HYBRIDSE_SSE42_INLINE V Set1(R v) { return _mm_set1_epi32(v); }
+    HYBRIDSE_SSE42_INLINE V Add(V x, V acc) { return _mm_add_epi32(x, acc); }
+    HYBRIDSE_SSE42_INLINE V Min(V x, V acc) { return _mm_min_epi32(x, acc); }
+    HYBRIDSE_SSE42_INLINE V Max(V x, V acc) { return _mm_max_epi32(x, acc); }
+};
+
+template <>
+struct Sse42<int64_t> {
+    typedef int64_t T;
+    typedef int64_t R;
+    typedef __m128i V;
+    static const size_t kLanes = 2;
+    HYBRIDSE_SSE42_INLINE V Load(const T* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    HYBRIDSE_SSE42_INLINE V Set1(R v) { return _mm_set1_epi64x(v); }
+    HYBRIDSE_SSE42_INLINE V Add(V x, V acc) { return _mm_add_epi64(x, acc); }
+    HYBRIDSE_SSE42_INLINE V Min(V x, V acc) {
+        return _mm_blendv_epi8(acc, x, _mm_cmpgt_epi64(acc, x));
+    }
+    HYBRIDSE_SSE42_INLINE V Max(V x, V acc) {
+        return _mm_blendv_epi8(acc, x, _mm_cmpgt_epi64(x, acc));
+    }
+};
+
+template <>
+struct Sse42<float> {
+    typedef float T;
+    typedef float R;
+    typedef __m128 V;
+    static const size_t kLanes = 4;
+    HYBRIDSE_SSE42_INLINE V Load(const T* p) { return _mm_loadu_ps(p); }
+    HYBRIDSE_SSE42_INLINE V Set1(R v) { return _mm_set1_ps(v); }
+    HYBRIDSE_SSE42_INLINE V Min(V x, V acc) { return _mm_min_ps(x, acc); }
+    HYBRIDSE_SSE42_INLINE V Max(V x, V acc) { return _mm_max_ps(x, acc); }
+};
+
+template <>
+struct Sse42<double> {
+    typedef double T;
+    typedef double R;
+    typedef __m128d V;
+    static const size_t kLanes = 2;
+    HYBRIDSE_SSE42_INLINE V Load(const T* p) { return _mm_loadu_pd(p); }
+    HYBRIDSE_SSE42_INLINE V Set1(R v) { return _mm_set1_pd(v); }
+    HYBRIDSE_SSE42_INLINE V Min(V x, V acc) { return _mm_min_pd(x, acc); }
+    HYBRIDSE_SSE42_INLINE V Max(V x, V acc) { return _mm_max_pd(x, acc); }
+};
+
+template <typename T>
+struct Sse42Wide;
+
+template <>
+struct Sse42Wide<int16_t> {
+    typedef int16_t T;
+    typedef int64_t R;
+    typedef __m128i V;
+    static const size_t kLanes = 2;
+    HYBRIDSE_SSE42_INLINE V Load(const T* p) {
+        int32_t pair;
+        memcpy(&pair, p, sizeof(pair));
+        return _mm_cvtepi16_epi64(_mm_cvtsi32_si128(pair));
+    }
+    HYBRIDSE_SSE42_INLINE V Set1(R v) { return _mm_set1_epi64x(v); }
+    HYBRIDSE_SSE42_INLINE V Add(V x, V acc) { return _mm_add_epi64(x, acc); }
+};
+
+template <>
+struct Sse42Wide<int32_t> {
+    typedef int32_t T;
+    typedef int64_t R;
+    typedef __m128i V;
+    static const size_t kLanes = 2;
+    HYBRIDSE_SSE42_INLINE V Load(const T* p) {
+        return _mm_cvtepi32_epi64(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+    }
+    HYBRIDSE_SSE42_INLINE V Set1(R v) { return _mm_set1_epi64x(v); }
+    HYBRIDSE_SSE42_INLINE V Add(V x, V acc) { return _mm_add_epi64(x, acc); }
+};
+
+// Fold `kLanes` values a step into vector lanes, then fold the lanes and the
+// tail of input with scalar code. Each lane of min/max starts from `init`
+// so folding lanes once more from `init` gives the same result.
+#define HYBRIDSE_DEFINE_SIMD_KERNEL(NAME, TARGET)                            \
+    template <typename Vec,                                                  \
+              typename Vec::V (*Step)(typename Vec::V, typename Vec::V),     \
+              typename Fold>                                                 \
+    __attribute__((target(TARGET))) typename Vec::R NAME(                    \
+        const typename Vec::T* values, size_t n, typename Vec::R init) {     \
+        typedef typename Vec::R R;                                           \
+        typename Vec::V acc = Vec::Set1(Fold::kFromZero ? R(0) : init);      \
+        size_t i = 0;                                                        \
+        for (; i + Vec::kLanes <= n; i += Vec::kLanes) {                     \
+            acc = Step(Vec::Load(values + i), acc);                          \
+        }                                                                    \
+        R lanes[sizeof(acc) / sizeof(R)];                                    \
+        memcpy(lanes, &acc, sizeof(acc));                                    \
+        R cur = ScalarFold<Fold>(lanes, sizeof(acc) / sizeof(R), init);      \
+        return ScalarFold<Fold>(values + i, n - i, cur);                     \
+    }
+
+HYBRIDSE_DEFINE_SIMD_KERNEL(Avx2Kernel, "avx2")
+HYBRIDSE_DEFINE_SIMD_KERNEL(Sse42Kernel, "sse4.2")
+#undef HYBRIDSE_DEFINE_SIMD_KERNEL
+
+SimdLevel DetectSimdLevel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return kSimdAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return kSimdSse42;
+    }
+    return kSimdScalar;
+}
+
+#define HYBRIDSE_SIMD_DISPATCH(AVX2, SSE42, STEP, FOLD, values, n, init)    \
+    do {                                                                    \
+        switch (GetSimdLevel()) {                                           \
+            case kSimdAvx2:                                                 \
+                return Avx2Kernel<AVX2, &AVX2::STEP, FOLD>(values, n, init); \
+            case kSimdSse42:                                                \
+                return Sse42Kernel<SSE42, &SSE42::STEP, FOLD>(values, n,    \
+                                                              init);        \
+            default:                                                        \
+                break;                                                      \
+        }                                                                   \
+        return ScalarFold<FOLD>(values, n, init);                           \
+    } while (0)
+
+#else
+
+SimdLevel DetectSimdLevel() { return kSimdScalar; }
+
+#define HYBRIDSE_SIMD_DISPATCH(AVX2, SSE42, STEP, FOLD, values, n, init) \
+    return ScalarFold<FOLD>(values, n, init)
+
+#endif  // __x86_64__
+
+}  // namespace
+
+SimdLevel GetSimdLevel() {
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+int16_t SimdSum(const int16_t* values, size_t n) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2<int16_t>, Sse42<int16_t>, Add, SumFold,
+                           values, n, static_cast<int16_t>(0));
+}
+int32_t SimdSum(const int32_t* values, size_t n) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2<int32_t>, Sse42<int32_t>, Add, SumFold,
+                           values, n, static_cast<int32_t>(0));
+}
+int64_t SimdSum(const int64_t* values, size_t n) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2<int64_t>, Sse42<int64_t>, Add, SumFold,
+                           values, n, static_cast<int64_t>(0));
+}
+
+int64_t SimdWideSum(const int16_t* values, size_t n) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2Wide<int16_t>, Sse42Wide<int16_t>, Add,
+                           SumFold, values, n, static_cast<int64_t>(0));
+}
+int64_t SimdWideSum(const int32_t* values, size_t n) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2Wide<int32_t>, Sse42Wide<int32_t>, Add,
+                           SumFold, values, n, static_cast<int64_t>(0));
+}
+
+int16_t SimdMin(const int16_t* values, size_t n, int16_t init) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2<int16_t>, Sse42<int16_t>, Min, MinFold,
+                           values, n, init);
+}
+int32_t SimdMin(const int32_t* values, size_t n, int32_t init) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2<int32_t>, Sse42<int32_t>, Min, MinFold,
+                           values, n, init);
+}
+int64_t SimdMin(const int64_t* values, size_t n, int64_t init) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2<int64_t>, Sse42<int64_t>, Min, MinFold,
+                           values, n, init);
+}
+static float VectorMin(const float* values, size_t n, float init) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2<float>, Sse42<float>, Min, MinFold, values, n,
+                           init);
+}
+static double VectorMin(const double* values, size_t n, double init) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2<double>, Sse42<double>, Min, MinFold, values,
+                           n, init);
+}
+// +0.0 and -0.0 are equal, lanes may keep another one of them than the
+// scalar fold, which keeps the first one. Zero results are folded again by
+// scalar code to return the same sign.
+float SimdMin(const float* values, size_t n, float init) {
+    float cur = VectorMin(values, n, init);
+    return cur == 0 ? ScalarFold<MinFold>(values, n, init) : cur;
+}
+double SimdMin(const double* values, size_t n, double init) {
+    double cur = VectorMin(values, n, init);
+    return cur == 0 ? ScalarFold<MinFold>(values, n, init) : cur;
+}
+
+int16_t SimdMax(const int16_t* values, size_t n, int16_t init) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2<int16_t>, Sse42<int16_t>, Max, MaxFold,
+                           values, n, init);
+}
+int32_t SimdMax(const int32_t* values, size_t n, int32_t init) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2<int32_t>, Sse42<int32_t>, Max, MaxFold,
+                           values, n, init);
+}
+int64_t SimdMax(const int64_t* values, size_t n, int64_t init) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2<int64_t>, Sse42<int64_t>, Max, MaxFold,
+                           values, n, init);
+}
+static float VectorMax(const float* values, size_t n, float init) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2<float>, Sse42<float>, Max, MaxFold, values, n,
+                           init);
+}
+static double VectorMax(const double* values, size_t n, double init) {
+    HYBRIDSE_SIMD_DISPATCH(Avx2<double>, Sse42<double>, Max, MaxFold, values,
+                           n, init);
+}
+float SimdMax(const float* values, size_t n, float init) {
+    float cur = VectorMax(values, n, init);
+    return cur == 0 ? ScalarFold<MaxFold>(values, n, init) : cur;
+}
+double SimdMax(const double* values, size_t n, double init) {
+    double cur = VectorMax(values, n, init);
+    return cur == 0 ? ScalarFold<MaxFold>(values, n, init) : cur;
+}
+
+}  // namespace base
+}  // namespace hybridse
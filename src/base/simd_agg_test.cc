@@ -0,0 +1,148 @@
+/*
+ * Copyright 2021 4Paradigm
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/simd_agg.h"
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace base {
+
+class SimdAggTest : public ::testing::Test {
+ public:
+    SimdAggTest() {}
+    ~SimdAggTest() {}
+};
+
+template <typename T>
+std::vector<T> RandomValues(size_t n, std::mt19937* rand) {
+    std::uniform_int_distribution<int64_t> dist(
+        std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+    std::vector<T> values;
+    for (size_t i = 0; i < n; ++i) {
+        values.push_back(static_cast<T>(dist(*rand)));
+    }
+    return values;
+}
+
+template <typename T>
+void CheckIntKernels(std::mt19937* rand) {
+    typedef typename std::make_unsigned<T>::type U;
+    for (size_t n : {0, 1, 3, 7, 15, 16, 17, 33, 100, 1001}) {
+        auto values = RandomValues<T>(n, rand);
+        U sum = 0;
+        T min = 7;
+        T max = 7;
+        for (T v : values) {
+            sum += static_cast<U>(v);
+            min = v < min ? v : min;
+            max = v > max ? v : max;
+        }
+        ASSERT_EQ(static_cast<T>(sum), SimdSum(values.data(), n)) << n;
+        ASSERT_EQ(min, SimdMin(values.data(), n, static_cast<T>(7))) << n;
+        ASSERT_EQ(max, SimdMax(values.data(), n, static_cast<T>(7))) << n;
+    }
+}
+
+template <typename T>
+void CheckWideSum(std::mt19937* rand) {
+    for (size_t n : {0, 1, 3, 5, 100, 1001}) {
+        auto values = RandomValues<T>(n, rand);
+        int64_t sum = 0;
+        for (T v : values) {
+            sum += v;
+        }
+        ASSERT_EQ(sum, SimdWideSum(values.data(), n)) << n;
+    }
+}
+
+template <typename T>
+void CheckFloatKernels(std::mt19937* rand) {
+    std::uniform_real_distribution<T> dist(-1000, 1000);
+    for (size_t n : {0, 1, 3, 9, 100, 1001}) {
+        std::vector<T> values;
+        for (size_t i = 0; i < n; ++i) {
+            // NaN never replaces current min or max
+            values.push_back(i % 10 == 3 ? NAN : dist(*rand));
+        }
+        T min = std::numeric_limits<T>::max();
+        T max = std::numeric_limits<T>::lowest();
+        for (T v : values) {
+            min = v < min ? v : min;
+            max = v > max ? v : max;
+        }
+        ASSERT_EQ(min,
+                  SimdMin(values.data(), n, std::numeric_limits<T>::max()));
+        ASSERT_EQ(max,
+                  SimdMax(values.data(), n, std::numeric_limits<T>::lowest()));
+    }
+}
+
+template <typename T>
+void CheckSignedZero() {
+    // zeros of both signs are equal, the one the scalar fold meets first is
+    // kept
+    for (size_t n : {4, 8, 16, 33}) {
+        for (size_t first = 0; first < n; ++first) {
+            std::vector<T> values(n, 5);
+            for (size_t i = first; i < n; i += 3) {
+                values[i] = (i - first) % 2 == 0 ? -0.0 : 0.0;
+            }
+            T min = 7;
+            for (T v : values) {
+                min = v < min ? v : min;
+            }
+            T simd_min = SimdMin(values.data(), n, static_cast<T>(7));
+            ASSERT_EQ(std::signbit(min), std::signbit(simd_min)) << n;
+            for (auto& v : values) {
+                v = v == 5 ? -5 : v;
+            }
+            T max = -7;
+            for (T v : values) {
+                max = v > max ? v : max;
+            }
+            T simd_max = SimdMax(values.data(), n, static_cast<T>(-7));
+            ASSERT_EQ(std::signbit(max), std::signbit(simd_max)) << n;
+        }
+    }
+}
+
+TEST_F(SimdAggTest, IntKernels) {
+    std::mt19937 rand(42);
+    CheckIntKernels<int16_t>(&rand);
+    CheckIntKernels<int32_t>(&rand);
+    CheckIntKernels<int64_t>(&rand);
+    CheckWideSum<int16_t>(&rand);
+    CheckWideSum<int32_t>(&rand);
+}
+
+TEST_F(SimdAggTest, FloatKernels) {
+    std::mt19937 rand(42);
+    CheckFloatKernels<float>(&rand);
+    CheckFloatKernels<double>(&rand);
+    CheckSignedZero<float>();
+    CheckSignedZero<double>();
+}
+
+}  // namespace base
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
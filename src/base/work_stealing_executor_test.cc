@@ -0,0 +1,118 @@
+/*
+ * Copyright 2021 4Paradigm
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/work_stealing_executor.h"
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace base {
+
+class WorkStealingExecutorTest : public ::testing::Test {
+ public:
+    WorkStealingExecutorTest() {}
+    ~WorkStealingExecutorTest() {}
+};
+
+TEST_F(WorkStealingExecutorTest, RunEachTaskOnce) {
+    for (size_t worker_num : {0, 1, 2, 4, 16}) {
+        for (size_t task_num : {0, 1, 3, 100, 1000}) {
+            WorkStealingExecutor executor(worker_num);
+            std::vector<std::atomic<int>> cnts(task_num);
+            for (auto& cnt : cnts) {
+                cnt.store(0);
+            }
+            std::atomic<size_t> max_worker(0);
+            executor.Run(task_num, [&](size_t worker, size_t task) {
+                cnts[task].fetch_add(1);
+                size_t prev = max_worker.load();
+                while (prev < worker &&
+                       !max_worker.compare_exchange_weak(prev, worker)) {
+                }
+            });
+            for (auto& cnt : cnts) {
+                ASSERT_EQ(1, cnt.load());
+            }
+            ASSERT_LT(max_worker.load(), executor.worker_num());
+        }
+    }
+}
+
+TEST_F(WorkStealingExecutorTest, StealSkewedTasks) {
+    // the first half of tasks are slow, they are dealt to worker 0 and 1
+    // up front, other workers have to steal them to help
+    WorkStealingExecutor executor(4);
+    std::vector<size_t> workers(64);
+    executor.Run(workers.size(), [&](size_t worker, size_t task) {
+        if (task < workers.size() / 2) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        workers[task] = worker;
+    });
+    bool stolen = false;
+    for (size_t i = 0; i < workers.size() / 2; ++i) {
+        if (workers[i] > 1) {
+            stolen = true;
+        }
+    }
+    ASSERT_TRUE(stolen);
+}
+
+TEST_F(WorkStealingExecutorTest, ReuseHelpersAcrossRuns) {
+    auto executor = WorkStealingExecutor::GetShared(4);
+    ASSERT_EQ(executor, WorkStealingExecutor::GetShared(4));
+    ASSERT_NE(executor, WorkStealingExecutor::GetShared(2));
+
+    // concurrent runs either share the helpers in turn or run on the
+    // calling thread, every task of every run is done exactly once
+    std::vector<std::thread> callers;
+    std::atomic<size_t> total(0);
+    for (int t = 0; t < 4; t++) {
+        callers.emplace_back([&]() {
+            for (int round = 0; round < 100; round++) {
+                std::vector<std::atomic<int>> cnts(round % 7 + 1);
+                for (auto& cnt : cnts) {
+                    cnt.store(0);
+                }
+                executor->Run(cnts.size(), [&](size_t worker, size_t task) {
+                    cnts[task].fetch_add(1);
+                    total.fetch_add(1);
+                });
+                for (auto& cnt : cnts) {
+                    ASSERT_EQ(1, cnt.load());
+                }
+            }
+        });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    size_t expected = 0;
+    for (int round = 0; round < 100; round++) {
+        expected += round % 7 + 1;
+    }
+    ASSERT_EQ(expected * 4, total.load());
+}
+
+}  // namespace base
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -42,10 +42,16 @@ static void BM_ArraySumColDouble(benchmark::State& state) {  // NOLINT
 }
 
 static void BM_CopyMemSegment(benchmark::State& state) {  // NOLINT
-    CopyMemSegment(&state, BENCHMARK, state.range(0));
+    CopyMemSegment(&state, BENCHMARK, state.range(0), false);
+}
+static void BM_CopyMemSegmentAtomicRefCnt(benchmark::State& state) {  // NOLINT
+    CopyMemSegment(&state, BENCHMARK, state.range(0), true);
 }
 static void BM_CopyMemTable(benchmark::State& state) {  // NOLINT
-    CopyMemTable(&state, BENCHMARK, state.range(0));
+    CopyMemTable(&state, BENCHMARK, state.range(0), false);
+}
+static void BM_CopyMemTableAtomicRefCnt(benchmark::State& state) {  // NOLINT
+    CopyMemTable(&state, BENCHMARK, state.range(0), true);
 }
 static void BM_CopyArrayList(benchmark::State& state) {  // NOLINT
     CopyArrayList(&state, BENCHMARK, state.range(0));
@@ -95,6 +101,18 @@ static void BM_RequestUnionWindowExcludeCurrentTime(
     benchmark::State& state) {  // NOLINT
     RequestUnionWindowExcludeCurrentTime(&state, BENCHMARK, state.range(0));
 }
+static void BM_TableProjectRowByRow(benchmark::State& state) {  // NOLINT
+    TableProjectRowByRow(&state, BENCHMARK, state.range(0));
+}
+static void BM_TableProjectBatch(benchmark::State& state) {  // NOLINT
+    TableProjectBatch(&state, BENCHMARK, state.range(0));
+}
+static void BM_DayProject(benchmark::State& state) {  // NOLINT
+    DateUdfProject(&state, BENCHMARK, state.range(0));
+}
+static void BM_DayProjectUdfBitcode(benchmark::State& state) {  // NOLINT
+    DateUdfProjectBitcode(&state, BENCHMARK, state.range(0));
+}
 
 BENCHMARK(BM_CopyArrayList)
     ->Args({10})
@@ -107,11 +125,22 @@ BENCHMARK(BM_CopyMemSegment)
     ->Args({1000})
     ->Args({10000});
 
+BENCHMARK(BM_CopyMemSegmentAtomicRefCnt)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
+
 BENCHMARK(BM_CopyMemTable)
     ->Args({10})
     ->Args({100})
     ->Args({1000})
     ->Args({10000});
+BENCHMARK(BM_CopyMemTableAtomicRefCnt)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
 
 BENCHMARK(BM_ArraySumColInt)
     ->Args({10})
@@ -191,6 +220,23 @@ BENCHMARK(BM_RequestUnionWindowExcludeCurrentTime)
     ->Args({100})
     ->Args({1000})
     ->Args({10000});
+
+BENCHMARK(BM_TableProjectRowByRow)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
+BENCHMARK(BM_TableProjectBatch)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
+BENCHMARK(BM_DayProject)->Args({10})->Args({100})->Args({1000})->Args({10000});
+BENCHMARK(BM_DayProjectUdfBitcode)
+    ->Args({10})
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000});
 }  // namespace bm
 }  // namespace hybridse
 
@@ -25,9 +25,13 @@
 #include "codegen/window_ir_builder.h"
 #include "gtest/gtest.h"
 #include "udf/udf.h"
+#include "llvm/Support/TargetSelect.h"
 #include "udf/udf_test.h"
+#include "vm/core_api.h"
+#include "vm/engine.h"
 #include "vm/jit_runtime.h"
 #include "vm/mem_catalog.h"
+#include "vm/simple_catalog.h"
 namespace hybridse {
 namespace bm {
 using codec::ColumnImpl;
@@ -56,6 +60,25 @@ static void BuildData(type::TableDef& table_def,          // NOLINT
     }
 }
 
+// build rows owning their buffers, so that copies count references in the
+// ref count mode given
+static void BuildManagedData(type::TableDef& table_def,         // NOLINT
+                             vm::MemTimeTableHandler& segment,  // NOLINT
+                             int64_t data_size, bool atomic_ref_cnt) {
+    std::vector<Row> buffer;
+    CaseDataMock::BuildOnePkTableData(table_def, buffer, data_size);
+    base::AtomicRefCountScope atomic_scope(atomic_ref_cnt);
+    uint64_t ts = 1;
+    for (auto& row : buffer) {
+        auto buf = base::RefCountedSlice::AllocInline(row.size());
+        memcpy(buf, row.buf(), row.size());
+        auto slice =
+            base::RefCountedSlice::CreateManagedInline(buf, row.size());
+        segment.AddRow(ts, Row(slice));
+        free(row.buf());
+    }
+}
+
 void CopyArrayList(benchmark::State* state, MODE mode, int64_t data_size) {
     vm::MemTimeTableHandler window;
     type::TableDef table_def;
@@ -75,10 +98,11 @@ void CopyArrayList(benchmark::State* state, MODE mode, int64_t data_size) {
         }
     }
 }
-void CopyMemTable(benchmark::State* state, MODE mode, int64_t data_size) {
+void CopyMemTable(benchmark::State* state, MODE mode, int64_t data_size,
+                  bool atomic_ref_cnt) {
     vm::MemTimeTableHandler table;
     type::TableDef table_def;
-    BuildData(table_def, table, data_size);
+    BuildManagedData(table_def, table, data_size, atomic_ref_cnt);
     switch (mode) {
         case BENCHMARK: {
             for (auto _ : *state) {
@@ -95,10 +119,11 @@ void CopyMemTable(benchmark::State* state, MODE mode, int64_t data_size) {
     }
 }
 
-void CopyMemSegment(benchmark::State* state, MODE mode, int64_t data_size) {
+void CopyMemSegment(benchmark::State* state, MODE mode, int64_t data_size,
+                    bool atomic_ref_cnt) {
     vm::MemTimeTableHandler table;
     type::TableDef table_def;
-    BuildData(table_def, table, data_size);
+    BuildManagedData(table_def, table, data_size, atomic_ref_cnt);
     switch (mode) {
         case BENCHMARK: {
             for (auto _ : *state) {
@@ -687,5 +712,181 @@ void RequestUnionWindowExcludeCurrentTime(benchmark::State* state, MODE mode,
         }
     }
 }
+
+static const vm::FnInfo* FindTableProjectFnInfo(
+    const vm::PhysicalOpNode* node) {
+    if (node == nullptr) {
+        return nullptr;
+    }
+    if (node->GetOpType() == vm::kPhysicalOpProject &&
+        !node->GetFnInfos().empty()) {
+        return node->GetFnInfos()[0];
+    }
+    for (auto producer : node->producers()) {
+        auto fn_info = FindTableProjectFnInfo(producer);
+        if (fn_info != nullptr) {
+            return fn_info;
+        }
+    }
+    return nullptr;
+}
+
+int64_t RunTableProjectRowByRow(const vm::FnInfo* fn_info,
+                                const std::vector<Row>& rows) {
+    Row parameter;
+    int64_t cnt = 0;
+    for (auto& row : rows) {
+        Row output = vm::CoreAPI::RowProject(fn_info->fn_ptr(), row, parameter);
+        if (!output.empty()) {
+            cnt++;
+        }
+    }
+    return cnt;
+}
+
+int64_t RunTableProjectBatch(const vm::FnInfo* fn_info,
+                             const std::vector<Row>& rows) {
+    Row parameter;
+    std::vector<Row> outputs;
+    if (!vm::CoreAPI::RowProjectBatch(fn_info->batch_fn_ptr(), rows, parameter,
+                                      &outputs)) {
+        return -1;
+    }
+    return outputs.size();
+}
+
+static void DoTableProject(benchmark::State* state, MODE mode,
+                           int64_t data_size, bool is_batch) {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    type::TableDef table_def;
+    std::vector<Row> rows;
+    CaseDataMock::BuildOnePkTableData(table_def, rows, data_size);
+    type::Database db;
+    db.set_name("db");
+    *(db.add_tables()) = table_def;
+    auto catalog = std::make_shared<vm::SimpleCatalog>(true);
+    catalog->AddDatabase(db);
+
+    vm::Engine engine(catalog);
+    vm::BatchRunSession session;
+    base::Status status;
+    const std::string sql =
+        "SELECT col1 + 1 AS c1, col2 * 2 AS c2, col3 + col4 AS c34, "
+        "col5 + 1000 AS c5, substring(col6, 1, 3) AS c6 FROM t1;";
+    if (!engine.Get(sql, "db", session, status)) {
+        FAIL() << "fail to compile sql: " << status;
+    }
+    auto fn_info =
+        FindTableProjectFnInfo(session.GetCompileInfo()->GetPhysicalPlan());
+    if (fn_info == nullptr || fn_info->batch_fn_ptr() == nullptr) {
+        FAIL() << "fail to find batch project function";
+    }
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                benchmark::DoNotOptimize(
+                    is_batch ? RunTableProjectBatch(fn_info, rows)
+                             : RunTableProjectRowByRow(fn_info, rows));
+            }
+            break;
+        }
+        case TEST: {
+            Row parameter;
+            std::vector<Row> outputs;
+            ASSERT_TRUE(vm::CoreAPI::RowProjectBatch(
+                fn_info->batch_fn_ptr(), rows, parameter, &outputs));
+            ASSERT_EQ(rows.size(), outputs.size());
+            for (size_t i = 0; i < rows.size(); ++i) {
+                Row expect =
+                    vm::CoreAPI::RowProject(fn_info->fn_ptr(), rows[i], parameter);
+                ASSERT_EQ(expect.size(), outputs[i].size());
+                ASSERT_EQ(0, memcmp(expect.buf(), outputs[i].buf(),
+                                    expect.size()));
+            }
+            break;
+        }
+    }
+}
+
+// date udf projection, with udf calls inlined from bitcode or not
+static void DoDateUdfProject(benchmark::State* state, MODE mode,
+                             int64_t data_size, bool enable_udf_bitcode) {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    type::TableDef table_def;
+    std::vector<Row> rows;
+    CaseDataMock::BuildOnePkTableData(table_def, rows, data_size);
+    type::Database db;
+    db.set_name("db");
+    *(db.add_tables()) = table_def;
+    auto catalog = std::make_shared<vm::SimpleCatalog>(true);
+    catalog->AddDatabase(db);
+
+    vm::EngineOptions options;
+    options.jit_options().set_enable_udf_bitcode(enable_udf_bitcode);
+    vm::Engine engine(catalog, options);
+    vm::BatchRunSession session;
+    base::Status status;
+    const std::string sql =
+        "SELECT day(col5) AS d, month(col5) AS m, year(col5) AS y, "
+        "dayofweek(col5) AS w FROM t1;";
+    if (!engine.Get(sql, "db", session, status)) {
+        FAIL() << "fail to compile sql: " << status;
+    }
+    auto fn_info =
+        FindTableProjectFnInfo(session.GetCompileInfo()->GetPhysicalPlan());
+    if (fn_info == nullptr || fn_info->fn_ptr() == nullptr) {
+        FAIL() << "fail to find project function";
+    }
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                benchmark::DoNotOptimize(
+                    RunTableProjectRowByRow(fn_info, rows));
+            }
+            break;
+        }
+        case TEST: {
+            Row parameter;
+            auto& schema = session.GetSchema();
+            for (auto& row : rows) {
+                int64_t ts = 0;
+                codec::RowView input(table_def.columns(), row.buf(),
+                                     row.size());
+                ASSERT_EQ(0, input.GetInt64(4, &ts));
+                Row output =
+                    vm::CoreAPI::RowProject(fn_info->fn_ptr(), row, parameter);
+                codec::RowView row_view(schema, output.buf(), output.size());
+                int32_t value = 0;
+                ASSERT_EQ(0, row_view.GetInt32(0, &value));
+                ASSERT_EQ(udf::v1::dayofmonth(ts), value);
+                ASSERT_EQ(0, row_view.GetInt32(1, &value));
+                ASSERT_EQ(udf::v1::month(ts), value);
+                ASSERT_EQ(0, row_view.GetInt32(2, &value));
+                ASSERT_EQ(udf::v1::year(ts), value);
+                ASSERT_EQ(0, row_view.GetInt32(3, &value));
+                ASSERT_EQ(udf::v1::dayofweek(ts), value);
+            }
+            break;
+        }
+    }
+}
+
+void DateUdfProject(benchmark::State* state, MODE mode, int64_t data_size) {
+    DoDateUdfProject(state, mode, data_size, false);
+}
+void DateUdfProjectBitcode(benchmark::State* state, MODE mode,
+                           int64_t data_size) {
+    DoDateUdfProject(state, mode, data_size, true);
+}
+
+void TableProjectRowByRow(benchmark::State* state, MODE mode,
+                          int64_t data_size) {
+    DoTableProject(state, mode, data_size, false);
+}
+void TableProjectBatch(benchmark::State* state, MODE mode, int64_t data_size) {
+    DoTableProject(state, mode, data_size, true);
+}
 }  // namespace bm
 }  // namespace hybridse
@@ -28,8 +28,10 @@ void SumRequestUnionTableCol(benchmark::State* state, MODE mode,
                              int64_t data_size, const std::string& col_name);
 void SumArrayListCol(benchmark::State* state, MODE mode, int64_t data_size,
                      const std::string& col_name);
-void CopyMemTable(benchmark::State* state, MODE mode, int64_t data_size);
-void CopyMemSegment(benchmark::State* state, MODE mode, int64_t data_size);
+void CopyMemTable(benchmark::State* state, MODE mode, int64_t data_size,
+                  bool atomic_ref_cnt);
+void CopyMemSegment(benchmark::State* state, MODE mode, int64_t data_size,
+                    bool atomic_ref_cnt);
 void CopyArrayList(benchmark::State* state, MODE mode, int64_t data_size);
 // Time Udf
 void CTimeDay(benchmark::State* state, MODE mode, const int32_t data_size);
@@ -53,6 +55,12 @@ void HistoryWindowBufferExcludeCurrentTime(benchmark::State* state, MODE mode,
 void RequestUnionWindow(benchmark::State* state, MODE mode, int64_t data_size);
 void RequestUnionWindowExcludeCurrentTime(benchmark::State* state, MODE mode,
                                           int64_t data_size);
+void TableProjectRowByRow(benchmark::State* state, MODE mode,
+                          int64_t data_size);
+void TableProjectBatch(benchmark::State* state, MODE mode, int64_t data_size);
+void DateUdfProject(benchmark::State* state, MODE mode, int64_t data_size);
+void DateUdfProjectBitcode(benchmark::State* state, MODE mode,
+                           int64_t data_size);
 }  // namespace bm
 }  // namespace hybridse
 #endif  // SRC_BENCHMARK_UDF_BM_CASE_H_
@@ -46,15 +46,21 @@ TEST_F(UdfBMCaseTest, SumRequestUnionTableCol1_TEST) {
 }
 
 TEST_F(UdfBMCaseTest, CopyMemSegment_TEST) {
-    CopyMemSegment(nullptr, TEST, 10L);
-    CopyMemSegment(nullptr, TEST, 100L);
-    CopyMemSegment(nullptr, TEST, 1000L);
+    CopyMemSegment(nullptr, TEST, 10L, false);
+    CopyMemSegment(nullptr, TEST, 10L, true);
+    CopyMemSegment(nullptr, TEST, 100L, false);
+    CopyMemSegment(nullptr, TEST, 100L, true);
+    CopyMemSegment(nullptr, TEST, 1000L, false);
+    CopyMemSegment(nullptr, TEST, 1000L, true);
 }
 
 TEST_F(UdfBMCaseTest, CopyMemTable_TEST) {
-    CopyMemTable(nullptr, TEST, 10L);
-    CopyMemTable(nullptr, TEST, 100L);
-    CopyMemTable(nullptr, TEST, 1000L);
+    CopyMemTable(nullptr, TEST, 10L, false);
+    CopyMemTable(nullptr, TEST, 10L, true);
+    CopyMemTable(nullptr, TEST, 100L, false);
+    CopyMemTable(nullptr, TEST, 100L, true);
+    CopyMemTable(nullptr, TEST, 1000L, false);
+    CopyMemTable(nullptr, TEST, 1000L, true);
 }
 
 TEST_F(UdfBMCaseTest, CopyArrayList_TEST) {
@@ -80,6 +86,17 @@ TEST_F(UdfBMCaseTest, TimestampFormat_TEST) { TimestampFormat(nullptr, TEST); }
 TEST_F(UdfBMCaseTest, DateToString_TEST) { DateToString(nullptr, TEST); }
 TEST_F(UdfBMCaseTest, DateFormat_TEST) { DateFormat(nullptr, TEST); }
 
+TEST_F(UdfBMCaseTest, TableProjectBatch_TEST) {
+    TableProjectBatch(nullptr, TEST, 10);
+    TableProjectBatch(nullptr, TEST, 1000);
+    TableProjectBatch(nullptr, TEST, 2049);
+}
+
+TEST_F(UdfBMCaseTest, DateUdfProject_TEST) {
+    DateUdfProject(nullptr, TEST, 100);
+    DateUdfProjectBitcode(nullptr, TEST, 100);
+}
+
 }  // namespace bm
 }  // namespace hybridse
 int main(int argc, char** argv) {
@@ -45,17 +45,20 @@ bool SqlCase::TTLParse(const std::string& org_type_str,
 
     for (std::string ttlstr : ttlstrings) {
         char unit = ttlstr[ttlstr.size() - 1];
+        int64_t unit_ms = 0;
         if ('d' == unit) {
-            ttls.push_back(boost::lexical_cast<int64_t>(
-                               ttlstr.substr(0, ttlstr.size() - 1)) *
-                           24 * 60);
+            unit_ms = 24 * 60 * 60 * 1000;
         } else if ('h' == unit) {
-            ttls.push_back(boost::lexical_cast<int64_t>(
-                               ttlstr.substr(0, ttlstr.size() - 1)) *
-                           60);
+            unit_ms = 60 * 60 * 1000;
         } else if ('m' == unit) {
+            unit_ms = 60 * 1000;
+        } else if ('s' == unit) {
+            unit_ms = 1000;
+        }
+        if (unit_ms > 0) {
             ttls.push_back(boost::lexical_cast<int64_t>(
-                ttlstr.substr(0, ttlstr.size() - 1)));
+                               ttlstr.substr(0, ttlstr.size() - 1)) *
+                           unit_ms);
         } else {
             ttls.push_back(
                 boost::lexical_cast<int64_t>(ttlstr.substr(0, ttlstr.size())));
@@ -63,6 +66,14 @@ bool SqlCase::TTLParse(const std::string& org_type_str,
     }
     return true;
 }
+
+// abs ttl of index def in milliseconds, as minutes if it is whole minutes
+static std::string AbsTTLString(uint64_t ttl) {
+    if (ttl % (60 * 1000) == 0) {
+        return std::to_string(ttl / (60 * 1000)) + "m";
+    }
+    return std::to_string((ttl + 999) / 1000) + "s";
+}
 bool SqlCase::TTLTypeParse(const std::string& org_type_str,
                            ::hybridse::type::TTLType* type) {
     if (nullptr == type) {
@@ -357,14 +368,14 @@ bool SqlCase::BuildCreateSqlFromSchema(const type::TableDef& table,
                     break;
                 }
                 case type::kTTLTimeLive: {
-                    sql.append(", ttl=").append(std::to_string(index.ttl(0)));
-                    sql.append("m, ttl_type=absolute");
+                    sql.append(", ttl=").append(AbsTTLString(index.ttl(0)));
+                    sql.append(", ttl_type=absolute");
                     break;
                 }
                 case type::kTTLTimeLiveAndCountLive: {
                     sql.append(", ttl=(")
-                        .append(std::to_string(index.ttl(0)))
-                        .append("m,")
+                        .append(AbsTTLString(index.ttl(0)))
+                        .append(",")
                         .append(std::to_string(index.ttl(1)))
                         .append(")")
                         .append(", ttl_type=absandlat");
@@ -372,8 +383,8 @@ bool SqlCase::BuildCreateSqlFromSchema(const type::TableDef& table,
                 }
                 case type::kTTLTimeLiveOrCountLive: {
                     sql.append(", ttl=(")
-                        .append(std::to_string(index.ttl(0)))
-                        .append("m,")
+                        .append(AbsTTLString(index.ttl(0)))
+                        .append(",")
                         .append(std::to_string(index.ttl(1)))
                         .append(")")
                         .append(", ttl_type=absorlat");
@@ -69,6 +69,13 @@ void Row::Append(const Row &b) {
 
 int32_t Row::GetRowPtrCnt() const { return 1 + slices_.size(); }
 
+void Row::MakeRefCountAtomic() {
+    slice_.MakeRefCountAtomic();
+    for (auto &slice : slices_) {
+        slice.MakeRefCountAtomic();
+    }
+}
+
 // Return a string that contains the copy of the referenced data.
 std::string Row::ToString() const { return slice_.ToString(); }
 
@@ -26,6 +26,9 @@
 #include "codegen/variable_ir_builder.h"
 #include "gflags/gflags.h"
 #include "glog/logging.h"
+
+DECLARE_bool(enable_incremental_window_agg);
+
 namespace hybridse {
 namespace codegen {
 
@@ -149,7 +152,9 @@ class StatisticalAggGenerator {
           avg_states_(col_num_, nullptr),
           min_states_(col_num_, nullptr),
           max_states_(col_num_, nullptr),
-          count_state_(nullptr) {}
+          count_state_(nullptr),
+          min_queues_(col_num_, nullptr),
+          max_queues_(col_num_, nullptr) {}
 
     ::llvm::Value* GenSumInitState(::llvm::IRBuilder<>* builder) {
         ::llvm::LLVMContext& llvm_ctx = builder->getContext();
@@ -363,6 +368,229 @@ class StatisticalAggGenerator {
         }
     }
 
+    void GenSumRetract(size_t i, ::llvm::Value* input, ::llvm::Value* is_null,
+                       ::llvm::IRBuilder<>* builder) {
+        ::llvm::Value* accum = builder->CreateLoad(sum_states_[i]);
+        ::llvm::Value* sub;
+        if (input->getType()->isIntegerTy()) {
+            sub = builder->CreateSub(accum, input);
+        } else {
+            sub = builder->CreateFSub(accum, input);
+        }
+        sub = builder->CreateSelect(is_null, accum, sub);
+        builder->CreateStore(sub, sum_states_[i]);
+    }
+
+    void GenAvgRetract(size_t i, ::llvm::Value* input, ::llvm::Value* is_null,
+                       ::llvm::IRBuilder<>* builder) {
+        ::llvm::Value* accum = builder->CreateLoad(avg_states_[i]);
+        if (input->getType()->isIntegerTy()) {
+            input = builder->CreateSIToFP(input, accum->getType());
+        } else {
+            input = builder->CreateFPCast(input, accum->getType());
+        }
+        ::llvm::Value* sum = builder->CreateFSub(accum, input);
+        sum = builder->CreateSelect(is_null, accum, sum);
+        builder->CreateStore(sum, avg_states_[i]);
+    }
+
+    void GenCountRetract(::llvm::IRBuilder<>* builder, ::llvm::Value* is_null) {
+        ::llvm::Value* one = ::llvm::ConstantInt::get(
+            reinterpret_cast<::llvm::PointerType*>(count_state_->getType())
+                ->getElementType(),
+            1, true);
+        ::llvm::Value* cnt = builder->CreateLoad(count_state_);
+        ::llvm::Value* new_cnt = builder->CreateSub(cnt, one);
+        new_cnt = builder->CreateSelect(is_null, cnt, new_cnt);
+        builder->CreateStore(new_cnt, count_state_);
+    }
+
+    void GenRetract(::llvm::IRBuilder<>* builder,
+                    const std::vector<::llvm::Value*>& inputs,
+                    const std::vector<::llvm::Value*>& is_null) {
+        bool count_retracted = false;
+        for (size_t i = 0; i < col_num_; ++i) {
+            if (!sum_idxs_[i].empty() ||
+                (!avg_idxs_[i].empty() && avg_states_[i] == nullptr)) {
+                GenSumRetract(i, inputs[i], is_null[i], builder);
+            }
+            if (!avg_idxs_[i].empty() && avg_states_[i] != nullptr) {
+                GenAvgRetract(i, inputs[i], is_null[i], builder);
+            }
+            if ((!avg_idxs_[i].empty() || !count_idxs_[i].empty() ||
+                 !min_idxs_[i].empty() || !max_idxs_[i].empty()) &&
+                !count_retracted) {
+                GenCountRetract(builder, is_null[i]);
+                count_retracted = true;
+            }
+        }
+    }
+
+    // float sums are kept away from retract so results stay identical to
+    // a full scan, min and max are kept by monotonic queues of window
+    bool IsRetractable() const {
+        for (size_t i = 0; i < col_num_; ++i) {
+            if ((col_type_ == node::kFloat || col_type_ == node::kDouble) &&
+                (!sum_idxs_[i].empty() || !avg_idxs_[i].empty())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void GetStates(std::vector<::llvm::Value*>* states) const {
+        for (size_t i = 0; i < col_num_; ++i) {
+            if (sum_states_[i] != nullptr) {
+                states->push_back(sum_states_[i]);
+            }
+            if (avg_states_[i] != nullptr) {
+                states->push_back(avg_states_[i]);
+            }
+        }
+        if (count_state_ != nullptr) {
+            states->push_back(count_state_);
+        }
+    }
+
+    bool IsIntQueue() const {
+        return col_type_ != node::kFloat && col_type_ != node::kDouble;
+    }
+
+    ::llvm::FunctionCallee GetQueueFunc(::llvm::IRBuilder<>* builder,
+                                        const std::string& op) {
+        ::llvm::Module* module = builder->GetInsertBlock()->getModule();
+        ::llvm::Type* value_ty =
+            IsIntQueue() ? builder->getInt64Ty() : builder->getDoubleTy();
+        ::llvm::Type* ptr_ty = builder->getInt8PtrTy();
+        std::string fname = std::string("hybridse_storage_window_agg_") +
+                            (IsIntQueue() ? "int" : "real") + "_queue_" + op;
+        if (op == "front") {
+            return module->getOrInsertFunction(
+                fname, ::llvm::FunctionType::get(value_ty, {ptr_ty}, false));
+        }
+        return module->getOrInsertFunction(
+            fname, ::llvm::FunctionType::get(builder->getVoidTy(),
+                                             {ptr_ty, value_ty}, false));
+    }
+
+    // fetch min/max queues kept in window, `queue_idx` is shared by all
+    // generators of the same aggregation function
+    void GenGetQueues(::llvm::IRBuilder<>* builder, ::llvm::Value* window,
+                      ::llvm::Value* key, ::llvm::Value* reset,
+                      int32_t* queue_idx) {
+        ::llvm::Module* module = builder->GetInsertBlock()->getModule();
+        ::llvm::Type* ptr_ty = builder->getInt8PtrTy();
+        auto get_queue_func = module->getOrInsertFunction(
+            IsIntQueue() ? "hybridse_storage_get_window_agg_int_queue"
+                         : "hybridse_storage_get_window_agg_real_queue",
+            ::llvm::FunctionType::get(ptr_ty,
+                                      {ptr_ty, ptr_ty, builder->getInt32Ty(),
+                                       builder->getInt1Ty(),
+                                       builder->getInt1Ty()},
+                                      false));
+        for (size_t i = 0; i < col_num_; ++i) {
+            if (!min_idxs_[i].empty()) {
+                min_queues_[i] = builder->CreateCall(
+                    get_queue_func,
+                    {window, key, builder->getInt32((*queue_idx)++),
+                     builder->getInt1(true), reset});
+            }
+            if (!max_idxs_[i].empty()) {
+                max_queues_[i] = builder->CreateCall(
+                    get_queue_func,
+                    {window, key, builder->getInt32((*queue_idx)++),
+                     builder->getInt1(false), reset});
+            }
+        }
+    }
+
+    void GenQueueCall(::llvm::IRBuilder<>* builder, const std::string& op,
+                      ::llvm::Value* queue, ::llvm::Value* input,
+                      ::llvm::Value* is_null) {
+        ::llvm::Function* fn = builder->GetInsertBlock()->getParent();
+        ::llvm::LLVMContext& llvm_ctx = builder->getContext();
+        ::llvm::BasicBlock* call_block =
+            ::llvm::BasicBlock::Create(llvm_ctx, "queue_" + op, fn);
+        ::llvm::BasicBlock* end_block =
+            ::llvm::BasicBlock::Create(llvm_ctx, "queue_" + op + "_end", fn);
+        builder->CreateCondBr(is_null, end_block, call_block);
+        builder->SetInsertPoint(call_block);
+        if (IsIntQueue()) {
+            input = builder->CreateSExt(input, builder->getInt64Ty());
+        } else {
+            input = builder->CreateFPExt(input, builder->getDoubleTy());
+        }
+        builder->CreateCall(GetQueueFunc(builder, op), {queue, input});
+        builder->CreateBr(end_block);
+        builder->SetInsertPoint(end_block);
+    }
+
+    // rows are met newest first when scanning the whole window, while
+    // delta rows come in the order they entered the window
+    void GenQueueUpdate(::llvm::IRBuilder<>* builder,
+                        const std::vector<::llvm::Value*>& inputs,
+                        const std::vector<::llvm::Value*>& is_null,
+                        bool is_scan) {
+        std::string op = is_scan ? "push_front" : "push";
+        for (size_t i = 0; i < col_num_; ++i) {
+            if (min_queues_[i] != nullptr) {
+                GenQueueCall(builder, op, min_queues_[i], inputs[i],
+                             is_null[i]);
+            }
+            if (max_queues_[i] != nullptr) {
+                GenQueueCall(builder, op, max_queues_[i], inputs[i],
+                             is_null[i]);
+            }
+        }
+    }
+
+    void GenQueueRetract(::llvm::IRBuilder<>* builder,
+                         const std::vector<::llvm::Value*>& inputs,
+                         const std::vector<::llvm::Value*>& is_null) {
+        for (size_t i = 0; i < col_num_; ++i) {
+            if (min_queues_[i] != nullptr) {
+                GenQueueCall(builder, "pop", min_queues_[i], inputs[i],
+                             is_null[i]);
+            }
+            if (max_queues_[i] != nullptr) {
+                GenQueueCall(builder, "pop", max_queues_[i], inputs[i],
+                             is_null[i]);
+            }
+        }
+    }
+
+    ::llvm::Value* GenQueueFront(::llvm::IRBuilder<>* builder,
+                                 ::llvm::Value* queue, ::llvm::Type* ty) {
+        ::llvm::Value* front =
+            builder->CreateCall(GetQueueFunc(builder, "front"), {queue});
+        if (IsIntQueue()) {
+            return builder->CreateTrunc(front, ty);
+        }
+        return builder->CreateFPTrunc(front, ty);
+    }
+
+    // min and max states after delta applied are heads of queues
+    void GenLoadQueueFronts(::llvm::IRBuilder<>* builder) {
+        for (size_t i = 0; i < col_num_; ++i) {
+            if (min_queues_[i] != nullptr) {
+                ::llvm::Type* ty = reinterpret_cast<::llvm::PointerType*>(
+                                       min_states_[i]->getType())
+                                       ->getElementType();
+                builder->CreateStore(
+                    GenQueueFront(builder, min_queues_[i], ty),
+                    min_states_[i]);
+            }
+            if (max_queues_[i] != nullptr) {
+                ::llvm::Type* ty = reinterpret_cast<::llvm::PointerType*>(
+                                       max_states_[i]->getType())
+                                       ->getElementType();
+                builder->CreateStore(
+                    GenQueueFront(builder, max_queues_[i], ty),
+                    max_states_[i]);
+            }
+        }
+    }
+
     void GenOutputs(::llvm::IRBuilder<>* builder,
                     std::vector<std::pair<size_t, NativeValue>>* outputs) {
         for (size_t i = 0; i < col_num_; ++i) {
@@ -459,6 +687,10 @@ class StatisticalAggGenerator {
     std::vector<::llvm::Value*> min_states_;
     std::vector<::llvm::Value*> max_states_;
     ::llvm::Value* count_state_;
+
+    // min/max queues kept in window for incremental aggregation
+    std::vector<::llvm::Value*> min_queues_;
+    std::vector<::llvm::Value*> max_queues_;
 };
 
 llvm::Type* AggregateIRBuilder::GetOutputLlvmType(
@@ -590,117 +822,78 @@ bool ScheduleAggGenerators(
     return true;
 }
 
-bool AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
-                                    ExprIRBuilder* expr_ir_builder,
-                                    VariableIRBuilder* variable_ir_builder,
-                                    ::llvm::BasicBlock* cur_block,
-                                    const std::string& output_ptr_name,
-                                    const vm::Schema& output_schema) {
-    ::llvm::LLVMContext& llvm_ctx = module_->getContext();
-    ::llvm::IRBuilder<> builder(llvm_ctx);
+// every running state takes a slot of 8 bytes in the window state buffer
+static const uint32_t STATE_SLOT_SIZE = 8;
+
+enum AggLoopMode {
+    // update states with rows of whole window, newest first
+    kScanUpdate,
+    // update states with rows entered window, oldest first
+    kDeltaUpdate,
+    // retract states with rows left window, oldest first
+    kDeltaRetract,
+};
+
+// iterate rows from the row iterator at `iter_ptr` which is already created,
+// and apply update (or retract) of all generators on each row
+static bool BuildAggIterLoop(
+    const vm::SchemasContext* schema_context,
+    const std::unordered_map<std::string, AggColumnInfo>& agg_col_infos,
+    std::vector<StatisticalAggGenerator>* generators, ::llvm::Function* fn,
+    ::llvm::Value* iter_ptr, AggLoopMode mode, ::llvm::IRBuilder<>* builder) {
+    ::llvm::Module* module = fn->getParent();
+    ::llvm::LLVMContext& llvm_ctx = module->getContext();
     auto void_ty = llvm::Type::getVoidTy(llvm_ctx);
     auto int64_ty = llvm::Type::getInt64Ty(llvm_ctx);
-    expr_ir_builder->set_frame(nullptr, frame_node_);
-    base::Status status;
-    NativeValue window_ptr;
-    status = expr_ir_builder->BuildWindow(&window_ptr);
-    if (!status.isOK() || window_ptr.GetRaw() == nullptr) {
-        LOG(ERROR) << "fail to find window_ptr: " + status.str();
-        return false;
-    }
-    NativeValue output_buf_wrapper;
-    bool ok = variable_ir_builder->LoadValue(output_ptr_name,
-                                             &output_buf_wrapper, status);
-    if (!ok) {
-        LOG(ERROR) << "fail to get output row ptr";
-        return false;
-    }
-    ::llvm::Value* output_buf = output_buf_wrapper.GetValue(&builder);
-
-    std::string fn_name =
-        base_funcname + "_multi_column_agg_" + std::to_string(id_) + "__";
     auto ptr_ty = llvm::Type::getInt8Ty(llvm_ctx)->getPointerTo();
-    ::llvm::FunctionType* fnt = ::llvm::FunctionType::get(
-        llvm::Type::getVoidTy(llvm_ctx), {ptr_ty, ptr_ty}, false);
-    ::llvm::Function* fn = ::llvm::Function::Create(
-        fnt, llvm::Function::ExternalLinkage, fn_name, module_);
-    builder.SetInsertPoint(cur_block);
-    builder.CreateCall(
-        module_->getOrInsertFunction(fn_name, fnt),
-        {window_ptr.GetValue(&builder), builder.CreateLoad(output_buf)});
+    std::string prefix = mode == kDeltaRetract ? "retract_" : "";
 
-    ::llvm::BasicBlock* head_block =
-        ::llvm::BasicBlock::Create(llvm_ctx, "head", fn);
     ::llvm::BasicBlock* enter_block =
-        ::llvm::BasicBlock::Create(llvm_ctx, "enter_iter", fn);
+        ::llvm::BasicBlock::Create(llvm_ctx, prefix + "enter_iter", fn);
     ::llvm::BasicBlock* body_block =
-        ::llvm::BasicBlock::Create(llvm_ctx, "iter_body", fn);
+        ::llvm::BasicBlock::Create(llvm_ctx, prefix + "iter_body", fn);
     ::llvm::BasicBlock* exit_block =
-        ::llvm::BasicBlock::Create(llvm_ctx, "exit_iter", fn);
-
-    std::vector<StatisticalAggGenerator> generators;
-    if (!ScheduleAggGenerators(agg_col_infos_, &generators)) {
-        LOG(WARNING) << "Schedule agg ops failed";
-        return false;
-    }
-
-    // gen head
-    builder.SetInsertPoint(head_block);
-    for (auto& agg_generator : generators) {
-        agg_generator.GenInitState(&builder);
-    }
-
-    ::llvm::Value* input_arg = fn->arg_begin();
-    ::llvm::Value* output_arg = fn->arg_begin() + 1;
-
-    // on stack unique pointer
-    size_t iter_bytes = sizeof(std::unique_ptr<codec::RowIterator>);
-    ::llvm::Value* iter_ptr = CreateAllocaAtHead(
-        &builder, ::llvm::Type::getInt8Ty(llvm_ctx), "row_iter",
-        ::llvm::ConstantInt::get(int64_ty, iter_bytes, true));
-    auto get_iter_func = module_->getOrInsertFunction(
-        "hybridse_storage_get_row_iter", void_ty, ptr_ty, ptr_ty);
-    builder.CreateCall(get_iter_func, {input_arg, iter_ptr});
-    builder.CreateBr(enter_block);
+        ::llvm::BasicBlock::Create(llvm_ctx, prefix + "exit_iter", fn);
+    builder->CreateBr(enter_block);
 
     // gen iter begin
-    builder.SetInsertPoint(enter_block);
+    builder->SetInsertPoint(enter_block);
     auto bool_ty = llvm::Type::getInt1Ty(llvm_ctx);
-    auto has_next_func = module_->getOrInsertFunction(
+    auto has_next_func = module->getOrInsertFunction(
         "hybridse_storage_row_iter_has_next",
         ::llvm::FunctionType::get(bool_ty, {ptr_ty}, false));
-    ::llvm::Value* has_next = builder.CreateCall(has_next_func, iter_ptr);
-    builder.CreateCondBr(has_next, body_block, exit_block);
+    ::llvm::Value* has_next = builder->CreateCall(has_next_func, iter_ptr);
+    builder->CreateCondBr(has_next, body_block, exit_block);
 
     // gen iter body
-    builder.SetInsertPoint(body_block);
-    auto get_slice_func = module_->getOrInsertFunction(
+    builder->SetInsertPoint(body_block);
+    auto get_slice_func = module->getOrInsertFunction(
         "hybridse_storage_row_iter_get_cur_slice",
         ::llvm::FunctionType::get(ptr_ty, {ptr_ty, int64_ty}, false));
-    auto get_slice_size_func = module_->getOrInsertFunction(
+    auto get_slice_size_func = module->getOrInsertFunction(
         "hybridse_storage_row_iter_get_cur_slice_size",
         ::llvm::FunctionType::get(int64_ty, {ptr_ty, int64_ty}, false));
     std::unordered_map<size_t, std::pair<::llvm::Value*, ::llvm::Value*>>
         used_slices;
 
     // compute current row's slices
-    for (auto& pair : agg_col_infos_) {
+    for (auto& pair : agg_col_infos) {
         size_t schema_idx = pair.second.schema_idx;
         auto iter = used_slices.find(schema_idx);
         if (iter == used_slices.end()) {
             ::llvm::Value* idx_value =
                 llvm::ConstantInt::get(int64_ty, schema_idx, true);
             ::llvm::Value* buf_ptr =
-                builder.CreateCall(get_slice_func, {iter_ptr, idx_value});
-            ::llvm::Value* buf_size =
-                builder.CreateCall(get_slice_size_func, {iter_ptr, idx_value});
+                builder->CreateCall(get_slice_func, {iter_ptr, idx_value});
+            ::llvm::Value* buf_size = builder->CreateCall(
+                get_slice_size_func, {iter_ptr, idx_value});
             used_slices[schema_idx] = {buf_ptr, buf_size};
         }
     }
 
     // compute row field fetches
     std::unordered_map<std::string, NativeValue> cur_row_fields_dict;
-    for (auto& pair : agg_col_infos_) {
+    for (auto& pair : agg_col_infos) {
         auto& info = pair.second;
         std::string col_key = info.GetColKey();
         if (cur_row_fields_dict.find(col_key) == cur_row_fields_dict.end()) {
@@ -709,7 +902,7 @@ bool AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
 
             ScopeVar dummy_scope_var;
             BufNativeIRBuilder buf_builder(
-                schema_idx, schema_context_->GetRowFormat(schema_idx),
+                schema_idx, schema_context->GetRowFormat(schema_idx),
                 body_block, &dummy_scope_var);
             NativeValue field_value;
             if (!buf_builder.BuildGetField(info.col_idx, slice_info.first,
@@ -722,7 +915,7 @@ bool AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
     }
 
     // compute accumulation
-    for (auto& agg_generator : generators) {
+    for (auto& agg_generator : *generators) {
         std::vector<::llvm::Value*> fields;
         std::vector<::llvm::Value*> fields_is_null;
         for (auto& key : agg_generator.GetColKeys()) {
@@ -732,28 +925,211 @@ bool AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
                 return false;
             }
             auto& field_value = iter->second;
-            fields.push_back(field_value.GetValue(&builder));
-            fields_is_null.push_back(field_value.GetIsNull(&builder));
+            fields.push_back(field_value.GetValue(builder));
+            fields_is_null.push_back(field_value.GetIsNull(builder));
+        }
+        if (mode == kDeltaRetract) {
+            agg_generator.GenRetract(builder, fields, fields_is_null);
+            agg_generator.GenQueueRetract(builder, fields, fields_is_null);
+        } else {
+            agg_generator.GenUpdate(builder, fields, fields_is_null);
+            agg_generator.GenQueueUpdate(builder, fields, fields_is_null,
+                                         mode == kScanUpdate);
         }
-        agg_generator.GenUpdate(&builder, fields, fields_is_null);
     }
-    auto next_func = module_->getOrInsertFunction(
+    auto next_func = module->getOrInsertFunction(
         "hybridse_storage_row_iter_next",
         ::llvm::FunctionType::get(void_ty, {ptr_ty}, false));
-    builder.CreateCall(next_func, {iter_ptr});
-    builder.CreateBr(enter_block);
+    builder->CreateCall(next_func, {iter_ptr});
+    builder->CreateBr(enter_block);
 
     // gen iter end
-    builder.SetInsertPoint(exit_block);
-    auto delete_iter_func = module_->getOrInsertFunction(
+    builder->SetInsertPoint(exit_block);
+    auto delete_iter_func = module->getOrInsertFunction(
         "hybridse_storage_row_iter_delete",
         ::llvm::FunctionType::get(void_ty, {ptr_ty}, false));
-    builder.CreateCall(delete_iter_func, {iter_ptr});
+    builder->CreateCall(delete_iter_func, {iter_ptr});
+    return true;
+}
+
+bool AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
+                                    ExprIRBuilder* expr_ir_builder,
+                                    VariableIRBuilder* variable_ir_builder,
+                                    ::llvm::BasicBlock* cur_block,
+                                    const std::string& output_ptr_name,
+                                    const vm::Schema& output_schema) {
+    ::llvm::LLVMContext& llvm_ctx = module_->getContext();
+    ::llvm::IRBuilder<> builder(llvm_ctx);
+    auto void_ty = llvm::Type::getVoidTy(llvm_ctx);
+    auto int64_ty = llvm::Type::getInt64Ty(llvm_ctx);
+    expr_ir_builder->set_frame(nullptr, frame_node_);
+    base::Status status;
+    NativeValue window_ptr;
+    status = expr_ir_builder->BuildWindow(&window_ptr);
+    if (!status.isOK() || window_ptr.GetRaw() == nullptr) {
+        LOG(ERROR) << "fail to find window_ptr: " + status.str();
+        return false;
+    }
+    NativeValue output_buf_wrapper;
+    bool ok = variable_ir_builder->LoadValue(output_ptr_name,
+                                             &output_buf_wrapper, status);
+    if (!ok) {
+        LOG(ERROR) << "fail to get output row ptr";
+        return false;
+    }
+    ::llvm::Value* output_buf = output_buf_wrapper.GetValue(&builder);
+
+    std::string fn_name =
+        base_funcname + "_multi_column_agg_" + std::to_string(id_) + "__";
+    auto ptr_ty = llvm::Type::getInt8Ty(llvm_ctx)->getPointerTo();
+    ::llvm::FunctionType* fnt = ::llvm::FunctionType::get(
+        llvm::Type::getVoidTy(llvm_ctx), {ptr_ty, ptr_ty}, false);
+    ::llvm::Function* fn = ::llvm::Function::Create(
+        fnt, llvm::Function::ExternalLinkage, fn_name, module_);
+    builder.SetInsertPoint(cur_block);
+    builder.CreateCall(
+        module_->getOrInsertFunction(fn_name, fnt),
+        {window_ptr.GetValue(&builder), builder.CreateLoad(output_buf)});
+
+    ::llvm::BasicBlock* head_block =
+        ::llvm::BasicBlock::Create(llvm_ctx, "head", fn);
+
+    std::vector<StatisticalAggGenerator> generators;
+    if (!ScheduleAggGenerators(agg_col_infos_, &generators)) {
+        LOG(WARNING) << "Schedule agg ops failed";
+        return false;
+    }
+
+    // gen head
+    builder.SetInsertPoint(head_block);
+    for (auto& agg_generator : generators) {
+        agg_generator.GenInitState(&builder);
+    }
+
+    ::llvm::Value* input_arg = fn->arg_begin();
+    ::llvm::Value* output_arg = fn->arg_begin() + 1;
+
+    // on stack unique pointer
+    size_t iter_bytes = sizeof(std::unique_ptr<codec::RowIterator>);
+    ::llvm::Value* iter_ptr = CreateAllocaAtHead(
+        &builder, ::llvm::Type::getInt8Ty(llvm_ctx), "row_iter",
+        ::llvm::ConstantInt::get(int64_ty, iter_bytes, true));
+
+    // states kept in window across rows if all aggregations can retract
+    bool incremental = FLAGS_enable_incremental_window_agg;
+    for (auto& agg_generator : generators) {
+        incremental = incremental && agg_generator.IsRetractable();
+    }
+    std::vector<::llvm::Value*> states;
+    ::llvm::Value* state_buf = nullptr;
+    if (incremental) {
+        for (auto& agg_generator : generators) {
+            agg_generator.GetStates(&states);
+        }
+        ::llvm::Value* is_delta_ptr = CreateAllocaAtHead(
+            &builder, ::llvm::Type::getInt8Ty(llvm_ctx), "is_delta");
+        auto get_state_func = module_->getOrInsertFunction(
+            "hybridse_storage_get_window_agg_state",
+            ::llvm::FunctionType::get(
+                ptr_ty, {ptr_ty, ptr_ty, builder.getInt32Ty(), ptr_ty, ptr_ty},
+                false));
+        state_buf = builder.CreateCall(
+            get_state_func,
+            {input_arg, builder.CreateBitCast(fn, ptr_ty),
+             builder.getInt32(STATE_SLOT_SIZE *
+                              static_cast<uint32_t>(states.size())),
+             is_delta_ptr, ::llvm::ConstantPointerNull::get(ptr_ty)});
+        ::llvm::Value* is_delta = builder.CreateICmpNE(
+            builder.CreateLoad(is_delta_ptr), builder.getInt8(0));
+        int32_t queue_idx = 0;
+        for (auto& agg_generator : generators) {
+            agg_generator.GenGetQueues(&builder, input_arg,
+                                       builder.CreateBitCast(fn, ptr_ty),
+                                       builder.CreateNot(is_delta),
+                                       &queue_idx);
+        }
+
+        ::llvm::BasicBlock* delta_block =
+            ::llvm::BasicBlock::Create(llvm_ctx, "apply_delta", fn);
+        ::llvm::BasicBlock* scan_block =
+            ::llvm::BasicBlock::Create(llvm_ctx, "scan_window", fn);
+        ::llvm::BasicBlock* save_block =
+            ::llvm::BasicBlock::Create(llvm_ctx, "save_states", fn);
+        builder.CreateCondBr(is_delta, delta_block, scan_block);
+
+        // load states of previous row, retract popped rows and update
+        // entered rows
+        builder.SetInsertPoint(delta_block);
+        for (size_t i = 0; i < states.size(); ++i) {
+            ::llvm::Value* slot = builder.CreatePointerCast(
+                builder.CreateGEP(state_buf,
+                                  builder.getInt64(STATE_SLOT_SIZE * i)),
+                states[i]->getType());
+            builder.CreateStore(builder.CreateLoad(slot), states[i]);
+        }
+        auto get_delta_iter_func = module_->getOrInsertFunction(
+            "hybridse_storage_get_window_delta_iter", void_ty, ptr_ty,
+            builder.getInt1Ty(), ptr_ty);
+        builder.CreateCall(get_delta_iter_func,
+                           {input_arg, builder.getInt1(true), iter_ptr});
+        if (!BuildAggIterLoop(schema_context_, agg_col_infos_, &generators,
+                              fn, iter_ptr, kDeltaRetract, &builder)) {
+            return false;
+        }
+        builder.CreateCall(get_delta_iter_func,
+                           {input_arg, builder.getInt1(false), iter_ptr});
+        if (!BuildAggIterLoop(schema_context_, agg_col_infos_, &generators,
+                              fn, iter_ptr, kDeltaUpdate, &builder)) {
+            return false;
+        }
+        for (auto& agg_generator : generators) {
+            agg_generator.GenLoadQueueFronts(&builder);
+        }
+        builder.CreateBr(save_block);
+
+        // recompute states from whole window
+        builder.SetInsertPoint(scan_block);
+        auto get_iter_func = module_->getOrInsertFunction(
+            "hybridse_storage_get_row_iter", void_ty, ptr_ty, ptr_ty);
+        builder.CreateCall(get_iter_func, {input_arg, iter_ptr});
+        if (!BuildAggIterLoop(schema_context_, agg_col_infos_, &generators,
+                              fn, iter_ptr, kScanUpdate, &builder)) {
+            return false;
+        }
+        builder.CreateBr(save_block);
+
+        // save states for next row, window may not provide state buffer
+        builder.SetInsertPoint(save_block);
+        ::llvm::BasicBlock* store_block =
+            ::llvm::BasicBlock::Create(llvm_ctx, "store_states", fn);
+        ::llvm::BasicBlock* output_block =
+            ::llvm::BasicBlock::Create(llvm_ctx, "output", fn);
+        builder.CreateCondBr(builder.CreateIsNull(state_buf), output_block,
+                             store_block);
+        builder.SetInsertPoint(store_block);
+        for (size_t i = 0; i < states.size(); ++i) {
+            ::llvm::Value* slot = builder.CreatePointerCast(
+                builder.CreateGEP(state_buf,
+                                  builder.getInt64(STATE_SLOT_SIZE * i)),
+                states[i]->getType());
+            builder.CreateStore(builder.CreateLoad(states[i]), slot);
+        }
+        builder.CreateBr(output_block);
+        builder.SetInsertPoint(output_block);
+    } else {
+        auto get_iter_func = module_->getOrInsertFunction(
+            "hybridse_storage_get_row_iter", void_ty, ptr_ty, ptr_ty);
+        builder.CreateCall(get_iter_func, {input_arg, iter_ptr});
+        if (!BuildAggIterLoop(schema_context_, agg_col_infos_, &generators,
+                              fn, iter_ptr, kScanUpdate, &builder)) {
+            return false;
+        }
+    }
 
     // store results to output row
     std::map<uint32_t, NativeValue> dummy_map;
     BufNativeEncoderIRBuilder output_encoder(&dummy_map, &output_schema,
-                                             exit_block);
+                                             builder.GetInsertBlock());
     for (auto& agg_generator : generators) {
         std::vector<std::pair<size_t, NativeValue>> outputs;
         agg_generator.GenOutputs(&builder, &outputs);
@@ -257,10 +257,10 @@ bool BufNativeEncoderIRBuilder::BuildEncode(::llvm::Value* output_ptr) {
     }
 
     ::llvm::Type* i8_ptr_ty = builder.getInt8PtrTy();
-    ::llvm::Value* i8_ptr =
-        ::llvm::CallInst::CreateMalloc(block_, row_size->getType(), i8_ptr_ty, row_size, nullptr, nullptr, "malloc");
-    block_->getInstList().push_back(::llvm::cast<::llvm::Instruction>(i8_ptr));
-    i8_ptr = builder.CreatePointerCast(i8_ptr, i8_ptr_ty);
+    // allocate output row from runtime, see JitRuntime::AllocRow
+    ::llvm::FunctionCallee alloc_row_fn =
+        block_->getModule()->getOrInsertFunction("hybridse_alloc_row", i8_ptr_ty, row_size->getType());
+    ::llvm::Value* i8_ptr = builder.CreateCall(alloc_row_fn, {row_size}, "row_buf");
     DLOG(INFO) << "i8_ptr type " << i8_ptr->getType()->getTypeID() << " output ptr type "
                << output_ptr->getType()->getTypeID();
     // make sure free it in c++ always
@@ -158,6 +158,84 @@ Status RowFnLetIRBuilder::Build(
     return Status::OK();
 }
 
+Status RowFnLetIRBuilder::BuildBatch(const std::string& name,
+                                     const std::string& row_fn_name) {
+    ::llvm::Module* module = ctx_->GetModule();
+    CHECK_TRUE(module->getFunction(name) == NULL, kCodegenError, "function ",
+               name, " already exists");
+    ::llvm::Function* row_fn = module->getFunction(row_fn_name);
+    CHECK_TRUE(row_fn != nullptr, kCodegenError, "row function ", row_fn_name,
+               " not found");
+
+    ::llvm::LLVMContext& llvm_ctx = module->getContext();
+    ::llvm::Type* i8_ptr_ty = ::llvm::Type::getInt8PtrTy(llvm_ctx);
+    ::llvm::Type* i32_ty = ::llvm::Type::getInt32Ty(llvm_ctx);
+    std::vector<::llvm::Type*> args_llvm_type = {
+        i8_ptr_ty->getPointerTo(), i32_ty, i8_ptr_ty,
+        i8_ptr_ty->getPointerTo()};
+
+    ::llvm::Function* fn = nullptr;
+    CHECK_TRUE(BuildFnHeader(name, args_llvm_type, i32_ty, &fn) &&
+                   fn != nullptr,
+               kCodegenError, "Fail to build fn header for name ", name);
+    auto arg_iter = fn->arg_begin();
+    ::llvm::Value* rows = &*(arg_iter++);
+    ::llvm::Value* cnt = &*(arg_iter++);
+    ::llvm::Value* parameter = &*(arg_iter++);
+    ::llvm::Value* outputs = &*(arg_iter++);
+
+    auto entry_block = ::llvm::BasicBlock::Create(llvm_ctx, "entry", fn);
+    auto cond_block = ::llvm::BasicBlock::Create(llvm_ctx, "loop_cond", fn);
+    auto body_block = ::llvm::BasicBlock::Create(llvm_ctx, "loop_body", fn);
+    auto fail_block = ::llvm::BasicBlock::Create(llvm_ctx, "fail", fn);
+    auto step_block = ::llvm::BasicBlock::Create(llvm_ctx, "loop_step", fn);
+    auto exit_block = ::llvm::BasicBlock::Create(llvm_ctx, "exit", fn);
+
+    ::llvm::IRBuilder<> builder(entry_block);
+    ::llvm::Value* fail_cnt = builder.CreateAlloca(i32_ty);
+    builder.CreateStore(builder.getInt32(0), fail_cnt);
+    builder.CreateBr(cond_block);
+
+    // for (idx = 0; idx < cnt; ++idx)
+    builder.SetInsertPoint(cond_block);
+    ::llvm::PHINode* idx = builder.CreatePHI(i32_ty, 2);
+    idx->addIncoming(builder.getInt32(0), entry_block);
+    builder.CreateCondBr(builder.CreateICmpSLT(idx, cnt), body_block,
+                         exit_block);
+
+    // ret = row_fn(0, rows[idx], null, parameter, &outputs[idx])
+    builder.SetInsertPoint(body_block);
+    ::llvm::Value* row =
+        builder.CreateLoad(builder.CreateInBoundsGEP(i8_ptr_ty, rows, idx));
+    ::llvm::Value* output =
+        builder.CreateInBoundsGEP(i8_ptr_ty, outputs, idx);
+    ::llvm::Value* ret = builder.CreateCall(
+        row_fn, {builder.getInt64(0), row,
+                 ::llvm::ConstantPointerNull::get(
+                     ::llvm::cast<::llvm::PointerType>(i8_ptr_ty)),
+                 parameter, output});
+    builder.CreateCondBr(builder.CreateICmpEQ(ret, builder.getInt32(0)),
+                         step_block, fail_block);
+
+    // a failed row gets a null output like the per-row path, then go on
+    builder.SetInsertPoint(fail_block);
+    builder.CreateStore(::llvm::ConstantPointerNull::get(
+                            ::llvm::cast<::llvm::PointerType>(i8_ptr_ty)),
+                        output);
+    builder.CreateStore(
+        builder.CreateAdd(builder.CreateLoad(fail_cnt), builder.getInt32(1)),
+        fail_cnt);
+    builder.CreateBr(step_block);
+
+    builder.SetInsertPoint(step_block);
+    idx->addIncoming(builder.CreateAdd(idx, builder.getInt32(1)), step_block);
+    builder.CreateBr(cond_block);
+
+    builder.SetInsertPoint(exit_block);
+    builder.CreateRet(builder.CreateLoad(fail_cnt));
+    return Status::OK();
+}
+
 bool RowFnLetIRBuilder::EncodeBuf(
     const std::map<uint32_t, NativeValue>* values, const vm::Schema& schema,
     VariableIRBuilder& variable_ir_builder,  // NOLINT (runtime/references)
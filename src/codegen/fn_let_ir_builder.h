@@ -45,6 +45,14 @@ class RowFnLetIRBuilder {
                  const std::vector<const node::FrameNode*>& project_frames,
                  const vm::Schema& output_schema);
 
+    /// Build a batch entry `name` which applies row function `row_fn_name`
+    /// over an array of rows: `int32_t (int8_t** rows, int32_t cnt,
+    /// int8_t* parameter, int8_t** outputs)`. Rows are `&Row` pointers and
+    /// the i-th output buffer is written into `outputs[i]`, or null if the
+    /// row fails. Return the number of failed rows. Only valid for row
+    /// functions which do not touch any window.
+    Status BuildBatch(const std::string& name, const std::string& row_fn_name);
+
  private:
     bool BuildFnHeader(const std::string& name,
                        const std::vector<::llvm::Type*>& args_type,
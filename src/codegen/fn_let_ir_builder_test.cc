@@ -491,6 +491,67 @@ TEST_F(FnLetIRBuilderTest, test_simple_project_with_placeholder) {
     ASSERT_EQ(100u, *reinterpret_cast<uint32_t*>(output + 7+4));
     free(ptr);
 }
+
+// a row function which fails on null rows and outputs the row itself
+static void BuildFailOnNullRowFn(::llvm::Module* m, const std::string& name) {
+    ::llvm::LLVMContext& llvm_ctx = m->getContext();
+    ::llvm::Type* i8_ptr_ty = ::llvm::Type::getInt8PtrTy(llvm_ctx);
+    ::llvm::FunctionType* fn_ty = ::llvm::FunctionType::get(
+        ::llvm::Type::getInt32Ty(llvm_ctx),
+        {::llvm::Type::getInt64Ty(llvm_ctx), i8_ptr_ty, i8_ptr_ty, i8_ptr_ty,
+         i8_ptr_ty->getPointerTo()},
+        false);
+    ::llvm::Function* fn = ::llvm::Function::Create(
+        fn_ty, ::llvm::Function::ExternalLinkage, name, m);
+    auto arg_iter = fn->arg_begin();
+    arg_iter++;
+    ::llvm::Value* row = &*(arg_iter++);
+    arg_iter++;
+    arg_iter++;
+    ::llvm::Value* output = &*(arg_iter++);
+    auto entry_block = ::llvm::BasicBlock::Create(llvm_ctx, "entry", fn);
+    auto fail_block = ::llvm::BasicBlock::Create(llvm_ctx, "fail", fn);
+    auto ok_block = ::llvm::BasicBlock::Create(llvm_ctx, "ok", fn);
+    ::llvm::IRBuilder<> builder(entry_block);
+    builder.CreateCondBr(builder.CreateIsNull(row), fail_block, ok_block);
+    builder.SetInsertPoint(fail_block);
+    builder.CreateRet(builder.getInt32(1));
+    builder.SetInsertPoint(ok_block);
+    builder.CreateStore(row, output);
+    builder.CreateRet(builder.getInt32(0));
+}
+
+TEST_F(FnLetIRBuilderTest, test_batch_project_failed_row) {
+    auto ctx = llvm::make_unique<LLVMContext>();
+    auto m = make_unique<Module>("test_batch_project", *ctx);
+    BuildFailOnNullRowFn(m.get(), "test_row_fn");
+    vm::SchemasContext schemas_ctx;
+    codegen::CodeGenContext codegen_ctx(m.get(), &schemas_ctx, nullptr,
+                                        &manager);
+    codegen::RowFnLetIRBuilder builder(&codegen_ctx);
+    base::Status status = builder.BuildBatch("test_row_fn_batch", "test_row_fn");
+    ASSERT_TRUE(status.isOK()) << status;
+
+    auto jit = std::unique_ptr<vm::HybridSeJitWrapper>(
+        vm::HybridSeJitWrapper::Create());
+    jit->Init();
+    vm::HybridSeJitWrapper::InitJitSymbols(jit.get());
+    ASSERT_TRUE(jit->AddModule(std::move(m), std::move(ctx)));
+    auto batch_fn = reinterpret_cast<int32_t (*)(
+        const int8_t**, const int32_t, const int8_t*, int8_t**)>(
+        const_cast<int8_t*>(jit->FindFunction("test_row_fn_batch")));
+    ASSERT_TRUE(batch_fn != nullptr);
+
+    // the failed row gets a null output and the rest are still projected
+    int8_t row1 = 1;
+    int8_t row3 = 3;
+    const int8_t* rows[] = {&row1, nullptr, &row3};
+    int8_t* outputs[] = {nullptr, &row1, nullptr};
+    ASSERT_EQ(1, batch_fn(rows, 3, nullptr, outputs));
+    ASSERT_EQ(&row1, outputs[0]);
+    ASSERT_EQ(nullptr, outputs[1]);
+    ASSERT_EQ(&row3, outputs[2]);
+}
 }  // namespace codegen
 }  // namespace hybridse
 
@@ -24,12 +24,16 @@
 #include "codegen/list_ir_builder.h"
 #include "codegen/null_ir_builder.h"
 #include "codegen/timestamp_ir_builder.h"
+#include "gflags/gflags.h"
 #include "llvm/IR/Attributes.h"
 #include "node/node_manager.h"
 #include "node/sql_node.h"
 #include "udf/udf.h"
 #include "udf/udf_registry.h"
 
+DECLARE_bool(enable_window_column_agg);
+DECLARE_bool(enable_incremental_window_agg);
+
 using ::hybridse::common::kCodegenError;
 
 namespace hybridse {
@@ -501,10 +505,8 @@ Status UdfIRBuilder::BuildUdafCall(
     // udaf input elements type
     size_t input_num = fn->GetArgSize();
     std::vector<const node::TypeNode*> elem_types(input_num);
-    std::vector<int> elem_nullable(input_num);
     for (size_t i = 0; i < input_num; ++i) {
         elem_types[i] = fn->GetElementType(i);
-        elem_nullable[i] = fn->IsElementNullable(i);
     }
     Status status;
 
@@ -532,17 +534,6 @@ Status UdfIRBuilder::BuildUdafCall(
         list_ptrs.push_back(args[i].GetValue(ctx_));
     }
 
-    // iter head
-    ::llvm::BasicBlock* head_block = ctx_->GetCurrentBlock();
-    ListIRBuilder iter_head_builder(head_block, nullptr);
-    std::vector<::llvm::Value*> iterators;
-    for (size_t i = 0; i < input_num; ++i) {
-        ::llvm::Value* iter = nullptr;
-        CHECK_STATUS(iter_head_builder.BuildIterator(list_ptrs[i],
-                                                     elem_types[i], &iter));
-        iterators.push_back(iter);
-    }
-
     // build init state
     NativeValue init_value;
     CHECK_TRUE(fn->init_expr() != nullptr, kCodegenError);
@@ -580,6 +571,88 @@ Status UdfIRBuilder::BuildUdafCall(
         }
     }
 
+    // aggregate on columnar copy of window if possible, the list is
+    // iterated only if it is not a column of window
+    ::llvm::Value* done = nullptr;
+    if (FLAGS_enable_window_column_agg && input_num == 1) {
+        CHECK_STATUS(BuildWindowColumnAgg(fn, elem_types[0], list_ptrs[0],
+                                          states_storage, &done));
+    }
+
+    // otherwise apply rows entered and left since previous row on states
+    // kept in window, if the udaf can retract rows
+    if (done == nullptr && IsIncrementalWindowAgg(fn, state_llvm_tys)) {
+        CHECK_STATUS(BuildIncrementalWindowAgg(fn, state_llvm_tys,
+                                               list_ptrs[0], states_storage,
+                                               &done));
+    }
+
+    CHECK_STATUS(BuildUdafStepLoop(fn, fn->update_func(), list_ptrs,
+                                   states_storage, done));
+
+    builder.SetInsertPoint(ctx_->GetCurrentBlock());
+    std::vector<NativeValue> final_state_values;
+    for (size_t i = 0; i < state_num; ++i) {
+        if (TypeIRBuilder::IsStructPtr(states_storage[i]->getType())) {
+            final_state_values.push_back(
+                NativeValue::Create(states_storage[i]));
+        } else {
+            final_state_values.push_back(
+                NativeValue::Create(builder.CreateLoad(states_storage[i])));
+        }
+    }
+    NativeValue single_final_state;
+    if (state_num > 1) {
+        single_final_state = NativeValue::CreateTuple(final_state_values);
+    } else {
+        single_final_state = final_state_values[0];
+    }
+
+    UdfIRBuilder sub_udf_builder_exit(ctx_, frame_arg_, frame_);
+    NativeValue local_output;
+    CHECK_STATUS(
+        sub_udf_builder_exit.BuildCall(fn->output_func(), {state_type},
+                                       {single_final_state}, &local_output),
+        "Build output function call failed");
+    *output = local_output;
+    return Status::OK();
+}
+
+/**
+ * Iterate `list_ptrs` together and apply `step`, the update or retract
+ * function of `fn`, on states in `states_storage` with elements of lists.
+ * Stop once any list is exhausted or `done` is set.
+ */
+Status UdfIRBuilder::BuildUdafStepLoop(
+    const node::UdafDefNode* fn, const node::FnDefNode* step,
+    const std::vector<::llvm::Value*>& list_ptrs,
+    const std::vector<::llvm::Value*>& states_storage, ::llvm::Value* done) {
+    CHECK_TRUE(step != nullptr, kCodegenError);
+    const node::TypeNode* state_type = fn->GetStateType();
+    size_t state_num = states_storage.size();
+    size_t input_num = list_ptrs.size();
+    std::vector<const node::TypeNode*> elem_types(input_num);
+    std::vector<int> elem_nullable(input_num);
+    std::vector<const node::TypeNode*> step_arg_types = {state_type};
+    for (size_t i = 0; i < input_num; ++i) {
+        elem_types[i] = fn->GetElementType(i);
+        elem_nullable[i] = fn->IsElementNullable(i);
+        step_arg_types.push_back(elem_types[i]);
+    }
+    Status status;
+
+    // iter head
+    ::llvm::BasicBlock* head_block = ctx_->GetCurrentBlock();
+    ListIRBuilder iter_head_builder(head_block, nullptr);
+    std::vector<::llvm::Value*> iterators;
+    for (size_t i = 0; i < input_num; ++i) {
+        ::llvm::Value* iter = nullptr;
+        CHECK_STATUS(iter_head_builder.BuildIterator(list_ptrs[i],
+                                                     elem_types[i], &iter));
+        iterators.push_back(iter);
+    }
+
+    ::llvm::IRBuilder<> builder(head_block);
     CHECK_STATUS(ctx_->CreateWhile(
         [&](::llvm::Value** has_next) {
             // enter
@@ -597,6 +670,10 @@ Status UdfIRBuilder::BuildUdafCall(
                     *has_next = builder.CreateAnd(cur_has_next, *has_next);
                 }
             }
+            if (done != nullptr) {
+                *has_next =
+                    builder.CreateAnd(builder.CreateNot(done), *has_next);
+            }
             return Status::OK();
         },
         [&]() {
@@ -606,7 +683,7 @@ Status UdfIRBuilder::BuildUdafCall(
             UdfIRBuilder sub_udf_builder(ctx_, frame_arg_, frame_);
 
             std::vector<NativeValue> cur_state_values;
-            std::vector<NativeValue> update_args;
+            std::vector<NativeValue> step_args;
             for (size_t i = 0; i < state_num; ++i) {
                 if (TypeIRBuilder::IsStructPtr(states_storage[i]->getType())) {
                     cur_state_values.push_back(
@@ -618,83 +695,321 @@ Status UdfIRBuilder::BuildUdafCall(
                 }
             }
             if (state_num > 1) {
-                update_args.push_back(
-                    NativeValue::CreateTuple(cur_state_values));
+                step_args.push_back(NativeValue::CreateTuple(cur_state_values));
             } else {
-                update_args.push_back(cur_state_values[0]);
+                step_args.push_back(cur_state_values[0]);
             }
             for (size_t i = 0; i < input_num; ++i) {
                 NativeValue next_val;
                 CHECK_STATUS(iter_next_builder.BuildIteratorNext(
                     iterators[i], elem_types[i], elem_nullable[i], &next_val));
-                update_args.push_back(next_val);
+                step_args.push_back(next_val);
             }
 
-            NativeValue update_value;
-            std::vector<const node::TypeNode*> update_arg_types;
-            update_arg_types.push_back(state_type);
-            for (size_t i = 0; i < input_num; ++i) {
-                update_arg_types.push_back(elem_types[i]);
-            }
-            CHECK_TRUE(fn->update_func() != nullptr, kCodegenError);
-            CHECK_STATUS(sub_udf_builder.BuildCall(fn->update_func(),
-                                                   update_arg_types,
-                                                   update_args, &update_value));
+            NativeValue step_value;
+            CHECK_STATUS(sub_udf_builder.BuildCall(step, step_arg_types,
+                                                   step_args, &step_value));
 
             builder.SetInsertPoint(ctx_->GetCurrentBlock());
-            if (update_value.IsTuple()) {
-                CHECK_TRUE(update_value.GetFieldNum() == state_num,
+            if (step_value.IsTuple()) {
+                CHECK_TRUE(step_value.GetFieldNum() == state_num,
                            kCodegenError);
                 for (size_t i = 0; i < state_num; ++i) {
-                    NativeValue sub = update_value.GetField(i);
-                    ::llvm::Value* raw_update = sub.GetValue(ctx_);
-                    if (TypeIRBuilder::IsStructPtr(raw_update->getType())) {
-                        raw_update = builder.CreateLoad(raw_update);
+                    NativeValue sub = step_value.GetField(i);
+                    ::llvm::Value* raw_step = sub.GetValue(ctx_);
+                    if (TypeIRBuilder::IsStructPtr(raw_step->getType())) {
+                        raw_step = builder.CreateLoad(raw_step);
                     }
-                    builder.CreateStore(raw_update, states_storage[i]);
+                    builder.CreateStore(raw_step, states_storage[i]);
                 }
             } else {
-                ::llvm::Value* raw_update = update_value.GetValue(ctx_);
-                if (TypeIRBuilder::IsStructPtr(raw_update->getType())) {
-                    raw_update = builder.CreateLoad(raw_update);
+                ::llvm::Value* raw_step = step_value.GetValue(ctx_);
+                if (TypeIRBuilder::IsStructPtr(raw_step->getType())) {
+                    raw_step = builder.CreateLoad(raw_step);
                 }
-                builder.CreateStore(raw_update, states_storage[0]);
+                builder.CreateStore(raw_step, states_storage[0]);
             }
             return Status::OK();
         }));
 
-    builder.SetInsertPoint(ctx_->GetCurrentBlock());
-    std::vector<NativeValue> final_state_values;
-    for (size_t i = 0; i < state_num; ++i) {
-        if (TypeIRBuilder::IsStructPtr(states_storage[i]->getType())) {
-            final_state_values.push_back(
-                NativeValue::Create(states_storage[i]));
-        } else {
-            final_state_values.push_back(
-                NativeValue::Create(builder.CreateLoad(states_storage[i])));
-        }
-    }
-    NativeValue single_final_state;
-    if (state_num > 1) {
-        single_final_state = NativeValue::CreateTuple(final_state_values);
-    } else {
-        single_final_state = final_state_values[0];
-    }
-
-    UdfIRBuilder sub_udf_builder_exit(ctx_, frame_arg_, frame_);
-    NativeValue local_output;
-    CHECK_STATUS(
-        sub_udf_builder_exit.BuildCall(fn->output_func(), {state_type},
-                                       {single_final_state}, &local_output),
-        "Build output function call failed");
-
     ListIRBuilder iter_delete_builder(ctx_->GetCurrentBlock(), nullptr);
     for (size_t i = 0; i < input_num; ++i) {
         ::llvm::Value* delete_iter_res;
         CHECK_STATUS(iter_delete_builder.BuildIteratorDelete(
             iterators[i], elem_types[i], &delete_iter_res));
     }
-    *output = local_output;
+    return Status::OK();
+}
+
+/**
+ * Whether states of `fn` can be kept in window across rows. The udaf has to
+ * iterate rows of window only and be able to retract rows leaving window.
+ * States are either plain values, or a single opaque state created in place
+ * by an external init function, which is copied out by merge for output and
+ * dropped by output.
+ */
+bool UdfIRBuilder::IsIncrementalWindowAgg(
+    const node::UdafDefNode* fn,
+    const std::vector<::llvm::Type*>& state_llvm_tys) {
+    if (!FLAGS_enable_incremental_window_agg || !fn->AllowRetract() ||
+        fn->GetArgSize() != 1 || fn->GetElementType(0) == nullptr ||
+        fn->GetElementType(0)->base() != node::kRow) {
+        return false;
+    }
+    if (fn->GetStateType()->base() != node::kOpaque) {
+        for (auto ty : state_llvm_tys) {
+            if (!ty->isIntegerTy() && !ty->isFloatingPointTy()) {
+                return false;
+            }
+        }
+        return true;
+    }
+    auto init_call = dynamic_cast<const node::CallExprNode*>(fn->init_expr());
+    if (init_call == nullptr || init_call->GetChildNum() != 0 ||
+        fn->merge_func() == nullptr) {
+        return false;
+    }
+    auto init_fn =
+        dynamic_cast<const node::ExternalFnDefNode*>(init_call->GetFnDef());
+    auto output_fn =
+        dynamic_cast<const node::ExternalFnDefNode*>(fn->output_func());
+    return init_fn != nullptr && init_fn->return_by_arg() &&
+           output_fn != nullptr && !output_fn->IsArgNullable(0);
+}
+
+Status UdfIRBuilder::BuildIncrementalWindowAgg(
+    const node::UdafDefNode* fn,
+    const std::vector<::llvm::Type*>& state_llvm_tys, ::llvm::Value* list_ptr,
+    const std::vector<::llvm::Value*>& states_storage, ::llvm::Value** done) {
+    auto module = ctx_->GetModule();
+    ::llvm::IRBuilder<> builder(ctx_->GetCurrentBlock());
+    auto ptr_ty = builder.getInt8PtrTy();
+    const node::TypeNode* state_type = fn->GetStateType();
+    size_t state_num = states_storage.size();
+    bool is_opaque = state_type->base() == node::kOpaque;
+
+    // states are laid in 8 bytes aligned slots of state buffer
+    std::vector<uint64_t> offsets;
+    uint64_t buf_size = 0;
+    for (size_t i = 0; i < state_num; ++i) {
+        uint64_t bytes = 8;
+        if (is_opaque) {
+            auto opaque_type =
+                dynamic_cast<const node::OpaqueTypeNode*>(state_type);
+            CHECK_TRUE(opaque_type != nullptr, kCodegenError);
+            bytes = opaque_type->bytes();
+        }
+        offsets.push_back(buf_size);
+        buf_size += (bytes + 7) / 8 * 8;
+    }
+
+    // opaque state is created in place by init, and released by output whose
+    // result is dropped
+    ::llvm::FunctionCallee init_callee;
+    ::llvm::Value* release = ::llvm::ConstantPointerNull::get(ptr_ty);
+    if (is_opaque) {
+        auto init_fn = dynamic_cast<const node::ExternalFnDefNode*>(
+            dynamic_cast<const node::CallExprNode*>(fn->init_expr())
+                ->GetFnDef());
+        ::llvm::FunctionType* init_ty = nullptr;
+        CHECK_STATUS(GetLlvmFunctionType(init_fn, &init_ty));
+        CHECK_TRUE(init_ty->getNumParams() == 1 &&
+                       init_ty->getParamType(0) == ptr_ty,
+                   kCodegenError, "Illegal opaque init function ",
+                   init_fn->function_name());
+        init_callee =
+            module->getOrInsertFunction(init_fn->function_name(), init_ty);
+
+        auto output_fn =
+            dynamic_cast<const node::ExternalFnDefNode*>(fn->output_func());
+        ::llvm::FunctionType* output_ty = nullptr;
+        CHECK_STATUS(GetLlvmFunctionType(output_fn, &output_ty));
+        CHECK_TRUE(output_ty->getNumParams() >= 1 &&
+                       output_ty->getParamType(0) == ptr_ty,
+                   kCodegenError, "Illegal opaque output function ",
+                   output_fn->function_name());
+        auto output_callee =
+            module->getOrInsertFunction(output_fn->function_name(), output_ty);
+        auto release_fn = ::llvm::Function::Create(
+            ::llvm::FunctionType::get(builder.getVoidTy(), {ptr_ty}, false),
+            ::llvm::Function::InternalLinkage, "window_agg_state_release",
+            module);
+        ::llvm::IRBuilder<> release_builder(::llvm::BasicBlock::Create(
+            module->getContext(), "entry", release_fn));
+        std::vector<::llvm::Value*> output_args = {release_fn->arg_begin()};
+        for (size_t i = 1; i < output_ty->getNumParams(); ++i) {
+            output_args.push_back(release_builder.CreateAlloca(
+                output_ty->getParamType(i)->getPointerElementType()));
+        }
+        release_builder.CreateCall(output_callee, output_args);
+        release_builder.CreateRetVoid();
+        release = builder.CreatePointerCast(release_fn, ptr_ty);
+    }
+
+    // states are identified by the call site
+    auto key = new ::llvm::GlobalVariable(
+        *module, builder.getInt8Ty(), false,
+        ::llvm::GlobalValue::PrivateLinkage, builder.getInt8(0),
+        "window_agg_state_key");
+    ::llvm::Value* is_delta_ptr =
+        CreateAllocaAtHead(&builder, builder.getInt8Ty(), "is_delta");
+    auto get_state_func = module->getOrInsertFunction(
+        "hybridse_storage_get_window_agg_state",
+        ::llvm::FunctionType::get(
+            ptr_ty, {ptr_ty, ptr_ty, builder.getInt32Ty(), ptr_ty, ptr_ty},
+            false));
+    ::llvm::Value* buf = builder.CreateCall(
+        get_state_func,
+        {builder.CreatePointerCast(list_ptr, ptr_ty), key,
+         builder.getInt32(static_cast<uint32_t>(buf_size)), is_delta_ptr,
+         release});
+    ::llvm::Value* is_delta = builder.CreateICmpNE(
+        builder.CreateLoad(is_delta_ptr), builder.getInt8(0));
+
+    // list is not a window if it provides no state buffer
+    *done = builder.CreateIsNotNull(buf);
+
+    std::vector<::llvm::Value*> kept_states(state_num, nullptr);
+    if (is_opaque) {
+        kept_states[0] =
+            CreateAllocaAtHead(&builder, ptr_ty, "kept_state_alloca");
+    }
+    return ctx_->CreateBranch(*done, [&]() {
+        auto ir = ctx_->GetBuilder();
+        for (size_t i = 0; i < state_num; ++i) {
+            ::llvm::Value* slot = ir->CreateGEP(buf, ir->getInt64(offsets[i]));
+            if (is_opaque) {
+                ir->CreateStore(slot, kept_states[i]);
+            } else {
+                kept_states[i] = ir->CreatePointerCast(
+                    slot, state_llvm_tys[i]->getPointerTo());
+            }
+        }
+        CHECK_STATUS(ctx_->CreateBranch(
+            is_delta,
+            [&]() {
+                // retract rows left and update rows entered since states
+                // were computed for previous row
+                ::llvm::Value* popped = nullptr;
+                CHECK_STATUS(BuildWindowDeltaList(list_ptr, true, &popped));
+                CHECK_STATUS(BuildUdafStepLoop(fn, fn->retract_func(),
+                                               {popped}, kept_states, nullptr));
+                ::llvm::Value* added = nullptr;
+                CHECK_STATUS(BuildWindowDeltaList(list_ptr, false, &added));
+                CHECK_STATUS(BuildUdafStepLoop(fn, fn->update_func(), {added},
+                                               kept_states, nullptr));
+                return Status::OK();
+            },
+            [&]() {
+                // recompute states from the whole window, local states
+                // still hold init values
+                auto init_ir = ctx_->GetBuilder();
+                for (size_t i = 0; i < state_num; ++i) {
+                    if (is_opaque) {
+                        init_ir->CreateCall(
+                            init_callee, {init_ir->CreateLoad(kept_states[i])});
+                    } else {
+                        init_ir->CreateStore(
+                            init_ir->CreateLoad(states_storage[i]),
+                            kept_states[i]);
+                    }
+                }
+                return BuildUdafStepLoop(fn, fn->update_func(), {list_ptr},
+                                         kept_states, nullptr);
+            }));
+
+        // output from local copy of states, since output may consume states
+        ir = ctx_->GetBuilder();
+        if (is_opaque) {
+            UdfIRBuilder merge_builder(ctx_, frame_arg_, frame_);
+            NativeValue merged;
+            CHECK_STATUS(merge_builder.BuildCall(
+                fn->merge_func(), {state_type, state_type},
+                {NativeValue::Create(ir->CreateLoad(states_storage[0])),
+                 NativeValue::Create(ir->CreateLoad(kept_states[0]))},
+                &merged));
+            ir = ctx_->GetBuilder();
+            ir->CreateStore(merged.GetValue(ir), states_storage[0]);
+        } else {
+            for (size_t i = 0; i < state_num; ++i) {
+                ir->CreateStore(ir->CreateLoad(kept_states[i]),
+                                states_storage[i]);
+            }
+        }
+        return Status::OK();
+    });
+}
+
+Status UdfIRBuilder::BuildWindowDeltaList(::llvm::Value* list_ptr,
+                                          bool is_retract,
+                                          ::llvm::Value** output) {
+    auto builder = ctx_->GetBuilder();
+    auto ptr_ty = builder->getInt8PtrTy();
+    ::llvm::Value* delta_list = CreateAllocaAtHead(
+        builder, list_ptr->getType()->getPointerElementType(),
+        is_retract ? "window_popped_list" : "window_added_list");
+    auto get_delta_list_func = ctx_->GetModule()->getOrInsertFunction(
+        "hybridse_storage_get_window_delta_list", builder->getVoidTy(), ptr_ty,
+        builder->getInt1Ty(), ptr_ty);
+    builder->CreateCall(get_delta_list_func,
+                        {builder->CreatePointerCast(list_ptr, ptr_ty),
+                         builder->getInt1(is_retract),
+                         builder->CreatePointerCast(delta_list, ptr_ty)});
+    *output = delta_list;
+    return Status::OK();
+}
+
+Status UdfIRBuilder::BuildWindowColumnAgg(
+    const node::UdafDefNode* fn, const node::TypeNode* elem_type,
+    ::llvm::Value* list_ptr, const std::vector<::llvm::Value*>& states_storage,
+    ::llvm::Value** done) {
+    *done = nullptr;
+    std::string type_name;
+    switch (elem_type->base()) {
+        case node::kInt16:
+            type_name = "int16";
+            break;
+        case node::kInt32:
+            type_name = "int32";
+            break;
+        case node::kInt64:
+            type_name = "int64";
+            break;
+        case node::kFloat:
+            type_name = "float";
+            break;
+        case node::kDouble:
+            type_name = "double";
+            break;
+        default:
+            return Status::OK();
+    }
+    // state of min/max is (is_empty, value), state of avg is (cnt, sum)
+    const std::string& name = fn->GetName();
+    size_t state_num = 0;
+    if (name == "sum" || name == "count") {
+        state_num = 1;
+    } else if (name == "min" || name == "max" || name == "avg") {
+        state_num = 2;
+    }
+    if (state_num == 0 || states_storage.size() != state_num) {
+        return Status::OK();
+    }
+
+    ::llvm::IRBuilder<> builder(ctx_->GetCurrentBlock());
+    std::vector<::llvm::Type*> arg_types = {builder.getInt8PtrTy()};
+    std::vector<::llvm::Value*> args = {
+        builder.CreatePointerCast(list_ptr, builder.getInt8PtrTy())};
+    for (auto state : states_storage) {
+        arg_types.push_back(state->getType());
+        args.push_back(state);
+    }
+    auto func_ty =
+        ::llvm::FunctionType::get(builder.getInt32Ty(), arg_types, false);
+    auto callee = ctx_->GetModule()->getOrInsertFunction(
+        "hybridse_storage_window_column_" + name + "_" + type_name, func_ty);
+    ::llvm::Value* ret = builder.CreateCall(callee, args);
+    *done = builder.CreateICmpEQ(ret, builder.getInt32(0));
     return Status::OK();
 }
 
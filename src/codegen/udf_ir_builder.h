@@ -100,6 +100,32 @@ class UdfIRBuilder {
     Status GetLlvmFunctionType(const node::FnDefNode* fn,
                                ::llvm::FunctionType** func_ty);
 
+    Status BuildWindowColumnAgg(
+        const node::UdafDefNode* fn, const node::TypeNode* elem_type,
+        ::llvm::Value* list_ptr,
+        const std::vector<::llvm::Value*>& states_storage,
+        ::llvm::Value** done);
+
+    bool IsIncrementalWindowAgg(
+        const node::UdafDefNode* fn,
+        const std::vector<::llvm::Type*>& state_llvm_tys);
+
+    Status BuildIncrementalWindowAgg(
+        const node::UdafDefNode* fn,
+        const std::vector<::llvm::Type*>& state_llvm_tys,
+        ::llvm::Value* list_ptr,
+        const std::vector<::llvm::Value*>& states_storage,
+        ::llvm::Value** done);
+
+    Status BuildWindowDeltaList(::llvm::Value* list_ptr, bool is_retract,
+                                ::llvm::Value** output);
+
+    Status BuildUdafStepLoop(const node::UdafDefNode* fn,
+                             const node::FnDefNode* step,
+                             const std::vector<::llvm::Value*>& list_ptrs,
+                             const std::vector<::llvm::Value*>& states_storage,
+                             ::llvm::Value* done);
+
     CodeGenContext* ctx_;
     node::ExprNode* frame_arg_;
     const node::FrameNode* frame_;
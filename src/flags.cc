@@ -22,3 +22,23 @@ DEFINE_string(default_db_name, "_hybridse",
 // Offline Spark config
 DEFINE_bool(enable_spark_unsaferow_format, false,
             "config if codec uses Spark UnsafeRow format");
+
+// Jit runtime config
+DEFINE_bool(enable_jit_runtime_arena, true,
+            "config if jit runtime retains memory chunks between run steps");
+DEFINE_int32(jit_runtime_arena_idle_threshold, 1000,
+             "config how many run steps in a row may leave retained chunks "
+             "unused before the jit runtime releases them, 0 never releases");
+
+// Window aggregation config
+DEFINE_bool(enable_incremental_window_agg, true,
+            "config if window sum/count/avg/min/max keep running states and "
+            "only apply rows entered and popped since the previous row");
+DEFINE_bool(enable_window_column_agg, false,
+            "config if window sum/count/avg/min/max over a column keep "
+            "columnar copies of the column and run simd kernels on them");
+
+// Batch request subquery config
+DEFINE_int32(scatter_gather_io_worker_num, 64,
+             "config how many threads wait on tablet subqueries of "
+             "parallel scatter gather results, shared in process");
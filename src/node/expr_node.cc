@@ -833,8 +833,10 @@ UdfByCodeGenDefNode* UdfByCodeGenDefNode::DeepCopy(NodeManager* nm) const {
 }
 
 UdafDefNode* UdafDefNode::ShadowCopy(NodeManager* nm) const {
-    return nm->MakeUdafDefNode(name_, arg_types_, init_expr_, update_, merge_,
-                               output_);
+    auto udaf = nm->MakeUdafDefNode(name_, arg_types_, init_expr_, update_,
+                                    merge_, output_);
+    udaf->SetRetractFunc(retract_);
+    return udaf;
 }
 
 UdafDefNode* UdafDefNode::DeepCopy(NodeManager* nm) const {
@@ -842,8 +844,11 @@ UdafDefNode* UdafDefNode::DeepCopy(NodeManager* nm) const {
     FnDefNode* new_update = update_ ? update_->DeepCopy(nm) : nullptr;
     FnDefNode* new_merge = merge_ ? merge_->DeepCopy(nm) : nullptr;
     FnDefNode* new_output = output_ ? output_->DeepCopy(nm) : nullptr;
-    return nm->MakeUdafDefNode(name_, arg_types_, new_init, new_update,
-                               new_merge, new_output);
+    FnDefNode* new_retract = retract_ ? retract_->DeepCopy(nm) : nullptr;
+    auto udaf = nm->MakeUdafDefNode(name_, arg_types_, new_init, new_update,
+                                    new_merge, new_output);
+    udaf->SetRetractFunc(new_retract);
+    return udaf;
 }
 
 // Default expr deep copy: shadow copy self and deep copy children
@@ -107,6 +107,53 @@ Status ApplyArgs(node::FnDefNode* func, const std::vector<ExprNode*>& args,
     return Status::OK();
 }
 
+/**
+ * Build merged update (or retract) function, which applies each of
+ * `sub_funcs` on its own part of merged state.
+ */
+Status BuildMergedStepFunc(
+    const std::vector<node::FnDefNode*>& sub_funcs,
+    const std::vector<ExprIdNode*>& new_args,
+    const std::vector<std::pair<size_t, size_t>>& state_range,
+    const std::vector<std::vector<size_t>>& arg_mappings,
+    node::NodeManager* nm, node::LambdaNode** output) {
+    ExprIdNode* new_state = new_args[0];
+    std::vector<ExprNode*> sub_results;
+    for (size_t i = 0; i < sub_funcs.size(); ++i) {
+        std::vector<ExprNode*> sub_args;
+        size_t state_begin_idx = state_range[i].first;
+        size_t state_end_idx = state_range[i].second;
+        bool is_tuple = state_end_idx - state_begin_idx > 1;
+        if (is_tuple) {
+            std::vector<ExprNode*> tuple;
+            for (size_t j = state_begin_idx; j < state_end_idx; ++j) {
+                tuple.push_back(nm->MakeGetFieldExpr(new_state, j));
+            }
+            sub_args.push_back(nm->MakeFuncNode("make_tuple", tuple, nullptr));
+        } else {
+            sub_args.push_back(
+                nm->MakeGetFieldExpr(new_state, state_begin_idx));
+        }
+        auto sub_func = sub_funcs[i];
+        for (size_t j = 1; j < sub_func->GetArgSize(); ++j) {
+            sub_args.push_back(new_args[arg_mappings[i][j - 1]]);
+        }
+        ExprNode* sub_call = nullptr;
+        CHECK_STATUS(ApplyArgs(sub_func, sub_args, nm, &sub_call));
+        if (is_tuple) {
+            for (size_t j = state_begin_idx; j < state_end_idx; ++j) {
+                sub_results.push_back(
+                    nm->MakeGetFieldExpr(sub_call, j - state_begin_idx));
+            }
+        } else {
+            sub_results.push_back(sub_call);
+        }
+    }
+    auto results = nm->MakeFuncNode("make_tuple", sub_results, nullptr);
+    *output = nm->MakeLambdaNode(new_args, results);
+    return Status::OK();
+}
+
 Status MergeUdafCalls(const std::vector<ExprNode*>& calls, ExprIdNode* window,
                       node::NodeManager* nm, ExprNode** output) {
     std::vector<node::UdafDefNode*> udafs;
@@ -178,42 +225,25 @@ Status MergeUdafCalls(const std::vector<ExprNode*>& calls, ExprIdNode* window,
         }
     }
 
-    // build update function
-    std::vector<ExprNode*> sub_update_results;
-    for (size_t i = 0; i < udafs.size(); ++i) {
-        std::vector<ExprNode*> sub_update_args;
-        size_t state_begin_idx = state_range[i].first;
-        size_t state_end_idx = state_range[i].second;
-        bool is_tuple = state_end_idx - state_begin_idx > 1;
-        if (is_tuple) {
-            std::vector<ExprNode*> tuple;
-            for (size_t j = state_begin_idx; j < state_end_idx; ++j) {
-                tuple.push_back(nm->MakeGetFieldExpr(new_state, j));
-            }
-            sub_update_args.push_back(
-                nm->MakeFuncNode("make_tuple", tuple, nullptr));
-        } else {
-            sub_update_args.push_back(
-                nm->MakeGetFieldExpr(new_state, state_begin_idx));
-        }
-        auto update_func = udafs[i]->update_func();
-        for (size_t j = 1; j < update_func->GetArgSize(); ++j) {
-            sub_update_args.push_back(new_update_args[arg_mappings[i][j - 1]]);
-        }
-        ExprNode* sub_call = nullptr;
-        CHECK_STATUS(ApplyArgs(update_func, sub_update_args, nm, &sub_call));
-        if (is_tuple) {
-            for (size_t j = state_begin_idx; j < state_end_idx; ++j) {
-                sub_update_results.push_back(
-                    nm->MakeGetFieldExpr(sub_call, j - state_begin_idx));
-            }
-        } else {
-            sub_update_results.push_back(sub_call);
+    // build update function, and retract function if all udafs can retract
+    std::vector<node::FnDefNode*> update_funcs;
+    std::vector<node::FnDefNode*> retract_funcs;
+    for (auto udaf : udafs) {
+        update_funcs.push_back(udaf->update_func());
+        if (udaf->retract_func() != nullptr) {
+            retract_funcs.push_back(udaf->retract_func());
         }
     }
-    auto update_results =
-        nm->MakeFuncNode("make_tuple", sub_update_results, nullptr);
-    auto new_update_func = nm->MakeLambdaNode(new_update_args, update_results);
+    node::LambdaNode* new_update_func = nullptr;
+    CHECK_STATUS(BuildMergedStepFunc(update_funcs, new_update_args,
+                                     state_range, arg_mappings, nm,
+                                     &new_update_func));
+    node::LambdaNode* new_retract_func = nullptr;
+    if (retract_funcs.size() == udafs.size()) {
+        CHECK_STATUS(BuildMergedStepFunc(retract_funcs, new_update_args,
+                                         state_range, arg_mappings, nm,
+                                         &new_retract_func));
+    }
 
     // build output function
     ExprIdNode* final_new_state = nm->MakeExprIdNode("merged_state");
@@ -285,6 +315,7 @@ Status MergeUdafCalls(const std::vector<ExprNode*>& calls, ExprIdNode* window,
     auto new_udaf =
         nm->MakeUdafDefNode("merged_window_agg", call_arg_types, new_init_expr,
                             new_update_func, nullptr, new_output_func);
+    new_udaf->SetRetractFunc(new_retract_func);
     *output = nm->MakeFuncNode(new_udaf, call_args, nullptr);
     return Status::OK();
 }
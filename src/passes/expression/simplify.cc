@@ -183,24 +183,33 @@ Status ExprInplaceTransformUp::VisitUdaf(
     }
 
     // update
+    std::vector<ExprAttrNode> update_args;
+    update_args.push_back(ExprAttrNode(udaf->GetStateType(), false));
+    for (auto& arg : arg_attrs) {
+        const node::TypeNode* dtype = arg.type();
+        if (dtype != nullptr && dtype->generics_.size() == 1) {
+            // list<T>
+            dtype = dtype->generics_[0];
+        }
+        update_args.push_back(ExprAttrNode(dtype, false));
+    }
     node::FnDefNode* update = udaf->update_func();
     if (update != nullptr) {
-        std::vector<ExprAttrNode> update_args;
-        update_args.push_back(ExprAttrNode(udaf->GetStateType(), false));
-        for (auto& arg : arg_attrs) {
-            const node::TypeNode* dtype = arg.type();
-            if (dtype != nullptr && dtype->generics_.size() == 1) {
-                // list<T>
-                dtype = dtype->generics_[0];
-            }
-            update_args.push_back(ExprAttrNode(dtype, false));
-        }
         CHECK_STATUS(VisitFnDef(udaf->update_func(), update_args, &update));
         if (update != udaf->update_func()) {
             changed = true;
         }
     }
 
+    // retract
+    node::FnDefNode* retract = udaf->retract_func();
+    if (retract != nullptr) {
+        CHECK_STATUS(VisitFnDef(udaf->retract_func(), update_args, &retract));
+        if (retract != udaf->retract_func()) {
+            changed = true;
+        }
+    }
+
     // merge
     node::FnDefNode* merge = udaf->merge_func();
     if (merge != nullptr) {
@@ -225,9 +234,11 @@ Status ExprInplaceTransformUp::VisitUdaf(
     }
 
     if (changed) {
-        *out = ctx_->node_manager()->MakeUdafDefNode(
+        auto new_udaf = ctx_->node_manager()->MakeUdafDefNode(
             udaf->GetName(), udaf->GetArgTypeList(), init, update, merge,
             output_fn);
+        new_udaf->SetRetractFunc(retract);
+        *out = new_udaf;
     } else {
         *out = udaf;
     }
@@ -15,8 +15,11 @@
  */
 
 #include "passes/lambdafy_projects.h"
+#include "gflags/gflags.h"
 #include "passes/resolve_fn_and_attrs.h"
 
+DECLARE_bool(enable_window_column_agg);
+
 namespace hybridse {
 namespace passes {
 
@@ -218,6 +221,15 @@ Status LambdafyProjects::VisitAggExpr(node::CallExprNode* call,
     auto fn = dynamic_cast<const node::ExternalFnDefNode*>(call->GetFnDef());
     CHECK_TRUE(fn != nullptr, kCodegenError, "Fail to visit agg expression with null function definition node");
 
+    // aggregation on a column keeps the column as list input, which may run
+    // on columnar copy of window instead of iterating rows
+    if (legacy_agg_opt_ && FLAGS_enable_window_column_agg &&
+        FallBackToLegacyAgg(call)) {
+        *out = call;
+        *is_window_agg = true;
+        return Status::OK();
+    }
+
     // represent row argument in window iteration
     node::ExprIdNode* iter_row = nullptr;
 
@@ -339,12 +351,17 @@ Status LambdafyProjects::VisitAggExpr(node::CallExprNode* call,
         proxy_udaf_arg_types.push_back(window_arg->GetOutputType());
     }
 
+    // rows can be retracted from state only if the update depends on
+    // nothing but the row and constants
+    bool allow_retract = has_window_iter;
+
     // fill other update arguments
     for (size_t i = 0; i < agg_arg_num; ++i) {
         if (args_require_window_iter[i]) {
             // use transformed child (produced by new row arg)
             actual_update_args.push_back(transformed_child[i]);
         } else if (args_require_iter[i]) {
+            allow_retract = false;
             // use proxy lambda argument
             auto arg = nm->MakeExprIdNode("iter_arg_" + std::to_string(i));
             auto child_type = transformed_child[i]->GetOutputType();
@@ -360,6 +377,9 @@ Status LambdafyProjects::VisitAggExpr(node::CallExprNode* call,
         } else {
             // non-iter argument
             actual_update_args.push_back(transformed_child[i]);
+            if (transformed_child[i]->GetExprType() != node::kExprPrimary) {
+                allow_retract = false;
+            }
         }
     }
 
@@ -368,6 +388,15 @@ Status LambdafyProjects::VisitAggExpr(node::CallExprNode* call,
         nm->MakeFuncNode(ori_update_fn, actual_update_args, nullptr);
     auto update_func = nm->MakeLambdaNode(proxy_update_args, update_body);
 
+    // wrap actual retract call the same way
+    auto ori_retract_fn = origin_udaf->retract_func();
+    node::LambdaNode* retract_func = nullptr;
+    if (allow_retract && ori_retract_fn != nullptr) {
+        auto retract_body =
+            nm->MakeFuncNode(ori_retract_fn, actual_update_args, nullptr);
+        retract_func = nm->MakeLambdaNode(proxy_update_args, retract_body);
+    }
+
     std::string new_udaf_name = "window_agg_$";
     new_udaf_name.append(fn->function_name());
     new_udaf_name.append("<");
@@ -382,6 +411,7 @@ Status LambdafyProjects::VisitAggExpr(node::CallExprNode* call,
     auto new_udaf =
         nm->MakeUdafDefNode(new_udaf_name, proxy_udaf_arg_types, ori_init,
                             update_func, ori_merge_fn, ori_output_fn);
+    new_udaf->SetRetractFunc(retract_func);
     *out = nm->MakeFuncNode(new_udaf, proxy_udaf_args, nullptr);
     return Status::OK();
 }
@@ -183,9 +183,20 @@ Status ResolveFnAndAttrs::VisitUdafDef(
             "Resolve output function of ", lambda->GetName(), " failed");
     }
 
+    // visit retract
+    node::FnDefNode* resolved_retract = nullptr;
+    if (lambda->retract_func() != nullptr) {
+        update_arg_types[0] = state_type;
+        CHECK_STATUS(VisitFnDef(lambda->retract_func(), update_arg_types,
+                                &resolved_retract),
+                     "Resolve retract function of ", lambda->GetName(),
+                     " failed");
+    }
+
     *output = ctx_->node_manager()->MakeUdafDefNode(
         lambda->GetName(), arg_types, resolved_init, resolved_update,
         resolved_merge, resolved_output);
+    (*output)->SetRetractFunc(resolved_retract);
     CHECK_STATUS((*output)->Validate(arg_types), "Illegal resolved udaf: \n",
                  (*output)->GetTreeString());
     return Status::OK();
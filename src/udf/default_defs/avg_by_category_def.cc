@@ -16,6 +16,7 @@
 
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -52,14 +53,23 @@ struct AvgCateDef {
             std::string suffix = ".opaque_dict_" +
                                  DataTypeTrait<K>::to_string() + "_" +
                                  DataTypeTrait<V>::to_string();
-            helper
-                .templates<StringRef, Opaque<ContainerT>, Nullable<V>,
-                           Nullable<K>>()
-                .init("avg_cate_init" + suffix, ContainerT::Init)
+            auto udaf = helper.templates<StringRef, Opaque<ContainerT>,
+                                         Nullable<V>, Nullable<K>>();
+            udaf.init("avg_cate_init" + suffix, ContainerT::Init)
                 .update("avg_cate_update" + suffix, Update)
                 .output("avg_cate_output" + suffix, Output);
+            if (kRetractable) {
+                udaf.retract("avg_cate_retract" + suffix, Retract)
+                    .merge("avg_cate_merge" + suffix,
+                           reinterpret_cast<void*>(Merge));
+            }
         }
 
+        // state kept across rows of window can not refer to string keys of
+        // rows already left the window, and floating sums drift on retract
+        static constexpr bool kRetractable =
+            !std::is_same<K, StringRef>::value && std::is_integral<V>::value;
+
         static ContainerT* Update(ContainerT* ptr, InputV value,
                                   bool is_value_null, InputK key,
                                   bool is_key_null) {
@@ -80,6 +90,37 @@ struct AvgCateDef {
             return ptr;
         }
 
+        static ContainerT* Retract(ContainerT* ptr, InputV value,
+                                   bool is_value_null, InputK key,
+                                   bool is_key_null) {
+            if (is_key_null || is_value_null) {
+                return ptr;
+            }
+            auto& map = ptr->map();
+            auto iter = map.find(ContainerT::to_stored_key(key));
+            if (iter == map.end()) {
+                return ptr;
+            }
+            auto& pair = iter->second;
+            pair.first -= 1;
+            if (pair.first <= 0) {
+                map.erase(iter);
+            } else {
+                pair.second -= ContainerT::to_stored_value(value);
+            }
+            return ptr;
+        }
+
+        static ContainerT* Merge(ContainerT* ptr, ContainerT* other) {
+            auto& map = ptr->map();
+            for (auto& kv : other->map()) {
+                auto& pair = map[kv.first];
+                pair.first += kv.second.first;
+                pair.second += kv.second.second;
+            }
+            return ptr;
+        }
+
         static void Output(ContainerT* ptr, codec::StringRef* output) {
             ContainerT::OutputString(
                 ptr, false, output,
@@ -116,12 +157,17 @@ struct AvgCateWhereDef {
             std::string suffix = ".opaque_dict_" +
                                  DataTypeTrait<K>::to_string() + "_" +
                                  DataTypeTrait<V>::to_string();
-            helper
-                .templates<StringRef, Opaque<ContainerT>, Nullable<V>,
-                           Nullable<bool>, Nullable<K>>()
-                .init("avg_cate_where_init" + suffix, ContainerT::Init)
+            auto udaf =
+                helper.templates<StringRef, Opaque<ContainerT>, Nullable<V>,
+                                 Nullable<bool>, Nullable<K>>();
+            udaf.init("avg_cate_where_init" + suffix, ContainerT::Init)
                 .update("avg_cate_where_update" + suffix, Update)
                 .output("avg_cate_where_output" + suffix, AvgCateImpl::Output);
+            if (AvgCateImpl::kRetractable) {
+                udaf.retract("avg_cate_where_retract" + suffix, Retract)
+                    .merge("avg_cate_where_merge" + suffix,
+                           reinterpret_cast<void*>(AvgCateImpl::Merge));
+            }
         }
 
         static ContainerT* Update(ContainerT* ptr, InputV value,
@@ -134,6 +180,17 @@ struct AvgCateWhereDef {
             }
             return ptr;
         }
+
+        static ContainerT* Retract(ContainerT* ptr, InputV value,
+                                   bool is_value_null, bool cond,
+                                   bool is_cond_null, InputK key,
+                                   bool is_key_null) {
+            if (cond && !is_cond_null) {
+                AvgCateImpl::Retract(ptr, value, is_value_null, key,
+                                     is_key_null);
+            }
+            return ptr;
+        }
     };
 };
 template <typename K>
@@ -16,6 +16,7 @@
 
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -49,14 +50,23 @@ struct CountCateDef {
             std::string suffix = ".opaque_dict_" +
                                  DataTypeTrait<K>::to_string() + "_" +
                                  DataTypeTrait<V>::to_string();
-            helper
-                .templates<StringRef, Opaque<ContainerT>, Nullable<V>,
-                           Nullable<K>>()
-                .init("count_cate_init" + suffix, ContainerT::Init)
+            auto udaf = helper.templates<StringRef, Opaque<ContainerT>,
+                                         Nullable<V>, Nullable<K>>();
+            udaf.init("count_cate_init" + suffix, ContainerT::Init)
                 .update("count_cate_update" + suffix, Update)
                 .output("count_cate_output" + suffix, Output);
+            if (kRetractable) {
+                udaf.retract("count_cate_retract" + suffix, Retract)
+                    .merge("count_cate_merge" + suffix,
+                           reinterpret_cast<void*>(Merge));
+            }
         }
 
+        // state kept across rows of window can not refer to string keys of
+        // rows already left the window
+        static constexpr bool kRetractable =
+            !std::is_same<K, StringRef>::value;
+
         static ContainerT* Update(ContainerT* ptr, InputV value,
                                   bool is_value_null, InputK key,
                                   bool is_key_null) {
@@ -75,6 +85,32 @@ struct CountCateDef {
             return ptr;
         }
 
+        static ContainerT* Retract(ContainerT* ptr, InputV value,
+                                   bool is_value_null, InputK key,
+                                   bool is_key_null) {
+            if (is_key_null || is_value_null) {
+                return ptr;
+            }
+            auto& map = ptr->map();
+            auto iter = map.find(ContainerT::to_stored_key(key));
+            if (iter == map.end()) {
+                return ptr;
+            }
+            iter->second -= 1;
+            if (iter->second <= 0) {
+                map.erase(iter);
+            }
+            return ptr;
+        }
+
+        static ContainerT* Merge(ContainerT* ptr, ContainerT* other) {
+            auto& map = ptr->map();
+            for (auto& kv : other->map()) {
+                map[kv.first] += kv.second;
+            }
+            return ptr;
+        }
+
         static void Output(ContainerT* ptr, codec::StringRef* output) {
             ContainerT::OutputString(
                 ptr, false, output,
@@ -107,13 +143,18 @@ struct CountCateWhereDef {
             std::string suffix = ".opaque_dict_" +
                                  DataTypeTrait<K>::to_string() + "_" +
                                  DataTypeTrait<V>::to_string();
-            helper
-                .templates<StringRef, Opaque<ContainerT>, Nullable<V>,
-                           Nullable<bool>, Nullable<K>>()
-                .init("count_cate_where_init" + suffix, ContainerT::Init)
+            auto udaf =
+                helper.templates<StringRef, Opaque<ContainerT>, Nullable<V>,
+                                 Nullable<bool>, Nullable<K>>();
+            udaf.init("count_cate_where_init" + suffix, ContainerT::Init)
                 .update("count_cate_where_update" + suffix, Update)
                 .output("count_cate_where_output" + suffix,
                         CountCateImpl::Output);
+            if (CountCateImpl::kRetractable) {
+                udaf.retract("count_cate_where_retract" + suffix, Retract)
+                    .merge("count_cate_where_merge" + suffix,
+                           reinterpret_cast<void*>(CountCateImpl::Merge));
+            }
         }
 
         static ContainerT* Update(ContainerT* ptr, InputV value,
@@ -126,6 +167,17 @@ struct CountCateWhereDef {
             }
             return ptr;
         }
+
+        static ContainerT* Retract(ContainerT* ptr, InputV value,
+                                   bool is_value_null, bool cond,
+                                   bool is_cond_null, InputK key,
+                                   bool is_key_null) {
+            if (cond && !is_cond_null) {
+                CountCateImpl::Retract(ptr, value, is_value_null, key,
+                                       is_key_null);
+            }
+            return ptr;
+        }
     };
 };
 
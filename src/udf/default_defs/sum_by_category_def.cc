@@ -16,6 +16,7 @@
 
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -42,7 +43,9 @@ struct SumCateDef {
 
     template <typename V>
     struct Impl {
-        using ContainerT = udf::container::BoundedGroupByDict<K, V, V>;
+        // store (count, sum) pair so that a key can be dropped on retract
+        using ContainerT =
+            udf::container::BoundedGroupByDict<K, V, std::pair<int64_t, V>>;
         using InputK = typename ContainerT::InputK;
         using InputV = typename ContainerT::InputV;
 
@@ -50,14 +53,23 @@ struct SumCateDef {
             std::string suffix = ".opaque_dict_" +
                                  DataTypeTrait<K>::to_string() + "_" +
                                  DataTypeTrait<V>::to_string();
-            helper
-                .templates<StringRef, Opaque<ContainerT>, Nullable<V>,
-                           Nullable<K>>()
-                .init("sum_cate_init" + suffix, ContainerT::Init)
+            auto udaf = helper.templates<StringRef, Opaque<ContainerT>,
+                                         Nullable<V>, Nullable<K>>();
+            udaf.init("sum_cate_init" + suffix, ContainerT::Init)
                 .update("sum_cate_update" + suffix, Update)
                 .output("sum_cate_output" + suffix, Output);
+            if (kRetractable) {
+                udaf.retract("sum_cate_retract" + suffix, Retract)
+                    .merge("sum_cate_merge" + suffix,
+                           reinterpret_cast<void*>(Merge));
+            }
         }
 
+        // state kept across rows of window can not refer to string keys of
+        // rows already left the window, and floating sums drift on retract
+        static constexpr bool kRetractable =
+            !std::is_same<K, StringRef>::value && std::is_integral<V>::value;
+
         static ContainerT* Update(ContainerT* ptr, InputV value,
                                   bool is_value_null, InputK key,
                                   bool is_key_null) {
@@ -68,19 +80,53 @@ struct SumCateDef {
             auto stored_key = ContainerT::to_stored_key(key);
             auto iter = map.find(stored_key);
             if (iter == map.end()) {
-                map.insert(iter,
-                           {stored_key, ContainerT::to_stored_value(value)});
+                map.insert(iter, {stored_key,
+                                  {1, ContainerT::to_stored_value(value)}});
+            } else {
+                auto& pair = iter->second;
+                pair.first += 1;
+                pair.second += ContainerT::to_stored_value(value);
+            }
+            return ptr;
+        }
+
+        static ContainerT* Retract(ContainerT* ptr, InputV value,
+                                   bool is_value_null, InputK key,
+                                   bool is_key_null) {
+            if (is_key_null || is_value_null) {
+                return ptr;
+            }
+            auto& map = ptr->map();
+            auto iter = map.find(ContainerT::to_stored_key(key));
+            if (iter == map.end()) {
+                return ptr;
+            }
+            auto& pair = iter->second;
+            pair.first -= 1;
+            if (pair.first <= 0) {
+                map.erase(iter);
             } else {
-                auto& single = iter->second;
-                single += ContainerT::to_stored_value(value);
+                pair.second -= ContainerT::to_stored_value(value);
+            }
+            return ptr;
+        }
+
+        static ContainerT* Merge(ContainerT* ptr, ContainerT* other) {
+            auto& map = ptr->map();
+            for (auto& kv : other->map()) {
+                auto& pair = map[kv.first];
+                pair.first += kv.second.first;
+                pair.second += kv.second.second;
             }
             return ptr;
         }
 
         static void Output(ContainerT* ptr, codec::StringRef* output) {
             ContainerT::OutputString(
-                ptr, false, output, [](const V& sum, char* buf, size_t size) {
-                    return v1::format_string(sum, buf, size);
+                ptr, false, output,
+                [](const std::pair<int64_t, V>& value, char* buf,
+                   size_t size) {
+                    return v1::format_string(value.second, buf, size);
                 });
             ContainerT::Destroy(ptr);
         }
@@ -98,22 +144,27 @@ struct SumCateWhereDef {
 
     template <typename V>
     struct Impl {
-        using ContainerT = udf::container::BoundedGroupByDict<K, V, V>;
+        using SumCateImpl = typename SumCateDef<K>::template Impl<V>;
+
+        using ContainerT = typename SumCateImpl::ContainerT;
         using InputK = typename ContainerT::InputK;
         using InputV = typename ContainerT::InputV;
 
-        using SumCateImpl = typename SumCateDef<K>::template Impl<V>;
-
         void operator()(UdafRegistryHelper& helper) {  // NOLINT
             std::string suffix = ".opaque_dict_" +
                                  DataTypeTrait<K>::to_string() + "_" +
                                  DataTypeTrait<V>::to_string();
-            helper
-                .templates<StringRef, Opaque<ContainerT>, Nullable<V>,
-                           Nullable<bool>, Nullable<K>>()
-                .init("sum_cate_where_init" + suffix, ContainerT::Init)
+            auto udaf =
+                helper.templates<StringRef, Opaque<ContainerT>, Nullable<V>,
+                                 Nullable<bool>, Nullable<K>>();
+            udaf.init("sum_cate_where_init" + suffix, ContainerT::Init)
                 .update("sum_cate_where_update" + suffix, Update)
                 .output("sum_cate_where_output" + suffix, SumCateImpl::Output);
+            if (SumCateImpl::kRetractable) {
+                udaf.retract("sum_cate_where_retract" + suffix, Retract)
+                    .merge("sum_cate_where_merge" + suffix,
+                           reinterpret_cast<void*>(SumCateImpl::Merge));
+            }
         }
 
         static ContainerT* Update(ContainerT* ptr, InputV value,
@@ -126,6 +177,17 @@ struct SumCateWhereDef {
             }
             return ptr;
         }
+
+        static ContainerT* Retract(ContainerT* ptr, InputV value,
+                                   bool is_value_null, bool cond,
+                                   bool is_cond_null, InputK key,
+                                   bool is_key_null) {
+            if (cond && !is_cond_null) {
+                SumCateImpl::Retract(ptr, value, is_value_null, key,
+                                     is_key_null);
+            }
+            return ptr;
+        }
     };
 };
 
@@ -144,8 +206,6 @@ struct TopKSumCateWhereDef {
         using InputK = typename ContainerT::InputK;
         using InputV = typename ContainerT::InputV;
 
-        using AvgCateImpl = typename SumCateDef<K>::template Impl<V>;
-
         void operator()(UdafRegistryHelper& helper) {  // NOLINT
             std::string suffix;
 
@@ -175,10 +235,16 @@ struct TopKSumCateWhereDef {
                                   bool is_value_null, bool cond,
                                   bool is_cond_null, InputK key,
                                   bool is_key_null, int64_t bound) {
-            if (cond && !is_cond_null) {
-                AvgCateImpl::Update(ptr, value, is_value_null, key,
-                                    is_key_null);
+            if (cond && !is_cond_null && !is_key_null && !is_value_null) {
                 auto& map = ptr->map();
+                auto stored_key = ContainerT::to_stored_key(key);
+                auto iter = map.find(stored_key);
+                if (iter == map.end()) {
+                    map.insert(iter, {stored_key,
+                                      ContainerT::to_stored_value(value)});
+                } else {
+                    iter->second += ContainerT::to_stored_value(value);
+                }
                 if (bound >= 0 && map.size() > static_cast<size_t>(bound)) {
                     map.erase(map.begin());
                 }
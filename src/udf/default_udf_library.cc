@@ -19,6 +19,7 @@
 #include <string>
 #include <tuple>
 #include <unordered_set>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -97,8 +98,8 @@ struct BuildGetSecondUdf {
 template <typename T>
 struct SumUdafDef {
     void operator()(UdafRegistryHelper& helper) {  // NOLINT
-        helper.templates<T, T, T>()
-            .const_init(T(0))
+        auto udaf = helper.templates<T, T, T>();
+        udaf.const_init(T(0))
             .update([](UdfResolveContext* ctx, ExprNode* cur_sum,
                        ExprNode* input) {
                 auto nm = ctx->node_manager();
@@ -108,6 +109,19 @@ struct SumUdafDef {
                 return nm->MakeCondExpr(is_null, cur_sum, new_sum);
             })
             .output("identity");
+        // floating sums drift once inputs are retracted, they are always
+        // recomputed from the whole window
+        if (std::is_integral<T>::value) {
+            udaf.retract(Retract);
+        }
+    }
+
+    static ExprNode* Retract(UdfResolveContext* ctx, ExprNode* cur_sum,
+                             ExprNode* input) {
+        auto nm = ctx->node_manager();
+        auto is_null = nm->MakeUnaryExprNode(input, node::kFnOpIsNull);
+        auto new_sum = nm->MakeBinaryExprNode(cur_sum, input, node::kFnOpMinus);
+        return nm->MakeCondExpr(is_null, cur_sum, new_sum);
     }
 };
 
@@ -219,6 +233,14 @@ struct CountUdafDef {
                     cur_cnt, nm->MakeConstNode(1), node::kFnOpAdd);
                 return nm->MakeCondExpr(is_null, cur_cnt, new_cnt);
             })
+            .retract([](UdfResolveContext* ctx, ExprNode* cur_cnt,
+                        ExprNode* input) {
+                auto nm = ctx->node_manager();
+                auto is_null = nm->MakeUnaryExprNode(input, node::kFnOpIsNull);
+                auto new_cnt = nm->MakeBinaryExprNode(
+                    cur_cnt, nm->MakeConstNode(1), node::kFnOpMinus);
+                return nm->MakeCondExpr(is_null, cur_cnt, new_cnt);
+            })
             .output("identity");
     }
 };
@@ -226,8 +248,8 @@ struct CountUdafDef {
 template <typename T>
 struct AvgUdafDef {
     void operator()(UdafRegistryHelper& helper) {  // NOLINT
-        helper.templates<double, Tuple<int64_t, double>, T>()
-            .const_init(MakeTuple((int64_t)0, 0.0))
+        auto udaf = helper.templates<double, Tuple<int64_t, double>, T>();
+        udaf.const_init(MakeTuple((int64_t)0, 0.0))
             .update(
                 [](UdfResolveContext* ctx, ExprNode* state, ExprNode* input) {
                     auto nm = ctx->node_manager();
@@ -250,6 +272,22 @@ struct AvgUdafDef {
                     nm->MakeBinaryExprNode(sum, cnt, node::kFnOpFDiv);
                 return avg;
             });
+        if (std::is_integral<T>::value) {
+            udaf.retract(Retract);
+        }
+    }
+
+    static ExprNode* Retract(UdfResolveContext* ctx, ExprNode* state,
+                             ExprNode* input) {
+        auto nm = ctx->node_manager();
+        ExprNode* cnt = nm->MakeGetFieldExpr(state, 0);
+        ExprNode* sum = nm->MakeGetFieldExpr(state, 1);
+        ExprNode* is_null = nm->MakeUnaryExprNode(input, node::kFnOpIsNull);
+        cnt = nm->MakeBinaryExprNode(cnt, nm->MakeConstNode(1),
+                                     node::kFnOpMinus);
+        sum = nm->MakeBinaryExprNode(sum, input, node::kFnOpMinus);
+        auto new_state = nm->MakeFuncNode("make_tuple", {cnt, sum}, nullptr);
+        return nm->MakeCondExpr(is_null, state, new_state);
     }
 };
 
@@ -296,8 +334,8 @@ struct DistinctCountDef {
 template <typename T>
 struct SumWhereDef {
     void operator()(UdafRegistryHelper& helper) {  // NOLINT
-        helper.templates<T, T, T, bool>()
-            .const_init(0.0)
+        auto udaf = helper.templates<T, T, T, bool>();
+        udaf.const_init(0.0)
             .update([](UdfResolveContext* ctx, ExprNode* sum, ExprNode* elem,
                        ExprNode* cond) {
                 auto nm = ctx->node_manager();
@@ -310,6 +348,16 @@ struct SumWhereDef {
                 return update;
             })
             .output("identity");
+        if (std::is_integral<T>::value) {
+            udaf.retract(Retract);
+        }
+    }
+
+    static ExprNode* Retract(UdfResolveContext* ctx, ExprNode* sum,
+                             ExprNode* elem, ExprNode* cond) {
+        auto nm = ctx->node_manager();
+        auto new_sum = nm->MakeBinaryExprNode(sum, elem, node::kFnOpMinus);
+        return nm->MakeCondExpr(cond, new_sum, sum);
     }
 };
 
@@ -329,6 +377,16 @@ struct CountWhereDef {
                 ExprNode* update = nm->MakeCondExpr(cond, new_cnt, cnt);
                 return update;
             })
+            .retract([](UdfResolveContext* ctx, ExprNode* cnt, ExprNode* elem,
+                        ExprNode* cond) {
+                auto nm = ctx->node_manager();
+                ExprNode* is_null =
+                    nm->MakeUnaryExprNode(elem, node::kFnOpIsNull);
+                ExprNode* new_cnt = nm->MakeBinaryExprNode(
+                    cnt, nm->MakeConstNode(1), node::kFnOpMinus);
+                new_cnt = nm->MakeCondExpr(is_null, cnt, new_cnt);
+                return nm->MakeCondExpr(cond, new_cnt, cnt);
+            })
             .output("identity");
     }
 };
@@ -336,8 +394,9 @@ struct CountWhereDef {
 template <typename T>
 struct AvgWhereDef {
     void operator()(UdafRegistryHelper& helper) {  // NOLINT
-        helper.templates<double, Tuple<int64_t, double>, T, bool>()
-            .const_init(MakeTuple((int64_t)0, 0.0))
+        auto udaf =
+            helper.templates<double, Tuple<int64_t, double>, T, bool>();
+        udaf.const_init(MakeTuple((int64_t)0, 0.0))
             .update([](UdfResolveContext* ctx, ExprNode* state, ExprNode* elem,
                        ExprNode* cond) {
                 auto nm = ctx->node_manager();
@@ -370,6 +429,28 @@ struct AvgWhereDef {
                     nm->MakeBinaryExprNode(sum, cnt, node::kFnOpFDiv);
                 return avg;
             });
+        if (std::is_integral<T>::value) {
+            udaf.retract(Retract);
+        }
+    }
+
+    static ExprNode* Retract(UdfResolveContext* ctx, ExprNode* state,
+                             ExprNode* elem, ExprNode* cond) {
+        auto nm = ctx->node_manager();
+        ExprNode* cnt = nm->MakeGetFieldExpr(state, 0);
+        ExprNode* sum = nm->MakeGetFieldExpr(state, 1);
+        ExprNode* is_null = nm->MakeUnaryExprNode(elem, node::kFnOpIsNull);
+
+        ExprNode* new_cnt = nm->MakeBinaryExprNode(cnt, nm->MakeConstNode(1),
+                                                   node::kFnOpMinus);
+        new_cnt = nm->MakeCondExpr(is_null, cnt, new_cnt);
+
+        ExprNode* new_sum = nm->MakeBinaryExprNode(sum, elem, node::kFnOpMinus);
+        new_sum = nm->MakeCondExpr(is_null, sum, new_sum);
+
+        ExprNode* new_state =
+            nm->MakeFuncNode("make_tuple", {new_cnt, new_sum}, nullptr);
+        return nm->MakeCondExpr(cond, new_state, state);
     }
 };
 
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "udf/udf_bitcode.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include "glog/logging.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/AlwaysInliner.h"
+
+#ifdef UDF_BITCODE_ENABLE
+namespace hybridse {
+namespace udf {
+// generated by udf_bitcode/embed_bitcode.cmake
+extern const unsigned char kBuiltinUdfBitcode[];
+extern const size_t kBuiltinUdfBitcodeSize;
+}  // namespace udf
+}  // namespace hybridse
+#endif
+
+namespace hybridse {
+namespace udf {
+
+bool IsUdfBitcodeAvailable() {
+#ifdef UDF_BITCODE_ENABLE
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool LinkUdfBitcode(::llvm::Module* m) {
+#ifdef UDF_BITCODE_ENABLE
+    if (m == nullptr) {
+        LOG(WARNING) << "module is null";
+        return false;
+    }
+    std::vector<std::string> declared;
+    for (auto& fn : *m) {
+        if (fn.isDeclaration()) {
+            declared.push_back(fn.getName().str());
+        }
+    }
+    if (declared.empty()) {
+        return false;
+    }
+    ::llvm::StringRef data(reinterpret_cast<const char*>(kBuiltinUdfBitcode),
+                           kBuiltinUdfBitcodeSize);
+    // lazy loaded, only functions required by the module are materialized
+    auto bitcode = ::llvm::getLazyBitcodeModule(
+        ::llvm::MemoryBufferRef(data, "builtin_udf"), m->getContext());
+    if (!bitcode) {
+        LOG(WARNING) << "fail to load udf bitcode: "
+                     << ::llvm::toString(bitcode.takeError());
+        return false;
+    }
+    // data layout and triple are applied to the module by jit later
+    (*bitcode)->setTargetTriple(m->getTargetTriple());
+    (*bitcode)->setDataLayout(m->getDataLayout());
+    if (::llvm::Linker::linkModules(*m, std::move(*bitcode),
+                                    ::llvm::Linker::LinkOnlyNeeded)) {
+        LOG(WARNING) << "fail to link udf bitcode into module "
+                     << m->getModuleIdentifier();
+        return false;
+    }
+
+    bool linked = false;
+    for (auto& name : declared) {
+        auto fn = m->getFunction(name);
+        if (fn == nullptr || fn->isDeclaration()) {
+            continue;
+        }
+        // private copy of the module, never conflict with the jit symbol
+        fn->setLinkage(::llvm::GlobalValue::InternalLinkage);
+        // caller functions of the module carry no target attributes, which
+        // would make the inliner refuse the bitcode functions
+        fn->removeFnAttr("target-cpu");
+        fn->removeFnAttr("target-features");
+        fn->removeFnAttr(::llvm::Attribute::NoInline);
+        fn->removeFnAttr(::llvm::Attribute::OptimizeNone);
+        fn->addFnAttr(::llvm::Attribute::AlwaysInline);
+        linked = true;
+    }
+    if (!linked) {
+        return false;
+    }
+    // inline regardless of jit opt level, the legacy light passes have no
+    // inliner
+    ::llvm::legacy::PassManager pm;
+    pm.add(::llvm::createAlwaysInlinerLegacyPass());
+    pm.add(::llvm::createGlobalDCEPass());
+    pm.run(*m);
+    return true;
+#else
+    return false;
+#endif
+}
+
+}  // namespace udf
+}  // namespace hybridse
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_UDF_UDF_BITCODE_H_
+#define SRC_UDF_UDF_BITCODE_H_
+
+#include "llvm/IR/Module.h"
+
+namespace hybridse {
+namespace udf {
+
+/// Whether builtin udf bitcode is embedded, see `UDF_BITCODE_ENABLE`
+bool IsUdfBitcodeAvailable();
+
+/// Link definitions of the builtin udfs called by the module from the
+/// embedded bitcode and inline them into the callers. Calls to udfs without
+/// bitcode are kept as external calls. Return false if nothing is linked.
+bool LinkUdfBitcode(::llvm::Module* m);
+
+}  // namespace udf
+}  // namespace hybridse
+#endif  // SRC_UDF_UDF_BITCODE_H_
@@ -169,8 +169,18 @@ Status UdafRegistry::ResolveFunction(UdfResolveContext* ctx,
             udaf_gen_.output_gen->ResolveFunction(&output_ctx, &output_func),
             "Resolve output function of ", name(), " failed");
     }
-    *result = nm->MakeUdafDefNode(name(), list_types, init_expr, update_func,
-                                  merge_func, output_func);
+    // gen retract
+    node::FnDefNode* retract_func = nullptr;
+    if (udaf_gen_.retract_gen != nullptr) {
+        UdfResolveContext retract_ctx(update_args, nm, ctx->library());
+        CHECK_STATUS(
+            udaf_gen_.retract_gen->ResolveFunction(&retract_ctx, &retract_func),
+            "Resolve retract function of ", name(), " failed");
+    }
+    auto udaf = nm->MakeUdafDefNode(name(), list_types, init_expr, update_func,
+                                    merge_func, output_func);
+    udaf->SetRetractFunc(retract_func);
+    *result = udaf;
     return Status::OK();
 }
 
@@ -376,6 +376,42 @@ TEST_F(UdfRegistryTest, test_simple_udaf_register) {
     ASSERT_TRUE(fn_def == nullptr);
 }
 
+TEST_F(UdfRegistryTest, test_retractable_udaf_register) {
+    UdfLibrary library;
+
+    library.RegisterExprUdf("identity")
+        .args<AnyArg>([](UdfResolveContext* ctx, ExprNode* x) { return x; });
+
+    library.RegisterUdaf("sum")
+        .templates<int32_t, int32_t, int32_t>()
+        .const_init(0)
+        .update([](UdfResolveContext* ctx, ExprNode* x, ExprNode* y) {
+            return ctx->node_manager()->MakeBinaryExprNode(x, y,
+                                                           node::kFnOpAdd);
+        })
+        .retract([](UdfResolveContext* ctx, ExprNode* x, ExprNode* y) {
+            return ctx->node_manager()->MakeBinaryExprNode(x, y,
+                                                           node::kFnOpMinus);
+        })
+        .output("identity")
+        .templates<int64_t, int64_t, int64_t>()
+        .const_init(0)
+        .update([](UdfResolveContext* ctx, ExprNode* x, ExprNode* y) {
+            return ctx->node_manager()->MakeBinaryExprNode(x, y,
+                                                           node::kFnOpAdd);
+        })
+        .output("identity")
+        .finalize();
+
+    auto fn_def = dynamic_cast<const node::UdafDefNode*>(
+        GetFnDef<codec::ListRef<int32_t>>(&library, "sum", &nm));
+    ASSERT_TRUE(fn_def != nullptr && fn_def->AllowRetract());
+
+    fn_def = dynamic_cast<const node::UdafDefNode*>(
+        GetFnDef<codec::ListRef<int64_t>>(&library, "sum", &nm));
+    ASSERT_TRUE(fn_def != nullptr && !fn_def->AllowRetract());
+}
+
 TEST_F(UdfRegistryTest, test_codegen_udf_register) {
     UdfLibrary library;
     const node::UdfByCodeGenDefNode* fn_def;
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Small builtin udfs compiled to llvm bitcode and linked into query modules,
+// so that the optimizer can inline them into the generated code. Symbols are
+// named after the registered external functions(`name.arg_type`), keep the
+// results identical to the implementations in udf/udf.cc. No libc calls are
+// allowed here since the bitcode is linked without any runtime.
+
+#include <stdint.h>
+
+namespace hybridse {
+namespace udf {
+namespace bitcode {
+
+// same layout as codec::Timestamp
+struct Timestamp {
+    int64_t ts_;
+};
+
+// must stay in sync with TZ_OFFSET of src/udf/udf.cc, the udfs compiled
+// into the engine that these bitcode udfs replace
+static const int64_t TZ_OFFSET = 8 * 3600000;
+
+struct CivilDate {
+    int32_t year;
+    int32_t month;
+    int32_t day;
+    int32_t weekday;
+};
+
+// gmtime_r without the struct tm, see
+// http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+static inline CivilDate ToCivilDate(int64_t ts) {
+    // truncate to seconds as the time_t conversion in udf.cc does
+    int64_t secs = (ts + TZ_OFFSET) / 1000;
+    int64_t days = secs / 86400;
+    if (secs % 86400 < 0) {
+        days -= 1;
+    }
+    CivilDate date;
+    int64_t weekday = (days + 4) % 7;  // 1970-01-01 is thursday
+    date.weekday = static_cast<int32_t>(weekday < 0 ? weekday + 7 : weekday);
+
+    int64_t z = days + 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    int64_t month = mp < 10 ? mp + 3 : mp - 9;
+    date.day = static_cast<int32_t>(doy - (153 * mp + 2) / 5 + 1);
+    date.month = static_cast<int32_t>(month);
+    date.year = static_cast<int32_t>(yoe + era * 400 + (month <= 2 ? 1 : 0));
+    return date;
+}
+
+extern "C" {
+int32_t DayOfMonth(int64_t ts) __asm__("dayofmonth.int64");
+int32_t DayOfMonth(int64_t ts) { return ToCivilDate(ts).day; }
+int32_t DayOfWeek(int64_t ts) __asm__("dayofweek.int64");
+int32_t DayOfWeek(int64_t ts) { return ToCivilDate(ts).weekday + 1; }
+int32_t Month(int64_t ts) __asm__("month.int64");
+int32_t Month(int64_t ts) { return ToCivilDate(ts).month; }
+int32_t Year(int64_t ts) __asm__("year.int64");
+int32_t Year(int64_t ts) { return ToCivilDate(ts).year; }
+
+int32_t DayOfMonthTs(Timestamp* ts) __asm__("dayofmonth.timestamp");
+int32_t DayOfMonthTs(Timestamp* ts) { return ToCivilDate(ts->ts_).day; }
+int32_t DayOfWeekTs(Timestamp* ts) __asm__("dayofweek.timestamp");
+int32_t DayOfWeekTs(Timestamp* ts) {
+    return ToCivilDate(ts->ts_).weekday + 1;
+}
+int32_t MonthTs(Timestamp* ts) __asm__("month.timestamp");
+int32_t MonthTs(Timestamp* ts) { return ToCivilDate(ts->ts_).month; }
+int32_t YearTs(Timestamp* ts) __asm__("year.timestamp");
+int32_t YearTs(Timestamp* ts) { return ToCivilDate(ts->ts_).year; }
+}
+
+}  // namespace bitcode
+}  // namespace udf
+}  // namespace hybridse
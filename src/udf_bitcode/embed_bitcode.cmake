@@ -0,0 +1,26 @@
+# Copyright 2021 4Paradigm
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# usage: cmake -DINPUT=<bitcode> -DOUTPUT=<source> -P embed_bitcode.cmake
+file(READ ${INPUT} UDF_BITCODE_HEX HEX)
+string(LENGTH "${UDF_BITCODE_HEX}" UDF_BITCODE_HEX_LEN)
+math(EXPR UDF_BITCODE_SIZE "${UDF_BITCODE_HEX_LEN} / 2")
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," UDF_BITCODE_BYTES "${UDF_BITCODE_HEX}")
+file(WRITE ${OUTPUT}
+        "// generated from builtin_udf.cc, do not edit\n"
+        "#include <stddef.h>\n"
+        "namespace hybridse {\nnamespace udf {\n"
+        "extern const unsigned char kBuiltinUdfBitcode[] = {${UDF_BITCODE_BYTES}};\n"
+        "extern const size_t kBuiltinUdfBitcodeSize = ${UDF_BITCODE_SIZE};\n"
+        "}  // namespace udf\n}  // namespace hybridse\n")
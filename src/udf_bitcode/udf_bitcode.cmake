@@ -0,0 +1,42 @@
+# Copyright 2021 4Paradigm
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# compile builtin udfs to llvm bitcode with the clang matching llvm, and
+# embed the bitcode into a generated source of hybridse core. included by
+# src/CMakeLists.txt so the generated source is visible to the core targets
+message(STATUS "Enable hybridse udf bitcode")
+find_program(UDF_BITCODE_CLANG NAMES clang clang++
+        HINTS ${LLVM_TOOLS_BINARY_DIR} ${CMAKE_PREFIX_PATH}/bin NO_DEFAULT_PATH)
+if (NOT UDF_BITCODE_CLANG)
+    message(FATAL_ERROR "clang of llvm ${LLVM_PACKAGE_VERSION} not found, required by UDF_BITCODE_ENABLE")
+endif ()
+message(STATUS "Compile udf bitcode with ${UDF_BITCODE_CLANG}")
+
+set(UDF_BITCODE_DIR ${CMAKE_CURRENT_LIST_DIR})
+set(UDF_BITCODE_FILE ${CMAKE_CURRENT_BINARY_DIR}/udf_bitcode/builtin_udf.bc)
+set(UDF_BITCODE_SRC ${CMAKE_CURRENT_BINARY_DIR}/udf_bitcode/builtin_udf_bitcode.cc)
+file(MAKE_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}/udf_bitcode)
+add_custom_command(
+        OUTPUT ${UDF_BITCODE_FILE}
+        COMMAND ${UDF_BITCODE_CLANG} -x c++ -std=c++17 -O2 -emit-llvm -c
+            -fno-exceptions -fno-rtti -fno-stack-protector
+            ${UDF_BITCODE_DIR}/builtin_udf.cc -o ${UDF_BITCODE_FILE}
+        DEPENDS ${UDF_BITCODE_DIR}/builtin_udf.cc
+        COMMENT "Compiling builtin udfs to llvm bitcode")
+add_custom_command(
+        OUTPUT ${UDF_BITCODE_SRC}
+        COMMAND ${CMAKE_COMMAND} -DINPUT=${UDF_BITCODE_FILE} -DOUTPUT=${UDF_BITCODE_SRC}
+            -P ${UDF_BITCODE_DIR}/embed_bitcode.cmake
+        DEPENDS ${UDF_BITCODE_FILE} ${UDF_BITCODE_DIR}/embed_bitcode.cmake
+        COMMENT "Embedding builtin udf bitcode")
@@ -205,7 +205,7 @@ hybridse::codec::Row CoreAPI::RowConstProject(const RawPtrHandle fn,
         LOG(WARNING) << "fail to run udf " << ret;
         return hybridse::codec::Row();
     }
-    return Row(base::RefCountedSlice::CreateManaged(
+    return Row(JitRuntime::get()->CreateRowSlice(
         buf, hybridse::codec::RowView::GetSize(buf)));
 }
 
@@ -235,10 +235,60 @@ hybridse::codec::Row CoreAPI::RowProject(const RawPtrHandle fn,
         LOG(WARNING) << "fail to run udf " << ret;
         return hybridse::codec::Row();
     }
-    return Row(base::RefCountedSlice::CreateManaged(
+    return Row(JitRuntime::get()->CreateRowSlice(
         buf, hybridse::codec::RowView::GetSize(buf)));
 }
 
+bool CoreAPI::RowProjectBatch(const RawPtrHandle batch_fn,
+                              const std::vector<hybridse::codec::Row>& rows,
+                              const hybridse::codec::Row& parameter,
+                              std::vector<hybridse::codec::Row>* outputs) {
+    if (outputs == nullptr) {
+        return false;
+    }
+    outputs->clear();
+    outputs->resize(rows.size());
+    std::vector<const int8_t*> row_ptrs;
+    std::vector<size_t> row_idxs;
+    row_ptrs.reserve(rows.size());
+    row_idxs.reserve(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (!rows[i].empty()) {
+            row_ptrs.push_back(reinterpret_cast<const int8_t*>(&rows[i]));
+            row_idxs.push_back(i);
+        }
+    }
+    if (row_ptrs.empty()) {
+        return true;
+    }
+    std::vector<int8_t*> bufs(row_ptrs.size(), nullptr);
+
+    // Init current run step runtime
+    JitRuntime::get()->InitRunStep();
+
+    auto udf = reinterpret_cast<int32_t (*)(const int8_t**, const int32_t,
+                                            const int8_t*, int8_t**)>(
+        const_cast<int8_t*>(batch_fn));
+    int32_t ret =
+        udf(row_ptrs.data(), static_cast<int32_t>(row_ptrs.size()),
+            reinterpret_cast<const int8_t*>(&parameter), bufs.data());
+
+    // Release current run step resources
+    JitRuntime::get()->ReleaseRunStep();
+
+    // failed rows keep empty outputs like RowProject
+    for (size_t i = 0; i < bufs.size(); ++i) {
+        if (bufs[i] != nullptr) {
+            (*outputs)[row_idxs[i]] = Row(JitRuntime::get()->CreateRowSlice(
+                bufs[i], hybridse::codec::RowView::GetSize(bufs[i])));
+        }
+    }
+    if (ret != 0) {
+        LOG(WARNING) << "fail to run batch udf on " << ret << " rows";
+    }
+    return true;
+}
+
 hybridse::codec::Row CoreAPI::UnsafeRowProject(
     const hybridse::vm::RawPtrHandle fn,
     hybridse::vm::ByteArrayPtr inputUnsafeRowBytes,
@@ -266,7 +316,7 @@ hybridse::codec::Row CoreAPI::UnsafeRowProject(
         return hybridse::codec::Row();
     }
 
-    return Row(base::RefCountedSlice::CreateManaged(
+    return Row(JitRuntime::get()->CreateRowSlice(
         buf, hybridse::codec::RowView::GetSize(buf)));
 }
 
@@ -306,8 +356,8 @@ hybridse::codec::Row CoreAPI::WindowProject(const RawPtrHandle fn,
         LOG(WARNING) << "fail to run udf " << ret;
         return Row();
     }
-    return Row(base::RefCountedSlice::CreateManaged(out_buf,
-                                                    RowView::GetSize(out_buf)));
+    return Row(JitRuntime::get()->CreateRowSlice(out_buf,
+                                                 RowView::GetSize(out_buf)));
 }
 
 hybridse::codec::Row CoreAPI::WindowProject(const RawPtrHandle fn,
@@ -348,11 +398,11 @@ bool CoreAPI::ComputeCondition(const hybridse::vm::RawPtrHandle fn,
 }
 
 hybridse::codec::Row CoreAPI::NewRow(size_t bytes) {
-    auto buf = reinterpret_cast<int8_t*>(malloc(bytes));
+    auto buf = base::RefCountedSlice::AllocInline(bytes);
     if (buf == nullptr) {
         return hybridse::codec::Row();
     }
-    auto slice = base::RefCountedSlice::CreateManaged(buf, bytes);
+    auto slice = base::RefCountedSlice::CreateManagedInline(buf, bytes);
     return hybridse::codec::Row(slice);
 }
 
@@ -361,11 +411,11 @@ RawPtrHandle CoreAPI::GetRowBuf(hybridse::codec::Row* row, size_t idx) {
 }
 
 RawPtrHandle CoreAPI::AppendRow(hybridse::codec::Row* row, size_t bytes) {
-    auto buf = reinterpret_cast<int8_t*>(malloc(bytes));
+    auto buf = base::RefCountedSlice::AllocInline(bytes);
     if (buf == nullptr) {
         return nullptr;
     }
-    auto slice = base::RefCountedSlice::CreateManaged(buf, bytes);
+    auto slice = base::RefCountedSlice::CreateManagedInline(buf, bytes);
     row->Append(slice);
     return buf;
 }
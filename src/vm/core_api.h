@@ -20,6 +20,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 #include "codec/fe_row_codec.h"
 #include "codec/row.h"
 #include "vm/catalog.h"
@@ -129,6 +130,14 @@ class CoreAPI {
                                            const hybridse::codec::Row row,
                                            const hybridse::codec::Row parameter,
                                            const bool need_free = false);
+    /// Project a batch of rows with the batch entry of a row function
+    /// (see FnInfo::batch_fn_ptr), one output row per input row. Empty input
+    /// rows and rows failed to project produce empty output rows, the same
+    /// as RowProject does.
+    static bool RowProjectBatch(const hybridse::vm::RawPtrHandle batch_fn,
+                                const std::vector<hybridse::codec::Row>& rows,
+                                const hybridse::codec::Row& parameter,
+                                std::vector<hybridse::codec::Row>* outputs);
     static hybridse::codec::Row RowConstProject(
         const hybridse::vm::RawPtrHandle fn, const hybridse::codec::Row parameter,
         const bool need_free = false);
@@ -15,12 +15,12 @@
  */
 
 #include "vm/engine.h"
+#include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 #include "base/fe_strings.h"
-#include "boost/none.hpp"
-#include "boost/optional.hpp"
 #include "codec/fe_row_codec.h"
 #include "codec/fe_schema_codec.h"
 #include "codec/list_iterator_codec.h"
@@ -29,6 +29,7 @@
 #include "llvm-c/Target.h"
 #include "vm/local_tablet_handler.h"
 #include "vm/mem_catalog.h"
+#include "vm/runner_executor.h"
 #include "vm/sql_compiler.h"
 
 DECLARE_bool(logtostderr);
@@ -49,7 +50,15 @@ EngineOptions::EngineOptions()
       batch_request_optimized_(true),
       enable_expr_optimize_(true),
       enable_batch_window_parallelization_(false),
+      enable_row_slab_allocator_(false),
+      enable_hash_partition_(false),
+      enable_atomic_ref_count_(false),
+      batch_window_agg_worker_num_(1),
+      enable_batch_window_agg_ordered_(true),
+      request_runner_worker_num_(1),
       max_sql_cache_size_(50),
+      compile_worker_num_(2),
+      max_pending_compile_num_(64),
       enable_spark_unsaferow_format_(false) {
     // TODO(chendihao): Pass the parameter to avoid global gflag
     FLAGS_enable_spark_unsaferow_format = enable_spark_unsaferow_format_;
@@ -61,9 +70,16 @@ EngineOptions* EngineOptions::set_enable_spark_unsaferow_format(bool flag) {
     return this;
 }
 
-Engine::Engine(const std::shared_ptr<Catalog>& catalog) : cl_(catalog), options_(), mu_(), lru_cache_() {}
+Engine::Engine(const std::shared_ptr<Catalog>& catalog)
+    : cl_(catalog),
+      options_(),
+      compile_cache_(options_.max_sql_cache_size()),
+      compile_pool_(options_.compile_worker_num(), options_.max_pending_compile_num()) {}
 Engine::Engine(const std::shared_ptr<Catalog>& catalog, const EngineOptions& options)
-    : cl_(catalog), options_(options), mu_(), lru_cache_() {}
+    : cl_(catalog),
+      options_(options),
+      compile_cache_(options_.max_sql_cache_size()),
+      compile_pool_(options_.compile_worker_num(), options_.max_pending_compile_num()) {}
 Engine::~Engine() {}
 void Engine::InitializeGlobalLLVM() {
     if (LLVM_IS_INITIALIZED) return;
@@ -177,7 +193,8 @@ bool Engine::IsCompatibleCache(RunSession& session,  // NOLINT
 
 bool Engine::Get(const std::string& sql, const std::string& db, RunSession& session,
                  base::Status& status) {  // NOLINT (runtime/references)
-    std::shared_ptr<CompileInfo> cached_info = GetCacheLocked(db, sql, session.engine_mode());
+    CompileCacheKey key(session.engine_mode(), db, sql);
+    std::shared_ptr<CompileInfo> cached_info = GetCacheLocked(key);
     if (cached_info && IsCompatibleCache(session, cached_info, status)) {
         session.SetCompileInfo(cached_info);
         return true;
@@ -187,6 +204,78 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
         LOG(WARNING) << status;
         status = base::Status::OK();
     }
+
+    std::shared_ptr<InflightCompile> inflight;
+    bool is_owner = false;
+    {
+        std::lock_guard<std::mutex> lock(inflight_mu_);
+        auto& entry = inflight_compiles_[key];
+        if (entry == nullptr) {
+            entry = std::make_shared<InflightCompile>();
+            is_owner = true;
+        }
+        inflight = entry;
+    }
+    if (!is_owner) {
+        std::shared_ptr<CompileInfo> info;
+        {
+            std::unique_lock<std::mutex> lock(inflight->mu);
+            inflight->cond.wait(lock, [&inflight]() { return inflight->done; });
+            info = inflight->info;
+        }
+        if (info && IsCompatibleCache(session, info, status)) {
+            session.SetCompileInfo(info);
+            return true;
+        }
+        // failed or incompatible with this session, compile on our own
+        status = base::Status::OK();
+        return Compile(sql, db, session, status);
+    }
+    bool ok = Compile(sql, db, session, status);
+    {
+        std::lock_guard<std::mutex> lock(inflight->mu);
+        inflight->done = true;
+        inflight->info = ok ? session.GetCompileInfo() : nullptr;
+    }
+    inflight->cond.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(inflight_mu_);
+        inflight_compiles_.erase(key);
+    }
+    return ok;
+}
+
+void Engine::GetAsync(const std::string& sql, const std::string& db, std::shared_ptr<RunSession> session,
+                      std::function<void(const base::Status&)> done) {
+    base::Status status;
+    std::shared_ptr<CompileInfo> cached_info = GetCacheLocked(CompileCacheKey(session->engine_mode(), db, sql));
+    if (cached_info && IsCompatibleCache(*session, cached_info, status)) {
+        session->SetCompileInfo(cached_info);
+        done(status);
+        return;
+    }
+    bool ok = compile_pool_.Submit([this, sql, db, session, done]() {
+        base::Status status;
+        if (!Get(sql, db, *session, status) && status.isOK()) {
+            status = base::Status(common::kSqlError, "fail to compile sql");
+        }
+        done(status);
+    });
+    if (!ok) {
+        done(base::Status(common::kBadRequest, "too many pending compile tasks"));
+    }
+}
+
+std::future<base::Status> Engine::GetAsync(const std::string& sql, const std::string& db,
+                                           std::shared_ptr<RunSession> session) {
+    auto promise = std::make_shared<std::promise<base::Status>>();
+    auto future = promise->get_future();
+    GetAsync(sql, db, session, [promise](const base::Status& status) { promise->set_value(status); });
+    return future;
+}
+
+bool Engine::Compile(const std::string& sql, const std::string& db, RunSession& session,
+                     base::Status& status) {  // NOLINT (runtime/references)
     DLOG(INFO) << "Compile HYBRIDSE ...";
     status = base::Status::OK();
     std::shared_ptr<SqlCompileInfo> info = std::make_shared<SqlCompileInfo>();
@@ -199,6 +288,12 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
     sql_context.is_batch_request_optimized = options_.is_batch_request_optimized();
     sql_context.enable_batch_window_parallelization = options_.is_enable_batch_window_parallelization();
     sql_context.enable_expr_optimize = options_.is_enable_expr_optimize();
+    sql_context.enable_row_slab_allocator = options_.is_enable_row_slab_allocator();
+    sql_context.enable_hash_partition = options_.is_enable_hash_partition();
+    sql_context.enable_atomic_ref_count = options_.is_enable_atomic_ref_count();
+    sql_context.batch_window_agg_worker_num = options_.batch_window_agg_worker_num();
+    sql_context.enable_batch_window_agg_ordered = options_.is_enable_batch_window_agg_ordered();
+    sql_context.request_runner_worker_num = options_.request_runner_worker_num();
     sql_context.jit_options = options_.jit_options();
     sql_context.parameter_types = session.parameter_schema_;
 
@@ -221,7 +316,7 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
         }
     }
 
-    SetCacheLocked(db, sql, session.engine_mode(), info);
+    SetCacheLocked(CompileCacheKey(session.engine_mode(), db, sql), info);
     session.SetCompileInfo(info);
     if (session.is_debug_) {
         std::ostringstream plan_oss;
@@ -306,51 +401,16 @@ bool Engine::Explain(const std::string& sql, const std::string& db, EngineMode e
     return Explain(sql, db, engine_mode, parameter_schema, {}, explain_output, status);
 }
 
-void Engine::ClearCacheLocked(const std::string& db) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    for (auto& cache : lru_cache_) {
-        cache.second.erase(db);
-    }
-}
+void Engine::ClearCacheLocked(const std::string& db) { compile_cache_.Clear(db); }
 
-std::shared_ptr<CompileInfo> Engine::GetCacheLocked(const std::string& db, const std::string& sql,
-                                                    EngineMode engine_mode) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    auto mode_iter = lru_cache_.find(engine_mode);
-    if (mode_iter == lru_cache_.end()) {
-        return nullptr;
-    }
-    auto& mode_cache = mode_iter->second;
-    auto db_iter = mode_cache.find(db);
-    if (db_iter == mode_cache.end()) {
-        return nullptr;
-    }
-    auto& lru = db_iter->second;
-    auto value = lru.get(sql);
-    if (value == boost::none) {
-        return nullptr;
-    } else {
-        return value.value();
-    }
-}
+std::shared_ptr<CompileInfo> Engine::GetCacheLocked(const CompileCacheKey& key) { return compile_cache_.Get(key); }
 
-bool Engine::SetCacheLocked(const std::string& db, const std::string& sql, EngineMode engine_mode,
-                            std::shared_ptr<CompileInfo> info) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    auto& mode_cache = lru_cache_[engine_mode];
-    using BoostLRU = boost::compute::detail::lru_cache<std::string, std::shared_ptr<CompileInfo>>;
-    std::map<std::string, BoostLRU>::iterator db_iter = mode_cache.find(db);
-    if (db_iter == mode_cache.end()) {
-        db_iter = mode_cache.insert(db_iter, {db, BoostLRU(options_.max_sql_cache_size())});
-    }
-    auto& lru = db_iter->second;
-    auto value = lru.get(sql);
-    if (value == boost::none || engine_mode == kBatchRequestMode) {
-        lru.insert(sql, info);
+bool Engine::SetCacheLocked(const CompileCacheKey& key, std::shared_ptr<CompileInfo> info) {
+    if (compile_cache_.Insert(key, info, key.engine_mode() == kBatchRequestMode)) {
         return true;
     } else {
         // TODO(xxx): Ensure compile result is stable
-        DLOG(INFO) << "Engine cache already exists: " << engine_mode << " " << db << "\n" << sql;
+        DLOG(INFO) << "Engine cache already exists: " << key.engine_mode() << " " << key.db() << "\n" << key.sql();
         return false;
     }
 }
@@ -369,18 +429,30 @@ int32_t RequestRunSession::Run(const Row& in_row, const Row& parameter_row, Row*
                in_row, parameter_row, out_row);
 }
 int32_t RequestRunSession::Run(const uint32_t task_id, const Row& in_row, const Row& parameter_row, Row* out_row) {
-    auto task = std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)
-                    ->get_sql_context()
-                    .cluster_job.GetTask(task_id)
-                    .GetRoot();
+    auto& sql_ctx = std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context();
+    auto task = sql_ctx.cluster_job.GetTask(task_id).GetRoot();
     if (nullptr == task) {
         LOG(WARNING) << "fail to run request plan: taskid" << task_id << " not exist!";
         return -2;
     }
     DLOG(INFO) << "Request Row Run with task_id " << task_id;
-    RunnerContext ctx(&std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().cluster_job, in_row,
-                      parameter_row, sp_name_, is_debug_);
-    auto output = task->RunWithCache(ctx);
+    RunnerContext ctx(&sql_ctx.cluster_job, in_row, parameter_row, sp_name_, is_debug_);
+    // runners on helper threads share rows of the run
+    if (sql_ctx.enable_atomic_ref_count || sql_ctx.request_runner_worker_num > 1) {
+        ctx.EnableAtomicRefCount();
+    }
+    if (sql_ctx.enable_row_slab_allocator) {
+        ctx.EnableRowSlabAllocator();
+    }
+    ctx.SetRunnerWorkers(sql_ctx.request_runner_worker_num);
+    auto output = RunnerExecutor::Run(task, ctx);
+    if (is_debug_) {
+        std::ostringstream oss;
+        for (auto& runner_time : ctx.GetRunnerTimes()) {
+            oss << "[" << runner_time.first << "]" << runner_time.second << "us ";
+        }
+        LOG(INFO) << "RUNNER ELAPSED: " << oss.str();
+    }
     if (!output) {
         LOG(WARNING) << "run request plan output is null";
         return -1;
@@ -401,6 +473,14 @@ int32_t BatchRequestRunSession::Run(const uint32_t id, const std::vector<Row>& r
                                     std::vector<Row>& output) {
     RunnerContext ctx(&std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().cluster_job,
                       request_batch, parameter_row, sp_name_, is_debug_);
+    // subqueries scattered to several tablets share rows of the run
+    if (std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().enable_atomic_ref_count ||
+        std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().is_cluster_optimized) {
+        ctx.EnableAtomicRefCount();
+    }
+    if (std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().enable_row_slab_allocator) {
+        ctx.EnableRowSlabAllocator();
+    }
     auto task =
         std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().cluster_job.GetTask(id).GetRoot();
     if (nullptr == task) {
@@ -423,6 +503,20 @@ int32_t BatchRequestRunSession::Run(const uint32_t id, const std::vector<Row>& r
 std::shared_ptr<TableHandler> BatchRunSession::Run(const Row& parameter_row) {
     RunnerContext ctx(&std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().cluster_job,
                       parameter_row, is_debug_);
+    // window aggregation workers share rows of the run
+    if (std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().enable_atomic_ref_count ||
+        std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().batch_window_agg_worker_num > 1) {
+        ctx.EnableAtomicRefCount();
+    }
+    if (std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().enable_row_slab_allocator) {
+        ctx.EnableRowSlabAllocator();
+    }
+    if (std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().enable_hash_partition) {
+        ctx.EnableHashPartition();
+    }
+    ctx.SetWindowAggWorkers(
+        std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().batch_window_agg_worker_num,
+        std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context().enable_batch_window_agg_ordered);
     auto output = std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)
                       ->get_sql_context()
                       .cluster_job.GetMainTask()
@@ -451,6 +545,17 @@ std::shared_ptr<TableHandler> BatchRunSession::Run(const Row& parameter_row) {
 int32_t BatchRunSession::Run(const Row& parameter_row, std::vector<Row>& rows, uint64_t limit) {
     auto& sql_ctx = std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context();
     RunnerContext ctx(&sql_ctx.cluster_job, parameter_row, is_debug_);
+    // window aggregation workers share rows of the run
+    if (sql_ctx.enable_atomic_ref_count || sql_ctx.batch_window_agg_worker_num > 1) {
+        ctx.EnableAtomicRefCount();
+    }
+    if (sql_ctx.enable_row_slab_allocator) {
+        ctx.EnableRowSlabAllocator();
+    }
+    if (sql_ctx.enable_hash_partition) {
+        ctx.EnableHashPartition();
+    }
+    ctx.SetWindowAggWorkers(sql_ctx.batch_window_agg_worker_num, sql_ctx.enable_batch_window_agg_ordered);
     auto output = sql_ctx.cluster_job.GetTask(0).GetRoot()->RunWithCache(ctx);
     if (!output) {
         LOG(WARNING) << "run batch plan output is null";
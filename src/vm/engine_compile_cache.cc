@@ -0,0 +1,135 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/engine_compile_cache.h"
+#include "base/fe_hash.h"
+
+namespace hybridse {
+namespace vm {
+
+CompileCacheKey::CompileCacheKey(EngineMode engine_mode, const std::string& db,
+                                 const std::string& sql)
+    : engine_mode_(engine_mode), db_(db), sql_(sql) {
+    uint64_t sql_hash =
+        base::MurmurHash64A(sql.data(), sql.size(), 0xe17a1465);
+    uint64_t db_hash = base::MurmurHash64A(db.data(), db.size(),
+                                           static_cast<uint32_t>(engine_mode));
+    hash_ = sql_hash ^ (db_hash * 0x9e3779b97f4a7c15);
+}
+
+EngineCompileCache::EngineCompileCache(uint32_t capacity)
+    : capacity_(capacity == 0 ? 1 : capacity) {}
+
+std::shared_ptr<CompileInfo> EngineCompileCache::Get(
+    const CompileCacheKey& key) {
+    auto& shard = GetShard(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mu);
+    auto iter = shard.entries.find(key);
+    if (iter == shard.entries.end()) {
+        shard.miss_cnt.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    auto& entry = iter->second;
+    // avoid writing the shared cache line once it is marked
+    if (!entry->referenced.load(std::memory_order_relaxed)) {
+        entry->referenced.store(true, std::memory_order_relaxed);
+    }
+    shard.hit_cnt.fetch_add(1, std::memory_order_relaxed);
+    return entry->info;
+}
+
+bool EngineCompileCache::Insert(const CompileCacheKey& key,
+                                const std::shared_ptr<CompileInfo>& info,
+                                bool overwrite) {
+    std::lock_guard<std::mutex> clock_lock(clock_mu_);
+    auto& shard = GetShard(key);
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mu);
+        auto iter = shard.entries.find(key);
+        if (iter != shard.entries.end()) {
+            if (!overwrite) {
+                return false;
+            }
+            iter->second = std::make_shared<Entry>(info);
+            return true;
+        }
+    }
+    auto& clock = clocks_[std::make_pair(key.engine_mode(), key.db())];
+    while (clock.keys.size() >= capacity_) {
+        EvictOne(&clock);
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mu);
+        shard.entries.emplace(key, std::make_shared<Entry>(info));
+    }
+    clock.keys.push_back(key);
+    return true;
+}
+
+void EngineCompileCache::EvictOne(Clock* clock) {
+    while (true) {
+        if (clock->hand >= clock->keys.size()) {
+            clock->hand = 0;
+        }
+        auto& victim = clock->keys[clock->hand];
+        auto& shard = GetShard(victim);
+        {
+            std::unique_lock<std::shared_mutex> lock(shard.mu);
+            auto iter = shard.entries.find(victim);
+            if (iter != shard.entries.end()) {
+                if (iter->second->referenced.exchange(false)) {
+                    // second chance
+                    clock->hand += 1;
+                    continue;
+                }
+                shard.entries.erase(iter);
+                shard.eviction_cnt.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        clock->keys.erase(clock->keys.begin() + clock->hand);
+        return;
+    }
+}
+
+void EngineCompileCache::Clear(const std::string& db) {
+    std::lock_guard<std::mutex> clock_lock(clock_mu_);
+    for (auto iter = clocks_.begin(); iter != clocks_.end();) {
+        if (iter->first.second != db) {
+            ++iter;
+            continue;
+        }
+        for (auto& key : iter->second.keys) {
+            auto& shard = GetShard(key);
+            std::unique_lock<std::shared_mutex> lock(shard.mu);
+            shard.entries.erase(key);
+        }
+        iter = clocks_.erase(iter);
+    }
+}
+
+CompileCacheStats EngineCompileCache::GetStats() const {
+    CompileCacheStats stats;
+    for (auto& shard : shards_) {
+        stats.hit_cnt += shard.hit_cnt.load(std::memory_order_relaxed);
+        stats.miss_cnt += shard.miss_cnt.load(std::memory_order_relaxed);
+        stats.eviction_cnt +=
+            shard.eviction_cnt.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/engine_compile_cache.h"
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace vm {
+
+class MockCompileInfo : public CompileInfo {
+ public:
+    explicit MockCompileInfo(const std::string& sql) : sql_(sql) {}
+    bool GetIRBuffer(const base::RawBuffer& buf) override { return false; }
+    size_t GetIRSize() override { return 0; }
+    const EngineMode GetEngineMode() const override { return kBatchMode; }
+    const std::string& GetSql() const override { return sql_; }
+    const Schema& GetSchema() const override { return schema_; }
+    const ComileType GetCompileType() const override { return kCompileSql; }
+    const std::string& GetEncodedSchema() const override { return sql_; }
+    const Schema& GetRequestSchema() const override { return schema_; }
+    const Schema& GetParameterSchema() const override { return schema_; }
+    const std::string& GetRequestName() const override { return sql_; }
+    const BatchRequestInfo& GetBatchRequestInfo() const override {
+        return batch_request_info_;
+    }
+    const PhysicalOpNode* GetPhysicalPlan() const override { return nullptr; }
+    void DumpPhysicalPlan(std::ostream& output,
+                          const std::string& tab) override {}
+    void DumpClusterJob(std::ostream& output, const std::string& tab) override {
+    }
+
+ private:
+    std::string sql_;
+    Schema schema_;
+    BatchRequestInfo batch_request_info_;
+};
+
+class EngineCompileCacheTest : public ::testing::Test {};
+
+TEST_F(EngineCompileCacheTest, ClockEviction) {
+    EngineCompileCache cache(2);
+    CompileCacheKey k1(kBatchMode, "db", "sql1");
+    CompileCacheKey k2(kBatchMode, "db", "sql2");
+    CompileCacheKey k3(kBatchMode, "db", "sql3");
+    auto i1 = std::make_shared<MockCompileInfo>("sql1");
+    ASSERT_TRUE(cache.Insert(k1, i1, false));
+    ASSERT_FALSE(cache.Insert(k1, std::make_shared<MockCompileInfo>("x"),
+                              false));
+    ASSERT_TRUE(cache.Insert(k2, std::make_shared<MockCompileInfo>("sql2"),
+                             false));
+
+    // k1 is referenced, k2 is evicted
+    ASSERT_EQ(i1, cache.Get(k1));
+    ASSERT_TRUE(cache.Insert(k3, std::make_shared<MockCompileInfo>("sql3"),
+                             false));
+    ASSERT_EQ(i1, cache.Get(k1));
+    ASSERT_EQ(nullptr, cache.Get(k2));
+    ASSERT_NE(nullptr, cache.Get(k3));
+
+    // capacity is counted by mode and db
+    CompileCacheKey other_db(kBatchMode, "db2", "sql1");
+    CompileCacheKey other_mode(kRequestMode, "db", "sql1");
+    ASSERT_EQ(nullptr, cache.Get(other_db));
+    ASSERT_TRUE(cache.Insert(other_db, i1, false));
+    ASSERT_TRUE(cache.Insert(other_mode, i1, false));
+    ASSERT_EQ(i1, cache.Get(k1));
+
+    auto stats = cache.GetStats();
+    ASSERT_EQ(4u, stats.hit_cnt);
+    ASSERT_EQ(2u, stats.miss_cnt);
+    ASSERT_EQ(1u, stats.eviction_cnt);
+
+    cache.Clear("db");
+    ASSERT_EQ(nullptr, cache.Get(k1));
+    ASSERT_EQ(nullptr, cache.Get(other_mode));
+    ASSERT_EQ(i1, cache.Get(other_db));
+}
+
+TEST_F(EngineCompileCacheTest, ConcurrentGetAndInsert) {
+    EngineCompileCache cache(16);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&cache, t]() {
+            for (int i = 0; i < 1000; ++i) {
+                std::string sql = "sql" + std::to_string((i * 7 + t) % 64);
+                CompileCacheKey key(kBatchMode, "db", sql);
+                auto info = cache.Get(key);
+                if (info == nullptr) {
+                    cache.Insert(key, std::make_shared<MockCompileInfo>(sql),
+                                 false);
+                } else {
+                    ASSERT_EQ(sql, info->GetSql());
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto stats = cache.GetStats();
+    ASSERT_EQ(8000u, stats.hit_cnt + stats.miss_cnt);
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
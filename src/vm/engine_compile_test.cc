@@ -82,9 +82,53 @@ TEST_F(EngineCompileTest, EngineLRUCacheTest) {
         ASSERT_EQ(get_status.code, common::kOk);
         ASSERT_NE(bsession1.GetCompileInfo().get(),
                   bsession2.GetCompileInfo().get());
+        auto stats = engine.GetCacheStats();
+        ASSERT_EQ(1u, stats.hit_cnt);
+        ASSERT_EQ(3u, stats.miss_cnt);
+        ASSERT_EQ(2u, stats.eviction_cnt);
     }
 }
 
+TEST_F(EngineCompileTest, EngineAsyncCompileTest) {
+    auto catalog = BuildSimpleCatalog();
+    hybridse::type::Database db;
+    db.set_name("simple_db");
+    hybridse::type::TableDef table_def;
+    sqlcase::CaseSchemaMock::BuildTableDef(table_def);
+    table_def.set_name("t1");
+    AddTable(db, table_def);
+    catalog->AddDatabase(db);
+
+    EngineOptions options;
+    options.set_compile_only(true);
+    options.set_compile_worker_num(4);
+    Engine engine(catalog, options);
+
+    // concurrent compiles of one sql share the same compile result
+    std::string sql = "select col1, col2 + 1 from t1;";
+    std::vector<std::shared_ptr<BatchRunSession>> sessions;
+    std::vector<std::future<base::Status>> futures;
+    for (int i = 0; i < 8; ++i) {
+        sessions.push_back(std::make_shared<BatchRunSession>());
+        futures.push_back(engine.GetAsync(sql, "simple_db", sessions.back()));
+    }
+    for (size_t i = 0; i < futures.size(); ++i) {
+        auto status = futures[i].get();
+        ASSERT_TRUE(status.isOK()) << status;
+        ASSERT_EQ(sessions[0]->GetCompileInfo().get(),
+                  sessions[i]->GetCompileInfo().get());
+    }
+
+    // compile error is reported by the callback
+    auto session = std::make_shared<BatchRunSession>();
+    std::promise<base::Status> promise;
+    engine.GetAsync("select not_exist from t1;", "simple_db", session,
+                    [&promise](const base::Status& status) {
+                        promise.set_value(status);
+                    });
+    ASSERT_FALSE(promise.get_future().get().isOK());
+}
+
 TEST_F(EngineCompileTest, EngineCompileOnlyTest) {
     // Build Simple Catalog
     auto catalog = BuildSimpleCatalog();
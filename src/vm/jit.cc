@@ -15,7 +15,10 @@
  */
 
 #include "vm/jit.h"
+#include <map>
+#include <memory>
 #include <string>
+#include <tuple>
 #include <utility>
 extern "C" {
 #include <cmath>
@@ -36,6 +39,9 @@ extern "C" {
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/Host.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/GVN.h"
@@ -52,6 +58,75 @@ HybridSeJit::HybridSeJit(::llvm::orc::LLJITBuilderState& s, ::llvm::Error& e)
     : LLJIT(s, e) {}
 HybridSeJit::~HybridSeJit() {}
 
+static ::llvm::CodeGenOpt::Level GetCodeGenOptLevel(int opt_level) {
+    switch (opt_level) {
+        case 0:
+            return ::llvm::CodeGenOpt::None;
+        case 1:
+            return ::llvm::CodeGenOpt::Less;
+        case 2:
+            return ::llvm::CodeGenOpt::Default;
+        default:
+            return ::llvm::CodeGenOpt::Aggressive;
+    }
+}
+
+static ::llvm::Expected<::llvm::orc::JITTargetMachineBuilder>
+CreateTargetMachineBuilder(const JitOptions& jit_options) {
+    auto jtmb = ::llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!jtmb) {
+        return jtmb.takeError();
+    }
+    if (jit_options.is_enable_host_cpu_features()) {
+        ::llvm::StringMap<bool> feature_map;
+        ::llvm::SubtargetFeatures features;
+        if (::llvm::sys::getHostCPUFeatures(feature_map)) {
+            for (auto& feature : feature_map) {
+                features.AddFeature(feature.first(), feature.second);
+            }
+        }
+        jtmb->setCPU(::llvm::sys::getHostCPUName().str());
+        jtmb->addFeatures(features.getFeatures());
+        DLOG(INFO) << "Generate code for host cpu "
+                   << ::llvm::sys::getHostCPUName().str();
+    }
+    if (jit_options.opt_level() >= 0) {
+        jtmb->setCodeGenOptLevel(GetCodeGenOptLevel(jit_options.opt_level()));
+    }
+    return jtmb;
+}
+
+::llvm::Expected<std::unique_ptr<HybridSeJit>> HybridSeJit::Create(
+    const JitOptions& jit_options, JitObjectCache* object_cache) {
+    auto jtmb = CreateTargetMachineBuilder(jit_options);
+    if (!jtmb) {
+        return jtmb.takeError();
+    }
+    HybridSeJitBuilder builder;
+    builder.setJITTargetMachineBuilder(*jtmb);
+    if (object_cache != nullptr) {
+        builder.setCompileFunctionCreator(
+            [object_cache](::llvm::orc::JITTargetMachineBuilder jtmb)
+                -> ::llvm::Expected<
+                    ::llvm::orc::IRCompileLayer::CompileFunction> {
+                auto tm = jtmb.createTargetMachine();
+                if (!tm) {
+                    return tm.takeError();
+                }
+                return ::llvm::orc::IRCompileLayer::CompileFunction(
+                    ::llvm::orc::TMOwningSimpleCompiler(std::move(*tm),
+                                                        object_cache));
+            });
+    }
+    auto jit = builder.create();
+    if (jit) {
+        (*jit)->object_cache_ = object_cache;
+        (*jit)->opt_level_ = jit_options.opt_level();
+        (*jit)->jtmb_.reset(new ::llvm::orc::JITTargetMachineBuilder(*jtmb));
+    }
+    return jit;
+}
+
 static void RunDefaultOptPasses(::llvm::Module* m) {
     ::llvm::legacy::FunctionPassManager fpm(m);
     // Add some optimizations.
@@ -66,6 +141,53 @@ static void RunDefaultOptPasses(::llvm::Module* m) {
     }
 }
 
+// run the O1-O3 module pipeline of new pass manager, target information
+// lets vectorizers and inliner make cost decisions for the target cpu
+static bool RunOptPipeline(::llvm::Module* m, int opt_level,
+                           ::llvm::orc::JITTargetMachineBuilder* jtmb) {
+    auto tm = jtmb->createTargetMachine();
+    if (!tm) {
+        LOG(WARNING) << "fail to create target machine: "
+                     << LlvmToString(tm.takeError());
+        return false;
+    }
+    ::llvm::PipelineTuningOptions tuning_options;
+    tuning_options.LoopVectorization = opt_level >= 2;
+    tuning_options.SLPVectorization = opt_level >= 2;
+    ::llvm::PassBuilder pass_builder(tm->get(), tuning_options);
+
+    // declared in this order to be destroyed in reverse
+    ::llvm::LoopAnalysisManager lam;
+    ::llvm::FunctionAnalysisManager fam;
+    ::llvm::CGSCCAnalysisManager cgam;
+    ::llvm::ModuleAnalysisManager mam;
+    pass_builder.registerModuleAnalyses(mam);
+    pass_builder.registerCGSCCAnalyses(cgam);
+    pass_builder.registerFunctionAnalyses(fam);
+    pass_builder.registerLoopAnalyses(lam);
+    pass_builder.crossRegisterProxies(lam, fam, cgam, mam);
+
+    ::llvm::PassBuilder::OptimizationLevel level =
+        opt_level == 1   ? ::llvm::PassBuilder::O1
+        : opt_level == 2 ? ::llvm::PassBuilder::O2
+                         : ::llvm::PassBuilder::O3;
+    ::llvm::ModulePassManager mpm =
+        pass_builder.buildPerModuleDefaultPipeline(level);
+    mpm.run(*m, mam);
+    return true;
+}
+
+static bool RunOptPasses(::llvm::Module* m, int opt_level,
+                         ::llvm::orc::JITTargetMachineBuilder* jtmb) {
+    if (opt_level < 0) {
+        RunDefaultOptPasses(m);
+        return true;
+    } else if (opt_level == 0) {
+        return true;
+    }
+    return RunOptPipeline(m, opt_level, jtmb);
+}
+
 ::llvm::Error HybridSeJit::AddIRModule(::llvm::orc::JITDylib& jd,  // NOLINT
                                        ::llvm::orc::ThreadSafeModule tsm,
                                        ::llvm::orc::VModuleKey key) {
@@ -82,8 +204,15 @@ bool HybridSeJit::OptModule(::llvm::Module* m) {
     if (auto err = applyDataLayout(*m)) {
         return false;
     }
+    if (object_cache_ != nullptr && object_cache_->PinObject(m)) {
+        // compiled object pinned to the module will be loaded from cache
+        DLOG(INFO) << "Skip opt of cached module " << m->getModuleIdentifier();
+        return true;
+    }
     DLOG(INFO) << "Module before opt:\n" << LlvmToString(*m);
-    RunDefaultOptPasses(m);
+    if (!RunOptPasses(m, opt_level_, jtmb_.get())) {
+        return false;
+    }
     DLOG(INFO) << "Module after opt:\n" << LlvmToString(*m);
     return true;
 }
@@ -150,8 +279,7 @@ bool HybridSeJit::AddSymbol(::llvm::orc::JITDylib& jd,
 
 bool HybridSeLlvmJitWrapper::Init() {
     DLOG(INFO) << "Start to initialize hybridse jit";
-    auto jit = ::llvm::Expected<std::unique_ptr<HybridSeJit>>(
-        HybridSeJitBuilder().create());
+    auto jit = HybridSeJit::Create(jit_options_, object_cache_);
     {
         ::llvm::Error e = jit.takeError();
         if (e) {
@@ -204,12 +332,210 @@ bool HybridSeLlvmJitWrapper::AddExternalFunction(const std::string& name,
                                                 name, addr);
 }
 
+// register builtin symbols into the main JITDylib of a shared session
+class JitSessionSymbolRegistry : public HybridSeJitWrapper {
+ public:
+    JitSessionSymbolRegistry(HybridSeJit* jit,
+                             ::llvm::orc::MangleAndInterner* mi)
+        : jit_(jit), mi_(mi) {}
+    ~JitSessionSymbolRegistry() {}
+
+    bool Init() override { return true; }
+
+    bool OptModule(::llvm::Module* module) override { return false; }
+
+    bool AddModule(std::unique_ptr<llvm::Module> module,
+                   std::unique_ptr<llvm::LLVMContext> llvm_ctx) override {
+        return false;
+    }
+
+    bool AddExternalFunction(const std::string& name, void* addr) override {
+        return HybridSeJit::AddSymbol(jit_->getMainJITDylib(), *mi_, name,
+                                      addr);
+    }
+
+    hybridse::vm::RawPtrHandle FindFunction(
+        const std::string& funcname) override {
+        return nullptr;
+    }
+
+ private:
+    HybridSeJit* jit_;
+    ::llvm::orc::MangleAndInterner* mi_;
+};
+
+std::shared_ptr<HybridSeJitSession> HybridSeJitSession::GetShared(
+    const JitOptions& jit_options, JitObjectCache* object_cache) {
+    // options the generated code depends on, and the cache instance of the
+    // object cache dir
+    using SessionKey = std::tuple<int, bool, bool, JitObjectCache*>;
+    static std::mutex mu;
+    static std::map<SessionKey, std::shared_ptr<HybridSeJitSession>> sessions;
+    SessionKey key(jit_options.opt_level(),
+                   jit_options.is_enable_host_cpu_features(),
+                   jit_options.is_enable_udf_bitcode(), object_cache);
+    std::lock_guard<std::mutex> lock(mu);
+    auto& current = sessions[key];
+    if (current == nullptr || current->retired_cnt() >= max_retired_dylibs) {
+        std::shared_ptr<HybridSeJitSession> session(new HybridSeJitSession());
+        if (!session->Init(jit_options, object_cache)) {
+            return nullptr;
+        }
+        current = session;
+    }
+    return current;
+}
+
+bool HybridSeJitSession::Init(const JitOptions& jit_options,
+                              JitObjectCache* object_cache) {
+    LOG(INFO) << "Start to initialize shared hybridse jit session";
+    auto jit = HybridSeJit::Create(jit_options, object_cache);
+    {
+        ::llvm::Error e = jit.takeError();
+        if (e) {
+            LOG(WARNING) << "fail to init jit let";
+            return false;
+        }
+    }
+    this->jit_ = std::move(jit.get());
+    jit_->Init();
+
+    this->mi_ = std::unique_ptr<::llvm::orc::MangleAndInterner>(
+        new ::llvm::orc::MangleAndInterner(jit_->getExecutionSession(),
+                                           jit_->getDataLayout()));
+    JitSessionSymbolRegistry registry(jit_.get(), mi_.get());
+    return HybridSeJitWrapper::InitJitSymbols(&registry);
+}
+
+::llvm::orc::JITDylib* HybridSeJitSession::CreateQueryDylib() {
+    std::lock_guard<std::mutex> lock(mu_);
+    // do not add query dylib to the search order of main dylib
+    auto& jd = jit_->getExecutionSession().createJITDylib(
+        "query_" + std::to_string(dylib_cnt_++), false);
+    jd.addToSearchOrder(jit_->getMainJITDylib());
+    return &jd;
+}
+
+void HybridSeJitSession::ReleaseQueryDylib(
+    ::llvm::orc::JITDylib* jd, const ::llvm::orc::SymbolNameSet& symbols) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (!symbols.empty()) {
+            ::llvm::Error e = jd->remove(symbols);
+            if (e) {
+                LOG(WARNING) << "fail to remove query symbols: "
+                             << LlvmToString(e);
+            }
+        }
+    }
+    retired_cnt_.fetch_add(1);
+}
+
+bool HybridSeJitSession::OptModule(::llvm::Module* module) {
+    return jit_->OptModule(module);
+}
+
+bool HybridSeJitSession::AddModule(::llvm::orc::JITDylib* jd,
+                                   ::llvm::orc::ThreadSafeModule tsm,
+                                   ::llvm::orc::SymbolNameSet* symbols) {
+    std::lock_guard<std::mutex> lock(mu_);
+    // collect the same symbols IRLayer defines for the module
+    for (auto& gv : tsm.getModule()->global_values()) {
+        if (gv.hasName() && !gv.isDeclaration() && !gv.hasLocalLinkage() &&
+            !gv.hasAvailableExternallyLinkage() &&
+            !gv.hasAppendingLinkage()) {
+            symbols->insert((*mi_)(gv.getName()));
+        }
+    }
+    ::llvm::Error e = jit_->addIRModule(*jd, std::move(tsm));
+    if (e) {
+        LOG(WARNING) << "fail to add ir module: " << LlvmToString(e);
+        return false;
+    }
+    return true;
+}
+
+bool HybridSeJitSession::AddExternalFunction(
+    ::llvm::orc::JITDylib* jd, const std::string& name, void* addr,
+    ::llvm::orc::SymbolNameSet* symbols) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!HybridSeJit::AddSymbol(*jd, *mi_, name, addr)) {
+        return false;
+    }
+    symbols->insert((*mi_)(name));
+    return true;
+}
+
+RawPtrHandle HybridSeJitSession::FindFunction(::llvm::orc::JITDylib* jd,
+                                              const std::string& funcname) {
+    if (funcname == "") {
+        return 0;
+    }
+    // lookup materializes modules with the single compiler of session
+    std::lock_guard<std::mutex> lock(mu_);
+    ::llvm::Expected<::llvm::JITEvaluatedSymbol> symbol(
+        jit_->lookup(*jd, funcname));
+    ::llvm::Error e = symbol.takeError();
+    if (e) {
+        LOG(WARNING) << "fail to resolve fn address of" << funcname << ": "
+                     << LlvmToString(e);
+        return 0;
+    }
+    return reinterpret_cast<const int8_t*>(symbol->getAddress());
+}
+
+HybridSeSharedJitWrapper::~HybridSeSharedJitWrapper() {
+    if (session_ != nullptr && jd_ != nullptr) {
+        session_->ReleaseQueryDylib(jd_, symbols_);
+    }
+}
+
+bool HybridSeSharedJitWrapper::Init() {
+    session_ = HybridSeJitSession::GetShared(jit_options_, object_cache_);
+    if (session_ == nullptr) {
+        return false;
+    }
+    jd_ = session_->CreateQueryDylib();
+    return true;
+}
+
+bool HybridSeSharedJitWrapper::OptModule(::llvm::Module* module) {
+    return session_->OptModule(module);
+}
+
+bool HybridSeSharedJitWrapper::AddModule(
+    std::unique_ptr<llvm::Module> module,
+    std::unique_ptr<llvm::LLVMContext> llvm_ctx) {
+    return session_->AddModule(
+        jd_,
+        ::llvm::orc::ThreadSafeModule(std::move(module), std::move(llvm_ctx)),
+        &symbols_);
+}
+
+bool HybridSeSharedJitWrapper::AddExternalFunction(const std::string& name,
+                                                   void* addr) {
+    return session_->AddExternalFunction(jd_, name, addr, &symbols_);
+}
+
+RawPtrHandle HybridSeSharedJitWrapper::FindFunction(
+    const std::string& funcname) {
+    return session_->FindFunction(jd_, funcname);
+}
+
 #ifdef LLVM_EXT_ENABLE
 bool HybridSeMcJitWrapper::Init() { return true; }
 
 bool HybridSeMcJitWrapper::OptModule(::llvm::Module* module) {
     DLOG(INFO) << "Module before opt:\n" << LlvmToString(*module);
-    RunDefaultOptPasses(module);
+    auto jtmb = CreateTargetMachineBuilder(jit_options_);
+    if (!jtmb) {
+        LOG(WARNING) << "fail to detect host target: "
+                     << LlvmToString(jtmb.takeError());
+        return false;
+    }
+    if (!RunOptPasses(module, jit_options_.opt_level(), &*jtmb)) {
+        return false;
+    }
     DLOG(INFO) << "Module after opt:\n" << LlvmToString(*module);
     return true;
 }
@@ -236,7 +562,9 @@ bool HybridSeMcJitWrapper::AddModule(
             engine_builder.setEngineKind(llvm::EngineKind::JIT)
                 .setErrorStr(&err_str_)
                 .setVerifyModules(true)
-                .setOptLevel(::llvm::CodeGenOpt::Level::Default)
+                .setOptLevel(jit_options_.opt_level() < 0
+                                 ? ::llvm::CodeGenOpt::Level::Default
+                                 : GetCodeGenOptLevel(jit_options_.opt_level()))
                 .setSymbolResolver(
                     std::unique_ptr<::llvm::LegacyJITSymbolResolver>(
                         ::llvm::cast<::llvm::LegacyJITSymbolResolver>(
@@ -17,11 +17,16 @@
 #ifndef SRC_VM_JIT_H_
 #define SRC_VM_JIT_H_
 
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "vm/engine_context.h"
+#include "vm/jit_object_cache.h"
 #include "vm/jit_wrapper.h"
 
 #ifdef LLVM_EXT_ENABLE
@@ -42,6 +47,10 @@ class HybridSeJit : public ::llvm::orc::LLJIT {
     friend class ::llvm::orc::LLJITBuilderSetters;
 
  public:
+    // create a jit compiling through the object cache if it is not null
+    static ::llvm::Expected<std::unique_ptr<HybridSeJit>> Create(
+        const JitOptions& jit_options, JitObjectCache* object_cache);
+
     void Init();
 
     ::llvm::Error AddIRModule(::llvm::orc::JITDylib& jd,  // NOLINT
@@ -68,6 +77,12 @@ class HybridSeJit : public ::llvm::orc::LLJIT {
 
  protected:
     HybridSeJit(::llvm::orc::LLJITBuilderState& s, ::llvm::Error& e);  // NOLINT
+
+ private:
+    JitObjectCache* object_cache_ = nullptr;
+    int opt_level_ = -1;
+    // target of generated code, used by target aware optimizations
+    std::unique_ptr<::llvm::orc::JITTargetMachineBuilder> jtmb_;
 };
 
 class HybridSeJitBuilder
@@ -88,6 +103,9 @@ std::string LlvmToString(const T& value) {
 class HybridSeLlvmJitWrapper : public HybridSeJitWrapper {
  public:
     HybridSeLlvmJitWrapper() {}
+    HybridSeLlvmJitWrapper(const JitOptions& jit_options,
+                           JitObjectCache* object_cache)
+        : jit_options_(jit_options), object_cache_(object_cache) {}
     ~HybridSeLlvmJitWrapper() {}
 
     bool Init() override;
@@ -103,8 +121,93 @@ class HybridSeLlvmJitWrapper : public HybridSeJitWrapper {
         const std::string& funcname) override;
 
  private:
+    JitOptions jit_options_;
+    JitObjectCache* object_cache_ = nullptr;
+    std::unique_ptr<HybridSeJit> jit_;
+    std::unique_ptr<::llvm::orc::MangleAndInterner> mi_;
+};
+
+/**
+ * A process wide LLJIT session shared by compiled queries. Builtin and
+ * default udf symbols are registered once into the main JITDylib, each
+ * query owns a child JITDylib that searches the main one.
+ *
+ * LLVM 9 can not drop a JITDylib or the object memory behind it, so query
+ * symbols are removed when the query is released and the whole session is
+ * retired after `max_retired_dylibs` releases. A retired session is freed
+ * once the last query still using it is evicted.
+ */
+class HybridSeJitSession {
+ public:
+    ~HybridSeJitSession() {}
+
+    // sessions are shared by queries of the same opt level, host cpu
+    // features, udf bitcode option and object cache
+    static std::shared_ptr<HybridSeJitSession> GetShared(
+        const JitOptions& jit_options, JitObjectCache* object_cache);
+
+    ::llvm::orc::JITDylib* CreateQueryDylib();
+
+    void ReleaseQueryDylib(::llvm::orc::JITDylib* jd,
+                           const ::llvm::orc::SymbolNameSet& symbols);
+
+    bool OptModule(::llvm::Module* module);
+
+    bool AddModule(::llvm::orc::JITDylib* jd,
+                   ::llvm::orc::ThreadSafeModule tsm,
+                   ::llvm::orc::SymbolNameSet* symbols);
+
+    bool AddExternalFunction(::llvm::orc::JITDylib* jd,
+                             const std::string& name, void* addr,
+                             ::llvm::orc::SymbolNameSet* symbols);
+
+    RawPtrHandle FindFunction(::llvm::orc::JITDylib* jd,
+                              const std::string& funcname);
+
+    uint64_t retired_cnt() const { return retired_cnt_.load(); }
+
+    static const uint64_t max_retired_dylibs = 4096;
+
+ private:
+    HybridSeJitSession() {}
+    bool Init(const JitOptions& jit_options, JitObjectCache* object_cache);
+
+    // guard module compilation and symbol table updates of the session
+    std::mutex mu_;
     std::unique_ptr<HybridSeJit> jit_;
     std::unique_ptr<::llvm::orc::MangleAndInterner> mi_;
+    uint64_t dylib_cnt_ = 0;
+    std::atomic<uint64_t> retired_cnt_{0};
+};
+
+class HybridSeSharedJitWrapper : public HybridSeJitWrapper {
+ public:
+    HybridSeSharedJitWrapper() {}
+    HybridSeSharedJitWrapper(const JitOptions& jit_options,
+                             JitObjectCache* object_cache)
+        : jit_options_(jit_options), object_cache_(object_cache) {}
+    ~HybridSeSharedJitWrapper();
+
+    bool Init() override;
+
+    bool OptModule(::llvm::Module* module) override;
+
+    bool AddModule(std::unique_ptr<llvm::Module> module,
+                   std::unique_ptr<llvm::LLVMContext> llvm_ctx) override;
+
+    bool AddExternalFunction(const std::string& name, void* addr) override;
+
+    hybridse::vm::RawPtrHandle FindFunction(
+        const std::string& funcname) override;
+
+    bool IsSharedSession() const override { return true; }
+
+ private:
+    JitOptions jit_options_;
+    JitObjectCache* object_cache_ = nullptr;
+    std::shared_ptr<HybridSeJitSession> session_ = nullptr;
+    ::llvm::orc::JITDylib* jd_ = nullptr;
+    ::llvm::orc::SymbolNameSet symbols_;
 };
 
 #ifdef LLVM_EXT_ENABLE
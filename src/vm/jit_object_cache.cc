@@ -0,0 +1,197 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/jit_object_cache.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include "boost/filesystem.hpp"
+#include "glog/logging.h"
+#include "hybridse_version.h"  // NOLINT
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace hybridse {
+namespace vm {
+
+static const char OBJECT_CACHE_KEY_PREFIX[] = "hybridse_plan_";
+static const char OBJECT_CACHE_MAGIC[] = "HYBRIDSE_OBJ_V1";
+
+static std::string Sha1Hex(::llvm::StringRef data) {
+    auto digest = ::llvm::SHA1::hash(::llvm::ArrayRef<uint8_t>(
+        reinterpret_cast<const uint8_t*>(data.data()), data.size()));
+    return ::llvm::toHex(::llvm::StringRef(
+        reinterpret_cast<const char*>(digest.data()), digest.size()));
+}
+
+JitObjectCache::JitObjectCache(const std::string& cache_dir)
+    : cache_dir_(cache_dir) {
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(cache_dir_, ec);
+    if (ec) {
+        LOG(WARNING) << "fail to create object cache dir " << cache_dir_
+                     << ": " << ec.message();
+    }
+}
+
+JitObjectCache* JitObjectCache::Get(const std::string& cache_dir) {
+    static std::mutex mu;
+    static std::map<std::string, std::unique_ptr<JitObjectCache>> caches;
+    std::lock_guard<std::mutex> lock(mu);
+    auto& cache = caches[cache_dir];
+    if (cache == nullptr) {
+        cache.reset(new JitObjectCache(cache_dir));
+    }
+    return cache.get();
+}
+
+std::string JitObjectCache::ComputeKey(const std::string& compile_info,
+                                       const ::llvm::Module& module) {
+    std::string key_str;
+    ::llvm::raw_string_ostream ss(key_str);
+    ss << "hybridse " << HYBRIDSE_VERSION_MAJOR << "."
+       << HYBRIDSE_VERSION_MINOR << "." << HYBRIDSE_VERSION_BUG
+       << "\nllvm " << LLVM_VERSION_STRING << "\n"
+       << ::llvm::sys::getProcessTriple() << " "
+       << ::llvm::sys::getHostCPUName() << "\n"
+       << compile_info << "\n"
+       << module;
+    ss.flush();
+    return OBJECT_CACHE_KEY_PREFIX + Sha1Hex(key_str);
+}
+
+bool JitObjectCache::IsCacheable(const std::string& module_id) {
+    return module_id.compare(0, sizeof(OBJECT_CACHE_KEY_PREFIX) - 1,
+                             OBJECT_CACHE_KEY_PREFIX) == 0;
+}
+
+std::string JitObjectCache::GetPath(const std::string& module_id) const {
+    return cache_dir_ + "/" + module_id + ".o";
+}
+
+bool JitObjectCache::Load(const std::string& module_id, std::string* obj) {
+    std::ifstream in(GetPath(module_id), std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    std::string magic;
+    std::string key;
+    std::string digest;
+    if (!std::getline(in, magic) || !std::getline(in, key) ||
+        !std::getline(in, digest)) {
+        return false;
+    }
+    std::stringstream buf;
+    buf << in.rdbuf();
+    *obj = buf.str();
+    if (magic != OBJECT_CACHE_MAGIC || key != module_id ||
+        digest != Sha1Hex(*obj)) {
+        LOG(WARNING) << "Ignore broken object cache " << GetPath(module_id);
+        return false;
+    }
+    return true;
+}
+
+bool JitObjectCache::PinObject(const ::llvm::Module* module) {
+    const std::string& module_id = module->getModuleIdentifier();
+    if (!IsCacheable(module_id)) {
+        return false;
+    }
+    std::string obj;
+    if (!Load(module_id, &obj)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    pinned_objects_[module] = std::make_pair(module_id, std::move(obj));
+    return true;
+}
+
+void JitObjectCache::notifyObjectCompiled(const ::llvm::Module* module,
+                                          ::llvm::MemoryBufferRef obj) {
+    const std::string& module_id = module->getModuleIdentifier();
+    if (!IsCacheable(module_id)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto iter = pinned_objects_.find(module);
+        if (iter != pinned_objects_.end() && iter->second.first == module_id) {
+            // compiled without its pinned object, the module skipped the
+            // optimizer and must not replace an optimized object
+            LOG(WARNING) << "Skip caching object of unoptimized module "
+                         << module_id;
+            pinned_objects_.erase(iter);
+            return;
+        }
+    }
+    // write a temporary file first so readers never see a partial object
+    std::string path = GetPath(module_id);
+    std::string tmp_path =
+        path + ".tmp" + std::to_string(reinterpret_cast<uintptr_t>(module));
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            LOG(WARNING) << "fail to open object cache file " << tmp_path;
+            return;
+        }
+        out << OBJECT_CACHE_MAGIC << "\n"
+            << module_id << "\n"
+            << Sha1Hex(obj.getBuffer()) << "\n";
+        out.write(obj.getBufferStart(), obj.getBufferSize());
+        if (!out.good()) {
+            LOG(WARNING) << "fail to write object cache file " << tmp_path;
+            out.close();
+            std::remove(tmp_path.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        LOG(WARNING) << "fail to save object cache file " << path;
+        std::remove(tmp_path.c_str());
+    }
+}
+
+std::unique_ptr<::llvm::MemoryBuffer> JitObjectCache::getObject(
+    const ::llvm::Module* module) {
+    const std::string& module_id = module->getModuleIdentifier();
+    std::string obj;
+    {
+        // only a module pinned its object, other modules of the same id were
+        // optimized on a miss and are compiled
+        std::lock_guard<std::mutex> lock(mu_);
+        auto iter = pinned_objects_.find(module);
+        if (iter == pinned_objects_.end()) {
+            return nullptr;
+        }
+        // a stale pin of a former module at the same address
+        bool stale = iter->second.first != module_id;
+        obj = std::move(iter->second.second);
+        pinned_objects_.erase(iter);
+        if (stale) {
+            return nullptr;
+        }
+    }
+    DLOG(INFO) << "Load compiled object of " << module_id << " from cache";
+    return ::llvm::MemoryBuffer::getMemBufferCopy(obj, module_id);
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VM_JIT_OBJECT_CACHE_H_
+#define SRC_VM_JIT_OBJECT_CACHE_H_
+
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace hybridse {
+namespace vm {
+
+/**
+ * On-disk cache of compiled sql modules. Only modules whose identifier is
+ * a key built by `ComputeKey` are cached, one file per key under the cache
+ * directory. Each file records the key and a digest of the object code, a
+ * file failing the check is ignored and the module is compiled again.
+ */
+class JitObjectCache : public ::llvm::ObjectCache {
+ public:
+    explicit JitObjectCache(const std::string& cache_dir);
+    ~JitObjectCache() {}
+
+    // process wide cache instance of the directory
+    static JitObjectCache* Get(const std::string& cache_dir);
+
+    // build the module key from the compile inputs of a sql and its ir,
+    // schema changes of the catalog always change the ir
+    static std::string ComputeKey(const std::string& compile_info,
+                                  const ::llvm::Module& module);
+
+    static bool IsCacheable(const std::string& module_id);
+
+    // load and check the cached object of `module` and pin it to the module
+    // until the compiler takes it by `getObject`, so a module left
+    // unoptimized for the cache never misses it. Return false on a miss, the
+    // module should be optimized then
+    bool PinObject(const ::llvm::Module* module);
+
+    void notifyObjectCompiled(const ::llvm::Module* module,
+                              ::llvm::MemoryBufferRef obj) override;
+
+    std::unique_ptr<::llvm::MemoryBuffer> getObject(
+        const ::llvm::Module* module) override;
+
+ private:
+    std::string GetPath(const std::string& module_id) const;
+    bool Load(const std::string& module_id, std::string* obj);
+
+    const std::string cache_dir_;
+    std::mutex mu_;
+    // module -> (module id, object) pinned and not yet taken
+    std::map<const ::llvm::Module*, std::pair<std::string, std::string>>
+        pinned_objects_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // SRC_VM_JIT_OBJECT_CACHE_H_
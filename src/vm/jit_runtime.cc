@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 #include "vm/jit_runtime.h"
+#include "gflags/gflags.h"
+
+DECLARE_bool(enable_jit_runtime_arena);
+DECLARE_int32(jit_runtime_arena_idle_threshold);
 
 namespace hybridse {
 namespace vm {
@@ -26,6 +30,31 @@ int8_t* JitRuntime::AllocManaged(size_t bytes) {
     return reinterpret_cast<int8_t*>(mem_pool_.Alloc(bytes));
 }
 
+int8_t* JitRuntime::AllocRow(size_t bytes) {
+    if (row_allocator_ != nullptr) {
+        return row_allocator_->Alloc(bytes);
+    }
+    return base::RefCountedSlice::AllocInline(bytes);
+}
+
+base::RefCountedSlice JitRuntime::CreateRowSlice(int8_t* buf, size_t bytes) {
+    if (row_allocator_ != nullptr) {
+        return base::SlabAllocator::CreateSlice(buf, bytes);
+    }
+    return base::RefCountedSlice::CreateManagedInline(buf, bytes);
+}
+
+base::SlabAllocator* JitRuntime::SetRowAllocator(
+    base::SlabAllocator* allocator) {
+    auto prev = row_allocator_;
+    row_allocator_ = allocator;
+    return prev;
+}
+
+int8_t* JitRuntime::AllocRowBuf(int32_t bytes) {
+    return get()->AllocRow(bytes);
+}
+
 void JitRuntime::AddManagedObject(base::FeBaseObject* obj) {
     if (obj != nullptr) {
         allocated_obj_pool_.push_back(obj);
@@ -35,7 +64,13 @@ void JitRuntime::AddManagedObject(base::FeBaseObject* obj) {
 void JitRuntime::InitRunStep() {}
 
 void JitRuntime::ReleaseRunStep() {
-    mem_pool_.Reset();
+    if (FLAGS_enable_jit_runtime_arena) {
+        mem_pool_.Rewind(FLAGS_jit_runtime_arena_idle_threshold > 0
+                             ? FLAGS_jit_runtime_arena_idle_threshold
+                             : 0);
+    } else {
+        mem_pool_.Reset();
+    }
     for (base::FeBaseObject* obj : allocated_obj_pool_) {
         if (obj != nullptr) {
             delete obj;
@@ -19,14 +19,16 @@
 #include <list>
 
 #include "base/fe_object.h"
+#include "base/fe_slice.h"
 #include "base/mem_pool.h"
+#include "base/slab_allocator.h"
 
 namespace hybridse {
 namespace vm {
 
 class JitRuntime {
  public:
-    JitRuntime() {}
+    JitRuntime() : row_allocator_(nullptr) {}
 
     /**
      * Get TLS JIT runtime instance.
@@ -56,9 +58,41 @@ class JitRuntime {
      */
     void ReleaseRunStep();
 
+    /**
+     * Allocate buffer for a codegen output row. The buffer is carved from
+     * the row allocator of current thread if there is one, or else it is
+     * malloc-ed together with its ref count cell. Wrap it with
+     * `CreateRowSlice()` on the same thread.
+     */
+    int8_t* AllocRow(size_t bytes);
+
+    /**
+     * Create managed slice for buffer returned by `AllocRow()`.
+     */
+    base::RefCountedSlice CreateRowSlice(int8_t* buf, size_t bytes);
+
+    /**
+     * Install row allocator for current thread, null to fallback to
+     * malloc. Return the previous one.
+     */
+    base::SlabAllocator* SetRowAllocator(base::SlabAllocator* allocator);
+
+    /**
+     * Output row allocation entry for codegen
+     */
+    static int8_t* AllocRowBuf(int32_t bytes);
+
+    /**
+     * Return memory stats of the runtime of current thread
+     */
+    const base::MemoryPoolStats& GetMemPoolStats() const {
+        return mem_pool_.stats();
+    }
+
  private:
     base::ByteMemoryPool mem_pool_;
     std::list<base::FeBaseObject*> allocated_obj_pool_;
+    base::SlabAllocator* row_allocator_;
 
     static thread_local JitRuntime tls_runtime_inst_;
 };
@@ -39,6 +39,7 @@
 #include "udf/default_udf_library.h"
 #include "udf/udf.h"
 #include "vm/jit.h"
+#include "vm/jit_runtime.h"
 
 namespace hybridse {
 namespace vm {
@@ -70,20 +71,27 @@ HybridSeJitWrapper* HybridSeJitWrapper::Create() {
 }
 
 HybridSeJitWrapper* HybridSeJitWrapper::Create(const JitOptions& jit_options) {
+    JitObjectCache* object_cache = nullptr;
+    if (!jit_options.object_cache_dir().empty()) {
+        object_cache = JitObjectCache::Get(jit_options.object_cache_dir());
+    }
     if (jit_options.is_enable_mcjit()) {
 #ifdef LLVM_EXT_ENABLE
         LOG(INFO) << "Create McJit engine";
         return new HybridSeMcJitWrapper(jit_options);
 #else
         LOG(WARNING) << "McJit support is not enabled";
-        return new HybridSeLlvmJitWrapper();
+        return new HybridSeLlvmJitWrapper(jit_options, object_cache);
 #endif
     } else {
         if (jit_options.is_enable_vtune() || jit_options.is_enable_perf() ||
             jit_options.is_enable_gdb()) {
             LOG(WARNING) << "LLJIT do not support jit events";
         }
-        return new HybridSeLlvmJitWrapper();
+        if (jit_options.is_enable_shared_session()) {
+            return new HybridSeSharedJitWrapper(jit_options, object_cache);
+        }
+        return new HybridSeLlvmJitWrapper(jit_options, object_cache);
     }
 }
 
@@ -93,6 +101,27 @@ void HybridSeJitWrapper::DeleteJit(HybridSeJitWrapper* jit) {
     }
 }
 
+template <typename T>
+static void AddWindowColumnAggSymbols(HybridSeJitWrapper* jit,
+                                      const std::string& type_name) {
+    const std::string prefix = "hybridse_storage_window_column_";
+    jit->AddExternalFunction(
+        prefix + "sum_" + type_name,
+        reinterpret_cast<void*>(&hybridse::vm::WindowColumnSum<T>));
+    jit->AddExternalFunction(
+        prefix + "count_" + type_name,
+        reinterpret_cast<void*>(&hybridse::vm::WindowColumnCount<T>));
+    jit->AddExternalFunction(
+        prefix + "min_" + type_name,
+        reinterpret_cast<void*>(&hybridse::vm::WindowColumnMin<T>));
+    jit->AddExternalFunction(
+        prefix + "max_" + type_name,
+        reinterpret_cast<void*>(&hybridse::vm::WindowColumnMax<T>));
+    jit->AddExternalFunction(
+        prefix + "avg_" + type_name,
+        reinterpret_cast<void*>(&hybridse::vm::WindowColumnAvg<T>));
+}
+
 void InitBuiltinJitSymbols(HybridSeJitWrapper* jit) {
     jit->AddExternalFunction("malloc", (reinterpret_cast<void*>(&malloc)));
     jit->AddExternalFunction("memset", (reinterpret_cast<void*>(&memset)));
@@ -197,6 +226,50 @@ void InitBuiltinJitSymbols(HybridSeJitWrapper* jit) {
     jit->AddExternalFunction(
         "hybridse_storage_row_iter_delete",
         reinterpret_cast<void*>(&hybridse::vm::RowIterDelete));
+    jit->AddExternalFunction(
+        "hybridse_storage_get_window_agg_state",
+        reinterpret_cast<void*>(&hybridse::vm::GetWindowAggState));
+    jit->AddExternalFunction(
+        "hybridse_storage_get_window_delta_iter",
+        reinterpret_cast<void*>(&hybridse::vm::GetWindowDeltaIter));
+    jit->AddExternalFunction(
+        "hybridse_storage_get_window_delta_list",
+        reinterpret_cast<void*>(&hybridse::vm::GetWindowDeltaList));
+    jit->AddExternalFunction(
+        "hybridse_storage_get_window_agg_int_queue",
+        reinterpret_cast<void*>(&hybridse::vm::GetWindowAggIntQueue));
+    jit->AddExternalFunction(
+        "hybridse_storage_get_window_agg_real_queue",
+        reinterpret_cast<void*>(&hybridse::vm::GetWindowAggRealQueue));
+    jit->AddExternalFunction(
+        "hybridse_storage_window_agg_int_queue_push",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggIntQueuePush));
+    jit->AddExternalFunction(
+        "hybridse_storage_window_agg_int_queue_push_front",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggIntQueuePushFront));
+    jit->AddExternalFunction(
+        "hybridse_storage_window_agg_int_queue_pop",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggIntQueuePop));
+    jit->AddExternalFunction(
+        "hybridse_storage_window_agg_int_queue_front",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggIntQueueFront));
+    jit->AddExternalFunction(
+        "hybridse_storage_window_agg_real_queue_push",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggRealQueuePush));
+    jit->AddExternalFunction(
+        "hybridse_storage_window_agg_real_queue_push_front",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggRealQueuePushFront));
+    jit->AddExternalFunction(
+        "hybridse_storage_window_agg_real_queue_pop",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggRealQueuePop));
+    jit->AddExternalFunction(
+        "hybridse_storage_window_agg_real_queue_front",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggRealQueueFront));
+    AddWindowColumnAggSymbols<int16_t>(jit, "int16");
+    AddWindowColumnAggSymbols<int32_t>(jit, "int32");
+    AddWindowColumnAggSymbols<int64_t>(jit, "int64");
+    AddWindowColumnAggSymbols<float>(jit, "float");
+    AddWindowColumnAggSymbols<double>(jit, "double");
     jit->AddExternalFunction(
         "hybridse_storage_get_row_slice",
         reinterpret_cast<void*>(&hybridse::vm::RowGetSlice));
@@ -204,6 +277,10 @@ void InitBuiltinJitSymbols(HybridSeJitWrapper* jit) {
         "hybridse_storage_get_row_slice_size",
         reinterpret_cast<void*>(&hybridse::vm::RowGetSliceSize));
 
+    jit->AddExternalFunction(
+        "hybridse_alloc_row",
+        reinterpret_cast<void*>(&hybridse::vm::JitRuntime::AllocRowBuf));
+
     jit->AddExternalFunction(
         "hybridse_memery_pool_alloc",
         reinterpret_cast<void*>(&udf::v1::AllocManagedStringBuf));
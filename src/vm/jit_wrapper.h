@@ -51,6 +51,10 @@ class HybridSeJitWrapper {
     virtual hybridse::vm::RawPtrHandle FindFunction(
         const std::string& funcname) = 0;
 
+    // return true if builtin and default udf symbols are already
+    // registered by a shared jit session
+    virtual bool IsSharedSession() const { return false; }
+
     static HybridSeJitWrapper* Create(const JitOptions& jit_options);
     static HybridSeJitWrapper* Create();
     static void DeleteJit(HybridSeJitWrapper* jit);
@@ -15,10 +15,15 @@
  */
 
 #include "vm/jit_wrapper.h"
+#include <fstream>
+#include "boost/filesystem.hpp"
 #include "codec/fe_row_codec.h"
 #include "gtest/gtest.h"
 #include "udf/udf.h"
+#include "udf/udf_bitcode.h"
 #include "vm/engine.h"
+#include "vm/jit.h"
+#include "vm/jit_object_cache.h"
 #include "vm/simple_catalog.h"
 #include "vm/sql_compiler.h"
 
@@ -105,6 +110,16 @@ TEST_F(JitWrapperTest, test) {
     simple_test(options);
 }
 
+TEST_F(JitWrapperTest, test_opt_level) {
+    for (int level = 0; level <= 3; ++level) {
+        EngineOptions options;
+        options.set_keep_ir(true);
+        options.jit_options().set_opt_level(level);
+        options.jit_options().set_enable_host_cpu_features(true);
+        simple_test(options);
+    }
+}
+
 #ifdef LLVM_EXT_ENABLE
 TEST_F(JitWrapperTest, test_mcjit) {
     EngineOptions options;
@@ -117,6 +132,193 @@ TEST_F(JitWrapperTest, test_mcjit) {
 }
 #endif
 
+void CheckRowProject(const int8_t *fn, std::shared_ptr<SimpleCatalog> catalog,
+                     double c1_value, int64_t c2_value) {
+    ASSERT_TRUE(fn != nullptr);
+    int8_t buf[1024];
+    auto schema = catalog->GetTable("db", "t1")->GetSchema();
+    codec::RowBuilder row_builder(*schema);
+    row_builder.SetBuffer(buf, 1024);
+    row_builder.AppendDouble(c1_value);
+    row_builder.AppendInt64(c2_value);
+
+    hybridse::codec::Row empty_parameter;
+    hybridse::codec::Row row(base::RefCountedSlice::Create(buf, 1024));
+    hybridse::codec::Row output = CoreAPI::RowProject(fn, row, empty_parameter);
+    codec::RowView row_view(*schema, output.buf(), output.size());
+    double c1;
+    int64_t c2;
+    ASSERT_EQ(row_view.GetDouble(0, &c1), 0);
+    ASSERT_EQ(row_view.GetInt64(1, &c2), 0);
+    ASSERT_EQ(c1, c1_value);
+    ASSERT_EQ(c2, c2_value);
+}
+
+TEST_F(JitWrapperTest, test_shared_session) {
+    EngineOptions options;
+    options.jit_options().set_enable_shared_session(true);
+    auto catalog = GetTestCatalog();
+    std::string sql = "select col_1, col_2 from t1;";
+    auto info1 = Compile(sql, options, catalog);
+    ASSERT_TRUE(info1 != nullptr);
+    ASSERT_TRUE(info1->get_sql_context().jit->IsSharedSession());
+    auto info2 = Compile(sql, options, catalog);
+    ASSERT_TRUE(info2 != nullptr);
+
+    // each query is compiled into its own dylib of the shared session
+    auto fn1 = info1->get_sql_context().physical_plan->GetFnInfos()[0];
+    auto fn2 = info2->get_sql_context().physical_plan->GetFnInfos()[0];
+    ASSERT_NE(fn1->fn_ptr(), fn2->fn_ptr());
+    CheckRowProject(fn1->fn_ptr(), catalog, 3.14, 42);
+
+    // release one query and the other one keeps working
+    info2 = nullptr;
+    CheckRowProject(fn1->fn_ptr(), catalog, 3.14, 42);
+    auto info3 = Compile(sql, options, catalog);
+    ASSERT_TRUE(info3 != nullptr);
+    CheckRowProject(
+        info3->get_sql_context().physical_plan->GetFnInfos()[0]->fn_ptr(),
+        catalog, 1.5, 7);
+}
+
+TEST_F(JitWrapperTest, test_shared_session_options) {
+    // queries compiled with different options do not share a session
+    JitOptions o0;
+    o0.set_opt_level(0);
+    JitOptions o2;
+    o2.set_opt_level(2);
+    JitOptions o2_host = o2;
+    o2_host.set_enable_host_cpu_features(true);
+    auto s0 = HybridSeJitSession::GetShared(o0, nullptr);
+    auto s2 = HybridSeJitSession::GetShared(o2, nullptr);
+    auto s2_host = HybridSeJitSession::GetShared(o2_host, nullptr);
+    ASSERT_TRUE(s0 != nullptr && s2 != nullptr && s2_host != nullptr);
+    ASSERT_NE(s0, s2);
+    ASSERT_NE(s2, s2_host);
+    ASSERT_EQ(s0, HybridSeJitSession::GetShared(o0, nullptr));
+}
+
+TEST_F(JitWrapperTest, test_udf_bitcode) {
+    EngineOptions options;
+    options.set_keep_ir(true);
+    options.jit_options().set_enable_udf_bitcode(true);
+    auto catalog = GetTestCatalog();
+    auto info = Compile(
+        "select day(col_2) as c1, month(col_2) as c2, year(col_2) as c3, "
+        "dayofweek(col_2) as c4 from t1;",
+        options, catalog);
+    ASSERT_TRUE(info != nullptr);
+    auto &sql_context = info->get_sql_context();
+    if (udf::IsUdfBitcodeAvailable()) {
+        // inlined, no external call left
+        ASSERT_EQ(std::string::npos, sql_context.ir.find("dayofmonth.int64"));
+    }
+
+    int8_t buf[1024];
+    auto schema = catalog->GetTable("db", "t1")->GetSchema();
+    codec::RowBuilder row_builder(*schema);
+    row_builder.SetBuffer(buf, 1024);
+    row_builder.AppendDouble(0.0);
+    int64_t ts = 1590115420000L;
+    row_builder.AppendInt64(ts);
+    hybridse::codec::Row empty_parameter;
+    hybridse::codec::Row row(base::RefCountedSlice::Create(buf, 1024));
+    auto fn = sql_context.physical_plan->GetFnInfos()[0]->fn_ptr();
+    ASSERT_TRUE(fn != nullptr);
+    hybridse::codec::Row output = CoreAPI::RowProject(fn, row, empty_parameter);
+    codec::RowView row_view(sql_context.schema, output.buf(), output.size());
+    int32_t day, month, year, weekday;
+    ASSERT_EQ(row_view.GetInt32(0, &day), 0);
+    ASSERT_EQ(row_view.GetInt32(1, &month), 0);
+    ASSERT_EQ(row_view.GetInt32(2, &year), 0);
+    ASSERT_EQ(row_view.GetInt32(3, &weekday), 0);
+    ASSERT_EQ(udf::v1::dayofmonth(ts), day);
+    ASSERT_EQ(udf::v1::month(ts), month);
+    ASSERT_EQ(udf::v1::year(ts), year);
+    ASSERT_EQ(udf::v1::dayofweek(ts), weekday);
+}
+
+size_t CountCacheFiles(const std::string &cache_dir) {
+    size_t cnt = 0;
+    for (auto &entry : boost::filesystem::directory_iterator(cache_dir)) {
+        if (entry.path().extension() == ".o") {
+            cnt += 1;
+        }
+    }
+    return cnt;
+}
+
+TEST_F(JitWrapperTest, test_object_cache) {
+    std::string cache_dir = "/tmp/hybridse_jit_object_cache_test";
+    boost::filesystem::remove_all(cache_dir);
+    EngineOptions options;
+    options.jit_options().set_object_cache_dir(cache_dir);
+    auto catalog = GetTestCatalog();
+    std::string sql = "select col_1, col_2 from t1;";
+
+    auto info1 = Compile(sql, options, catalog);
+    ASSERT_TRUE(info1 != nullptr);
+    ASSERT_EQ(1u, CountCacheFiles(cache_dir));
+    CheckRowProject(
+        info1->get_sql_context().physical_plan->GetFnInfos()[0]->fn_ptr(),
+        catalog, 3.14, 42);
+
+    // compile with a new engine is served by the cached object
+    auto info2 = Compile(sql, options, catalog);
+    ASSERT_TRUE(info2 != nullptr);
+    ASSERT_EQ(1u, CountCacheFiles(cache_dir));
+    CheckRowProject(
+        info2->get_sql_context().physical_plan->GetFnInfos()[0]->fn_ptr(),
+        catalog, 1.5, 7);
+
+    // broken cache file falls back to compilation
+    for (auto &entry : boost::filesystem::directory_iterator(cache_dir)) {
+        std::ofstream out(entry.path().string(), std::ios::app);
+        out << "broken";
+    }
+    auto info3 = Compile(sql, options, catalog);
+    ASSERT_TRUE(info3 != nullptr);
+    CheckRowProject(
+        info3->get_sql_context().physical_plan->GetFnInfos()[0]->fn_ptr(),
+        catalog, 2.5, 8);
+    boost::filesystem::remove_all(cache_dir);
+}
+
+// modules of one key compiled at the same time: a pinned module always gets
+// its object, others are compiled and only optimized ones are cached
+TEST_F(JitWrapperTest, test_object_cache_pin) {
+    std::string cache_dir = "/tmp/hybridse_jit_object_cache_pin_test";
+    boost::filesystem::remove_all(cache_dir);
+    JitObjectCache cache(cache_dir);
+    ::llvm::LLVMContext llvm_ctx;
+    ::llvm::Module empty("empty", llvm_ctx);
+    std::string module_id = JitObjectCache::ComputeKey("pin", empty);
+    ::llvm::Module optimized(module_id, llvm_ctx);
+    ::llvm::Module pinned(module_id, llvm_ctx);
+    ::llvm::Module unpinned(module_id, llvm_ctx);
+
+    ASSERT_FALSE(cache.PinObject(&pinned));
+    cache.notifyObjectCompiled(
+        &optimized, ::llvm::MemoryBufferRef("object", module_id));
+    ASSERT_TRUE(cache.PinObject(&pinned));
+    ASSERT_TRUE(cache.getObject(&unpinned) == nullptr);
+    auto obj = cache.getObject(&pinned);
+    ASSERT_TRUE(obj != nullptr);
+    ASSERT_EQ("object", obj->getBuffer().str());
+    ASSERT_TRUE(cache.getObject(&pinned) == nullptr);
+
+    // a pinned module compiled by itself skipped the optimizer, its object
+    // never replaces the cached one
+    ASSERT_TRUE(cache.PinObject(&pinned));
+    cache.notifyObjectCompiled(
+        &pinned, ::llvm::MemoryBufferRef("unoptimized", module_id));
+    ASSERT_TRUE(cache.PinObject(&unpinned));
+    obj = cache.getObject(&unpinned);
+    ASSERT_TRUE(obj != nullptr);
+    ASSERT_EQ("object", obj->getBuffer().str());
+    boost::filesystem::remove_all(cache_dir);
+}
+
 TEST_F(JitWrapperTest, test_window) {
     EngineOptions options;
     options.set_keep_ir(true);
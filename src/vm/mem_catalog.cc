@@ -16,6 +16,9 @@
 
 #include "vm/mem_catalog.h"
 #include <algorithm>
+#include <type_traits>
+#include "base/fe_hash.h"
+#include "base/simd_agg.h"
 namespace hybridse {
 namespace vm {
 MemTimeTableIterator::MemTimeTableIterator(const MemTimeTable* table,
@@ -133,19 +136,74 @@ void MemTimeTableHandler::PopBackRow() { table_.pop_back(); }
 
 void MemTimeTableHandler::PopFrontRow() { table_.pop_front(); }
 
+Window::~Window() {
+    for (auto& kv : agg_states_) {
+        if (kv.second.release != nullptr) {
+            kv.second.release(kv.second.buf.data());
+        }
+    }
+}
+
+int8_t* Window::GetAggState(const void* key, size_t size, bool* is_delta,
+                            void (*release)(int8_t*)) {
+    track_delta_ = true;
+    delta_consumed_ = true;
+    auto& state = agg_states_[key];
+    *is_delta = delta_valid_ && state.buf.size() == size &&
+                state.step + 1 == step_;
+    // state is recomputed by the caller
+    if (!*is_delta && state.release != nullptr) {
+        state.release(state.buf.data());
+    }
+    if (state.buf.size() != size) {
+        state.buf.resize(size);
+    }
+    state.step = step_;
+    state.release = release;
+    return state.buf.data();
+}
+
+RowIterator* WindowDeltaList::GetRawIterator() {
+    return window_->GetRawDeltaIterator(is_retract_);
+}
+
 const Types& MemTimeTableHandler::GetTypes() { return types_; }
 
-void MemTimeTableHandler::Sort(const bool is_asc) {
-    if (is_asc) {
-        AscComparor comparor;
-        std::sort(table_.begin(), table_.end(), comparor);
-        order_type_ = kAscOrder;
+// Sort rows by key. Rows coming from an ordered source are often in order
+// already or in strictly opposite order, which is checked in one pass, so
+// they are kept or reversed without sorting.
+static void SortTimeTable(MemTimeTable* table, const bool is_asc) {
+    bool in_order = true;
+    bool in_strict_reverse_order = true;
+    for (size_t i = 1; i < table->size(); ++i) {
+        uint64_t prev = (*table)[i - 1].first;
+        uint64_t cur = (*table)[i].first;
+        if (is_asc ? cur < prev : cur > prev) {
+            in_order = false;
+        }
+        if (is_asc ? cur >= prev : cur <= prev) {
+            in_strict_reverse_order = false;
+        }
+        if (!in_order && !in_strict_reverse_order) {
+            break;
+        }
+    }
+    if (in_order) {
+        return;
+    }
+    if (in_strict_reverse_order) {
+        std::reverse(table->begin(), table->end());
+    } else if (is_asc) {
+        std::sort(table->begin(), table->end(), AscComparor());
     } else {
-        DescComparor comparor;
-        std::sort(table_.begin(), table_.end(), comparor);
-        order_type_ = kDescOrder;
+        std::sort(table->begin(), table->end(), DescComparor());
     }
 }
+
+void MemTimeTableHandler::Sort(const bool is_asc) {
+    SortTimeTable(&table_, is_asc);
+    order_type_ = is_asc ? kAscOrder : kDescOrder;
+}
 void MemTimeTableHandler::Reverse() {
     std::reverse(table_.begin(), table_.end());
     order_type_ = kAscOrder == order_type_
@@ -199,19 +257,10 @@ std::unique_ptr<WindowIterator> MemPartitionHandler::GetWindowIterator() {
         new MemWindowIterator(&partitions_, schema_));
 }
 void MemPartitionHandler::Sort(const bool is_asc) {
-    if (is_asc) {
-        AscComparor comparor;
-        for (auto& segment : partitions_) {
-            std::sort(segment.second.begin(), segment.second.end(), comparor);
-        }
-        order_type_ = kAscOrder;
-    } else {
-        DescComparor comparor;
-        for (auto& segment : partitions_) {
-            std::sort(segment.second.begin(), segment.second.end(), comparor);
-        }
-        order_type_ = kDescOrder;
+    for (auto& segment : partitions_) {
+        SortTimeTable(&segment.second, is_asc);
     }
+    order_type_ = is_asc ? kAscOrder : kDescOrder;
 }
 void MemPartitionHandler::Reverse() {
     for (auto& segment : partitions_) {
@@ -232,6 +281,108 @@ void MemPartitionHandler::Print() {
     }
 }
 
+static const uint64_t EMPTY_SLOT = UINT64_MAX;
+static const uint32_t HASH_SEED = 0xe17a1465;
+
+HashWindowIterator::HashWindowIterator(const HashPartitionHandler* partitions,
+                                       const Schema* schema)
+    : WindowIterator(), partitions_(partitions), schema_(schema), pos_(0) {}
+HashWindowIterator::~HashWindowIterator() {}
+void HashWindowIterator::Seek(const std::string& key) {
+    pos_ = partitions_->Find(key);
+}
+void HashWindowIterator::SeekToFirst() { pos_ = 0; }
+void HashWindowIterator::Next() { pos_++; }
+bool HashWindowIterator::Valid() {
+    return pos_ < partitions_->GetSegmentList().size();
+}
+std::unique_ptr<RowIterator> HashWindowIterator::GetValue() {
+    return std::unique_ptr<RowIterator>(GetRawValue());
+}
+RowIterator* HashWindowIterator::GetRawValue() {
+    return new MemTimeTableIterator(
+        &(partitions_->GetSegmentList()[pos_].second), schema_);
+}
+const Row HashWindowIterator::GetKey() {
+    return Row(partitions_->GetSegmentList()[pos_].first);
+}
+
+HashPartitionHandler::HashPartitionHandler(const Schema* schema)
+    : PartitionHandler(),
+      table_name_(""),
+      db_(""),
+      schema_(schema),
+      slots_(16, EMPTY_SLOT),
+      order_type_(kNoneOrder) {}
+HashPartitionHandler::~HashPartitionHandler() {}
+uint64_t HashPartitionHandler::Hash(const std::string& key) const {
+    return base::MurmurHash64A(key.data(), key.size(), HASH_SEED);
+}
+size_t HashPartitionHandler::Probe(const std::string& key,
+                                   uint64_t hash) const {
+    // capacity of slots is always power of 2
+    size_t mask = slots_.size() - 1;
+    size_t slot = hash & mask;
+    while (slots_[slot] != EMPTY_SLOT) {
+        auto pos = slots_[slot];
+        if (hashes_[pos] == hash && segments_[pos].first == key) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+void HashPartitionHandler::Rehash(size_t capacity) {
+    slots_.assign(capacity, EMPTY_SLOT);
+    size_t mask = capacity - 1;
+    for (size_t pos = 0; pos < segments_.size(); ++pos) {
+        size_t slot = hashes_[pos] & mask;
+        while (slots_[slot] != EMPTY_SLOT) {
+            slot = (slot + 1) & mask;
+        }
+        slots_[slot] = pos;
+    }
+}
+size_t HashPartitionHandler::Find(const std::string& key) const {
+    auto pos = slots_[Probe(key, Hash(key))];
+    return pos == EMPTY_SLOT ? segments_.size() : pos;
+}
+bool HashPartitionHandler::AddRow(const std::string& key, uint64_t ts,
+                                  const Row& row) {
+    uint64_t hash = Hash(key);
+    size_t slot = Probe(key, hash);
+    if (slots_[slot] != EMPTY_SLOT) {
+        segments_[slots_[slot]].second.push_back(std::make_pair(ts, row));
+        return true;
+    }
+    slots_[slot] = segments_.size();
+    hashes_.push_back(hash);
+    segments_.emplace_back(key, MemTimeTable({std::make_pair(ts, row)}));
+    // keep load factor under 0.5
+    if (segments_.size() * 2 > slots_.size()) {
+        Rehash(slots_.size() * 2);
+    }
+    return true;
+}
+std::unique_ptr<WindowIterator> HashPartitionHandler::GetWindowIterator() {
+    return std::unique_ptr<WindowIterator>(
+        new HashWindowIterator(this, schema_));
+}
+void HashPartitionHandler::Sort(const bool is_asc) {
+    for (auto& segment : segments_) {
+        SortTimeTable(&segment.second, is_asc);
+    }
+    order_type_ = is_asc ? kAscOrder : kDescOrder;
+}
+void HashPartitionHandler::Reverse() {
+    for (auto& segment : segments_) {
+        std::reverse(segment.second.begin(), segment.second.end());
+    }
+    order_type_ = kAscOrder == order_type_
+                      ? kDescOrder
+                      : kDescOrder == order_type_ ? kAscOrder : kNoneOrder;
+}
+
 std::unique_ptr<WindowIterator> MemTableHandler::GetWindowIterator(
     const std::string& idx_name) {
     return std::unique_ptr<WindowIterator>();
@@ -382,6 +533,50 @@ RowIterator* RequestUnionTableHandler::GetRawIterator() {
     return new RequestUnionIterator(request_ts_, &request_row_, window_iter);
 }
 
+static void MakeRowsRefCountAtomic(RowIterator* iter) {
+    if (!iter) {
+        return;
+    }
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        // copies of a row share the ref count cells of the row
+        Row row = iter->GetValue();
+        row.MakeRefCountAtomic();
+    }
+}
+
+void MakeRowsRefCountAtomic(const std::shared_ptr<DataHandler>& input) {
+    if (!input) {
+        return;
+    }
+    switch (input->GetHanlderType()) {
+        case kRowHandler: {
+            Row row =
+                std::dynamic_pointer_cast<RowHandler>(input)->GetValue();
+            row.MakeRefCountAtomic();
+            break;
+        }
+        case kTableHandler: {
+            auto iter =
+                std::dynamic_pointer_cast<TableHandler>(input)->GetIterator();
+            MakeRowsRefCountAtomic(iter.get());
+            break;
+        }
+        case kPartitionHandler: {
+            auto partition = std::dynamic_pointer_cast<PartitionHandler>(input);
+            auto window_iter = partition->GetWindowIterator();
+            if (!window_iter) {
+                return;
+            }
+            for (window_iter->SeekToFirst(); window_iter->Valid();
+                 window_iter->Next()) {
+                auto iter = window_iter->GetValue();
+                MakeRowsRefCountAtomic(iter.get());
+            }
+            break;
+        }
+    }
+}
+
 // row iter interfaces for llvm
 void GetRowIter(int8_t* input, int8_t* iter_addr) {
     auto list_ref = reinterpret_cast<codec::ListRef<Row>*>(input);
@@ -417,6 +612,84 @@ void RowIterDelete(int8_t* iter_ptr) {
         *reinterpret_cast<std::unique_ptr<RowIterator>*>(iter_ptr);
     local_iter = nullptr;
 }
+int8_t* GetWindowAggState(int8_t* input, int8_t* key, int32_t size,
+                          bool* is_delta, void (*release)(int8_t*)) {
+    auto list_ref = reinterpret_cast<codec::ListRef<Row>*>(input);
+    auto window = dynamic_cast<Window*>(
+        reinterpret_cast<codec::ListV<Row>*>(list_ref->list));
+    *is_delta = false;
+    if (window == nullptr) {
+        return nullptr;
+    }
+    return window->GetAggState(key, size, is_delta, release);
+}
+void GetWindowDeltaIter(int8_t* input, bool is_retract, int8_t* iter_addr) {
+    auto list_ref = reinterpret_cast<codec::ListRef<Row>*>(input);
+    auto window = static_cast<Window*>(
+        reinterpret_cast<codec::ListV<Row>*>(list_ref->list));
+    auto local_iter = new (iter_addr) std::unique_ptr<RowIterator>(
+        window->GetRawDeltaIterator(is_retract));
+    (*local_iter)->SeekToFirst();
+}
+void GetWindowDeltaList(int8_t* input, bool is_retract, int8_t* output) {
+    auto list_ref = reinterpret_cast<codec::ListRef<Row>*>(input);
+    auto window = static_cast<Window*>(
+        reinterpret_cast<codec::ListV<Row>*>(list_ref->list));
+    auto delta_ref = reinterpret_cast<codec::ListRef<Row>*>(output);
+    delta_ref->list =
+        reinterpret_cast<int8_t*>(window->GetDeltaList(is_retract));
+}
+template <typename T>
+static int8_t* GetWindowAggQueue(int8_t* input, int8_t* key, int32_t idx,
+                                 bool is_min, bool reset) {
+    auto list_ref = reinterpret_cast<codec::ListRef<Row>*>(input);
+    auto window = dynamic_cast<Window*>(
+        reinterpret_cast<codec::ListV<Row>*>(list_ref->list));
+    if (window == nullptr) {
+        return nullptr;
+    }
+    return reinterpret_cast<int8_t*>(
+        window->GetAggQueue<T>(key, idx, is_min, reset));
+}
+int8_t* GetWindowAggIntQueue(int8_t* input, int8_t* key, int32_t idx,
+                             bool is_min, bool reset) {
+    return GetWindowAggQueue<int64_t>(input, key, idx, is_min, reset);
+}
+int8_t* GetWindowAggRealQueue(int8_t* input, int8_t* key, int32_t idx,
+                              bool is_min, bool reset) {
+    return GetWindowAggQueue<double>(input, key, idx, is_min, reset);
+}
+void WindowAggIntQueuePush(int8_t* queue, int64_t value) {
+    reinterpret_cast<MonotonicQueue<int64_t>*>(queue)->Push(value);
+}
+void WindowAggIntQueuePushFront(int8_t* queue, int64_t value) {
+    // queue is absent if input list is not a window
+    if (queue == nullptr) {
+        return;
+    }
+    reinterpret_cast<MonotonicQueue<int64_t>*>(queue)->PushFront(value);
+}
+void WindowAggIntQueuePop(int8_t* queue, int64_t value) {
+    reinterpret_cast<MonotonicQueue<int64_t>*>(queue)->Pop(value);
+}
+int64_t WindowAggIntQueueFront(int8_t* queue) {
+    return reinterpret_cast<MonotonicQueue<int64_t>*>(queue)->Front();
+}
+void WindowAggRealQueuePush(int8_t* queue, double value) {
+    reinterpret_cast<MonotonicQueue<double>*>(queue)->Push(value);
+}
+void WindowAggRealQueuePushFront(int8_t* queue, double value) {
+    if (queue == nullptr) {
+        return;
+    }
+    reinterpret_cast<MonotonicQueue<double>*>(queue)->PushFront(value);
+}
+void WindowAggRealQueuePop(int8_t* queue, double value) {
+    reinterpret_cast<MonotonicQueue<double>*>(queue)->Pop(value);
+}
+double WindowAggRealQueueFront(int8_t* queue) {
+    return reinterpret_cast<MonotonicQueue<double>*>(queue)->Front();
+}
 int8_t* RowGetSlice(int8_t* row_ptr, size_t idx) {
     auto row = reinterpret_cast<Row*>(row_ptr);
     return row->buf(idx);
@@ -425,5 +698,206 @@ size_t RowGetSliceSize(int8_t* row_ptr, size_t idx) {
     auto row = reinterpret_cast<Row*>(row_ptr);
     return row->size(idx);
 }
+
+// get columnar copy of column list `input` if it is a column of window
+template <typename T>
+static WindowColumn<T>* GetWindowColumn(int8_t* input) {
+    auto list_ref = reinterpret_cast<codec::ListRef<T>*>(input);
+    auto column = dynamic_cast<codec::ColumnImpl<T>*>(
+        reinterpret_cast<codec::ListV<T>*>(list_ref->list));
+    if (column == nullptr) {
+        return nullptr;
+    }
+    auto window = dynamic_cast<Window*>(column->root());
+    if (window == nullptr) {
+        return nullptr;
+    }
+    return window->GetColumn<T>(column->row_idx(), column->col_idx(),
+                                column->offset());
+}
+
+// integer sum wraps around the same no matter the order values are added,
+// and null values stored as zero make no difference
+template <typename T>
+static void AccumulateSum(const WindowColumn<T>& column, T* sum,
+                          std::false_type) {
+    *sum = static_cast<T>(
+        static_cast<uint64_t>(*sum) +
+        static_cast<uint64_t>(base::SimdSum(column.values(), column.size())));
+}
+
+// floating point values are added from the newest to the oldest as the
+// list is iterated, so that the result is exactly the same
+template <typename T>
+static void AccumulateSum(const WindowColumn<T>& column, T* sum,
+                          std::true_type) {
+    const T* values = column.values();
+    const uint8_t* nulls = column.nulls();
+    T cur = *sum;
+    for (size_t i = column.size(); i > 0; --i) {
+        if (!nulls[i - 1]) {
+            cur += values[i - 1];
+        }
+    }
+    *sum = cur;
+}
+
+template <typename T>
+int32_t WindowColumnSum(int8_t* input, T* sum) {
+    auto column = GetWindowColumn<T>(input);
+    if (column == nullptr) {
+        return -1;
+    }
+    AccumulateSum(*column, sum, std::is_floating_point<T>());
+    return 0;
+}
+
+template <typename T>
+int32_t WindowColumnCount(int8_t* input, int64_t* cnt) {
+    auto column = GetWindowColumn<T>(input);
+    if (column == nullptr) {
+        return -1;
+    }
+    *cnt += column->size() - column->null_cnt();
+    return 0;
+}
+
+// +0.0 and -0.0 are equal, the one met first is kept. Rows are folded from
+// the newest to the oldest as the list is iterated, so zero results are
+// folded again in that order to keep the same one.
+template <typename T, typename Better>
+static T FoldZeroFromNewest(const WindowColumn<T>& column, T init, T cur,
+                            Better better) {
+    if (!std::is_floating_point<T>::value || cur != 0) {
+        return cur;
+    }
+    const T* values = column.values();
+    const uint8_t* nulls = column.nulls();
+    cur = init;
+    for (size_t i = column.size(); i > 0; --i) {
+        if (!nulls[i - 1] && better(values[i - 1], cur)) {
+            cur = values[i - 1];
+        }
+    }
+    return cur;
+}
+
+template <typename T>
+int32_t WindowColumnMin(int8_t* input, bool* is_empty, T* min) {
+    auto column = GetWindowColumn<T>(input);
+    if (column == nullptr) {
+        return -1;
+    }
+    const T* values = column->values();
+    size_t size = column->size();
+    T init = *min;
+    if (column->null_cnt() == 0) {
+        *min = base::SimdMin(values, size, *min);
+    } else {
+        const uint8_t* nulls = column->nulls();
+        T cur = *min;
+        for (size_t i = 0; i < size; ++i) {
+            if (!nulls[i] && values[i] < cur) {
+                cur = values[i];
+            }
+        }
+        *min = cur;
+    }
+    *min = FoldZeroFromNewest(*column, init, *min,
+                              [](T v, T cur) { return v < cur; });
+    if (size > column->null_cnt()) {
+        *is_empty = false;
+    }
+    return 0;
+}
+
+template <typename T>
+int32_t WindowColumnMax(int8_t* input, bool* is_empty, T* max) {
+    auto column = GetWindowColumn<T>(input);
+    if (column == nullptr) {
+        return -1;
+    }
+    const T* values = column->values();
+    size_t size = column->size();
+    T init = *max;
+    if (column->null_cnt() == 0) {
+        *max = base::SimdMax(values, size, *max);
+    } else {
+        const uint8_t* nulls = column->nulls();
+        T cur = *max;
+        for (size_t i = 0; i < size; ++i) {
+            if (!nulls[i] && values[i] > cur) {
+                cur = values[i];
+            }
+        }
+        *max = cur;
+    }
+    *max = FoldZeroFromNewest(*column, init, *max,
+                              [](T v, T cur) { return v > cur; });
+    if (size > column->null_cnt()) {
+        *is_empty = false;
+    }
+    return 0;
+}
+
+// partial sums of less than 2^22 int32 values are exact in double, so an
+// exact integer sum is the same as adding values one by one
+static bool WideSumWindowColumn(const WindowColumn<int16_t>& column,
+                                double* sum) {
+    *sum = static_cast<double>(
+        base::SimdWideSum(column.values(), column.size()));
+    return true;
+}
+static bool WideSumWindowColumn(const WindowColumn<int32_t>& column,
+                                double* sum) {
+    if (column.size() >= (1u << 22)) {
+        return false;
+    }
+    *sum = static_cast<double>(
+        base::SimdWideSum(column.values(), column.size()));
+    return true;
+}
+template <typename T>
+static bool WideSumWindowColumn(const WindowColumn<T>& column, double* sum) {
+    return false;
+}
+
+template <typename T>
+int32_t WindowColumnAvg(int8_t* input, int64_t* cnt, double* sum) {
+    auto column = GetWindowColumn<T>(input);
+    if (column == nullptr) {
+        return -1;
+    }
+    *cnt += column->size() - column->null_cnt();
+    double wide_sum = 0;
+    if (*sum == 0 && WideSumWindowColumn(*column, &wide_sum)) {
+        *sum = wide_sum;
+        return 0;
+    }
+    const T* values = column->values();
+    const uint8_t* nulls = column->nulls();
+    double cur = *sum;
+    for (size_t i = column->size(); i > 0; --i) {
+        if (!nulls[i - 1]) {
+            cur += values[i - 1];
+        }
+    }
+    *sum = cur;
+    return 0;
+}
+
+#define INSTANTIATE_WINDOW_COLUMN_AGG(T)                                   \
+    template int32_t WindowColumnSum<T>(int8_t*, T*);                      \
+    template int32_t WindowColumnCount<T>(int8_t*, int64_t*);              \
+    template int32_t WindowColumnMin<T>(int8_t*, bool*, T*);               \
+    template int32_t WindowColumnMax<T>(int8_t*, bool*, T*);               \
+    template int32_t WindowColumnAvg<T>(int8_t*, int64_t*, double*);
+
+INSTANTIATE_WINDOW_COLUMN_AGG(int16_t)
+INSTANTIATE_WINDOW_COLUMN_AGG(int32_t)
+INSTANTIATE_WINDOW_COLUMN_AGG(int64_t)
+INSTANTIATE_WINDOW_COLUMN_AGG(float)
+INSTANTIATE_WINDOW_COLUMN_AGG(double)
+#undef INSTANTIATE_WINDOW_COLUMN_AGG
 }  // namespace vm
 }  // namespace hybridse
@@ -15,6 +15,7 @@
  */
 
 #include "vm/mem_catalog.h"
+#include <thread>  // NOLINT
 #include "gtest/gtest.h"
 #include "vm/catalog_wrapper.h"
 #include "testing/test_base.h"
@@ -337,6 +338,48 @@ TEST_F(MemCataLogTest, mem_table_iterator_test) {
     ASSERT_EQ(iter->GetValue().size(), rows[2].size());
 }
 
+TEST_F(MemCataLogTest, mem_time_table_sort_test) {
+    std::vector<Row> rows;
+    ::hybridse::type::TableDef table;
+    BuildRows(table, rows);
+    auto check_keys = [](vm::MemTimeTableHandler* handler,
+                         const std::vector<uint64_t>& keys) {
+        ASSERT_EQ(keys.size(), handler->GetCount());
+        auto iter = handler->GetIterator();
+        for (auto key : keys) {
+            ASSERT_TRUE(iter->Valid());
+            ASSERT_EQ(key, iter->GetKey());
+            iter->Next();
+        }
+        ASSERT_FALSE(iter->Valid());
+    };
+
+    // rows in order with equal keys keep their order
+    vm::MemTimeTableHandler in_order("t1", "temp", &(table.columns()));
+    std::vector<uint64_t> in_order_keys = {1, 2, 2, 3, 5};
+    for (size_t i = 0; i < rows.size(); i++) {
+        in_order.AddRow(in_order_keys[i], rows[i]);
+    }
+    in_order.Sort(true);
+    ASSERT_EQ(vm::kAscOrder, in_order.GetOrderType());
+    check_keys(&in_order, in_order_keys);
+    ASSERT_TRUE(in_order.At(1).buf() == rows[1].buf());
+    ASSERT_TRUE(in_order.At(2).buf() == rows[2].buf());
+
+    // rows out of order
+    vm::MemTimeTableHandler shuffled("t1", "temp", &(table.columns()));
+    std::vector<uint64_t> shuffled_keys = {3, 1, 5, 2, 4};
+    for (size_t i = 0; i < rows.size(); i++) {
+        shuffled.AddRow(shuffled_keys[i], rows[i]);
+    }
+    shuffled.Sort(false);
+    ASSERT_EQ(vm::kDescOrder, shuffled.GetOrderType());
+    check_keys(&shuffled, {5, 4, 3, 2, 1});
+    shuffled.Sort(true);
+    ASSERT_EQ(vm::kAscOrder, shuffled.GetOrderType());
+    check_keys(&shuffled, {1, 2, 3, 4, 5});
+}
+
 TEST_F(MemCataLogTest, mem_partition_test) {
     std::vector<Row> rows;
     ::hybridse::type::TableDef table;
@@ -421,6 +464,50 @@ TEST_F(MemCataLogTest, mem_partition_test) {
     }
 }
 
+TEST_F(MemCataLogTest, hash_partition_test) {
+    std::vector<Row> rows;
+    ::hybridse::type::TableDef table;
+    BuildRows(table, rows);
+    auto partition_handler = std::shared_ptr<vm::HashPartitionHandler>(
+        new vm::HashPartitionHandler(&(table.columns())));
+
+    // enough keys to rehash several times
+    uint64_t ts = 1;
+    for (int i = 0; i < 100; ++i) {
+        for (auto row : rows) {
+            partition_handler->AddRow("group" + std::to_string(i), ts++, row);
+        }
+    }
+    ASSERT_EQ(100u, partition_handler->GetCount());
+    partition_handler->Sort(false);
+
+    // segments are kept in the order keys are first added
+    auto window_iter = partition_handler->GetWindowIterator();
+    window_iter->SeekToFirst();
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(window_iter->Valid());
+        ASSERT_EQ("group" + std::to_string(i),
+                  window_iter->GetKey().ToString());
+        window_iter->Next();
+    }
+    ASSERT_FALSE(window_iter->Valid());
+
+    window_iter->Seek("group42");
+    ASSERT_TRUE(window_iter->Valid());
+    ASSERT_EQ("group42", window_iter->GetKey().ToString());
+    window_iter->Seek("group100");
+    ASSERT_FALSE(window_iter->Valid());
+
+    auto segment = partition_handler->GetSegment("group1");
+    ASSERT_EQ(rows.size(), segment->GetCount());
+    auto iter = segment->GetIterator();
+    iter->SeekToFirst();
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_TRUE(iter->GetValue().buf() == rows[4].buf());
+    ASSERT_EQ(rows.size() * 2, iter->GetKey());
+    ASSERT_EQ(0u, partition_handler->GetSegment("group100")->GetCount());
+}
+
 TEST_F(MemCataLogTest, mem_row_handler_test) {
     std::vector<Row> rows;
     ::hybridse::type::TableDef table;
@@ -465,6 +552,44 @@ TEST_F(MemCataLogTest, mem_row_comcat_test) {
     }
 }
 
+// one managed right row is joined to the rows of many keys, which run on
+// different workers, run under TSan to check the ref count updates
+TEST_F(MemCataLogTest, make_rows_ref_count_atomic_test) {
+    std::vector<Row> rows;
+    ::hybridse::type::TableDef table;
+    BuildRows(table, rows);
+    auto buf = reinterpret_cast<int8_t*>(malloc(rows[0].size()));
+    memcpy(buf, rows[0].buf(), rows[0].size());
+    Row right_row(base::RefCountedSlice::CreateManaged(buf, rows[0].size()));
+
+    auto right_table = std::make_shared<MemTableHandler>(&table.columns());
+    right_table->AddRow(right_row);
+    auto partition = std::make_shared<MemPartitionHandler>(&table.columns());
+    uint64_t ts = 1;
+    for (auto key : {"group1", "group2", "group3", "group4"}) {
+        partition->AddRow(key, ts++, right_row);
+    }
+    MakeRowsRefCountAtomic(right_table);
+    MakeRowsRefCountAtomic(partition);
+    right_row = Row();
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 4; ++i) {
+        workers.emplace_back([&]() {
+            for (int k = 0; k < 1000; ++k) {
+                Row joined = right_table->At(0);
+                auto segment = partition->GetSegment("group1");
+                auto iter = segment->GetIterator();
+                ASSERT_EQ(0, joined.compare(iter->GetValue()));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    ASSERT_EQ(0, rows[0].compare(right_table->At(0)));
+}
+
 }  // namespace vm
 }  // namespace hybridse
 int main(int argc, char** argv) {
@@ -15,22 +15,26 @@
  */
 
 #include "vm/runner.h"
+#include <chrono>  // NOLINT
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 #include "base/texttable.h"
+#include "base/work_stealing_executor.h"
 #include "udf/udf.h"
 #include "vm/catalog_wrapper.h"
 #include "vm/core_api.h"
 #include "vm/jit_runtime.h"
 #include "vm/mem_catalog.h"
+#include "vm/scatter_gather_handler.h"
 
 namespace hybridse {
 namespace vm {
 #define MAX_DEBUG_BATCH_SiZE 5
 #define MAX_DEBUG_LINES_CNT 20
 #define MAX_DEBUG_COLUMN_MAX 20
+#define MAX_PROJECT_BATCH_SIZE 1024
 
 // Build Runner for each physical node
 // return cluster task of given runner
@@ -895,11 +899,11 @@ Row Runner::WindowProject(const int8_t* fn, const uint64_t row_key,
         window->PopFrontData();
     }
     if (append_slices > 0) {
-        return Row(base::RefCountedSlice::CreateManaged(
+        return Row(JitRuntime::get()->CreateRowSlice(
                        out_buf, RowView::GetSize(out_buf)),
                    append_slices, row);
     } else {
-        return Row(base::RefCountedSlice::CreateManaged(
+        return Row(JitRuntime::get()->CreateRowSlice(
             out_buf, RowView::GetSize(out_buf)));
     }
 }
@@ -1032,9 +1036,12 @@ std::shared_ptr<DataHandlerList> Runner::BatchRequestRun(RunnerContext& ctx) {
     return outputs;
 }
 std::shared_ptr<DataHandler> Runner::RunWithCache(RunnerContext& ctx) {
-    if (need_cache_) {
-        auto cached = ctx.GetCache(id_);
-        if (cached != nullptr) {
+    // runners scheduled by `RunnerExecutor` are run ahead of their
+    // consumers, their outputs are always cached
+    bool use_cache = need_cache_ || ctx.is_async_runner();
+    if (use_cache) {
+        std::shared_ptr<DataHandler> cached;
+        if (ctx.GetCache(id_, &cached)) {
             DLOG(INFO) << "RUNNER ID " << id_ << " HIT CACHE!";
             return cached;
         }
@@ -1044,15 +1051,21 @@ std::shared_ptr<DataHandler> Runner::RunWithCache(RunnerContext& ctx) {
         inputs[idx - 1] = producers_[idx - 1]->RunWithCache(ctx);
     }
 
+    auto start = std::chrono::steady_clock::now();
     auto res = Run(ctx, inputs);
     if (ctx.is_debug()) {
+        int64_t elapsed_us =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count();
+        ctx.AddRunnerTime(id_, elapsed_us);
         std::ostringstream oss;
         oss << "RUNNER TYPE: " << RunnerTypeName(type_) << ", ID: " << id_
-            << "\n";
+            << ", ELAPSED: " << elapsed_us << "us\n";
         Runner::PrintData(oss, output_schemas_, res);
         LOG(INFO) << oss.str();
     }
-    if (need_cache_) {
+    if (use_cache) {
         ctx.SetCache(id_, res);
     }
     return res;
@@ -1138,7 +1151,8 @@ std::shared_ptr<DataHandler> GroupRunner::Run(
         LOG(WARNING) << "input is empty";
         return fail_ptr;
     }
-    return partition_gen_.Partition(input, ctx.GetParameterRow());
+    return partition_gen_.Partition(input, ctx.GetParameterRow(),
+                                    ctx.is_hash_partition());
 }
 std::shared_ptr<DataHandler> SortRunner::Run(
     RunnerContext& ctx,
@@ -1187,12 +1201,46 @@ std::shared_ptr<DataHandler> TableProjectRunner::Run(
     auto& parameter = ctx.GetParameterRow();
     iter->SeekToFirst();
     int32_t cnt = 0;
+    if (!project_gen_.BatchValid()) {
+        while (iter->Valid()) {
+            if (limit_cnt_ > 0 && cnt++ >= limit_cnt_) {
+                break;
+            }
+            output_table->AddRow(project_gen_.Gen(iter->GetValue(), parameter));
+            iter->Next();
+        }
+        return output_table;
+    }
+
+    // project rows chunk by chunk with batch entry
+    std::vector<Row> batch_rows;
+    std::vector<Row> batch_outputs;
+    batch_rows.reserve(MAX_PROJECT_BATCH_SIZE);
     while (iter->Valid()) {
         if (limit_cnt_ > 0 && cnt++ >= limit_cnt_) {
             break;
         }
-        output_table->AddRow(project_gen_.Gen(iter->GetValue(), parameter));
+        batch_rows.push_back(iter->GetValue());
         iter->Next();
+        if (batch_rows.size() >= MAX_PROJECT_BATCH_SIZE) {
+            if (!project_gen_.GenBatch(batch_rows, parameter, &batch_outputs)) {
+                LOG(WARNING) << "Table Project Fail: fail to project batch";
+                return std::shared_ptr<DataHandler>();
+            }
+            for (auto& row : batch_outputs) {
+                output_table->AddRow(row);
+            }
+            batch_rows.clear();
+        }
+    }
+    if (!batch_rows.empty()) {
+        if (!project_gen_.GenBatch(batch_rows, parameter, &batch_outputs)) {
+            LOG(WARNING) << "Table Project Fail: fail to project batch";
+            return std::shared_ptr<DataHandler>();
+        }
+        for (auto& row : batch_outputs) {
+            output_table->AddRow(row);
+        }
     }
     return output_table;
 }
@@ -1307,9 +1355,13 @@ std::shared_ptr<DataHandler> WindowAggRunner::Run(
         return fail_ptr;
     }
     auto& parameter = ctx.GetParameterRow();
+    // instance and union tables share keys, they can only be hashed together
+    bool hash_key = ctx.is_hash_partition() &&
+                    instance_window_gen_.partition_gen_.Valid() &&
+                    windows_union_gen_.AllPartitionValid();
     // Partition Instance Table
-    auto instance_partition =
-        instance_window_gen_.partition_gen_.Partition(input, parameter);
+    auto instance_partition = instance_window_gen_.partition_gen_.Partition(
+        input, parameter, hash_key);
     if (!instance_partition) {
         LOG(WARNING) << "Window Aggregation Fail: input partition is empty";
         return fail_ptr;
@@ -1324,13 +1376,29 @@ std::shared_ptr<DataHandler> WindowAggRunner::Run(
 
     // Partition Union Table
     auto union_inpus = windows_union_gen_.RunInputs(ctx);
-    auto union_partitions = windows_union_gen_.PartitionEach(union_inpus, parameter);
+    auto union_partitions =
+        windows_union_gen_.PartitionEach(union_inpus, parameter, hash_key);
     // Prepare Join Tables
     auto join_right_tables = windows_join_gen_.RunInputs(ctx);
 
     // Compute output
     std::shared_ptr<MemTableHandler> output_table =
         std::shared_ptr<MemTableHandler>(new MemTableHandler());
+    // limit is counted across keys, which only holds when run serially.
+    // Workers share input, union and join rows, whose ref counts are only
+    // safe to update across threads in atomic ref count mode, see
+    // `RunWindowAggOnKeys`
+    if (ctx.window_agg_worker_num() > 1 && ctx.is_atomic_ref_count() &&
+        limit_cnt_ <= 0) {
+        std::vector<std::string> keys;
+        while (instance_partition_iter->Valid()) {
+            keys.push_back(instance_partition_iter->GetKey().ToString());
+            instance_partition_iter->Next();
+        }
+        RunWindowAggOnKeys(ctx, instance_partition, union_partitions,
+                           join_right_tables, keys, output_table);
+        return output_table;
+    }
     while (instance_partition_iter->Valid()) {
         auto key = instance_partition_iter->GetKey().ToString();
         RunWindowAggOnKey(parameter, instance_partition, union_partitions,
@@ -1340,6 +1408,84 @@ std::shared_ptr<DataHandler> WindowAggRunner::Run(
     return output_table;
 }
 
+void WindowAggRunner::RunWindowAggOnKeys(
+    RunnerContext& ctx,
+    std::shared_ptr<PartitionHandler> instance_partition,
+    const std::vector<std::shared_ptr<PartitionHandler>>& union_partitions,
+    const std::vector<std::shared_ptr<DataHandler>>& joins,
+    const std::vector<std::string>& keys,
+    std::shared_ptr<MemTableHandler> output_table) {
+    auto executor =
+        base::WorkStealingExecutor::GetShared(ctx.window_agg_worker_num());
+    size_t worker_num = executor->worker_num();
+    const Row& parameter = ctx.GetParameterRow();
+
+    // rows created before this run, e.g. rows of the catalog or right rows
+    // joined to many keys, count references without atomic operations even
+    // in atomic ref count mode, switch them before workers share them
+    MakeRowsRefCountAtomic(instance_partition);
+    for (auto& union_partition : union_partitions) {
+        MakeRowsRefCountAtomic(union_partition);
+    }
+    for (auto& join : joins) {
+        MakeRowsRefCountAtomic(join);
+    }
+
+    // per worker output buffers, and the [begin, end) range each key
+    // occupies in the buffer of the worker it was run on
+    struct KeyOutput {
+        size_t worker = 0;
+        uint64_t begin = 0;
+        uint64_t end = 0;
+    };
+    std::vector<std::shared_ptr<MemTableHandler>> worker_outputs(worker_num);
+    for (size_t i = 0; i < worker_num; ++i) {
+        worker_outputs[i] = std::make_shared<MemTableHandler>();
+    }
+    std::vector<KeyOutput> key_outputs(keys.size());
+
+    // rows carved on a worker thread come from a slab allocator owned by
+    // that worker, it is never touched by other threads while running
+    std::vector<std::unique_ptr<base::SlabAllocator>> allocators(worker_num);
+    if (ctx.is_row_slab_allocator()) {
+        for (size_t i = 0; i < worker_num; ++i) {
+            allocators[i] = std::unique_ptr<base::SlabAllocator>(
+                new base::SlabAllocator());
+        }
+    }
+
+    executor->Run(keys.size(), [&](size_t worker, size_t task) {
+        base::AtomicRefCountScope atomic_scope;
+        auto prev_allocator =
+            JitRuntime::get()->SetRowAllocator(allocators[worker].get());
+        auto& output = worker_outputs[worker];
+        KeyOutput& key_output = key_outputs[task];
+        key_output.worker = worker;
+        key_output.begin = output->GetCount();
+        RunWindowAggOnKey(parameter, instance_partition, union_partitions,
+                          joins, keys[task], output);
+        key_output.end = output->GetCount();
+        JitRuntime::get()->SetRowAllocator(prev_allocator);
+    });
+
+    if (ctx.is_window_agg_ordered()) {
+        for (auto& key_output : key_outputs) {
+            auto& output = worker_outputs[key_output.worker];
+            for (uint64_t pos = key_output.begin; pos < key_output.end;
+                 ++pos) {
+                output_table->AddRow(output->At(pos));
+            }
+        }
+    } else {
+        for (auto& output : worker_outputs) {
+            uint64_t cnt = output->GetCount();
+            for (uint64_t pos = 0; pos < cnt; ++pos) {
+                output_table->AddRow(output->At(pos));
+            }
+        }
+    }
+}
+
 // Run Window Aggeregation on given key
 void WindowAggRunner::RunWindowAggOnKey(
     const Row& parameter,
@@ -1492,9 +1638,24 @@ std::shared_ptr<DataHandler> LastJoinRunner::Run(
         return fail_ptr;
     }
     auto &parameter = ctx.GetParameterRow();
+    // right table without index is joined by hash table built once
+    bool hash_join = kTableHandler == right->GetHanlderType() &&
+                     !join_gen_.index_key_gen_.Valid();
 
     switch (left->GetHanlderType()) {
         case kTableHandler: {
+            if (hash_join) {
+                auto left_table = std::dynamic_pointer_cast<TableHandler>(left);
+                auto output_table = std::shared_ptr<MemTimeTableHandler>(
+                    new MemTimeTableHandler());
+                output_table->SetOrderType(left_table->GetOrderType());
+                if (!join_gen_.TableHashJoin(
+                        left_table, std::dynamic_pointer_cast<TableHandler>(right),
+                        parameter, output_table)) {
+                    return fail_ptr;
+                }
+                return output_table;
+            }
             if (join_gen_.right_group_gen_.Valid()) {
                 right = join_gen_.right_group_gen_.Partition(right, parameter);
             }
@@ -1528,6 +1689,20 @@ std::shared_ptr<DataHandler> LastJoinRunner::Run(
             return output_table;
         }
         case kPartitionHandler: {
+            if (hash_join) {
+                auto output_partition = std::shared_ptr<MemPartitionHandler>(
+                    new MemPartitionHandler());
+                auto left_partition =
+                    std::dynamic_pointer_cast<PartitionHandler>(left);
+                output_partition->SetOrderType(left_partition->GetOrderType());
+                if (!join_gen_.PartitionHashJoin(
+                        left_partition,
+                        std::dynamic_pointer_cast<TableHandler>(right),
+                        parameter, output_partition)) {
+                    return fail_ptr;
+                }
+                return output_partition;
+            }
             if (join_gen_.right_group_gen_.Valid()) {
                 right = join_gen_.right_group_gen_.Partition(right, parameter);
             }
@@ -1572,14 +1747,16 @@ std::shared_ptr<DataHandler> LastJoinRunner::Run(
 }
 
 std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
-    std::shared_ptr<DataHandler> input, const Row& parameter) {
+    std::shared_ptr<DataHandler> input, const Row& parameter, bool hash_key) {
     switch (input->GetHanlderType()) {
         case kPartitionHandler: {
             return Partition(
-                std::dynamic_pointer_cast<PartitionHandler>(input), parameter);
+                std::dynamic_pointer_cast<PartitionHandler>(input), parameter,
+                hash_key);
         }
         case kTableHandler: {
-            return Partition(std::dynamic_pointer_cast<TableHandler>(input), parameter);
+            return Partition(std::dynamic_pointer_cast<TableHandler>(input),
+                             parameter, hash_key);
         }
         default: {
             LOG(WARNING) << "Partition Fail: input isn't partition or table";
@@ -1587,24 +1764,45 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
         }
     }
 }
-std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
-    std::shared_ptr<PartitionHandler> table, const Row& parameter) {
-    if (!key_gen_.Valid()) {
-        return table;
-    }
-    if (!table) {
-        return std::shared_ptr<PartitionHandler>();
+
+// add every row from `iter` into `output_partitions`, keyed by `prefix`
+// (if not null) followed by keys generated from the row
+template <typename PartitionT>
+static void AddPartitionRows(KeyGenerator* key_gen, RowIterator* iter,
+                             const Row& parameter, const std::string* prefix,
+                             bool hash_key, PartitionT* output_partitions) {
+    std::string keys;
+    while (iter->Valid()) {
+        if (hash_key) {
+            keys.clear();
+            if (prefix != nullptr) {
+                keys.append(*prefix);
+            }
+            key_gen->GenBinary(iter->GetValue(), parameter, &keys);
+        } else if (prefix == nullptr) {
+            keys = key_gen->Gen(iter->GetValue(), parameter);
+        } else {
+            keys = *prefix + "|" + key_gen->Gen(iter->GetValue(), parameter);
+        }
+        output_partitions->AddRow(keys, iter->GetKey(), iter->GetValue());
+        iter->Next();
     }
-    auto output_partitions = std::shared_ptr<MemPartitionHandler>(
-        new MemPartitionHandler(table->GetSchema()));
-    auto partitions = std::dynamic_pointer_cast<PartitionHandler>(table);
-    auto iter = partitions->GetWindowIterator();
+}
+
+template <typename PartitionT>
+static std::shared_ptr<PartitionHandler> PartitionSegments(
+    KeyGenerator* key_gen, std::shared_ptr<PartitionHandler> table,
+    const Row& parameter, bool hash_key) {
+    auto output_partitions =
+        std::shared_ptr<PartitionT>(new PartitionT(table->GetSchema()));
+    auto iter = table->GetWindowIterator();
     if (!iter) {
         LOG(WARNING) << "Partition Fail: partition is Empty";
         return std::shared_ptr<PartitionHandler>();
     }
     iter->SeekToFirst();
     output_partitions->SetOrderType(table->GetOrderType());
+    std::string prefix;
     while (iter->Valid()) {
         auto segment_iter = iter->GetValue();
         if (!segment_iter) {
@@ -1612,20 +1810,58 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
             continue;
         }
         auto segment_key = iter->GetKey().ToString();
-        segment_iter->SeekToFirst();
-        while (segment_iter->Valid()) {
-            std::string keys = key_gen_.Gen(segment_iter->GetValue(), parameter);
-            output_partitions->AddRow(segment_key + "|" + keys,
-                                      segment_iter->GetKey(),
-                                      segment_iter->GetValue());
-            segment_iter->Next();
+        if (hash_key) {
+            prefix.clear();
+            KeyGenerator::AppendBinaryString(segment_key.data(),
+                                             segment_key.size(), &prefix);
+        } else {
+            prefix = segment_key;
         }
+        segment_iter->SeekToFirst();
+        AddPartitionRows(key_gen, segment_iter.get(), parameter, &prefix,
+                         hash_key, output_partitions.get());
         iter->Next();
     }
     return output_partitions;
 }
+
+template <typename PartitionT>
+static std::shared_ptr<PartitionHandler> PartitionTable(
+    KeyGenerator* key_gen, std::shared_ptr<TableHandler> table,
+    const Row& parameter, bool hash_key) {
+    auto output_partitions =
+        std::shared_ptr<PartitionT>(new PartitionT(table->GetSchema()));
+    auto iter = table->GetIterator();
+    if (!iter) {
+        LOG(WARNING) << "Fail to group empty table: table is empty";
+        return std::shared_ptr<PartitionHandler>();
+    }
+    iter->SeekToFirst();
+    AddPartitionRows(key_gen, iter.get(), parameter, nullptr, hash_key,
+                     output_partitions.get());
+    output_partitions->SetOrderType(table->GetOrderType());
+    return output_partitions;
+}
+
 std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
-    std::shared_ptr<TableHandler> table, const Row& parameter) {
+    std::shared_ptr<PartitionHandler> table, const Row& parameter,
+    bool hash_key) {
+    if (!key_gen_.Valid()) {
+        return table;
+    }
+    if (!table) {
+        return std::shared_ptr<PartitionHandler>();
+    }
+    if (hash_key) {
+        return PartitionSegments<HashPartitionHandler>(&key_gen_, table,
+                                                       parameter, true);
+    }
+    return PartitionSegments<MemPartitionHandler>(&key_gen_, table, parameter,
+                                                  false);
+}
+std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
+    std::shared_ptr<TableHandler> table, const Row& parameter,
+    bool hash_key) {
     auto fail_ptr = std::shared_ptr<PartitionHandler>();
     if (!key_gen_.Valid()) {
         return fail_ptr;
@@ -1636,23 +1872,12 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
     if (kTableHandler != table->GetHanlderType()) {
         return fail_ptr;
     }
-
-    auto output_partitions = std::shared_ptr<MemPartitionHandler>(
-        new MemPartitionHandler(table->GetSchema()));
-
-    auto iter = std::dynamic_pointer_cast<TableHandler>(table)->GetIterator();
-    if (!iter) {
-        LOG(WARNING) << "Fail to group empty table: table is empty";
-        return fail_ptr;
-    }
-    iter->SeekToFirst();
-    while (iter->Valid()) {
-        std::string keys = key_gen_.Gen(iter->GetValue(), parameter);
-        output_partitions->AddRow(keys, iter->GetKey(), iter->GetValue());
-        iter->Next();
+    if (hash_key) {
+        return PartitionTable<HashPartitionHandler>(&key_gen_, table,
+                                                    parameter, true);
     }
-    output_partitions->SetOrderType(table->GetOrderType());
-    return output_partitions;
+    return PartitionTable<MemPartitionHandler>(&key_gen_, table, parameter,
+                                               false);
 }
 std::shared_ptr<DataHandler> SortGenerator::Sort(
     std::shared_ptr<DataHandler> input, const bool reverse) {
@@ -1732,6 +1957,10 @@ std::shared_ptr<TableHandler> SortGenerator::Sort(
         is_asc == (table->GetOrderType() == kAscOrder)) {
         return table;
     }
+    if (!order_gen().Valid() && kNoneOrder == table->GetOrderType()) {
+        LOG(WARNING) << "Fail to Sort, order type invalid";
+        return std::shared_ptr<TableHandler>();
+    }
     auto output_table = std::shared_ptr<MemTimeTableHandler>(
         new MemTimeTableHandler(table->GetSchema()));
     output_table->SetOrderType(table->GetOrderType());
@@ -1741,35 +1970,21 @@ std::shared_ptr<TableHandler> SortGenerator::Sort(
         return std::shared_ptr<TableHandler>();
     }
     iter->SeekToFirst();
-    while (iter->Valid()) {
-        if (order_gen_.Valid()) {
+    if (order_gen_.Valid()) {
+        while (iter->Valid()) {
             int64_t key = order_gen_.Gen(iter->GetValue());
             output_table->AddRow(static_cast<uint64_t>(key), iter->GetValue());
-        } else {
-            output_table->AddRow(iter->GetKey(), iter->GetValue());
+            iter->Next();
         }
-        iter->Next();
-    }
-
-    if (order_gen_.Valid()) {
+        // skip sorting if rows come in order already
         output_table->Sort(is_asc);
     } else {
-        switch (table->GetOrderType()) {
-            case kDescOrder:
-                if (is_asc) {
-                    output_table->Reverse();
-                }
-                break;
-            case kAscOrder:
-                if (!is_asc) {
-                    output_table->Reverse();
-                }
-                break;
-            default: {
-                LOG(WARNING) << "Fail to Sort, order type invalid";
-                return std::shared_ptr<TableHandler>();
-            }
+        // rows are in opposite order, build them reversed in one pass
+        while (iter->Valid()) {
+            output_table->AddFrontRow(iter->GetKey(), iter->GetValue());
+            iter->Next();
         }
+        output_table->SetOrderType(is_asc ? kAscOrder : kDescOrder);
     }
     return output_table;
 }
@@ -2008,6 +2223,114 @@ bool JoinGenerator::PartitionJoin(std::shared_ptr<PartitionHandler> left,
     }
     return true;
 }
+bool JoinGenerator::BuildHashTable(std::shared_ptr<TableHandler> right,
+                                   const Row& parameter,
+                                   JoinHashTable* hash_table) {
+    // sort once, rows of each key keep the order of sorted table
+    if (right_sort_gen_.Valid()) {
+        right = right_sort_gen_.Sort(right, true);
+    }
+    if (!right) {
+        LOG(WARNING) << "Last Join right table is empty";
+        return true;
+    }
+    auto right_iter = right->GetIterator();
+    if (!right_iter) {
+        DLOG(WARNING) << "Last Join right table is empty";
+        return true;
+    }
+    right_iter->SeekToFirst();
+    while (right_iter->Valid()) {
+        auto& bucket = (*hash_table)[right_group_gen_.Valid()
+                                         ? right_group_gen_.GetKey(
+                                               right_iter->GetValue(), parameter)
+                                         : ""];
+        // only the first row of each key can be joined without condition
+        if (condition_gen_.Valid() || bucket.empty()) {
+            bucket.push_back(right_iter->GetValue());
+        }
+        right_iter->Next();
+    }
+    return true;
+}
+Row JoinGenerator::RowLastJoinHashTable(const Row& left_row,
+                                        const JoinHashTable& hash_table,
+                                        const Row& parameter) {
+    // keys are ignored if right table is not grouped, like joining right
+    // table by scan
+    std::string key = "";
+    if (right_group_gen_.Valid() && left_key_gen_.Valid()) {
+        key = left_key_gen_.Gen(left_row, parameter);
+    }
+    auto iter = hash_table.find(key);
+    if (iter == hash_table.cend()) {
+        return Row(left_slices_, left_row, right_slices_, Row());
+    }
+    for (auto& right_row : iter->second) {
+        Row joined_row(left_slices_, left_row, right_slices_, right_row);
+        if (!condition_gen_.Valid() ||
+            condition_gen_.Gen(joined_row, parameter)) {
+            return joined_row;
+        }
+    }
+    return Row(left_slices_, left_row, right_slices_, Row());
+}
+bool JoinGenerator::TableHashJoin(std::shared_ptr<TableHandler> left,
+                                  std::shared_ptr<TableHandler> right,
+                                  const Row& parameter,
+                                  std::shared_ptr<MemTimeTableHandler> output) {
+    auto left_iter = left->GetIterator();
+    if (!left_iter) {
+        LOG(WARNING) << "Table Join with empty left table";
+        return false;
+    }
+    JoinHashTable hash_table;
+    if (!BuildHashTable(right, parameter, &hash_table)) {
+        return false;
+    }
+    left_iter->SeekToFirst();
+    while (left_iter->Valid()) {
+        const Row& left_row = left_iter->GetValue();
+        output->AddRow(left_iter->GetKey(),
+                       RowLastJoinHashTable(left_row, hash_table, parameter));
+        left_iter->Next();
+    }
+    return true;
+}
+bool JoinGenerator::PartitionHashJoin(
+    std::shared_ptr<PartitionHandler> left, std::shared_ptr<TableHandler> right,
+    const Row& parameter, std::shared_ptr<MemPartitionHandler> output) {
+    auto left_window_iter = left->GetWindowIterator();
+    if (!left_window_iter) {
+        LOG(WARNING) << "fail to run last join: left iter empty";
+        return false;
+    }
+    JoinHashTable hash_table;
+    if (!BuildHashTable(right, parameter, &hash_table)) {
+        return false;
+    }
+    left_window_iter->SeekToFirst();
+    while (left_window_iter->Valid()) {
+        auto left_iter = left_window_iter->GetValue();
+        auto left_key = left_window_iter->GetKey();
+        if (!left_iter) {
+            left_window_iter->Next();
+            continue;
+        }
+        auto key_str = std::string(
+            reinterpret_cast<const char*>(left_key.buf()), left_key.size());
+        left_iter->SeekToFirst();
+        while (left_iter->Valid()) {
+            const Row& left_row = left_iter->GetValue();
+            output->AddRow(
+                key_str, left_iter->GetKey(),
+                RowLastJoinHashTable(left_row, hash_table, parameter));
+            left_iter->Next();
+        }
+        left_window_iter->Next();
+    }
+    return true;
+}
 const Row Runner::RowLastJoinTable(size_t left_slices, const Row& left_row,
                                    size_t right_slices,
                                    std::shared_ptr<TableHandler> right_table,
@@ -3027,25 +3350,66 @@ std::shared_ptr<TableHandler> ProxyRequestRunner::RunWithRowsInput(
         for (auto& index_row : index_rows) {
             pks.push_back(generator.Gen(index_row, parameter));
         }
-        tablet = table_handler->GetTablet(task.index(), pks);
+        // group rows by owning tablet, subquery the tablets in parallel
+        std::vector<std::shared_ptr<Tablet>> tablets;
+        std::vector<std::vector<Row>> tablet_rows;
+        std::vector<ScatterGatherTableHandler::RowLocation> locations;
+        bool all_located = true;
+        for (size_t idx = 0; idx < pks.size(); ++idx) {
+            auto pk_tablet = table_handler->GetTablet(task.index(), pks[idx]);
+            if (!pk_tablet) {
+                all_located = false;
+                break;
+            }
+            size_t part = 0;
+            while (part < tablets.size() && tablets[part] != pk_tablet) {
+                part++;
+            }
+            if (part == tablets.size()) {
+                tablets.push_back(pk_tablet);
+                tablet_rows.push_back(std::vector<Row>());
+            }
+            locations.push_back(std::make_pair(part, tablet_rows[part].size()));
+            tablet_rows[part].push_back(rows[idx]);
+        }
+        if (all_located && tablets.size() > 1) {
+            std::vector<std::shared_ptr<TableHandler>> parts;
+            for (size_t part = 0; part < tablets.size(); ++part) {
+                parts.push_back(SubQueryTablet(ctx, tablets[part],
+                                               table_handler->GetDatabase(),
+                                               tablet_rows[part], false));
+            }
+            return std::make_shared<ScatterGatherTableHandler>(
+                parts, locations, ctx.is_atomic_ref_count());
+        }
+        if (all_located && tablets.size() == 1) {
+            tablet = tablets[0];
+        } else {
+            tablet = table_handler->GetTablet(task.index(), pks);
+        }
     }
     if (!tablet) {
         LOG(WARNING)
             << "fail to run proxy runner with rows: subquery tablet is null";
         return fail_ptr;
     }
+    return SubQueryTablet(ctx, tablet, table_handler->GetDatabase(), rows,
+                          request_is_common);
+}
+
+std::shared_ptr<TableHandler> ProxyRequestRunner::SubQueryTablet(
+    RunnerContext& ctx, std::shared_ptr<Tablet> tablet,  // NOLINT
+    const std::string& db, const std::vector<Row>& rows,
+    const bool request_is_common) {
     if (ctx.sp_name().empty()) {
-        return tablet->SubQuery(task_id_, table_handler->GetDatabase(),
-                                cluster_job->sql(),
+        return tablet->SubQuery(task_id_, db, ctx.cluster_job()->sql(),
                                 ctx.cluster_job()->common_column_indices(),
                                 rows, request_is_common, false, ctx.is_debug());
     } else {
-        return tablet->SubQuery(task_id_, table_handler->GetDatabase(),
-                                ctx.sp_name(),
+        return tablet->SubQuery(task_id_, db, ctx.sp_name(),
                                 ctx.cluster_job()->common_column_indices(),
                                 rows, request_is_common, true, ctx.is_debug());
     }
-    return fail_ptr;
 }
 
 /**
@@ -3152,6 +3516,88 @@ const std::string KeyGenerator::Gen(const Row& row, const Row& parameter) {
     return keys;
 }
 
+// tags leading every key column of binary encoded keys
+enum BinaryKeyTag : char {
+    kBinaryKeyNull = 0,
+    kBinaryKeyInt = 1,
+    kBinaryKeyBool = 2,
+    kBinaryKeyString = 3,
+};
+
+void KeyGenerator::AppendBinaryString(const char* buf, uint32_t size,
+                                      std::string* key) {
+    key->push_back(kBinaryKeyString);
+    key->append(reinterpret_cast<const char*>(&size), sizeof(uint32_t));
+    key->append(buf, size);
+}
+
+static inline void AppendBinaryInt(int64_t value, std::string* key) {
+    key->push_back(kBinaryKeyInt);
+    key->append(reinterpret_cast<const char*>(&value), sizeof(int64_t));
+}
+
+void KeyGenerator::GenBinary(const Row& row, const Row& parameter,
+                             std::string* key) {
+    if (row.size() == 0) {
+        key->push_back(kBinaryKeyNull);
+        return;
+    }
+    Row key_row = CoreAPI::RowProject(fn_, row, parameter, true);
+    for (auto pos : idxs_) {
+        if (row_view_.IsNULL(key_row.buf(), pos)) {
+            key->push_back(kBinaryKeyNull);
+            continue;
+        }
+        // all integers are widened to int64, so that keys of different
+        // integer types still match like their string form does
+        ::hybridse::type::Type type = fn_schema_.Get(pos).type();
+        switch (type) {
+            case ::hybridse::type::kVarchar: {
+                const char* buf = nullptr;
+                uint32_t size = 0;
+                if (row_view_.GetValue(key_row.buf(), pos, &buf, &size) == 0) {
+                    AppendBinaryString(buf, size, key);
+                }
+                break;
+            }
+            case hybridse::type::kBool: {
+                bool buf = false;
+                if (row_view_.GetValue(key_row.buf(), pos, type,
+                                       reinterpret_cast<void*>(&buf)) == 0) {
+                    key->push_back(kBinaryKeyBool);
+                    key->push_back(buf ? 1 : 0);
+                }
+                break;
+            }
+            case hybridse::type::kInt16: {
+                int16_t buf = 0;
+                if (row_view_.GetValue(key_row.buf(), pos, type,
+                                       reinterpret_cast<void*>(&buf)) == 0)
+                    AppendBinaryInt(buf, key);
+                break;
+            }
+            case hybridse::type::kDate:
+            case hybridse::type::kInt32: {
+                int32_t buf = 0;
+                if (row_view_.GetValue(key_row.buf(), pos, type,
+                                       reinterpret_cast<void*>(&buf)) == 0)
+                    AppendBinaryInt(buf, key);
+                break;
+            }
+            case hybridse::type::kInt64:
+            case hybridse::type::kTimestamp: {
+                int64_t buf = 0;
+                if (row_view_.GetValue(key_row.buf(), pos, type,
+                                       reinterpret_cast<void*>(&buf)) == 0)
+                    AppendBinaryInt(buf, key);
+                break;
+            }
+            default:
+                continue;
+        }
+    }
+}
+
 const int64_t OrderGenerator::Gen(const Row& row) {
     Row order_row = CoreAPI::RowProject(fn_, row, Row(), true);
     return Runner::GetColumnInt64(order_row.buf(), &row_view_, idxs_[0],
@@ -3165,6 +3611,12 @@ const Row ProjectGenerator::Gen(const Row& row, const Row& parameter) {
     return CoreAPI::RowProject(fn_, row, parameter, false);
 }
 
+bool ProjectGenerator::GenBatch(const std::vector<Row>& rows,
+                                const Row& parameter,
+                                std::vector<Row>* outputs) {
+    return CoreAPI::RowProjectBatch(batch_fn_, rows, parameter, outputs);
+}
+
 const Row ConstProjectGenerator::Gen(const Row& parameter) {
     return CoreAPI::RowConstProject(fn_, parameter, false);
 }
@@ -3203,7 +3655,7 @@ Row Runner::GroupbyProject(const int8_t* fn, const codec::Row& parameter, TableH
         return Row();
     }
     return Row(
-        base::RefCountedSlice::CreateManaged(buf, RowView::GetSize(buf)));
+        JitRuntime::get()->CreateRowSlice(buf, RowView::GetSize(buf)));
 }
 
 const Row WindowProjectGenerator::Gen(const uint64_t key, const Row row,
@@ -3227,13 +3679,13 @@ std::vector<std::shared_ptr<DataHandler>> InputsGenerator::RunInputs(
 std::vector<std::shared_ptr<PartitionHandler>>
 WindowUnionGenerator::PartitionEach(
     std::vector<std::shared_ptr<DataHandler>> union_inputs,
-    const Row& parameter) {
+    const Row& parameter, bool hash_key) {
     std::vector<std::shared_ptr<PartitionHandler>> union_partitions;
     if (!windows_gen_.empty()) {
         union_partitions.reserve(windows_gen_.size());
         for (size_t i = 0; i < inputs_cnt_; i++) {
-            union_partitions.push_back(
-                windows_gen_[i].partition_gen_.Partition(union_inputs[i], parameter));
+            union_partitions.push_back(windows_gen_[i].partition_gen_.Partition(
+                union_inputs[i], parameter, hash_key));
         }
     }
     return union_partitions;
@@ -3392,12 +3844,42 @@ std::shared_ptr<DataHandlerList> RunnerContext::GetBatchCache(
     }
 }
 
+RunnerContext::~RunnerContext() {
+    if (row_allocator_) {
+        JitRuntime::get()->SetRowAllocator(prev_row_allocator_);
+    }
+}
+
+void RunnerContext::EnableRowSlabAllocator() {
+    if (row_allocator_) {
+        return;
+    }
+    row_allocator_ = std::unique_ptr<base::SlabAllocator>(
+        new base::SlabAllocator());
+    prev_row_allocator_ =
+        JitRuntime::get()->SetRowAllocator(row_allocator_.get());
+}
+
+void RunnerContext::EnableAtomicRefCount() {
+    if (atomic_ref_count_) {
+        return;
+    }
+    atomic_ref_count_ = std::unique_ptr<base::AtomicRefCountScope>(
+        new base::AtomicRefCountScope());
+    request_.MakeRefCountAtomic();
+    for (auto& request : requests_) {
+        request.MakeRefCountAtomic();
+    }
+    parameter_.MakeRefCountAtomic();
+}
+
 void RunnerContext::SetBatchCache(int64_t id,
                                   std::shared_ptr<DataHandlerList> data) {
     batch_cache_[id] = data;
 }
 
 std::shared_ptr<DataHandler> RunnerContext::GetCache(int64_t id) const {
+    std::lock_guard<std::mutex> lock(cache_mu_);
     auto iter = cache_.find(id);
     if (iter == cache_.end()) {
         return std::shared_ptr<DataHandler>();
@@ -3406,17 +3888,47 @@ std::shared_ptr<DataHandler> RunnerContext::GetCache(int64_t id) const {
     }
 }
 
+bool RunnerContext::GetCache(int64_t id,
+                             std::shared_ptr<DataHandler>* data) const {
+    std::lock_guard<std::mutex> lock(cache_mu_);
+    auto iter = cache_.find(id);
+    if (iter == cache_.end()) {
+        return false;
+    }
+    *data = iter->second;
+    return true;
+}
+
 void RunnerContext::SetCache(int64_t id,
                              const std::shared_ptr<DataHandler> data) {
+    std::lock_guard<std::mutex> lock(cache_mu_);
     cache_[id] = data;
 }
 
+void RunnerContext::AddRunnerTime(int32_t id, int64_t elapsed_us) {
+    std::lock_guard<std::mutex> lock(runner_time_mu_);
+    runner_times_[id] += elapsed_us;
+}
+
+std::map<int32_t, int64_t> RunnerContext::GetRunnerTimes() const {
+    std::lock_guard<std::mutex> lock(runner_time_mu_);
+    return runner_times_;
+}
+
 void RunnerContext::SetRequest(const hybridse::codec::Row& request) {
     request_ = request;
+    if (atomic_ref_count_) {
+        request_.MakeRefCountAtomic();
+    }
 }
 void RunnerContext::SetRequests(
     const std::vector<hybridse::codec::Row>& requests) {
     requests_ = requests;
+    if (atomic_ref_count_) {
+        for (auto& request : requests_) {
+            request.MakeRefCountAtomic();
+        }
+    }
 }
 }  // namespace vm
 }  // namespace hybridse
@@ -19,12 +19,14 @@
 
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <set>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 #include "base/fe_status.h"
+#include "base/slab_allocator.h"
 #include "codec/fe_row_codec.h"
 #include "node/node_manager.h"
 #include "vm/catalog.h"
@@ -77,10 +79,16 @@ class RowProjectFun : public ProjectFun {
 class ProjectGenerator : public FnGenerator {
  public:
     explicit ProjectGenerator(const FnInfo& info)
-        : FnGenerator(info), fun_(info.fn_ptr()) {}
+        : FnGenerator(info),
+          fun_(info.fn_ptr()),
+          batch_fn_(info.batch_fn_ptr()) {}
     virtual ~ProjectGenerator() {}
     const Row Gen(const Row& row, const Row& parameter);
+    inline const bool BatchValid() const { return nullptr != batch_fn_; }
+    bool GenBatch(const std::vector<Row>& rows, const Row& parameter,
+                  std::vector<Row>* outputs);
     RowProjectFun fun_;
+    const int8_t* batch_fn_;
 };
 
 class ConstProjectGenerator : public FnGenerator {
@@ -110,6 +118,11 @@ class KeyGenerator : public FnGenerator {
     virtual ~KeyGenerator() {}
     const std::string Gen(const Row& row, const Row& parameter);
     const std::string GenConst(const Row& parameter);
+    // append keys of row to `key` in typed binary form, which is cheaper
+    // than `Gen` but only comparable with keys encoded by `GenBinary`
+    void GenBinary(const Row& row, const Row& parameter, std::string* key);
+    static void AppendBinaryString(const char* buf, uint32_t size,
+                                   std::string* key);
 };
 class OrderGenerator : public FnGenerator {
  public:
@@ -199,12 +212,17 @@ class PartitionGenerator {
     virtual ~PartitionGenerator() {}
 
     const bool Valid() const { return key_gen_.Valid(); }
+    // partition by binary keys into `HashPartitionHandler` if `hash_key` is
+    // set, segments are then not sorted by key
     std::shared_ptr<PartitionHandler> Partition(
-        std::shared_ptr<DataHandler> input, const Row& parameter);
+        std::shared_ptr<DataHandler> input, const Row& parameter,
+        bool hash_key = false);
     std::shared_ptr<PartitionHandler> Partition(
-        std::shared_ptr<PartitionHandler> table, const Row& parameter);
+        std::shared_ptr<PartitionHandler> table, const Row& parameter,
+        bool hash_key = false);
     std::shared_ptr<PartitionHandler> Partition(
-        std::shared_ptr<TableHandler> table, const Row& parameter);
+        std::shared_ptr<TableHandler> table, const Row& parameter,
+        bool hash_key = false);
     const std::string GetKey(const Row& row, const Row& parameter) { return key_gen_.Gen(row, parameter); }
 
  private:
@@ -438,6 +456,11 @@ class Runner : public node::NodeBase<Runner> {
         return true;
     }
     const std::vector<Runner*>& GetProducers() const { return producers_; }
+    // Append every runner `Run` depends on, producers first, then runners
+    // run inside `Run` itself such as window union and proxy index inputs
+    virtual void GetInputRunners(std::vector<Runner*>* runners) const {
+        runners->insert(runners->end(), producers_.begin(), producers_.end());
+    }
     virtual void PrintRunnerInfo(std::ostream& output,
                                  const std::string& tab) const {
         output << tab << "[" << id_ << "]" << RunnerTypeName(type_);
@@ -587,7 +610,15 @@ class WindowUnionGenerator : public InputsGenerator {
     virtual ~WindowUnionGenerator() {}
     std::vector<std::shared_ptr<PartitionHandler>> PartitionEach(
         std::vector<std::shared_ptr<DataHandler>> union_inputs,
-        const Row& parameter);
+        const Row& parameter, bool hash_key = false);
+    const bool AllPartitionValid() const {
+        for (auto& window_gen : windows_gen_) {
+            if (!window_gen.partition_gen_.Valid()) {
+                return false;
+            }
+        }
+        return true;
+    }
     void AddWindowUnion(const WindowOp& window_op, Runner* runner) {
         windows_gen_.push_back(WindowGenerator(window_op));
         AddInput(runner);
@@ -620,6 +651,10 @@ class RequestWindowUnionGenerator : public InputsGenerator {
     }
     std::vector<RequestWindowGenertor> windows_gen_;
 };
+// right rows of last join grouped by join key, rows of each key are kept
+// in the order they are tried
+typedef std::unordered_map<std::string, std::vector<Row>> JoinHashTable;
+
 class JoinGenerator {
  public:
     explicit JoinGenerator(const Join& join, size_t left_slices,
@@ -647,6 +682,18 @@ class JoinGenerator {
                        const Row& parameter,
                        std::shared_ptr<MemPartitionHandler>);  // NOLINT
 
+    // build/probe last join for right table without index: right table is
+    // sorted and grouped by key once, each left row only tries rows of the
+    // same key
+    bool TableHashJoin(std::shared_ptr<TableHandler> left,
+                       std::shared_ptr<TableHandler> right,
+                       const Row& parameter,
+                       std::shared_ptr<MemTimeTableHandler> output);  // NOLINT
+    bool PartitionHashJoin(std::shared_ptr<PartitionHandler> left,
+                           std::shared_ptr<TableHandler> right,
+                           const Row& parameter,
+                           std::shared_ptr<MemPartitionHandler> output);  // NOLINT
+
     Row RowLastJoin(const Row& left_row, std::shared_ptr<DataHandler> right, const Row& parameter);
     Row RowLastJoinDropLeftSlices(const Row& left_row, std::shared_ptr<DataHandler> right, const Row& parameter);
     ConditionGenerator condition_gen_;
@@ -663,6 +710,11 @@ class JoinGenerator {
     Row RowLastJoinTable(const Row& left_row,
                          std::shared_ptr<TableHandler> table,
                          const Row& parameter);
+    bool BuildHashTable(std::shared_ptr<TableHandler> right,
+                        const Row& parameter, JoinHashTable* hash_table);
+    Row RowLastJoinHashTable(const Row& left_row,
+                             const JoinHashTable& hash_table,
+                             const Row& parameter);
 
     size_t left_slices_;
     size_t right_slices_;
@@ -888,6 +940,15 @@ class WindowAggRunner : public Runner {
     void AddWindowUnion(const WindowOp& window, Runner* runner) {
         windows_union_gen_.AddWindowUnion(window, runner);
     }
+    void GetInputRunners(std::vector<Runner*>* runners) const override {
+        Runner::GetInputRunners(runners);
+        runners->insert(runners->end(),
+                        windows_union_gen_.input_runners_.begin(),
+                        windows_union_gen_.input_runners_.end());
+        runners->insert(runners->end(),
+                        windows_join_gen_.input_runners_.begin(),
+                        windows_join_gen_.input_runners_.end());
+    }
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,  // NOLINT
         const std::vector<std::shared_ptr<DataHandler>>& inputs)
@@ -898,6 +959,16 @@ class WindowAggRunner : public Runner {
         std::vector<std::shared_ptr<PartitionHandler>> union_partitions,
         std::vector<std::shared_ptr<DataHandler>> joins, const std::string& key,
         std::shared_ptr<MemTableHandler> output_table);
+    // Run window aggregation on keys with the shared pool of workers, each
+    // worker outputs into a buffer of its own which are merged at the end.
+    // Rows are shared by workers, so `ctx` has to count them atomically
+    void RunWindowAggOnKeys(
+        RunnerContext& ctx,  // NOLINT
+        std::shared_ptr<PartitionHandler> instance_partition,
+        const std::vector<std::shared_ptr<PartitionHandler>>& union_partitions,
+        const std::vector<std::shared_ptr<DataHandler>>& joins,
+        const std::vector<std::string>& keys,
+        std::shared_ptr<MemTableHandler> output_table);
 
     const bool instance_not_in_window_;
     const bool exclude_current_time_;
@@ -931,6 +1002,12 @@ class RequestUnionRunner : public Runner {
     void AddWindowUnion(const RequestWindowOp& window, Runner* runner) {
         windows_union_gen_.AddWindowUnion(window, runner);
     }
+    void GetInputRunners(std::vector<Runner*>* runners) const override {
+        Runner::GetInputRunners(runners);
+        runners->insert(runners->end(),
+                        windows_union_gen_.input_runners_.begin(),
+                        windows_union_gen_.input_runners_.end());
+    }
     RequestWindowUnionGenerator windows_union_gen_;
     RangeGenerator range_gen_;
     bool exclude_current_time_;
@@ -1039,6 +1116,12 @@ class ProxyRequestRunner : public Runner {
         const std::vector<std::shared_ptr<DataHandler>>& inputs) override;
     std::shared_ptr<DataHandlerList> BatchRequestRun(
         RunnerContext& ctx) override;  // NOLINT
+    void GetInputRunners(std::vector<Runner*>* runners) const override {
+        Runner::GetInputRunners(runners);
+        if (nullptr != index_input_) {
+            runners->push_back(index_input_);
+        }
+    }
     virtual void PrintRunnerInfo(std::ostream& output,
                                  const std::string& tab) const {
         output << tab << "[" << id_ << "]" << RunnerTypeName(type_)
@@ -1086,6 +1169,10 @@ class ProxyRequestRunner : public Runner {
         RunnerContext& ctx,  // NOLINT
         const std::vector<Row>& rows, const std::vector<Row>& index_rows,
         const bool request_is_common);
+    std::shared_ptr<TableHandler> SubQueryTablet(
+        RunnerContext& ctx, std::shared_ptr<Tablet> tablet,  // NOLINT
+        const std::string& db, const std::vector<Row>& rows,
+        const bool request_is_common);
     uint32_t task_id_;
     Runner* index_input_;
 };
@@ -1437,7 +1524,14 @@ class RunnerContext {
           requests_(),
           parameter_(parameter),
           is_debug_(is_debug),
-          batch_cache_() {}
+          batch_cache_(),
+          row_allocator_(),
+          prev_row_allocator_(nullptr),
+          hash_partition_(false),
+          window_agg_worker_num_(1),
+          window_agg_ordered_(true),
+          runner_worker_num_(1),
+          atomic_ref_count_() {}
     explicit RunnerContext(hybridse::vm::ClusterJob* cluster_job,
                            const hybridse::codec::Row& request,
                            const hybridse::codec::Row& parameter,
@@ -1449,7 +1543,14 @@ class RunnerContext {
           requests_(),
           parameter_(parameter),
           is_debug_(is_debug),
-          batch_cache_() {}
+          batch_cache_(),
+          row_allocator_(),
+          prev_row_allocator_(nullptr),
+          hash_partition_(false),
+          window_agg_worker_num_(1),
+          window_agg_ordered_(true),
+          runner_worker_num_(1),
+          atomic_ref_count_() {}
     explicit RunnerContext(hybridse::vm::ClusterJob* cluster_job,
                            const std::vector<Row>& request_batch,
                            const hybridse::codec::Row& parameter,
@@ -1461,7 +1562,15 @@ class RunnerContext {
           requests_(request_batch),
           parameter_(parameter),
           is_debug_(is_debug),
-          batch_cache_() {}
+          batch_cache_(),
+          row_allocator_(),
+          prev_row_allocator_(nullptr),
+          hash_partition_(false),
+          window_agg_worker_num_(1),
+          window_agg_ordered_(true),
+          runner_worker_num_(1),
+          atomic_ref_count_() {}
+    ~RunnerContext();
 
     const size_t GetRequestSize() const { return requests_.size(); }
     const hybridse::codec::Row& GetRequest() const { return request_; }
@@ -1476,11 +1585,67 @@ class RunnerContext {
 
     const std::string& sp_name() { return sp_name_; }
     std::shared_ptr<DataHandler> GetCache(int64_t id) const;
+    // Return false if there is no cache of runner `id`, a cached null output
+    // is returned as is
+    bool GetCache(int64_t id, std::shared_ptr<DataHandler>* data) const;
     void SetCache(int64_t id, std::shared_ptr<DataHandler> data);
-    void ClearCache() { cache_.clear(); }
+    void ClearCache() {
+        std::lock_guard<std::mutex> lock(cache_mu_);
+        cache_.clear();
+    }
     std::shared_ptr<DataHandlerList> GetBatchCache(int64_t id) const;
     void SetBatchCache(int64_t id, std::shared_ptr<DataHandlerList> data);
 
+    // Carve codegen output rows produced on current thread from slabs until
+    // the context is destroyed. Slabs are released in bulk once all rows
+    // carved from them are released.
+    void EnableRowSlabAllocator();
+
+    // Count references of rows created on current thread with atomic
+    // operations until the context is destroyed, and switch request and
+    // parameter rows to atomic counts, so that rows of the run can be shared
+    // with worker threads. Parallel runners run on workers only if enabled.
+    // Rows read from table handlers are created before the run, the runner
+    // executor and parallel window aggregation switch them with
+    // `MakeRowsRefCountAtomic` before sharing, so catalog rows must not be
+    // referenced by runs of other threads without atomic ref counts.
+    void EnableAtomicRefCount();
+    bool is_atomic_ref_count() const {
+        return static_cast<bool>(atomic_ref_count_);
+    }
+
+    // Partition tables by binary keys into hash partitions, partitions are
+    // then iterated in the order keys are first seen instead of key order.
+    void EnableHashPartition() { hash_partition_ = true; }
+    bool is_hash_partition() const { return hash_partition_; }
+
+    // Run batch window aggregation over partition keys on `worker_num`
+    // threads. Output keeps the order of partition keys if `ordered` is set,
+    // or else it is concatenated in the order workers finish.
+    void SetWindowAggWorkers(size_t worker_num, bool ordered) {
+        window_agg_worker_num_ = worker_num == 0 ? 1 : worker_num;
+        window_agg_ordered_ = ordered;
+    }
+    size_t window_agg_worker_num() const { return window_agg_worker_num_; }
+    bool is_window_agg_ordered() const { return window_agg_ordered_; }
+    bool is_row_slab_allocator() const {
+        return static_cast<bool>(row_allocator_);
+    }
+
+    // Run independent runners of a request on `worker_num` threads, see
+    // `RunnerExecutor`. Every runner output is cached in the context then,
+    // so a runner is run once even if it is not marked to be cached.
+    void SetRunnerWorkers(size_t worker_num) {
+        runner_worker_num_ = worker_num == 0 ? 1 : worker_num;
+    }
+    size_t runner_worker_num() const { return runner_worker_num_; }
+    bool is_async_runner() const { return runner_worker_num_ > 1; }
+
+    // Elapsed microseconds of each runner run with this context, only
+    // recorded in debug mode
+    void AddRunnerTime(int32_t id, int64_t elapsed_us);
+    std::map<int32_t, int64_t> GetRunnerTimes() const;
+
  private:
     hybridse::vm::ClusterJob* cluster_job_;
     const std::string sp_name_;
@@ -1490,8 +1655,18 @@ class RunnerContext {
     size_t idx_;
     const bool is_debug_;
     // TODO(chenjing): optimize
+    mutable std::mutex cache_mu_;
     std::map<int64_t, std::shared_ptr<DataHandler>> cache_;
     std::map<int64_t, std::shared_ptr<DataHandlerList>> batch_cache_;
+    std::unique_ptr<base::SlabAllocator> row_allocator_;
+    base::SlabAllocator* prev_row_allocator_;
+    bool hash_partition_;
+    size_t window_agg_worker_num_;
+    bool window_agg_ordered_;
+    size_t runner_worker_num_;
+    std::unique_ptr<base::AtomicRefCountScope> atomic_ref_count_;
+    mutable std::mutex runner_time_mu_;
+    std::map<int32_t, int64_t> runner_times_;
 };
 }  // namespace vm
 }  // namespace hybridse
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/runner_executor.h"
+#include <algorithm>
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <utility>
+#include "glog/logging.h"
+
+namespace hybridse {
+namespace vm {
+
+bool RunnerExecutor::BuildGraph(Runner* root, std::vector<Node>* nodes) {
+    std::unordered_map<Runner*, size_t> node_idx;
+    nodes->push_back(Node());
+    nodes->back().runner = root;
+    node_idx[root] = 0;
+    bool has_branch = false;
+    // nodes are appended while visited, `idx` walks them breadth first
+    for (size_t idx = 0; idx < nodes->size(); ++idx) {
+        std::vector<Runner*> inputs;
+        (*nodes)[idx].runner->GetInputRunners(&inputs);
+        std::sort(inputs.begin(), inputs.end());
+        inputs.erase(std::unique(inputs.begin(), inputs.end()), inputs.end());
+        size_t pending = 0;
+        for (auto input : inputs) {
+            if (nullptr == input) {
+                continue;
+            }
+            size_t input_idx = 0;
+            auto iter = node_idx.find(input);
+            if (iter == node_idx.end()) {
+                input_idx = nodes->size();
+                node_idx[input] = input_idx;
+                nodes->push_back(Node());
+                nodes->back().runner = input;
+            } else {
+                input_idx = iter->second;
+            }
+            (*nodes)[input_idx].consumers.push_back(idx);
+            pending++;
+        }
+        (*nodes)[idx].pending = pending;
+        has_branch = has_branch || pending > 1;
+    }
+    return has_branch;
+}
+
+std::shared_ptr<DataHandler> RunnerExecutor::Run(Runner* root,
+                                                 RunnerContext& ctx) {
+    if (nullptr == root) {
+        LOG(WARNING) << "fail to run runner dag: root is null";
+        return std::shared_ptr<DataHandler>();
+    }
+    std::vector<Node> nodes;
+    // runners on helper threads share cached outputs of their producers,
+    // which is only safe if rows of the run are counted atomically
+    if (!ctx.is_async_runner() || !ctx.is_atomic_ref_count() ||
+        !BuildGraph(root, &nodes)) {
+        return root->RunWithCache(ctx);
+    }
+
+    // rows of data runners, e.g. rows of the catalog, are created before
+    // the run and are read on helpers as well, switch them to atomic ref
+    // counts before any helper shares them
+    for (auto& node : nodes) {
+        if (kRunnerData == node.runner->type_) {
+            MakeRowsRefCountAtomic(
+                dynamic_cast<DataRunner*>(node.runner)->data_handler_);
+        }
+    }
+
+    // helpers may start after the run is over if the pool is busy, so they
+    // share the scheduling state instead of referring to this frame
+    auto state = std::make_shared<DagState>();
+    state->nodes = std::move(nodes);
+    for (size_t idx = 0; idx < state->nodes.size(); ++idx) {
+        if (0 == state->nodes[idx].pending) {
+            state->ready.push_back(idx);
+        }
+    }
+    RunnerContext* ctx_ptr = &ctx;
+    size_t worker_num = std::min(ctx.runner_worker_num(), state->nodes.size());
+    auto& pool = GetHelperPool();
+    for (size_t i = 1; i < worker_num; ++i) {
+        // run with fewer helpers rather than wait if the pool is full
+        if (!pool.Submit([state, ctx_ptr]() {
+                base::AtomicRefCountScope atomic_scope;
+                WorkLoop(state.get(), ctx_ptr);
+            })) {
+            break;
+        }
+    }
+    // the calling thread works too and returns once the root is run, every
+    // other runner is done by then since root depends on all of them
+    WorkLoop(state.get(), ctx_ptr);
+    return root->RunWithCache(ctx);
+}
+
+base::BoundedThreadPool& RunnerExecutor::GetHelperPool() {
+    static base::BoundedThreadPool pool(
+        std::max(std::thread::hardware_concurrency(), 4u), 1024);
+    return pool;
+}
+
+void RunnerExecutor::WorkLoop(DagState* state, RunnerContext* ctx) {
+    std::unique_lock<std::mutex> lock(state->mu);
+    while (true) {
+        state->cond.wait(
+            lock, [state]() { return state->done || !state->ready.empty(); });
+        if (state->done) {
+            return;
+        }
+        size_t idx = state->ready.front();
+        state->ready.pop_front();
+        lock.unlock();
+        state->nodes[idx].runner->RunWithCache(*ctx);
+        lock.lock();
+        if (0 == idx) {
+            state->done = true;
+            state->cond.notify_all();
+            return;
+        }
+        for (auto consumer : state->nodes[idx].consumers) {
+            if (0 == --state->nodes[consumer].pending) {
+                state->ready.push_back(consumer);
+                state->cond.notify_one();
+            }
+        }
+    }
+}
+
+}  // namespace vm
+}  // namespace hybridse
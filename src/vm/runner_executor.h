@@ -0,0 +1,74 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VM_RUNNER_EXECUTOR_H_
+#define SRC_VM_RUNNER_EXECUTOR_H_
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+#include "base/bounded_thread_pool.h"
+#include "vm/runner.h"
+namespace hybridse {
+namespace vm {
+
+/// \brief Run the runner DAG of a task with dependency tracking.
+///
+/// Runners reachable from the root, including the ones run inside other
+/// runners such as window union inputs and proxy index inputs, are
+/// scheduled on the calling thread and up to
+/// `RunnerContext::runner_worker_num() - 1` helpers of a process-wide pool
+/// once all of their inputs are done, so independent subtrees (both sides of a last
+/// join, window union inputs, concat inputs, remote subqueries) overlap.
+///
+/// Every output is cached in the context, a runner finds the outputs of its
+/// inputs there and is never run twice. Rows output on helper threads are
+/// heap owned, the row slab allocator of the context only serves the
+/// calling thread. Rows are shared and released across threads, so runners
+/// only run on helpers if the context counts references atomically.
+class RunnerExecutor {
+ public:
+    /// Run `root` with `ctx` and return its output, run serially if the
+    /// context has a single runner worker, does not count references
+    /// atomically, or the DAG is a chain.
+    static std::shared_ptr<DataHandler> Run(Runner* root,
+                                            RunnerContext& ctx);  // NOLINT
+
+ private:
+    struct Node {
+        Runner* runner = nullptr;
+        size_t pending = 0;
+        std::vector<size_t> consumers;
+    };
+    struct DagState {
+        std::mutex mu;
+        std::condition_variable cond;
+        std::vector<Node> nodes;
+        std::deque<size_t> ready;
+        bool done = false;
+    };
+    // collect runners reachable from root into `nodes`, root is the first,
+    // return false if no runner has more than one input
+    static bool BuildGraph(Runner* root, std::vector<Node>* nodes);
+    // run ready runners of `state` until the root is run
+    static void WorkLoop(DagState* state, RunnerContext* ctx);
+    static base::BoundedThreadPool& GetHelperPool();
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // SRC_VM_RUNNER_EXECUTOR_H_
@@ -14,7 +14,13 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <memory>
+#include <mutex>  // NOLINT
+#include <set>
+#include <thread>  // NOLINT
 #include <utility>
 #include "boost/algorithm/string.hpp"
 #include "case/sql_case.h"
@@ -34,6 +40,7 @@
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "plan/plan_api.h"
 #include "testing/test_base.h"
+#include "vm/runner_executor.h"
 #include "vm/sql_compiler.h"
 
 using namespace llvm;       // NOLINT
@@ -410,6 +417,240 @@ TEST_F(RunnerTest, RunnerPrintDataMemTimeTableTest) {
         LOG(INFO) << oss.str();
     }
 }
+
+// runner outputs its input, or an empty table if it has no input, counting
+// the times it is run. Runners with a latch wait until all of the runners
+// sharing the latch are running
+class CountRunner : public Runner {
+ public:
+    CountRunner(int32_t id, std::atomic<int>* latch)
+        : Runner(id), run_cnt_(0), overlapped_(false), latch_(latch) {}
+    std::shared_ptr<DataHandler> Run(
+        RunnerContext& ctx,  // NOLINT
+        const std::vector<std::shared_ptr<DataHandler>>& inputs) override {
+        run_cnt_++;
+        if (nullptr != latch_) {
+            latch_->fetch_sub(1);
+            auto deadline =
+                std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (latch_->load() > 0 &&
+                   std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+            overlapped_ = latch_->load() <= 0;
+        }
+        if (inputs.empty()) {
+            return std::make_shared<MemTableHandler>();
+        }
+        return inputs[0];
+    }
+    std::atomic<int> run_cnt_;
+    std::atomic<bool> overlapped_;
+
+ private:
+    std::atomic<int>* latch_;
+};
+
+TEST_F(RunnerTest, RunnerExecutorOverlapBranchesTest) {
+    std::atomic<int> latch(2);
+    CountRunner leaf(0, nullptr);
+    CountRunner left(1, &latch);
+    CountRunner right(2, &latch);
+    CountRunner root(3, nullptr);
+    left.AddProducer(&leaf);
+    right.AddProducer(&leaf);
+    root.AddProducer(&left);
+    root.AddProducer(&right);
+
+    RunnerContext ctx(nullptr, Row(), Row());
+    ctx.SetRunnerWorkers(2);
+    ctx.EnableAtomicRefCount();
+    auto output = RunnerExecutor::Run(&root, ctx);
+    ASSERT_TRUE(output != nullptr);
+    ASSERT_EQ(output, ctx.GetCache(leaf.id_));
+    ASSERT_EQ(1, leaf.run_cnt_.load());
+    ASSERT_EQ(1, left.run_cnt_.load());
+    ASSERT_EQ(1, right.run_cnt_.load());
+    ASSERT_EQ(1, root.run_cnt_.load());
+    ASSERT_TRUE(left.overlapped_.load());
+    ASSERT_TRUE(right.overlapped_.load());
+}
+
+TEST_F(RunnerTest, RunnerExecutorSerialTest) {
+    CountRunner leaf(0, nullptr);
+    CountRunner left(1, nullptr);
+    CountRunner right(2, nullptr);
+    CountRunner root(3, nullptr);
+    left.AddProducer(&leaf);
+    right.AddProducer(&leaf);
+    root.AddProducer(&left);
+    root.AddProducer(&right);
+
+    // leaf is not cached, so it is run by both branches
+    RunnerContext ctx(nullptr, Row(), Row());
+    auto output = RunnerExecutor::Run(&root, ctx);
+    ASSERT_TRUE(output != nullptr);
+    ASSERT_EQ(2, leaf.run_cnt_.load());
+    ASSERT_EQ(1, root.run_cnt_.load());
+}
+
+// runner outputs an empty table and records the thread it is run on
+class ThreadIdRunner : public Runner {
+ public:
+    ThreadIdRunner(int32_t id, std::mutex* mu,
+                   std::set<std::thread::id>* thread_ids)
+        : Runner(id), mu_(mu), thread_ids_(thread_ids) {}
+    std::shared_ptr<DataHandler> Run(
+        RunnerContext& ctx,  // NOLINT
+        const std::vector<std::shared_ptr<DataHandler>>& inputs) override {
+        std::lock_guard<std::mutex> lock(*mu_);
+        thread_ids_->insert(std::this_thread::get_id());
+        return std::make_shared<MemTableHandler>();
+    }
+
+ private:
+    std::mutex* mu_;
+    std::set<std::thread::id>* thread_ids_;
+};
+
+// helpers come from a process-wide pool instead of being created per run
+TEST_F(RunnerTest, RunnerExecutorReuseHelpersTest) {
+    std::mutex mu;
+    std::set<std::thread::id> thread_ids;
+    for (int i = 0; i < 64; i++) {
+        ThreadIdRunner leaf(0, &mu, &thread_ids);
+        ThreadIdRunner left(1, &mu, &thread_ids);
+        ThreadIdRunner right(2, &mu, &thread_ids);
+        CountRunner root(3, nullptr);
+        left.AddProducer(&leaf);
+        right.AddProducer(&leaf);
+        root.AddProducer(&left);
+        root.AddProducer(&right);
+
+        RunnerContext ctx(nullptr, Row(), Row());
+        ctx.SetRunnerWorkers(2);
+        ctx.EnableAtomicRefCount();
+        ASSERT_TRUE(RunnerExecutor::Run(&root, ctx) != nullptr);
+        ASSERT_EQ(1, root.run_cnt_.load());
+    }
+    size_t pool_size = std::max(std::thread::hardware_concurrency(), 4u);
+    ASSERT_LE(thread_ids.size(), pool_size + 1);
+}
+
+// runner outputs rows carved from a slab of its own
+class SlabRowsRunner : public Runner {
+ public:
+    explicit SlabRowsRunner(int32_t id) : Runner(id) {}
+    std::shared_ptr<DataHandler> Run(
+        RunnerContext& ctx,  // NOLINT
+        const std::vector<std::shared_ptr<DataHandler>>& inputs) override {
+        base::SlabAllocator allocator(4096);
+        auto table = std::make_shared<MemTableHandler>();
+        for (int i = 0; i < 100; i++) {
+            auto buf = allocator.Alloc(16);
+            snprintf(reinterpret_cast<char*>(buf), 16, "row %d", i);
+            table->AddRow(Row(base::SlabAllocator::CreateSlice(buf, 16)));
+        }
+        return table;
+    }
+};
+
+// runner copies rows of its input table over and over, copies are released
+// while the other consumer of the same input does the same
+class CopyRowsRunner : public Runner {
+ public:
+    CopyRowsRunner(int32_t id, std::atomic<int>* latch)
+        : Runner(id), latch_(latch) {}
+    std::shared_ptr<DataHandler> Run(
+        RunnerContext& ctx,  // NOLINT
+        const std::vector<std::shared_ptr<DataHandler>>& inputs) override {
+        latch_->fetch_sub(1);
+        auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (latch_->load() > 0 &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        auto input = std::dynamic_pointer_cast<TableHandler>(inputs[0]);
+        std::shared_ptr<MemTableHandler> output;
+        for (int round = 0; round < 100; round++) {
+            output = std::make_shared<MemTableHandler>();
+            auto iter = input->GetIterator();
+            iter->SeekToFirst();
+            while (iter->Valid()) {
+                output->AddRow(iter->GetValue());
+                iter->Next();
+            }
+        }
+        return output;
+    }
+
+ private:
+    std::atomic<int>* latch_;
+};
+
+// two consumers on helper threads share the cached output of a producer,
+// build with -fsanitize=thread to check ref counts of rows and slabs
+TEST_F(RunnerTest, RunnerExecutorSharedProducerTest) {
+    std::atomic<int> latch(2);
+    SlabRowsRunner producer(0);
+    CopyRowsRunner left(1, &latch);
+    CopyRowsRunner right(2, &latch);
+    CountRunner root(3, nullptr);
+    left.AddProducer(&producer);
+    right.AddProducer(&producer);
+    root.AddProducer(&left);
+    root.AddProducer(&right);
+
+    std::shared_ptr<DataHandler> output;
+    {
+        RunnerContext ctx(nullptr, Row(), Row());
+        ctx.SetRunnerWorkers(4);
+        ctx.EnableAtomicRefCount();
+        ctx.EnableRowSlabAllocator();
+        output = RunnerExecutor::Run(&root, ctx);
+    }
+    ASSERT_FALSE(base::RefCountedSlice::IsAtomicRefCount());
+    auto table = std::dynamic_pointer_cast<TableHandler>(output);
+    ASSERT_TRUE(table != nullptr);
+    ASSERT_EQ(100u, table->GetCount());
+    ASSERT_EQ(0, strcmp(reinterpret_cast<char*>(table->At(42).buf()),
+                        "row 42"));
+}
+
+// consumers on helper threads share managed rows of the catalog, which are
+// created before the run, build with -fsanitize=thread to check ref counts
+TEST_F(RunnerTest, RunnerExecutorSharedCatalogRowsTest) {
+    auto catalog_table = std::make_shared<MemTableHandler>();
+    for (int i = 0; i < 100; i++) {
+        auto buf = reinterpret_cast<int8_t*>(malloc(16));
+        snprintf(reinterpret_cast<char*>(buf), 16, "row %d", i);
+        catalog_table->AddRow(
+            Row(base::RefCountedSlice::CreateManaged(buf, 16)));
+    }
+    std::atomic<int> latch(2);
+    DataRunner producer(0, nullptr, catalog_table);
+    CopyRowsRunner left(1, &latch);
+    CopyRowsRunner right(2, &latch);
+    CountRunner root(3, nullptr);
+    left.AddProducer(&producer);
+    right.AddProducer(&producer);
+    root.AddProducer(&left);
+    root.AddProducer(&right);
+
+    std::shared_ptr<DataHandler> output;
+    {
+        RunnerContext ctx(nullptr, Row(), Row());
+        ctx.SetRunnerWorkers(4);
+        ctx.EnableAtomicRefCount();
+        output = RunnerExecutor::Run(&root, ctx);
+    }
+    auto table = std::dynamic_pointer_cast<TableHandler>(output);
+    ASSERT_TRUE(table != nullptr);
+    ASSERT_EQ(100u, table->GetCount());
+    ASSERT_EQ(0, strcmp(reinterpret_cast<char*>(table->At(42).buf()),
+                        "row 42"));
+}
 }  // namespace vm
 }  // namespace hybridse
 
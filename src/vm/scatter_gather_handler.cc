@@ -0,0 +1,141 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/scatter_gather_handler.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include "base/bounded_thread_pool.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DECLARE_int32(scatter_gather_io_worker_num);
+
+namespace hybridse {
+namespace vm {
+
+// parts block on tablets rather than cpu, so they are waited on by a pool of
+// their own instead of the cpu bound executors
+static base::BoundedThreadPool& GetIOPool() {
+    static base::BoundedThreadPool pool(
+        std::max(FLAGS_scatter_gather_io_worker_num, 1), 4096);
+    return pool;
+}
+
+// parts are claimed one by one by the calling thread and pool tasks. Tasks
+// may start after the sync is over, they find no part left and only touch
+// this state
+struct SyncPartsState {
+    std::atomic<size_t> next{0};
+    std::mutex mu;
+    std::condition_variable cond;
+    size_t done_cnt = 0;
+};
+
+static void SyncParts(SyncPartsState* state, size_t part_cnt,
+                      const std::function<void(size_t)>& sync_part) {
+    while (true) {
+        size_t idx = state->next.fetch_add(1);
+        if (idx >= part_cnt) {
+            return;
+        }
+        sync_part(idx);
+        std::lock_guard<std::mutex> lock(state->mu);
+        if (++state->done_cnt == part_cnt) {
+            state->cond.notify_all();
+        }
+    }
+}
+
+base::Status ScatterGatherTableHandler::SyncValue() {
+    DLOG(INFO) << "Gather subquery results from " << parts_.size()
+               << " tablets";
+    std::function<void(size_t)> sync_part = [this](size_t idx) {
+        if (parts_[idx]) {
+            // force the lazy part to run its subquery
+            parts_[idx]->GetCount();
+        }
+    };
+    if (parallel_ && parts_.size() > 1) {
+        // parts share request rows and output rows created on pool threads
+        // are released on other threads, so rows are counted atomically
+        auto state = std::make_shared<SyncPartsState>();
+        size_t part_cnt = parts_.size();
+        for (size_t i = 1; i < part_cnt; ++i) {
+            // the calling thread takes the parts left if the pool is full
+            if (!GetIOPool().Submit([state, part_cnt, sync_part]() {
+                    base::AtomicRefCountScope atomic_scope;
+                    SyncParts(state.get(), part_cnt, sync_part);
+                })) {
+                break;
+            }
+        }
+        {
+            base::AtomicRefCountScope atomic_scope;
+            SyncParts(state.get(), part_cnt, sync_part);
+        }
+        // wait for the parts still synced by pool threads
+        std::unique_lock<std::mutex> lock(state->mu);
+        state->cond.wait(lock, [&state, part_cnt]() {
+            return state->done_cnt == part_cnt;
+        });
+    } else {
+        for (size_t idx = 0; idx < parts_.size(); ++idx) {
+            sync_part(idx);
+        }
+    }
+
+    std::vector<uint64_t> part_rows(parts_.size(), 0);
+    for (auto& location : locations_) {
+        if (location.first >= parts_.size()) {
+            return base::Status(common::kCallMethodError,
+                                "sub query fail: invalid row location");
+        }
+        part_rows[location.first] += 1;
+    }
+    for (size_t idx = 0; idx < parts_.size(); ++idx) {
+        auto& part = parts_[idx];
+        if (!part) {
+            return base::Status(common::kCallMethodError,
+                                "sub query fail: tablet result is null");
+        }
+        auto status = part->GetStatus();
+        if (!status.isOK()) {
+            LOG(WARNING) << "sub query fail: " << status;
+            return status;
+        }
+        // a request row yields exactly one output row
+        if (part->GetCount() != part_rows[idx]) {
+            LOG(WARNING) << "sub query fail: tablet result has "
+                         << part->GetCount() << " rows but "
+                         << part_rows[idx] << " requests";
+            return base::Status(common::kCallMethodError,
+                                "sub query fail: tablet result rows mismatch "
+                                "request rows");
+        }
+    }
+    Resize(locations_.size());
+    for (size_t pos = 0; pos < locations_.size(); ++pos) {
+        auto& location = locations_[pos];
+        SetRow(pos, parts_[location.first]->At(location.second));
+    }
+    return base::Status::OK();
+}
+}  // namespace vm
+}  // namespace hybridse
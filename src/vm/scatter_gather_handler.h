@@ -0,0 +1,89 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_VM_SCATTER_GATHER_HANDLER_H_
+#define SRC_VM_SCATTER_GATHER_HANDLER_H_
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "vm/mem_catalog.h"
+namespace hybridse {
+namespace vm {
+
+/// \brief Result of a batch request subquery scattered to several tablets.
+///
+/// Each part is the result table of one tablet subquery, rows of the
+/// requests are located by (part index, position in part). Parts are synced
+/// on first access and gathered in request order. They are synced in
+/// parallel if `parallel` is set, which requires rows of the run to count
+/// references atomically, see `RunnerContext::EnableAtomicRefCount`.
+class ScatterGatherTableHandler : public MemTableHandler {
+ public:
+    typedef std::pair<size_t, size_t> RowLocation;
+    ScatterGatherTableHandler(
+        const std::vector<std::shared_ptr<TableHandler>>& parts,
+        const std::vector<RowLocation>& locations, bool parallel)
+        : MemTableHandler(),
+          status_(base::Status::Running()),
+          parts_(parts),
+          locations_(locations),
+          parallel_(parallel) {}
+    ~ScatterGatherTableHandler() {}
+    Row At(uint64_t pos) override {
+        if (status_.isRunning()) {
+            status_ = SyncValue();
+        }
+        return MemTableHandler::At(pos);
+    }
+    std::unique_ptr<RowIterator> GetIterator() override {
+        if (status_.isRunning()) {
+            status_ = SyncValue();
+        }
+        return MemTableHandler::GetIterator();
+    }
+    RowIterator* GetRawIterator() override {
+        if (status_.isRunning()) {
+            status_ = SyncValue();
+        }
+        return MemTableHandler::GetRawIterator();
+    }
+    const uint64_t GetCount() override {
+        if (status_.isRunning()) {
+            status_ = SyncValue();
+        }
+        return MemTableHandler::GetCount();
+    }
+    base::Status GetStatus() override {
+        if (status_.isRunning()) {
+            status_ = SyncValue();
+        }
+        return status_;
+    }
+    const std::string GetHandlerTypeName() override {
+        return "ScatterGatherTableHandler";
+    }
+
+ private:
+    base::Status SyncValue();
+    base::Status status_;
+    std::vector<std::shared_ptr<TableHandler>> parts_;
+    std::vector<RowLocation> locations_;
+    const bool parallel_;
+};
+}  // namespace vm
+}  // namespace hybridse
+#endif  // SRC_VM_SCATTER_GATHER_HANDLER_H_
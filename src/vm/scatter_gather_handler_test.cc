@@ -0,0 +1,148 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/scatter_gather_handler.h"
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace vm {
+using hybridse::codec::Row;
+
+class ScatterGatherHandlerTest : public ::testing::Test {
+ public:
+    ScatterGatherHandlerTest() {}
+    ~ScatterGatherHandlerTest() {}
+};
+
+static Row MakeRow(const std::string& str) {
+    auto buf = base::RefCountedSlice::AllocInline(str.size());
+    memcpy(buf, str.data(), str.size());
+    return Row(base::RefCountedSlice::CreateManagedInline(buf, str.size()));
+}
+
+static std::shared_ptr<TableHandler> MakePart(
+    const std::vector<std::string>& values) {
+    auto part = std::make_shared<MemTableHandler>();
+    for (auto& value : values) {
+        part->AddRow(MakeRow(value));
+    }
+    return part;
+}
+
+TEST_F(ScatterGatherHandlerTest, GatherInRequestOrder) {
+    for (bool parallel : {false, true}) {
+        base::AtomicRefCountScope atomic_scope(parallel);
+        std::vector<std::shared_ptr<TableHandler>> parts = {
+            MakePart({"a0", "a1"}), MakePart({"b0"}), MakePart({"c0"})};
+        std::vector<ScatterGatherTableHandler::RowLocation> locations = {
+            {1, 0}, {0, 0}, {2, 0}, {0, 1}};
+        ScatterGatherTableHandler handler(parts, locations, parallel);
+        ASSERT_TRUE(handler.GetStatus().isOK());
+        ASSERT_EQ(4u, handler.GetCount());
+        std::vector<std::string> expect = {"b0", "a0", "c0", "a1"};
+        for (size_t pos = 0; pos < expect.size(); ++pos) {
+            ASSERT_EQ(expect[pos], handler.At(pos).ToString());
+        }
+    }
+}
+
+TEST_F(ScatterGatherHandlerTest, PartShortOfRows) {
+    for (bool parallel : {false, true}) {
+        base::AtomicRefCountScope atomic_scope(parallel);
+        std::vector<std::shared_ptr<TableHandler>> parts = {
+            MakePart({"a0"}), MakePart({"b0"})};
+        std::vector<ScatterGatherTableHandler::RowLocation> locations = {
+            {0, 0}, {1, 0}, {0, 1}};
+        ScatterGatherTableHandler handler(parts, locations, parallel);
+        ASSERT_FALSE(handler.GetStatus().isOK());
+    }
+}
+
+// part waits until all of the parts sharing its latch are synced, like
+// subqueries waiting on tablets
+class LatchPart : public MemTableHandler {
+ public:
+    explicit LatchPart(std::atomic<int>* latch)
+        : MemTableHandler(), latch_(latch), overlapped_(false) {
+        AddRow(MakeRow("row"));
+    }
+    const uint64_t GetCount() override {
+        if (!synced_) {
+            synced_ = true;
+            latch_->fetch_sub(1);
+            auto deadline =
+                std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (latch_->load() > 0 &&
+                   std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+            overlapped_ = latch_->load() <= 0;
+        }
+        return MemTableHandler::GetCount();
+    }
+    std::atomic<int>* latch_;
+    std::atomic<bool> overlapped_;
+    bool synced_ = false;
+};
+
+// parts of concurrent gathers all wait on tablets at the same time
+TEST_F(ScatterGatherHandlerTest, ConcurrentGathersOverlap) {
+    const size_t gather_cnt = 2;
+    const size_t part_cnt = 4;
+    std::atomic<int> latch(gather_cnt * part_cnt);
+    std::vector<std::shared_ptr<LatchPart>> all_parts;
+    std::vector<std::thread> threads;
+    std::atomic<int> ok_cnt(0);
+    for (size_t i = 0; i < gather_cnt; ++i) {
+        std::vector<std::shared_ptr<TableHandler>> parts;
+        std::vector<ScatterGatherTableHandler::RowLocation> locations;
+        for (size_t idx = 0; idx < part_cnt; ++idx) {
+            auto part = std::make_shared<LatchPart>(&latch);
+            all_parts.push_back(part);
+            parts.push_back(part);
+            locations.push_back({idx, 0});
+        }
+        threads.emplace_back([parts, locations, &ok_cnt]() {
+            base::AtomicRefCountScope atomic_scope;
+            ScatterGatherTableHandler handler(parts, locations, true);
+            if (handler.GetStatus().isOK() &&
+                locations.size() == handler.GetCount()) {
+                ok_cnt++;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(static_cast<int>(gather_cnt), ok_cnt.load());
+    for (auto& part : all_parts) {
+        ASSERT_TRUE(part->overlapped_.load());
+    }
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -16,6 +16,8 @@
 
 #include "vm/sql_compiler.h"
 #include <memory>
+#include <sstream>
+#include <string>
 #include <utility>
 #include <vector>
 #include "boost/filesystem.hpp"
@@ -30,6 +32,8 @@
 #include "llvm/Support/raw_ostream.h"
 #include "plan/plan_api.h"
 #include "udf/default_udf_library.h"
+#include "udf/udf_bitcode.h"
+#include "vm/jit_object_cache.h"
 #include "vm/runner.h"
 #include "vm/transform.h"
 
@@ -60,6 +64,25 @@ void SqlCompiler::KeepIR(SqlContext& ctx, llvm::Module* m) {
     LOG(INFO) << "keep ir length: " << ctx.ir.size();
 }
 
+// compile inputs of a sql besides its ir for the object cache key
+static std::string GetObjectCacheInfo(const SqlContext& ctx) {
+    std::stringstream ss;
+    ss << "db: " << ctx.db << "\nmode: " << EngineModeName(ctx.engine_mode)
+       << "\nperformance_sensitive: " << ctx.is_performance_sensitive
+       << "\ncluster_optimized: " << ctx.is_cluster_optimized
+       << "\nbatch_request_optimized: " << ctx.is_batch_request_optimized
+       << "\nenable_expr_optimize: " << ctx.enable_expr_optimize
+       << "\nopt_level: " << ctx.jit_options.opt_level()
+       << "\nhost_cpu_features: " << ctx.jit_options.is_enable_host_cpu_features()
+       << "\nudf_bitcode: " << ctx.jit_options.is_enable_udf_bitcode()
+       << "\nparameters:";
+    for (const auto& column : ctx.parameter_types) {
+        ss << " " << column.ShortDebugString();
+    }
+    ss << "\nsql: " << ctx.sql;
+    return ss.str();
+}
+
 bool SqlCompiler::Compile(SqlContext& ctx, Status& status) {  // NOLINT
     bool ok = Parse(ctx, status);
     if (!ok) {
@@ -122,8 +145,24 @@ bool SqlCompiler::Compile(SqlContext& ctx, Status& status) {  // NOLINT
         LOG(WARNING) << status;
         return false;
     }
-    InitBuiltinJitSymbols(jit.get());
-    ctx.udf_library->InitJITSymbols(jit.get());
+    if (!jit->IsSharedSession()) {
+        InitBuiltinJitSymbols(jit.get());
+        ctx.udf_library->InitJITSymbols(jit.get());
+    } else if (ctx.udf_library != udf::DefaultUdfLibrary::get()) {
+        // shared session only holds symbols of default udf library
+        ctx.udf_library->InitJITSymbols(jit.get());
+    }
+    if (ctx.jit_options.is_enable_udf_bitcode()) {
+        // udfs without bitcode are still resolved by jit symbols
+        if (udf::LinkUdfBitcode(m.get())) {
+            DLOG(INFO) << "link udf bitcode for sql " << ctx.sql;
+        }
+    }
+    if (!ctx.jit_options.object_cache_dir().empty()) {
+        // named by cache key so the compiled object can be reused
+        m->setModuleIdentifier(
+            JitObjectCache::ComputeKey(GetObjectCacheInfo(ctx), *m));
+    }
     if (!jit->OptModule(m.get())) {
         LOG(WARNING) << "fail to opt ir module for sql " << ctx.sql;
         return false;
@@ -380,6 +419,11 @@ bool SqlCompiler::ResolvePlanFnAddress(vm::PhysicalOpNode* node,
                                  << *node;
                 }
                 const_cast<FnInfo*>(info_ptr)->SetFnPtr(addr);
+                if (IsTableProjectNode(node) &&
+                    info_ptr->SupportBatchProject()) {
+                    const_cast<FnInfo*>(info_ptr)->SetBatchFnPtr(
+                        jit->FindFunction(info_ptr->batch_fn_name()));
+                }
             }
         }
     }
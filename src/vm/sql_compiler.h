@@ -44,6 +44,12 @@ struct SqlContext {
     bool is_batch_request_optimized = false;
     bool enable_expr_optimize = false;
     bool enable_batch_window_parallelization = false;
+    bool enable_row_slab_allocator = false;
+    bool enable_hash_partition = false;
+    bool enable_atomic_ref_count = false;
+    uint32_t batch_window_agg_worker_num = 1;
+    bool enable_batch_window_agg_ordered = true;
+    uint32_t request_runner_worker_num = 1;
 
     // the sql content
     std::string sql;
@@ -320,7 +320,7 @@ Status BatchModeTransformer::InitFnInfo(PhysicalOpNode* node,
         if (fn_info->fn_name().empty()) {
             continue;
         }
-        CHECK_STATUS(InstantiateLLVMFunction(*fn_infos[i]), "Instantiate ", i,
+        CHECK_STATUS(InstantiateLLVMFunction(*fn_infos[i], IsTableProjectNode(node)), "Instantiate ", i,
                      "th native function \"", fn_info->fn_name(),
                      "\" failed at node:\n", node->GetTreeString());
     }
@@ -941,12 +941,16 @@ Status ExtractProjectInfos(const node::PlanNodeList& projects,
     return Status::OK();
 }
 
-Status BatchModeTransformer::InstantiateLLVMFunction(const FnInfo& fn_info) {
+Status BatchModeTransformer::InstantiateLLVMFunction(const FnInfo& fn_info, bool table_project) {
     CHECK_TRUE(fn_info.IsValid(), kCodegenError, "Fail to install llvm function, function info is invalid");
     codegen::CodeGenContext codegen_ctx(module_, fn_info.schemas_ctx(), plan_ctx_.parameter_types(), node_manager_);
     codegen::RowFnLetIRBuilder builder(&codegen_ctx);
-    return builder.Build(fn_info.fn_name(), fn_info.fn_def(), fn_info.GetPrimaryFrame(), fn_info.GetFrames(),
-                         *fn_info.fn_schema());
+    CHECK_STATUS(builder.Build(fn_info.fn_name(), fn_info.fn_def(), fn_info.GetPrimaryFrame(), fn_info.GetFrames(),
+                               *fn_info.fn_schema()));
+    if (table_project && fn_info.SupportBatchProject()) {
+        CHECK_STATUS(builder.BuildBatch(fn_info.batch_fn_name(), fn_info.fn_name()));
+    }
+    return Status::OK();
 }
 
 bool BatchModeTransformer::AddDefaultPasses() {
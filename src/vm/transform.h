@@ -205,9 +205,10 @@ class BatchModeTransformer {
     Status GenFnDef(const node::FuncDefPlanNode* fn_plan);
 
     /**
-     * Instantiate underlying llvm function with specified fn info.
+     * Instantiate underlying llvm function with specified fn info, and
+     * its batch entry too if it belongs to a table project.
      */
-    Status InstantiateLLVMFunction(const FnInfo& fn_info);
+    Status InstantiateLLVMFunction(const FnInfo& fn_info, bool table_project);
 
     Status GenWindowJoinList(PhysicalWindowAggrerationNode* window_agg_op,
                              PhysicalOpNode* in);
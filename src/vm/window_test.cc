@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <cmath>
+#include <limits>
 #include <utility>
 #include "codec/list_iterator_codec.h"
 #include "gtest/gtest.h"
@@ -253,6 +255,249 @@ TEST_F(WindowIteratorTest, MemGetColTest) {
     //    delete (column);
 }
 
+static std::vector<uint64_t> GetDeltaKeys(vm::Window* window,
+                                           bool is_retract) {
+    std::vector<uint64_t> keys;
+    std::unique_ptr<RowIterator> iter(window->GetRawDeltaIterator(is_retract));
+    iter->SeekToFirst();
+    while (iter->Valid()) {
+        keys.push_back(iter->GetKey());
+        iter->Next();
+    }
+    return keys;
+}
+
+TEST_F(WindowIteratorTest, WindowAggStateDeltaTest) {
+    int8_t* ptr = reinterpret_cast<int8_t*>(malloc(28));
+    *(reinterpret_cast<int32_t*>(ptr + 2)) = 1;
+    *(reinterpret_cast<int64_t*>(ptr + 2 + 4)) = 1;
+    // managed slice, freed once the window drops the last row
+    Row row(base::RefCountedSlice::CreateManaged(ptr, 28));
+
+    vm::CurrentHistoryWindow window(vm::Window::kFrameRowsRange, -1000L, 0);
+    int key = 0;
+    bool is_delta = true;
+    window.BufferData(1L, row);
+    int8_t* state = window.GetAggState(&key, 16, &is_delta);
+    ASSERT_TRUE(state != nullptr);
+    ASSERT_FALSE(is_delta);
+
+    window.BufferData(2L, row);
+    ASSERT_EQ(state, window.GetAggState(&key, 16, &is_delta));
+    ASSERT_TRUE(is_delta);
+    ASSERT_EQ(std::vector<uint64_t>({2L}), GetDeltaKeys(&window, false));
+    ASSERT_EQ(std::vector<uint64_t>(), GetDeltaKeys(&window, true));
+
+    // rows accumulate until states consume them, row 3 enters and leaves
+    window.BufferData(3L, row);
+    window.BufferData(1500L, row);
+    ASSERT_EQ(1u, window.GetCount());
+    window.GetAggState(&key, 16, &is_delta);
+    ASSERT_TRUE(is_delta);
+    ASSERT_EQ(std::vector<uint64_t>({1500L}), GetDeltaKeys(&window, false));
+    ASSERT_EQ(std::vector<uint64_t>({1L, 2L}), GetDeltaKeys(&window, true));
+
+    // state requested twice in the same step should be recomputed
+    window.GetAggState(&key, 16, &is_delta);
+    ASSERT_FALSE(is_delta);
+
+    // popping front can not be applied incrementally
+    window.BufferData(1600L, row);
+    window.PopFrontData();
+    window.BufferData(1700L, row);
+    window.GetAggState(&key, 16, &is_delta);
+    ASSERT_FALSE(is_delta);
+    window.BufferData(1800L, row);
+    window.GetAggState(&key, 16, &is_delta);
+    ASSERT_TRUE(is_delta);
+}
+
+static int window_agg_state_released = 0;
+static void ReleaseWindowAggState(int8_t* state) {
+    window_agg_state_released += 1;
+}
+
+TEST_F(WindowIteratorTest, WindowAggStateReleaseTest) {
+    int8_t* ptr = reinterpret_cast<int8_t*>(malloc(28));
+    Row row(base::RefCountedSlice::CreateManaged(ptr, 28));
+    window_agg_state_released = 0;
+    {
+        vm::CurrentHistoryWindow window(vm::Window::kFrameRowsRange, -1000L,
+                                        0);
+        int key = 0;
+        bool is_delta = true;
+        window.BufferData(1L, row);
+        window.GetAggState(&key, 8, &is_delta, ReleaseWindowAggState);
+        ASSERT_FALSE(is_delta);
+        ASSERT_EQ(0, window_agg_state_released);
+
+        // state in sync is kept, rows changed are listed
+        window.BufferData(2L, row);
+        window.BufferData(1500L, row);
+        window.GetAggState(&key, 8, &is_delta, ReleaseWindowAggState);
+        ASSERT_TRUE(is_delta);
+        ASSERT_EQ(0, window_agg_state_released);
+        ASSERT_EQ(1u, window.GetDeltaList(false)->GetCount());
+        ASSERT_EQ(1u, window.GetDeltaList(true)->GetCount());
+        ASSERT_EQ(std::vector<uint64_t>({1500L}),
+                  GetDeltaKeys(&window, false));
+
+        // state to be recomputed is released first
+        window.GetAggState(&key, 8, &is_delta, ReleaseWindowAggState);
+        ASSERT_FALSE(is_delta);
+        ASSERT_EQ(1, window_agg_state_released);
+    }
+    // states left are released with window
+    ASSERT_EQ(2, window_agg_state_released);
+}
+
+TEST_F(WindowIteratorTest, WindowAggQueueTest) {
+    int8_t* ptr = reinterpret_cast<int8_t*>(malloc(28));
+    Row row(base::RefCountedSlice::Create(ptr, 28));
+    vm::CurrentHistoryWindow window(vm::Window::kFrameRowsRange, -1000L, 0);
+    int key = 0;
+    bool is_delta = true;
+    window.BufferData(1L, row);
+    window.GetAggState(&key, 8, &is_delta);
+    auto min_queue = window.GetAggQueue<int64_t>(&key, 0, true, true);
+    auto max_queue = window.GetAggQueue<int64_t>(&key, 1, false, true);
+    ASSERT_TRUE(min_queue->Empty());
+
+    // entered rows are kept in the order they entered
+    window.BufferData(2L, row);
+    window.BufferData(3L, row);
+    window.GetAggState(&key, 8, &is_delta);
+    ASSERT_TRUE(is_delta);
+    ASSERT_EQ(std::vector<uint64_t>({2L, 3L}), GetDeltaKeys(&window, false));
+    ASSERT_EQ(min_queue, window.GetAggQueue<int64_t>(&key, 0, true, false));
+
+    // sliding window 5 3 4 | 1 | 2 with rows of 3 values
+    std::vector<int64_t> values = {5, 3, 4, 1, 2, 2};
+    std::vector<int64_t> mins = {5, 3, 3, 1, 1, 1};
+    std::vector<int64_t> maxs = {5, 5, 5, 4, 4, 2};
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i >= 3) {
+            min_queue->Pop(values[i - 3]);
+            max_queue->Pop(values[i - 3]);
+        }
+        min_queue->Push(values[i]);
+        max_queue->Push(values[i]);
+        ASSERT_EQ(mins[i], min_queue->Front());
+        ASSERT_EQ(maxs[i], max_queue->Front());
+    }
+
+    // rebuild from newest to oldest gives the same heads
+    min_queue = window.GetAggQueue<int64_t>(&key, 0, true, true);
+    ASSERT_TRUE(min_queue->Empty());
+    min_queue->PushFront(2);
+    min_queue->PushFront(1);
+    min_queue->PushFront(4);
+    ASSERT_EQ(1, min_queue->Front());
+    min_queue->Pop(4);
+    min_queue->Pop(1);
+    ASSERT_EQ(2, min_queue->Front());
+}
+
+// row with a nullable int32 column 0 at offset 8
+static Row BuildInt32Row(int32_t value, bool is_null) {
+    int8_t* ptr = reinterpret_cast<int8_t*>(calloc(16, 1));
+    if (is_null) {
+        ptr[codec::v1::HEADER_LENGTH] = 1;
+    }
+    *(reinterpret_cast<int32_t*>(ptr + 8)) = value;
+    return Row(base::RefCountedSlice::CreateManaged(ptr, 16));
+}
+
+static std::vector<int32_t> GetColumnValues(WindowColumn<int32_t>* column) {
+    return std::vector<int32_t>(column->values(),
+                                column->values() + column->size());
+}
+
+TEST_F(WindowIteratorTest, WindowColumnTest) {
+    // rows window of 3 rows
+    vm::CurrentHistoryWindow window(vm::Window::kFrameRows, 0, 2, 0);
+    window.BufferData(1L, BuildInt32Row(5, false));
+    window.BufferData(2L, BuildInt32Row(3, true));
+
+    // column is built from window once requested, oldest first
+    auto column = window.GetColumn<int32_t>(0, 0, 8);
+    ASSERT_EQ(std::vector<int32_t>({5, 0}), GetColumnValues(column));
+    ASSERT_EQ(1u, column->null_cnt());
+    ASSERT_EQ(column, window.GetColumn<int32_t>(0, 0, 8));
+
+    // then kept in sync with rows entering and leaving
+    window.BufferData(3L, BuildInt32Row(7, false));
+    window.BufferData(4L, BuildInt32Row(-2, false));
+    ASSERT_EQ(std::vector<int32_t>({0, 7, -2}), GetColumnValues(column));
+    window.BufferData(5L, BuildInt32Row(4, false));
+    ASSERT_EQ(std::vector<int32_t>({7, -2, 4}), GetColumnValues(column));
+    ASSERT_EQ(0u, column->null_cnt());
+    window.PopFrontData();
+    ASSERT_EQ(std::vector<int32_t>({7, -2}), GetColumnValues(column));
+
+    // aggregate column list of window into udaf states
+    int8_t buf[sizeof(ColumnImpl<int32_t>)];
+    new (buf) ColumnImpl<int32_t>(&window, 0, 0, 8);
+    codec::ListRef<int32_t> list_ref;
+    list_ref.list = buf;
+    int8_t* input = reinterpret_cast<int8_t*>(&list_ref);
+    int32_t sum = 1;
+    ASSERT_EQ(0, WindowColumnSum<int32_t>(input, &sum));
+    ASSERT_EQ(6, sum);
+    int64_t cnt = 0;
+    ASSERT_EQ(0, WindowColumnCount<int32_t>(input, &cnt));
+    ASSERT_EQ(2, cnt);
+    bool is_empty = true;
+    int32_t min = INT32_MAX;
+    ASSERT_EQ(0, WindowColumnMin<int32_t>(input, &is_empty, &min));
+    ASSERT_FALSE(is_empty);
+    ASSERT_EQ(-2, min);
+    double avg_sum = 0;
+    cnt = 0;
+    ASSERT_EQ(0, WindowColumnAvg<int32_t>(input, &cnt, &avg_sum));
+    ASSERT_EQ(2, cnt);
+    ASSERT_DOUBLE_EQ(5.0, avg_sum);
+
+    // column list of other tables has to be iterated
+    vm::MemTimeTableHandler table;
+    table.AddRow(1L, BuildInt32Row(1, false));
+    new (buf) ColumnImpl<int32_t>(&table, 0, 0, 8);
+    ASSERT_EQ(-1, WindowColumnSum<int32_t>(input, &sum));
+}
+
+// row with a double column 0 at offset 8
+static Row BuildDoubleRow(double value) {
+    int8_t* ptr = reinterpret_cast<int8_t*>(calloc(16, 1));
+    *(reinterpret_cast<double*>(ptr + 8)) = value;
+    return Row(base::RefCountedSlice::CreateManaged(ptr, 16));
+}
+
+TEST_F(WindowIteratorTest, WindowColumnSignedZeroTest) {
+    // rows are folded from the newest one, which is kept among equal zeros
+    for (double other : {1.0, -1.0}) {
+        vm::CurrentHistoryWindow window(vm::Window::kFrameRows, 0, 2, 0);
+        window.BufferData(1L, BuildDoubleRow(other));
+        window.BufferData(2L, BuildDoubleRow(-0.0));
+        window.BufferData(3L, BuildDoubleRow(0.0));
+        int8_t buf[sizeof(ColumnImpl<double>)];
+        new (buf) ColumnImpl<double>(&window, 0, 0, 8);
+        codec::ListRef<double> list_ref;
+        list_ref.list = buf;
+        int8_t* input = reinterpret_cast<int8_t*>(&list_ref);
+        bool is_empty = true;
+        double value = 0;
+        if (other > 0) {
+            value = std::numeric_limits<double>::max();
+            ASSERT_EQ(0, WindowColumnMin<double>(input, &is_empty, &value));
+        } else {
+            value = std::numeric_limits<double>::lowest();
+            ASSERT_EQ(0, WindowColumnMax<double>(input, &is_empty, &value));
+        }
+        ASSERT_EQ(0.0, value);
+        ASSERT_FALSE(std::signbit(value));
+    }
+}
+
 TEST_F(WindowIteratorTest, CurrentHistoryWindowTest) {
     std::vector<std::pair<uint64_t, Row>> rows;
     int8_t* ptr = reinterpret_cast<int8_t*>(malloc(28));